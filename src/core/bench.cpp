@@ -0,0 +1,223 @@
+#include <pch.h>
+#include <core/bench.h>
+#include <core/json.h>
+
+#include <iomanip>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+static double MedianOf(std::vector<double> values)
+{
+	if (values.empty())
+		return 0.0;
+
+	const size_t mid = values.size() / 2;
+	std::nth_element(values.begin(), values.begin() + mid, values.end());
+
+	if (values.size() & 1)
+		return values[mid];
+
+	const double upper = values[mid];
+	const double lower = *std::max_element(values.begin(), values.begin() + mid);
+
+	return (lower + upper) * 0.5;
+}
+
+static double SecondsSince(const std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//
+// GetSourceRevision
+// Purpose: ask git for HEAD, first next to the executable (builds land inside the source tree), then in the working directory
+//
+std::string GetSourceRevision()
+{
+	std::vector<std::string> dirs;
+
+	char exePath[MAX_PATH];
+	const DWORD length = GetModuleFileNameA(nullptr, exePath, MAX_PATH);
+	if (length > 0 && length < MAX_PATH)
+		dirs.push_back(std::filesystem::path(exePath).parent_path().string());
+
+	dirs.push_back(".");
+
+	for (const std::string& dir : dirs)
+	{
+		const std::string command = "git -C \"" + dir + "\" rev-parse HEAD 2>nul";
+
+		FILE* const pPipe = _popen(command.c_str(), "r");
+		if (!pPipe)
+			continue;
+
+		char line[128] = {};
+		const bool read = fgets(line, sizeof(line), pPipe) != nullptr;
+		const int status = _pclose(pPipe);
+
+		std::string revision = read ? line : "";
+		while (!revision.empty() && isspace(static_cast<unsigned char>(revision.back())))
+			revision.pop_back();
+
+		if (status == 0 && revision.size() == 40)
+			return revision;
+	}
+
+	return "unknown";
+}
+
+//
+// RunBenchmarks
+// Purpose: one untimed warm up call per benchmark, then 'samples' timed samples
+//
+std::vector<s_benchresult_t> RunBenchmarks(const std::vector<s_benchmark_t>& benchmarks, const int samples)
+{
+	std::vector<s_benchresult_t> results;
+	results.reserve(benchmarks.size());
+
+	for (const s_benchmark_t& bench : benchmarks)
+	{
+		// warm up caches and the allocator, and see how long one call takes
+		auto start = std::chrono::steady_clock::now();
+		bench.fn();
+		const double warmupSeconds = SecondsSince(start);
+
+		int iterations = 1;
+		if (bench.calibrate)
+			iterations = static_cast<int>(min(ceil(BENCH_MIN_SAMPLE_SECONDS / max(warmupSeconds, 1e-9)), 1e6));
+
+		CParallelPool::Get().ResetPeakThreads();
+
+		std::vector<double> times(samples);
+		for (int i = 0; i < samples; i++)
+		{
+			start = std::chrono::steady_clock::now();
+			for (int it = 0; it < iterations; it++)
+				bench.fn();
+
+			times[i] = SecondsSince(start) / iterations;
+		}
+
+		s_benchresult_t result;
+		result.name = bench.name;
+		result.median = MedianOf(times);
+		result.samples = samples;
+		result.iterations = iterations;
+		result.threads = static_cast<int>(CParallelPool::Get().PeakThreads());
+
+		for (double& time : times)
+			time = fabs(time - result.median);
+
+		result.mad = MedianOf(times);
+
+		printf("  [BENCH] %-40s %12.3f us  (mad %.3f us, %d x %d, %d thread%s)\n", result.name.c_str(), result.median * 1e6, result.mad * 1e6, samples, iterations,
+			result.threads, result.threads == 1 ? "" : "s");
+
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+bool WriteBenchResults(const std::string& path, const s_benchinfo_t& info, const std::vector<s_benchresult_t>& results)
+{
+	std::ofstream ofs(path, std::ios::out | std::ios::binary);
+	if (!ofs.is_open())
+		return false;
+
+	ofs << std::setprecision(9);
+
+	ofs << "{\n";
+	ofs << "\t\"isa\": \"" << JsonEscape(info.isa) << "\",\n";
+	ofs << "\t\"revision\": \"" << JsonEscape(info.revision) << "\",\n";
+	ofs << "\t\"benchmarks\": [";
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const s_benchresult_t& result = results[i];
+
+		ofs << (i ? ",\n" : "\n");
+		ofs << "\t\t{ \"name\": \"" << JsonEscape(result.name) << "\", \"median\": " << result.median << ", \"mad\": " << result.mad
+			<< ", \"samples\": " << result.samples << ", \"iterations\": " << result.iterations << ", \"threads\": " << result.threads << " }";
+	}
+
+	ofs << "\n\t]\n}\n";
+
+	return ofs.good();
+}
+
+int CompareBenchBaseline(const std::string& path, const s_benchinfo_t& info, const std::vector<s_benchresult_t>& results, const double defaultThreshold)
+{
+	// scales a MAD to a standard deviation for normally distributed noise
+	constexpr double madToSigma = 1.4826;
+	constexpr double noiseSigmas = 3.0;
+
+	jsonvalue baseline;
+	std::string error;
+
+	if (!ReadJsonFile(path, baseline, error))
+	{
+		printf("ERROR: Could not read baseline '%s': %s\n", path.c_str(), error.c_str());
+		return -1;
+	}
+
+	const jsonvalue* const pBenchmarks = baseline.Find("benchmarks");
+	if (!pBenchmarks || !pBenchmarks->IsArray())
+	{
+		printf("ERROR: Baseline '%s' has no benchmarks array\n", path.c_str());
+		return -1;
+	}
+
+	const jsonvalue* const pIsa = baseline.Find("isa");
+	if (pIsa && pIsa->IsString() && pIsa->string != info.isa)
+		printf("WARNING: baseline was recorded with isa '%s', this run uses '%s'\n", pIsa->string.c_str(), info.isa.c_str());
+
+	int regressions = 0;
+
+	printf("\nBaseline: %s\n", path.c_str());
+	for (const s_benchresult_t& result : results)
+	{
+		const jsonvalue* pBase = nullptr;
+		for (const jsonvalue& entry : pBenchmarks->array)
+		{
+			const jsonvalue* const pName = entry.Find("name");
+			if (pName && pName->IsString() && pName->string == result.name)
+			{
+				pBase = &entry;
+				break;
+			}
+		}
+
+		const jsonvalue* const pMedian = pBase ? pBase->Find("median") : nullptr;
+		if (!pMedian || !pMedian->IsNumber() || pMedian->number <= 0.0)
+		{
+			printf("  %-40s no baseline\n", result.name.c_str());
+			continue;
+		}
+
+		const jsonvalue* const pMad = pBase->Find("mad");
+		const jsonvalue* const pThreshold = pBase->Find("threshold");
+
+		// a different thread count makes the medians incomparable, but it is the run's to explain, so only warn
+		const jsonvalue* const pThreads = pBase->Find("threads");
+		if (pThreads && pThreads->IsNumber() && static_cast<int>(pThreads->number) != result.threads)
+			printf("  WARNING: %s ran on %d threads, the baseline on %d\n", result.name.c_str(), result.threads, static_cast<int>(pThreads->number));
+
+		const double baseMedian = pMedian->number;
+		const double baseMad = pMad && pMad->IsNumber() ? pMad->number : 0.0;
+		const double threshold = pThreshold && pThreshold->IsNumber() ? pThreshold->number : defaultThreshold;
+
+		const double delta = result.median - baseMedian;
+		const double noise = noiseSigmas * madToSigma * max(result.mad, baseMad);
+
+		const bool regressed = delta > baseMedian * threshold && delta > noise;
+		if (regressed)
+			regressions++;
+
+		printf("  %-40s %+7.2f%% (limit %.0f%%)%s\n", result.name.c_str(), delta / baseMedian * 100.0, threshold * 100.0, regressed ? "  REGRESSION" : "");
+	}
+
+	return regressions;
+}
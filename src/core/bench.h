@@ -0,0 +1,41 @@
+#pragma once
+
+// benchmark runner with robust statistics and a baseline regression gate
+// every benchmark is sampled several times, the median and MAD (median absolute deviation) of the samples are
+// reported so a few slow runs on a noisy machine don't move the result
+
+struct s_benchmark_t
+{
+	std::string name;
+	std::function<void()> fn;
+	bool calibrate; // repeat fn inside each sample until it takes at least BENCH_MIN_SAMPLE_SECONDS (for small kernels)
+};
+
+struct s_benchresult_t
+{
+	std::string name;
+	double median;	// seconds per iteration
+	double mad;		// seconds per iteration
+	int samples;
+	int iterations;	// fn calls per sample
+	int threads;	// most threads that worked at once during the samples
+};
+
+struct s_benchinfo_t
+{
+	std::string isa;
+	std::string revision;
+};
+
+#define BENCH_MIN_SAMPLE_SECONDS 0.02
+#define BENCH_DEFAULT_THRESHOLD 0.10 // allowed slowdown as a fraction of the baseline median
+
+// git commit of the source tree the executable sits in (or of the working directory), "unknown" without git
+std::string GetSourceRevision();
+
+std::vector<s_benchresult_t> RunBenchmarks(const std::vector<s_benchmark_t>& benchmarks, const int samples);
+bool WriteBenchResults(const std::string& path, const s_benchinfo_t& info, const std::vector<s_benchresult_t>& results);
+
+// returns the number of regressed benchmarks, or -1 if the baseline couldn't be read
+// a benchmark regresses if it is slower than the baseline by more than its threshold and by more than the noise of both runs
+int CompareBenchBaseline(const std::string& path, const s_benchinfo_t& info, const std::vector<s_benchresult_t>& results, const double defaultThreshold);
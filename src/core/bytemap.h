@@ -0,0 +1,81 @@
+#pragma once
+
+// fixed size containers for byte keys (bone ids, hardware bone indices)
+// these replace std::set/std::map in the converters, no allocations and no tree walks
+
+// set of byte values, one bit per value
+class byteset
+{
+private:
+	unsigned __int64 _bits[4] = {};
+	unsigned int _size = 0;
+
+public:
+	inline void clear()
+	{
+		memset(this->_bits, 0, sizeof(this->_bits));
+		this->_size = 0;
+	}
+
+	inline bool count(const unsigned char value) const
+	{
+		return (this->_bits[value >> 6] >> (value & 63)) & 1;
+	}
+
+	// returns false if the value was already in the set
+	inline bool insert(const unsigned char value)
+	{
+		if (this->count(value))
+			return false;
+
+		this->_bits[value >> 6] |= 1ull << (value & 63);
+		this->_size++;
+
+		return true;
+	}
+
+	inline unsigned int size() const { return this->_size; }
+	inline bool empty() const { return this->_size == 0; }
+};
+
+// byte to byte map, iterating it with a 0-255 loop and count() visits keys in ascending order like std::map would
+class bytemap
+{
+private:
+	byteset _keys;
+	unsigned char _values[256] = {};
+
+public:
+	inline void clear()
+	{
+		this->_keys.clear();
+	}
+
+	inline bool count(const unsigned char key) const
+	{
+		return this->_keys.count(key);
+	}
+
+	// same as std::map::emplace, an existing key keeps its value
+	inline bool emplace(const unsigned char key, const unsigned char value)
+	{
+		if (!this->_keys.insert(key))
+			return false;
+
+		this->_values[key] = value;
+
+		return true;
+	}
+
+	// same as std::map::at, a missing key is an error instead of a zero value
+	inline unsigned char at(const unsigned char key) const
+	{
+		if (!this->count(key))
+			Error("bytemap has no value for key %i\n", key);
+
+		return this->_values[key];
+	}
+
+	inline unsigned int size() const { return this->_keys.size(); }
+	inline bool empty() const { return this->_keys.empty(); }
+};
@@ -0,0 +1,278 @@
+#include <pch.h>
+#include <core/cpu.h>
+
+#include <intrin.h>
+#include <immintrin.h>
+
+static const char* const s_isaNames[static_cast<int>(CpuIsa_t::COUNT)] = {
+	"scalar",
+	"sse4",
+	"avx2",
+	"avx512",
+};
+
+const char* GetIsaName(const CpuIsa_t isa)
+{
+	if (isa < CpuIsa_t::SCALAR || isa >= CpuIsa_t::COUNT)
+		return "unknown";
+
+	return s_isaNames[static_cast<int>(isa)];
+}
+
+//
+// DetectCpuFeatures
+// Purpose: read cpuid and xcr0, wide registers only count if the os saves their state
+//
+static void DetectCpuFeatures(s_cpufeatures_t& cpu)
+{
+	int regs[4] = {};
+
+	__cpuid(regs, 0);
+	const int maxLeaf = regs[0];
+
+	__cpuid(regs, 1);
+	cpu.sse2 = regs[3] & (1 << 26);
+	cpu.sse41 = regs[2] & (1 << 19);
+
+	const bool osxsave = regs[2] & (1 << 27);
+	const bool avx = regs[2] & (1 << 28);
+	const bool f16c = regs[2] & (1 << 29);
+
+	const unsigned __int64 xcr0 = osxsave ? _xgetbv(0) : 0;
+	const bool ymmState = (xcr0 & 0x6) == 0x6;		// xmm + ymm
+	const bool zmmState = (xcr0 & 0xe6) == 0xe6;	// xmm + ymm + opmask + zmm
+
+	cpu.f16c = avx && ymmState && f16c;
+
+	if (maxLeaf >= 7)
+	{
+		__cpuidex(regs, 7, 0);
+		cpu.avx2 = avx && ymmState && (regs[1] & (1 << 5));
+		cpu.avx512f = zmmState && (regs[1] & (1 << 16));
+		cpu.avx512bw = zmmState && (regs[1] & (1 << 30));
+	}
+
+	if (cpu.avx512f && cpu.avx512bw && cpu.avx2)
+		cpu.detectedIsa = CpuIsa_t::AVX512;
+	else if (cpu.avx2 && cpu.f16c)
+		cpu.detectedIsa = CpuIsa_t::AVX2;
+	else if (cpu.sse2 && cpu.sse41)
+		cpu.detectedIsa = CpuIsa_t::SSE4;
+	else
+		cpu.detectedIsa = CpuIsa_t::SCALAR;
+}
+
+//
+// RepackVertices
+// Purpose: copy vertices between buffers with different strides (e.g. stripping uv2)
+// the simd versions copy in full registers and finish each vertex with one overlapping load/store
+//
+static void RepackVertices_Scalar(char* pDst, const uint32_t dstStride, const char* pSrc, const uint32_t srcStride, const uint32_t count)
+{
+	const uint32_t copySize = min(dstStride, srcStride);
+
+	for (uint32_t i = 0; i < count; i++)
+		memcpy(pDst + static_cast<size_t>(i) * dstStride, pSrc + static_cast<size_t>(i) * srcStride, copySize);
+}
+
+static void RepackVertices_SSE4(char* pDst, const uint32_t dstStride, const char* pSrc, const uint32_t srcStride, const uint32_t count)
+{
+	const uint32_t copySize = min(dstStride, srcStride);
+
+	if (copySize < 16)
+	{
+		RepackVertices_Scalar(pDst, dstStride, pSrc, srcStride, count);
+		return;
+	}
+
+	for (uint32_t i = 0; i < count; i++, pDst += dstStride, pSrc += srcStride)
+	{
+		uint32_t offset = 0;
+		for (; offset + 16 <= copySize; offset += 16)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + offset), _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + offset)));
+
+		if (offset < copySize)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + copySize - 16), _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + copySize - 16)));
+	}
+}
+
+static void RepackVertices_AVX2(char* pDst, const uint32_t dstStride, const char* pSrc, const uint32_t srcStride, const uint32_t count)
+{
+	const uint32_t copySize = min(dstStride, srcStride);
+
+	if (copySize < 32)
+	{
+		RepackVertices_SSE4(pDst, dstStride, pSrc, srcStride, count);
+		return;
+	}
+
+	for (uint32_t i = 0; i < count; i++, pDst += dstStride, pSrc += srcStride)
+	{
+		uint32_t offset = 0;
+		for (; offset + 32 <= copySize; offset += 32)
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst + offset), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc + offset)));
+
+		if (offset < copySize)
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst + copySize - 32), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc + copySize - 32)));
+	}
+
+	_mm256_zeroupper();
+}
+
+// masked byte loads/stores, most vertex formats fit in a single register
+static void RepackVertices_AVX512(char* pDst, const uint32_t dstStride, const char* pSrc, const uint32_t srcStride, const uint32_t count)
+{
+	const uint32_t copySize = min(dstStride, srcStride);
+	const uint32_t tailSize = copySize & 63;
+	const __mmask64 tailMask = tailSize ? (1ull << tailSize) - 1 : 0;
+	const uint32_t fullSize = copySize - tailSize;
+
+	for (uint32_t i = 0; i < count; i++, pDst += dstStride, pSrc += srcStride)
+	{
+		for (uint32_t offset = 0; offset < fullSize; offset += 64)
+			_mm512_storeu_si512(pDst + offset, _mm512_loadu_si512(pSrc + offset));
+
+		if (tailMask)
+			_mm512_mask_storeu_epi8(pDst + fullSize, tailMask, _mm512_maskz_loadu_epi8(tailMask, pSrc + fullSize));
+	}
+
+	_mm256_zeroupper();
+}
+
+//
+// ExtendBounds
+// Purpose: min/max over strided float3 positions
+// the simd versions load exactly 12 bytes per position so the last one never reads past the buffer
+//
+static void ExtendBounds_Scalar(const char* pPositions, const uint32_t stride, const uint32_t count, float* pMins, float* pMaxs)
+{
+	for (uint32_t i = 0; i < count; i++, pPositions += stride)
+	{
+		const float* const pPos = reinterpret_cast<const float*>(pPositions);
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			pMins[axis] = min(pMins[axis], pPos[axis]);
+			pMaxs[axis] = max(pMaxs[axis], pPos[axis]);
+		}
+	}
+}
+
+static inline __m128 LoadFloat3(const char* pData)
+{
+	const __m128 xy = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(pData)));
+	const __m128 z = _mm_load_ss(reinterpret_cast<const float*>(pData) + 2);
+
+	return _mm_movelh_ps(xy, z);
+}
+
+static inline void StoreFloat3(float* pDst, const __m128 value)
+{
+	alignas(16) float values[4];
+	_mm_store_ps(values, value);
+
+	pDst[0] = values[0];
+	pDst[1] = values[1];
+	pDst[2] = values[2];
+}
+
+static void ExtendBounds_SSE4(const char* pPositions, const uint32_t stride, const uint32_t count, float* pMins, float* pMaxs)
+{
+	__m128 mins = _mm_setr_ps(pMins[0], pMins[1], pMins[2], 0.0f);
+	__m128 maxs = _mm_setr_ps(pMaxs[0], pMaxs[1], pMaxs[2], 0.0f);
+
+	for (uint32_t i = 0; i < count; i++, pPositions += stride)
+	{
+		const __m128 pos = LoadFloat3(pPositions);
+		mins = _mm_min_ps(mins, pos);
+		maxs = _mm_max_ps(maxs, pos);
+	}
+
+	StoreFloat3(pMins, mins);
+	StoreFloat3(pMaxs, maxs);
+}
+
+// two positions per register, the halves are folded together at the end
+static void ExtendBounds_AVX2(const char* pPositions, const uint32_t stride, const uint32_t count, float* pMins, float* pMaxs)
+{
+	const __m128 initMins = _mm_setr_ps(pMins[0], pMins[1], pMins[2], 0.0f);
+	const __m128 initMaxs = _mm_setr_ps(pMaxs[0], pMaxs[1], pMaxs[2], 0.0f);
+
+	__m256 mins = _mm256_set_m128(initMins, initMins);
+	__m256 maxs = _mm256_set_m128(initMaxs, initMaxs);
+
+	uint32_t i = 0;
+	for (; i + 2 <= count; i += 2, pPositions += static_cast<size_t>(stride) * 2)
+	{
+		const __m256 pos = _mm256_set_m128(LoadFloat3(pPositions + stride), LoadFloat3(pPositions));
+		mins = _mm256_min_ps(mins, pos);
+		maxs = _mm256_max_ps(maxs, pos);
+	}
+
+	__m128 mins128 = _mm_min_ps(_mm256_castps256_ps128(mins), _mm256_extractf128_ps(mins, 1));
+	__m128 maxs128 = _mm_max_ps(_mm256_castps256_ps128(maxs), _mm256_extractf128_ps(maxs, 1));
+
+	if (i < count)
+	{
+		const __m128 pos = LoadFloat3(pPositions);
+		mins128 = _mm_min_ps(mins128, pos);
+		maxs128 = _mm_max_ps(maxs128, pos);
+	}
+
+	_mm256_zeroupper();
+
+	StoreFloat3(pMins, mins128);
+	StoreFloat3(pMaxs, maxs128);
+}
+
+static void BindKernels(const CpuIsa_t isa)
+{
+	switch (isa)
+	{
+	case CpuIsa_t::AVX512:
+		g_kernels.RepackVertices = RepackVertices_AVX512;
+		g_kernels.ExtendBounds = ExtendBounds_AVX2; // 12 byte positions don't fill a zmm any better
+		break;
+	case CpuIsa_t::AVX2:
+		g_kernels.RepackVertices = RepackVertices_AVX2;
+		g_kernels.ExtendBounds = ExtendBounds_AVX2;
+		break;
+	case CpuIsa_t::SSE4:
+		g_kernels.RepackVertices = RepackVertices_SSE4;
+		g_kernels.ExtendBounds = ExtendBounds_SSE4;
+		break;
+	default:
+		g_kernels.RepackVertices = RepackVertices_Scalar;
+		g_kernels.ExtendBounds = ExtendBounds_Scalar;
+		break;
+	}
+}
+
+//
+// InitCpuDispatch
+// Purpose: detect the cpu once and bind every kernel, -isa can only lower the level
+//
+void InitCpuDispatch(const char* pszIsa)
+{
+	DetectCpuFeatures(g_cpu);
+	g_cpu.activeIsa = g_cpu.detectedIsa;
+
+	if (pszIsa && pszIsa[0])
+	{
+		CpuIsa_t requested = CpuIsa_t::COUNT;
+		for (int i = 0; i < static_cast<int>(CpuIsa_t::COUNT); i++)
+		{
+			if (!_stricmp(pszIsa, s_isaNames[i]))
+				requested = static_cast<CpuIsa_t>(i);
+		}
+
+		if (requested == CpuIsa_t::COUNT)
+			printf("WARNING: unknown isa '%s', using %s\n", pszIsa, GetIsaName(g_cpu.detectedIsa));
+		else if (requested > g_cpu.detectedIsa)
+			printf("WARNING: isa '%s' is not supported by this cpu, using %s\n", pszIsa, GetIsaName(g_cpu.detectedIsa));
+		else
+			g_cpu.activeIsa = requested;
+	}
+
+	BindKernels(g_cpu.activeIsa);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// runtime cpu feature detection and kernel dispatch
+// features are detected once at startup and each kernel is bound to the best version the cpu (or -isa) allows
+
+enum class CpuIsa_t : int
+{
+	SCALAR,
+	SSE4,	// sse2 + sse4.1
+	AVX2,	// avx2 + f16c
+	AVX512,	// avx512f + avx512bw
+
+	COUNT
+};
+
+struct s_cpufeatures_t
+{
+	bool sse2;
+	bool sse41;
+	bool avx2;
+	bool avx512f;
+	bool avx512bw;
+	bool f16c;
+
+	CpuIsa_t detectedIsa;	// highest level this cpu and os support
+	CpuIsa_t activeIsa;		// level the kernels are bound to
+};
+
+inline s_cpufeatures_t g_cpu{};
+
+// copy min(srcStride, dstStride) bytes for each of count vertices, dst advances by dstStride
+typedef void (*RepackVerticesFn)(char* pDst, const uint32_t dstStride, const char* pSrc, const uint32_t srcStride, const uint32_t count);
+
+// grow pMins/pMaxs (3 floats each) by count float3 positions, pPositions advances by stride
+typedef void (*ExtendBoundsFn)(const char* pPositions, const uint32_t stride, const uint32_t count, float* pMins, float* pMaxs);
+
+struct s_cpukernels_t
+{
+	RepackVerticesFn RepackVertices;
+	ExtendBoundsFn ExtendBounds;
+};
+
+inline s_cpukernels_t g_kernels{};
+
+// pszIsa is the -isa value (scalar, sse4, avx2, avx512) or nullptr to use the detected level
+void InitCpuDispatch(const char* pszIsa);
+const char* GetIsaName(const CpuIsa_t isa);
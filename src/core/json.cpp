@@ -0,0 +1,274 @@
+#include <pch.h>
+#include <core/json.h>
+
+class jsonparser
+{
+public:
+	jsonparser(const std::string& text) : _text(text), _pos(0) {}
+
+	bool Parse(jsonvalue& out, std::string& error)
+	{
+		if (!this->ReadValue(out, 0))
+		{
+			error = this->_error + " at offset " + std::to_string(this->_pos);
+			return false;
+		}
+
+		if (this->Peek() != '\0')
+		{
+			error = "trailing data at offset " + std::to_string(this->_pos);
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+	static constexpr int MAX_DEPTH = 64;
+
+	const std::string& _text;
+	size_t _pos;
+	std::string _error;
+
+	bool Fail(const char* msg)
+	{
+		this->_error = msg;
+		return false;
+	}
+
+	char Peek()
+	{
+		while (this->_pos < this->_text.size() && isspace(static_cast<unsigned char>(this->_text[this->_pos])))
+			this->_pos++;
+
+		return this->_pos < this->_text.size() ? this->_text[this->_pos] : '\0';
+	}
+
+	bool Expect(const char c)
+	{
+		if (this->Peek() != c)
+			return false;
+
+		this->_pos++;
+		return true;
+	}
+
+	bool ReadLiteral(const char* literal)
+	{
+		const size_t length = strlen(literal);
+		if (this->_text.compare(this->_pos, length, literal) != 0)
+			return this->Fail("invalid literal");
+
+		this->_pos += length;
+		return true;
+	}
+
+	bool ReadString(std::string& out)
+	{
+		if (!this->Expect('"'))
+			return this->Fail("expected string");
+
+		out.clear();
+		while (this->_pos < this->_text.size())
+		{
+			const char c = this->_text[this->_pos++];
+
+			if (c == '"')
+				return true;
+
+			if (c != '\\')
+			{
+				out += c;
+				continue;
+			}
+
+			if (this->_pos >= this->_text.size())
+				break;
+
+			const char esc = this->_text[this->_pos++];
+			switch (esc)
+			{
+			case '"':
+			case '\\':
+			case '/':
+				out += esc;
+				break;
+			case 'b':
+				out += '\b';
+				break;
+			case 'f':
+				out += '\f';
+				break;
+			case 'n':
+				out += '\n';
+				break;
+			case 'r':
+				out += '\r';
+				break;
+			case 't':
+				out += '\t';
+				break;
+			case 'u':
+			{
+				if (this->_pos + 4 > this->_text.size())
+					return this->Fail("truncated escape");
+
+				const unsigned long code = strtoul(this->_text.substr(this->_pos, 4).c_str(), nullptr, 16);
+				if (code > 0x7f)
+					return this->Fail("non ascii escape");
+
+				out += static_cast<char>(code);
+				this->_pos += 4;
+				break;
+			}
+			default:
+				return this->Fail("invalid escape");
+			}
+		}
+
+		return this->Fail("unterminated string");
+	}
+
+	bool ReadNumber(double& out)
+	{
+		const char* const pStart = this->_text.c_str() + this->_pos;
+		char* pEnd = nullptr;
+
+		out = strtod(pStart, &pEnd);
+		if (pEnd == pStart)
+			return this->Fail("invalid number");
+
+		this->_pos += pEnd - pStart;
+		return true;
+	}
+
+	bool ReadValue(jsonvalue& out, const int depth)
+	{
+		if (depth > MAX_DEPTH)
+			return this->Fail("nested too deep");
+
+		const char c = this->Peek();
+		switch (c)
+		{
+		case '{':
+		{
+			this->_pos++;
+			out.type = jsonvalue::Type_t::OBJECT;
+
+			if (this->Expect('}'))
+				return true;
+
+			do
+			{
+				std::pair<std::string, jsonvalue> member;
+				if (!this->ReadString(member.first))
+					return false;
+
+				if (!this->Expect(':'))
+					return this->Fail("expected ':'");
+
+				if (!this->ReadValue(member.second, depth + 1))
+					return false;
+
+				out.object.push_back(std::move(member));
+			} while (this->Expect(','));
+
+			return this->Expect('}') ? true : this->Fail("expected ',' or '}'");
+		}
+		case '[':
+		{
+			this->_pos++;
+			out.type = jsonvalue::Type_t::ARRAY;
+
+			if (this->Expect(']'))
+				return true;
+
+			do
+			{
+				out.array.emplace_back();
+				if (!this->ReadValue(out.array.back(), depth + 1))
+					return false;
+			} while (this->Expect(','));
+
+			return this->Expect(']') ? true : this->Fail("expected ',' or ']'");
+		}
+		case '"':
+			out.type = jsonvalue::Type_t::STRING;
+			return this->ReadString(out.string);
+		case 't':
+			out.type = jsonvalue::Type_t::BOOL;
+			out.boolean = true;
+			return this->ReadLiteral("true");
+		case 'f':
+			out.type = jsonvalue::Type_t::BOOL;
+			out.boolean = false;
+			return this->ReadLiteral("false");
+		case 'n':
+			out.type = jsonvalue::Type_t::NUL;
+			return this->ReadLiteral("null");
+		default:
+			out.type = jsonvalue::Type_t::NUMBER;
+			return this->ReadNumber(out.number);
+		}
+	}
+};
+
+bool ParseJson(const std::string& text, jsonvalue& out, std::string& error)
+{
+	out = jsonvalue();
+	return jsonparser(text).Parse(out, error);
+}
+
+bool ReadJsonFile(const std::string& path, jsonvalue& out, std::string& error)
+{
+	std::ifstream ifs(path, std::ios::in | std::ios::binary);
+	if (!ifs.is_open())
+	{
+		error = "could not open file";
+		return false;
+	}
+
+	const std::string text((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+	return ParseJson(text, out, error);
+}
+
+std::string JsonEscape(const std::string& str)
+{
+	std::string out;
+	out.reserve(str.size());
+
+	for (const char c : str)
+	{
+		switch (c)
+		{
+		case '"':
+			out += "\\\"";
+			break;
+		case '\\':
+			out += "\\\\";
+			break;
+		case '\n':
+			out += "\\n";
+			break;
+		case '\r':
+			out += "\\r";
+			break;
+		case '\t':
+			out += "\\t";
+			break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char buf[8];
+				snprintf(buf, sizeof(buf), "\\u%04x", c);
+				out += buf;
+			}
+			else
+				out += c;
+			break;
+		}
+	}
+
+	return out;
+}
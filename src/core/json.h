@@ -0,0 +1,47 @@
+#pragma once
+
+// small json reader/writer helpers for job lists, summaries and benchmark results
+// not a general purpose library: \u escapes are limited to ascii
+
+class jsonvalue
+{
+public:
+	enum class Type_t
+	{
+		NUL,
+		BOOL,
+		NUMBER,
+		STRING,
+		ARRAY,
+		OBJECT,
+	};
+
+	Type_t type = Type_t::NUL;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<jsonvalue> array;
+	std::vector<std::pair<std::string, jsonvalue>> object; // keeps the file's key order
+
+	inline bool IsString() const { return this->type == Type_t::STRING; }
+	inline bool IsNumber() const { return this->type == Type_t::NUMBER; }
+	inline bool IsArray() const { return this->type == Type_t::ARRAY; }
+	inline bool IsObject() const { return this->type == Type_t::OBJECT; }
+
+	// nullptr if this isn't an object or doesn't have the key
+	inline const jsonvalue* Find(const char* key) const
+	{
+		for (const auto& it : this->object)
+		{
+			if (it.first == key)
+				return &it.second;
+		}
+
+		return nullptr;
+	}
+};
+
+bool ParseJson(const std::string& text, jsonvalue& out, std::string& error);
+bool ReadJsonFile(const std::string& path, jsonvalue& out, std::string& error);
+
+std::string JsonEscape(const std::string& str);
@@ -0,0 +1,132 @@
+#include <pch.h>
+#include <core/metrics.h>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+
+static std::string s_metricsPath;
+static int s_metricsInterval = 5;
+
+static std::thread s_metricsThread;
+static std::mutex s_metricsLock;
+static std::condition_variable s_metricsWake;
+static bool s_metricsStop = false;
+
+static uint64_t GetPeakResidentBytes()
+{
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+
+	return counters.PeakWorkingSetSize;
+}
+
+static void WriteMetric(std::ofstream& out, const char* name, const char* type, const char* help, const uint64_t value)
+{
+	out << "# HELP " << name << " " << help << "\n";
+	out << "# TYPE " << name << " " << type << "\n";
+	out << name << " " << value << "\n";
+}
+
+//
+// WriteMetricsFile
+// Purpose: write to a temporary file and rename it over the old one so the collector never sees a partial file
+//
+static void WriteMetricsFile(const std::string& path)
+{
+	static const char* const s_stageNames[static_cast<int>(BatchStage_t::COUNT)] = { "read", "convert", "vg" };
+
+	const std::string tmpPath = path + ".tmp";
+
+	{
+		std::ofstream out(tmpPath, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return;
+
+		WriteMetric(out, "rmdlconv_models_converted_total", "counter", "Models converted successfully.", g_metrics.modelsConverted);
+		WriteMetric(out, "rmdlconv_models_failed_total", "counter", "Models that failed to convert.", g_metrics.modelsFailed);
+		WriteMetric(out, "rmdlconv_bytes_in_total", "counter", "Bytes read from input files.", g_metrics.bytesIn);
+		WriteMetric(out, "rmdlconv_bytes_out_total", "counter", "Bytes written to output files.", g_metrics.bytesOut);
+		WriteMetric(out, "rmdlconv_queue_depth", "gauge", "Models waiting to be converted.", g_metrics.queueDepth);
+		WriteMetric(out, "rmdlconv_peak_rss_bytes", "gauge", "Peak resident memory of the process.", GetPeakResidentBytes());
+
+		out << "# HELP rmdlconv_stage_seconds_total Cumulative seconds spent per stage, summed over worker threads.\n";
+		out << "# TYPE rmdlconv_stage_seconds_total counter\n";
+		for (int i = 0; i < static_cast<int>(BatchStage_t::COUNT); i++)
+			out << "rmdlconv_stage_seconds_total{stage=\"" << s_stageNames[i] << "\"} " << static_cast<double>(g_metrics.stageNanoseconds[i]) / 1e9 << "\n";
+
+		WriteMetric(out, "rmdlconv_files_written_total", "counter", "Output files written.", g_metrics.filesWritten);
+
+		out << "# HELP rmdlconv_file_write_seconds_total Cumulative seconds spent creating and writing output files.\n";
+		out << "# TYPE rmdlconv_file_write_seconds_total counter\n";
+		out << "rmdlconv_file_write_seconds_total " << static_cast<double>(g_metrics.fileWriteNanoseconds) / 1e9 << "\n";
+
+		out << "# HELP rmdlconv_file_sync_seconds_total Cumulative seconds spent flushing output files to disk.\n";
+		out << "# TYPE rmdlconv_file_sync_seconds_total counter\n";
+		out << "rmdlconv_file_sync_seconds_total " << static_cast<double>(g_metrics.fileSyncNanoseconds) / 1e9 << "\n";
+
+		out << "# HELP rmdlconv_models_by_version_total Models converted per source version.\n";
+		out << "# TYPE rmdlconv_models_by_version_total counter\n";
+		{
+			std::lock_guard<std::mutex> lock(g_metrics.versionLock);
+			for (const auto& it : g_metrics.versionCounts)
+				out << "rmdlconv_models_by_version_total{version=\"" << it.first << "\"} " << it.second << "\n";
+		}
+
+		const auto now = std::chrono::system_clock::now().time_since_epoch();
+		WriteMetric(out, "rmdlconv_last_update_timestamp_seconds", "gauge", "Unix time this file was written.", std::chrono::duration_cast<std::chrono::seconds>(now).count());
+
+		if (!out.good())
+			return;
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tmpPath, path, ec);
+	if (ec)
+		printf("WARNING: could not update metrics file '%s': %s\n", path.c_str(), ec.message().c_str());
+}
+
+static void MetricsThread()
+{
+	std::unique_lock<std::mutex> lock(s_metricsLock);
+
+	while (!s_metricsStop)
+	{
+		lock.unlock();
+		WriteMetricsFile(s_metricsPath);
+		lock.lock();
+
+		s_metricsWake.wait_for(lock, std::chrono::seconds(s_metricsInterval), [] { return s_metricsStop; });
+	}
+}
+
+void StartMetricsExport(const std::string& path, const int intervalSeconds)
+{
+	if (s_metricsThread.joinable())
+		return;
+
+	s_metricsPath = path;
+	s_metricsInterval = max(intervalSeconds, 1);
+	s_metricsStop = false;
+
+	s_metricsThread = std::thread(MetricsThread);
+}
+
+void StopMetricsExport()
+{
+	if (!s_metricsThread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(s_metricsLock);
+		s_metricsStop = true;
+	}
+
+	s_metricsWake.notify_all();
+	s_metricsThread.join();
+
+	// final values
+	WriteMetricsFile(s_metricsPath);
+}
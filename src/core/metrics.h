@@ -0,0 +1,67 @@
+#pragma once
+
+// batch counters, exported with -metrics as a prometheus textfile for node-exporter's textfile collector
+// the counters are always updated, the export thread only runs when asked for
+
+enum class BatchStage_t : int
+{
+	READ,		// reading input files
+	CONVERT,	// model conversion, including writing the output
+	VG,			// vertex group conversion
+
+	COUNT
+};
+
+struct s_batchmetrics_t
+{
+	std::atomic<uint64_t> modelsConverted{};
+	std::atomic<uint64_t> modelsFailed{};
+	std::atomic<uint64_t> bytesIn{};
+	std::atomic<uint64_t> bytesOut{};
+	std::atomic<uint64_t> queueDepth{};	// models not started yet
+	std::atomic<uint64_t> stageNanoseconds[static_cast<int>(BatchStage_t::COUNT)]{};
+
+	std::atomic<uint64_t> filesWritten{};
+	std::atomic<uint64_t> fileWriteNanoseconds{};	// create, preallocate and write, summed over worker threads
+	std::atomic<uint64_t> fileSyncNanoseconds{};
+
+	std::mutex versionLock;
+	std::map<std::string, uint64_t> versionCounts; // converted models per source version
+};
+
+inline s_batchmetrics_t g_metrics;
+
+inline void AddModelResult(const std::string& version, const bool success)
+{
+	if (!success)
+	{
+		g_metrics.modelsFailed++;
+		return;
+	}
+
+	g_metrics.modelsConverted++;
+
+	std::lock_guard<std::mutex> lock(g_metrics.versionLock);
+	g_metrics.versionCounts[version]++;
+}
+
+// adds the time from construction to destruction to a stage
+class stagetimer
+{
+public:
+	stagetimer(const BatchStage_t stage) : _stage(stage), _start(std::chrono::steady_clock::now()) {}
+
+	~stagetimer()
+	{
+		const auto elapsed = std::chrono::steady_clock::now() - this->_start;
+		g_metrics.stageNanoseconds[static_cast<int>(this->_stage)] += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	}
+
+private:
+	const BatchStage_t _stage;
+	const std::chrono::steady_clock::time_point _start;
+};
+
+// rewrites the file every intervalSeconds until StopMetricsExport, which writes it one last time
+void StartMetricsExport(const std::string& path, const int intervalSeconds);
+void StopMetricsExport();
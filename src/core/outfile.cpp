@@ -0,0 +1,173 @@
+#include <pch.h>
+#include <core/outfile.h>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+static size_t s_chunkSize = OUTPUT_DEFAULT_CHUNK_SIZE;
+static int s_syncEvery = -1;
+
+static std::mutex s_syncLock;
+static std::vector<std::string> s_unsyncedPaths;
+
+static std::atomic<uint64_t> s_bytesWritten{};
+
+// small parts are gathered here so the file still only sees full chunks
+static thread_local std::vector<char> s_stagingBuffer;
+
+static uint64_t NanosecondsSince(const std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SetOutputWriteOptions(const size_t chunkSize, const int syncEvery)
+{
+	// WriteFile takes a 32 bit size
+	constexpr size_t maxChunkSize = 256 * 1024 * 1024;
+
+	s_chunkSize = min(max(chunkSize, static_cast<size_t>(OUTPUT_CHUNK_ALIGN)), maxChunkSize);
+	s_chunkSize = (s_chunkSize + OUTPUT_CHUNK_ALIGN - 1) & ~static_cast<size_t>(OUTPUT_CHUNK_ALIGN - 1);
+	s_syncEvery = syncEvery;
+}
+
+static bool WriteChunk(HANDLE hFile, const char* pData, const size_t size)
+{
+	DWORD written = 0;
+	return WriteFile(hFile, pData, static_cast<DWORD>(size), &written, nullptr) && written == size;
+}
+
+//
+// SyncOutputFiles
+// Purpose: reopen and flush outputs that were closed without syncing, done in batches instead of per file
+//
+static void SyncOutputFiles(const std::vector<std::string>& paths)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	for (const std::string& path : paths)
+	{
+		HANDLE hFile = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE)
+			continue;
+
+		if (!FlushFileBuffers(hFile))
+			printf("WARNING: could not flush '%s' to disk\n", path.c_str());
+
+		CloseHandle(hFile);
+	}
+
+	g_metrics.fileSyncNanoseconds += NanosecondsSince(start);
+}
+
+//
+// WriteOutputFile
+// Purpose: create the file, reserve its final size up front, then write it in s_chunkSize pieces
+//
+bool WriteOutputFile(const std::string& path, std::initializer_list<s_outputpart_t> parts)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	size_t totalSize = 0;
+	for (const s_outputpart_t& part : parts)
+		totalSize += part.size;
+
+	HANDLE hFile = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		printf("ERROR: Could not create output file '%s'\n", path.c_str());
+		return false;
+	}
+
+	// one allocation for the whole file, not fatal if the filesystem doesn't support it
+	FILE_ALLOCATION_INFO allocInfo{};
+	allocInfo.AllocationSize.QuadPart = static_cast<LONGLONG>(totalSize);
+	SetFileInformationByHandle(hFile, FileAllocationInfo, &allocInfo, sizeof(allocInfo));
+
+	std::vector<char>& staging = s_stagingBuffer;
+	staging.clear();
+	staging.reserve(s_chunkSize);
+
+	bool success = true;
+	for (const s_outputpart_t& part : parts)
+	{
+		const char* pData = part.pData;
+		size_t remaining = part.size;
+
+		while (success && remaining > 0)
+		{
+			// nothing staged, full chunks can go straight from the caller's buffer
+			if (staging.empty() && remaining >= s_chunkSize)
+			{
+				success = WriteChunk(hFile, pData, s_chunkSize);
+				pData += s_chunkSize;
+				remaining -= s_chunkSize;
+				continue;
+			}
+
+			const size_t copySize = min(remaining, s_chunkSize - staging.size());
+			staging.insert(staging.end(), pData, pData + copySize);
+			pData += copySize;
+			remaining -= copySize;
+
+			if (staging.size() == s_chunkSize)
+			{
+				success = WriteChunk(hFile, staging.data(), staging.size());
+				staging.clear();
+			}
+		}
+	}
+
+	if (success && !staging.empty())
+		success = WriteChunk(hFile, staging.data(), staging.size());
+
+	CloseHandle(hFile);
+
+	g_metrics.fileWriteNanoseconds += NanosecondsSince(start);
+
+	if (!success)
+	{
+		printf("ERROR: Could not write output file '%s'\n", path.c_str());
+		return false;
+	}
+
+	g_metrics.filesWritten++;
+	s_bytesWritten += totalSize;
+
+	if (s_syncEvery < 0)
+		return true;
+
+	std::vector<std::string> syncPaths;
+	{
+		std::lock_guard<std::mutex> lock(s_syncLock);
+		s_unsyncedPaths.push_back(path);
+
+		if (s_syncEvery > 0 && s_unsyncedPaths.size() >= static_cast<size_t>(s_syncEvery))
+			syncPaths.swap(s_unsyncedPaths);
+	}
+
+	SyncOutputFiles(syncPaths);
+
+	return true;
+}
+
+void FlushOutputFiles()
+{
+	std::vector<std::string> syncPaths;
+	{
+		std::lock_guard<std::mutex> lock(s_syncLock);
+		syncPaths.swap(s_unsyncedPaths);
+	}
+
+	SyncOutputFiles(syncPaths);
+}
+
+void PrintOutputWriteStats()
+{
+	const double writeSeconds = static_cast<double>(g_metrics.fileWriteNanoseconds) / 1e9;
+	const double syncSeconds = static_cast<double>(g_metrics.fileSyncNanoseconds) / 1e9;
+	const double megabytes = static_cast<double>(s_bytesWritten) / (1024.0 * 1024.0);
+
+	printf("  Output:  %llu files, %.2f MB in %.2fs (%.1f MB/s), sync %.2fs\n", static_cast<unsigned long long>(g_metrics.filesWritten.load()),
+		megabytes, writeSeconds, writeSeconds > 0.0 ? megabytes / writeSeconds : 0.0, syncSeconds);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+// output file writer, every output's size is known before it is written so the file is preallocated in one extent
+// and written in large chunks instead of going through ofstream's small buffered writes
+
+struct s_outputpart_t
+{
+	const char* pData;
+	size_t size;
+};
+
+#define OUTPUT_DEFAULT_CHUNK_SIZE (1024 * 1024)
+#define OUTPUT_CHUNK_ALIGN 4096 // chunks are a multiple of this so every write but the last starts on a page/sector boundary
+
+// chunkSize is rounded up to OUTPUT_CHUNK_ALIGN
+// syncEvery < 0 never flushes outputs to disk (default), 0 flushes them all once in FlushOutputFiles, n flushes every n files
+void SetOutputWriteOptions(const size_t chunkSize, const int syncEvery);
+
+// parts are written back to back, the file is created or truncated
+bool WriteOutputFile(const std::string& path, std::initializer_list<s_outputpart_t> parts);
+
+inline bool WriteOutputFile(const std::string& path, const char* pData, const size_t size)
+{
+	return WriteOutputFile(path, { { pData, size } });
+}
+
+// flushes every output that hasn't been synced yet, call once the batch is done
+void FlushOutputFiles();
+void PrintOutputWriteStats();
@@ -0,0 +1,144 @@
+#pragma once
+
+// one ParallelFor call: its items are handed out in order to the caller and any pool workers that join
+struct s_parallelbatch_t
+{
+	const std::function<void(const size_t)>* fn;
+	size_t count;
+	std::atomic<size_t> next;
+	unsigned int maxHelpers; // pool workers allowed to join besides the caller
+	unsigned int helpers; // pool workers currently inside the batch, guarded by the pool mutex
+
+	void Work()
+	{
+		for (size_t i = next++; i < count; i = next++)
+			(*fn)(i);
+	}
+
+	bool WantsHelp() const { return helpers < maxHelpers && next.load(std::memory_order_relaxed) < count; }
+};
+
+// shared worker pool behind ParallelFor
+// every call uses the same workers, including calls made from inside a task (a -jobs-from job converting the sections
+// of its model), so nesting never multiplies the thread count. the caller always works its own batch and only idle workers
+// join it, so a nested call still finishes when every worker is busy, it just runs inline
+class CParallelPool
+{
+public:
+	static CParallelPool& Get()
+	{
+		// never destroyed: the workers are detached and a task may call exit() while they still run
+		static CParallelPool* s_pool = new CParallelPool();
+		return *s_pool;
+	}
+
+	// threads a call can use without starting more workers, the caller included
+	unsigned int DefaultThreads() const { return max(std::thread::hardware_concurrency(), 1u); }
+
+	// most threads that worked at the same time since the last reset: the calling thread plus the busiest the workers got
+	// lets a benchmark report the threads it really used rather than the core count
+	void ResetPeakThreads()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_peakBusyWorkers = m_busyWorkers;
+	}
+
+	unsigned int PeakThreads()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_peakBusyWorkers + 1;
+	}
+
+	void Run(const size_t count, const unsigned int numThreads, const std::function<void(const size_t)>& fn)
+	{
+		s_parallelbatch_t batch{ &fn, count, 0, numThreads - 1, 0 };
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			// explicit thread counts above the core count (-threads for io bound job lists) grow the pool once
+			while (m_numWorkers < batch.maxHelpers)
+			{
+				std::thread(&CParallelPool::WorkerLoop, this).detach();
+				m_numWorkers++;
+			}
+
+			m_batches.push_back(&batch);
+		}
+
+		m_workReady.notify_all();
+
+		batch.Work();
+
+		// once the batch is off the queue no worker can join, wait for the ones still finishing an item
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_batches.erase(std::find(m_batches.begin(), m_batches.end(), &batch));
+		m_batchDone.wait(lock, [&batch]() { return batch.helpers == 0; });
+	}
+
+private:
+	CParallelPool() : m_numWorkers(0), m_busyWorkers(0), m_peakBusyWorkers(0) {}
+
+	void WorkerLoop()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		for (;;)
+		{
+			s_parallelbatch_t* pBatch = nullptr;
+			m_workReady.wait(lock, [this, &pBatch]()
+			{
+				for (s_parallelbatch_t* pQueued : m_batches)
+				{
+					if (pQueued->WantsHelp())
+					{
+						pBatch = pQueued;
+						return true;
+					}
+				}
+
+				return false;
+			});
+
+			pBatch->helpers++;
+			m_busyWorkers++;
+			m_peakBusyWorkers = max(m_peakBusyWorkers, m_busyWorkers);
+			lock.unlock();
+
+			pBatch->Work();
+
+			lock.lock();
+			m_busyWorkers--;
+			if (--pBatch->helpers == 0)
+				m_batchDone.notify_all();
+		}
+	}
+
+	std::mutex m_mutex;
+	std::condition_variable m_workReady;
+	std::condition_variable m_batchDone;
+	std::vector<s_parallelbatch_t*> m_batches; // oldest first, so outer calls keep priority over the ones nested in them
+	unsigned int m_numWorkers;
+	unsigned int m_busyWorkers; // workers inside a batch
+	unsigned int m_peakBusyWorkers;
+};
+
+// fork/join helper: fn(i) is called once for every i in [0, count), items are handed out in order
+// numThreads 0 uses one thread per core, the calling thread works too. 1 runs inline without touching the pool
+inline void ParallelFor(const size_t count, unsigned int numThreads, const std::function<void(const size_t)>& fn)
+{
+	if (numThreads == 0)
+		numThreads = CParallelPool::Get().DefaultThreads();
+
+	numThreads = static_cast<unsigned int>(min(static_cast<size_t>(numThreads), count));
+
+	if (numThreads <= 1)
+	{
+		for (size_t i = 0; i < count; i++)
+			fn(i);
+
+		return;
+	}
+
+	CParallelPool::Get().Run(count, numThreads, fn);
+}
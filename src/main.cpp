@@ -3,7 +3,11 @@
 
 #include <pch.h>
 #include <algorithm>
+#include <cfloat>
 #include <core/CommandLine.h>
+#include <core/json.h>
+#include <core/bench.h>
+#include <studio/studio.h>
 #include <studio/versions.h>
 #include <core/utils.h>
 
@@ -140,6 +144,7 @@ const char* pszBatchHelpString = {
 	"\n"
 	"Version flags:\n"
 	"  -v8     Model v8\n"
+	"  -v12    Model v12\n"
 	"  -v121   Model v12.1\n"
 	"  -v122   Model v12.2\n"
 	"  -v123   Model v12.3\n"
@@ -159,15 +164,147 @@ const char* pszBatchHelpString = {
 	"If output_folder is not specified, uses '<input_folder>_rmdlconv_out'\n"
 	"Internal folder structure is preserved.\n"
 	"\n"
+	"Job list mode:\n"
+	"  rmdlconv.exe -jobs-from <file> [-threads <n>] [-summary <file>]\n"
+	"\n"
+	"  <file> is TSV (input<TAB>version<TAB>output[<TAB>options] per line, # comments)\n"
+	"  or a JSON array of { \"input\", \"version\", \"output\", \"options\" } objects.\n"
+	"  Jobs run in parallel, per job options add to the ones given on the command line.\n"
+	"  Results are written as JSON to the -summary file (default: <file>.summary.json).\n"
+	"  Inputs are checked (magic, version, size, loose files) so bad ones fail on their own.\n"
+	"  Malformed data past those checks still ends the whole run, the summary then marks\n"
+	"  every unfinished job as aborted and outputs of jobs that were running may be partial.\n"
+	"\n"
+	"Benchmark mode:\n"
+	"  rmdlconv.exe -bench [-bench-jobs <file>] [-bench-runs <n>] [-bench-out <file>]\n"
+	"               [-bench-baseline <file>] [-bench-threshold <f>] [-bench-rev <rev>]\n"
+	"\n"
+	"  Runs the kernel benchmarks and converts every job in -bench-jobs (job list format),\n"
+	"  each -bench-runs times (default 11), and writes median/MAD results as JSON\n"
+	"  (default: bench_results.json). With -bench-baseline (a previous results file, entries\n"
+	"  may set their own \"threshold\") it exits with 1 if a benchmark got slower than the\n"
+	"  threshold (default 0.10) and the measured noise. Every result records the threads it\n"
+	"  actually ran on. The revision is git's HEAD for the tree the executable was built in\n"
+	"  (or the working directory), -bench-rev overrides it.\n"
+	"\n"
+	"Batch and job list options:\n"
+	"  -metrics <file>        Keep a prometheus textfile (.prom) with live batch counters\n"
+	"  -metrics-interval <s>  Seconds between metrics updates (default: 5)\n"
+	"  -writechunk <KB>       Output write size, rounded up to 4 KB (default: 1024)\n"
+	"  -syncoutputs [n]       Flush outputs to disk every n files, or once at the end\n"
+	"\n"
+	"Options:\n"
+	"  -genbvh          Generate collision for MDL v48/49/53 static props\n"
+	"  -verifyfastpath  Also rebuild in place conversions (v12.0) from scratch and diff the outputs\n"
+	"  -pruneweights [t] Drop bone weights below t (default 0.05), max 3 per vertex\n"
+	"  -minpalette      Trim the vertex bone palette to the bones meshes use\n"
+	"  -serial          Convert sections of a model (VG meshes, collision, sequences, bodyparts) on one thread\n"
+	"  -verifysections  Also write sequences and bodyparts serially (v16 and later) and diff against the parallel output\n"
+	"  -tightbounds     Recompute view and sequence bounds from vertices over every animation frame, hulls are kept (MDL v48/49/53, RMDL v16/19.1)\n"
+	"  -refithitboxes   Shrink hitboxes to the vertices skinned to their bone, or near the box when a bone has several (MDL v48/49/53)\n"
+	"  -mergehitboxes   Drop flat hitboxes and merge redundant ones on the same bone\n"
+	"  -compactskins    Trim unused skinref columns and drop duplicate skin families at the end of the table\n"
+	"  -cullmaterials   Drop materials no mesh or skin family can use\n"
+	"  -mergemeshes     Merge meshes of a model that share a material (MDL v48/49/53)\n"
+	"  -overdraw [t]    Reorder VG triangles to cut overdraw, vertex cache misses may grow by t (default 1.05)\n"
+	"  -reorderbones    Renumber bones so every parent comes before its children (model only, rigs keep their order)\n"
+	"  -cullbones       Remove bones nothing uses and list them (MDL v48/49/53, rigs keep their bones)\n"
+	"  -includepath <d> Merge the sequences and animations of include models found under game root d, bones matched by name (MDL v52)\n"
+	"  -simplifyphy [n] Reduce PHY convex pieces to n vertices (default 24), losing at most -phyvolumeloss of their volume\n"
+	"  -phyvolumeloss f Volume share a convex piece may lose when simplified (default 0.05)\n"
+	"  -lodswitch [px]  Set VG LOD switch points where a LOD deviates px pixels from the one before it (default 1, v16 and later)\n"
+	"  -isa <level>     Force scalar, sse4, avx2 or avx512 code paths (default: best supported)\n"
+	"\n"
 	"Example:\n"
 	"  rmdlconv.exe -v122 C:\\models\\input C:\\models\\converted\n"
 	"  rmdlconv.exe -v191 C:\\models\\input\n"
 };
 
+// options are only ever switched on, so job list options can add to the global ones
+static void ParseConvertOptions(const CommandLine& cmdline, s_convertoptions_t& options)
+{
+	if (cmdline.HasParam("-genbvh"))
+		options.generateBVH = true;
+
+	if (cmdline.HasParam("-verifyfastpath"))
+		options.verifyFastPath = true;
+
+	if (cmdline.HasParam("-pruneweights"))
+	{
+		options.pruneWeights = true;
+		options.pruneWeightThreshold = static_cast<float>(atof(cmdline.GetParamValue("-pruneweights", "0.05")));
+	}
+
+	if (cmdline.HasParam("-minpalette"))
+		options.minimizePalette = true;
+
+	if (cmdline.HasParam("-serial"))
+		options.serialSections = true;
+
+	if (cmdline.HasParam("-verifysections"))
+		options.verifySections = true;
+
+	if (cmdline.HasParam("-tightbounds"))
+		options.tightBounds = true;
+
+	if (cmdline.HasParam("-refithitboxes"))
+		options.refitHitboxes = true;
+
+	if (cmdline.HasParam("-mergehitboxes"))
+		options.mergeHitboxes = true;
+
+	if (cmdline.HasParam("-compactskins"))
+		options.compactSkins = true;
+
+	if (cmdline.HasParam("-cullmaterials"))
+		options.cullMaterials = true;
+
+	if (cmdline.HasParam("-mergemeshes"))
+		options.mergeMeshes = true;
+
+	if (cmdline.HasParam("-overdraw"))
+	{
+		options.optimizeOverdraw = true;
+		options.overdrawCacheThreshold = static_cast<float>(atof(cmdline.GetParamValue("-overdraw", "1.05")));
+
+		// fewer misses than the original order can't be promised
+		options.overdrawCacheThreshold = max(options.overdrawCacheThreshold, 1.0f);
+	}
+
+	if (cmdline.HasParam("-reorderbones"))
+		options.reorderBones = true;
+
+	if (cmdline.HasParam("-cullbones"))
+		options.cullBones = true;
+
+	if (cmdline.HasParam("-includepath"))
+		options.includeModelPath = cmdline.GetParamValue("-includepath", "");
+
+	if (cmdline.HasParam("-simplifyphy"))
+	{
+		options.simplifyPhy = true;
+		options.phyHullVertexBudget = atoi(cmdline.GetParamValue("-simplifyphy", "24"));
+		options.phyMaxVolumeLoss = static_cast<float>(atof(cmdline.GetParamValue("-phyvolumeloss", "0.05")));
+
+		// a tetrahedron is the smallest hull
+		options.phyHullVertexBudget = max(options.phyHullVertexBudget, 4);
+	}
+
+	if (cmdline.HasParam("-lodswitch"))
+	{
+		options.computeLODSwitchPoints = true;
+		options.lodPixelError = static_cast<float>(atof(cmdline.GetParamValue("-lodswitch", "1")));
+
+		// a lod can't be held to less than a fraction of a pixel
+		options.lodPixelError = max(options.lodPixelError, 0.01f);
+	}
+}
+
 // Converter IDs
 enum ConverterID
 {
 	CONV_V8 = 0,
+	CONV_V120,
 	CONV_V121,
 	CONV_V122,
 	CONV_V124,
@@ -191,6 +328,11 @@ static const VersionMapping s_versionMappings[] = {
 	// Version 8
 	{ "8",     "-v8",   CONV_V8,   0,  false },
 
+	// Version 12 (same layout as v10 besides collision, converted in place)
+	{ "12",    "-v12",  CONV_V120, 0,  false },
+	{ "12.0",  nullptr, CONV_V120, 0,  false },
+	{ "120",   nullptr, CONV_V120, 0,  false },
+
 	// Version 12.x (all use VG rev2)
 	{ "12.1",  "-v121", CONV_V121, 0,  true },
 	{ "121",   nullptr, CONV_V121, 0,  true },  // Alias
@@ -267,14 +409,117 @@ static std::unique_ptr<char[]> ReadFileToBuffer(const std::string& path, uintmax
 	return buf;
 }
 
+//
+// CheckModelInput
+// Purpose: reject inputs a converter would Error() out on or read past before it runs.
+//			Error() exits the process, in a job list that would take every other job down with it
+//
+static bool CheckModelInput(const VersionMapping* mapping, const char* pMDL, const size_t fileSize, const std::string& inputFile, std::string& error)
+{
+	size_t headerSize = 0;
+
+	switch (mapping->converterID)
+	{
+	case CONV_V8:
+	case CONV_V120:
+		headerSize = sizeof(r5::v8::studiohdr_t);
+		break;
+	case CONV_V121:
+		headerSize = sizeof(r5::v121::studiohdr_t);
+		break;
+	case CONV_V122:
+		headerSize = sizeof(r5::v122::studiohdr_t);
+		break;
+	case CONV_V124:
+		headerSize = sizeof(r5::v124::studiohdr_t);
+		break;
+	case CONV_V125:
+		headerSize = sizeof(r5::v125::studiohdr_t);
+		break;
+	case CONV_V140:
+	case CONV_V150:
+		headerSize = sizeof(r5::v140::studiohdr_t);
+		break;
+	case CONV_V160:
+		headerSize = sizeof(r5::v160::studiohdr_t);
+		break;
+	case CONV_V191:
+		headerSize = sizeof(r5::v191::studiohdr_t);
+		break;
+	default:
+		error = "no converter for version '" + std::string(mapping->version) + "'";
+		return false;
+	}
+
+	if (fileSize < headerSize)
+	{
+		error = "file is " + std::to_string(fileSize) + " bytes, smaller than a v" + mapping->version + " header";
+		return false;
+	}
+
+	// v16 and later headers start with their flags, everything before is a regular IDST header
+	if (mapping->converterID == CONV_V160 || mapping->converterID == CONV_V191)
+		return true;
+
+	const r5::v8::studiohdr_t* const pHdr = reinterpret_cast<const r5::v8::studiohdr_t*>(pMDL);
+
+	if (pHdr->id != 'TSDI')
+	{
+		error = "not a studio model (no IDST magic)";
+		return false;
+	}
+
+	if (pHdr->version != MdlVersion::APEXLEGENDS)
+	{
+		error = "model version " + std::to_string(pHdr->version) + ", expected " + std::to_string(MdlVersion::APEXLEGENDS);
+		return false;
+	}
+
+	if (pHdr->length < static_cast<int>(headerSize) || static_cast<size_t>(pHdr->length) > fileSize)
+	{
+		error = "header length " + std::to_string(pHdr->length) + " doesn't fit the " + std::to_string(fileSize) + " byte file";
+		return false;
+	}
+
+	// v8 builds its vg from the loose source files
+	if (mapping->converterID == CONV_V8)
+	{
+		if ((!FILE_EXISTS(ChangeExtension(inputFile, "vtx")) && !FILE_EXISTS(ChangeExtension(inputFile, "dx11.vtx"))) || !FILE_EXISTS(ChangeExtension(inputFile, "vvd")))
+		{
+			error = "'.vtx' and '.vvd' files are required but were not found";
+			return false;
+		}
+
+		if ((pHdr->flags & (STUDIOHDR_FLAGS_USES_VERTEX_COLOR | STUDIOHDR_FLAGS_USES_UV2)) && !FILE_EXISTS(ChangeExtension(inputFile, "vvc")))
+		{
+			error = "model requires a '.vvc' file but it was not found";
+			return false;
+		}
+
+		if ((pHdr->flags & STUDIOHDR_FLAGS_USES_EXTRA_BONE_WEIGHTS) && !FILE_EXISTS(ChangeExtension(inputFile, "vvw")))
+		{
+			error = "model requires a '.vvw' file but it was not found";
+			return false;
+		}
+	}
+
+	return true;
+}
+
 static bool ConvertModel(const VersionMapping* mapping, char* pMDL, size_t fileSize,
-                         const std::string& inputFile, const std::string& outputFile)
+                         const std::string& inputFile, const std::string& outputFile, std::string& error)
 {
+	if (!CheckModelInput(mapping, pMDL, fileSize, inputFile, error))
+		return false;
+
 	switch (mapping->converterID)
 	{
 	case CONV_V8:
 		ConvertRMDL8To10(pMDL, inputFile, outputFile);
 		break;
+	case CONV_V120:
+		ConvertRMDL120To10(pMDL, fileSize, inputFile, outputFile);
+		break;
 	case CONV_V121:
 		ConvertRMDL121To10(pMDL, inputFile, outputFile);
 		break;
@@ -300,13 +545,24 @@ static bool ConvertModel(const VersionMapping* mapping, char* pMDL, size_t fileS
 		ConvertRMDL191To10(pMDL, fileSize, inputFile, outputFile);
 		break;
 	default:
+		error = "no converter for version '" + std::string(mapping->version) + "'";
 		return false;
 	}
 	return true;
 }
 
+static void AddOutputBytes(const std::filesystem::path& path)
+{
+	std::error_code ec;
+	const uintmax_t size = std::filesystem::file_size(path, ec);
+	if (!ec)
+		g_metrics.bytesOut += size;
+}
+
 static bool ConvertVGFile(const std::string& inputFile, const std::string& outputFile)
 {
+	stagetimer timer(BatchStage_t::VG);
+
 	std::filesystem::path vgInputPath(inputFile);
 	vgInputPath.replace_extension(".vg");
 
@@ -323,6 +579,8 @@ static bool ConvertVGFile(const std::string& inputFile, const std::string& outpu
 	vgIfs.read(vgBuf.get(), vgSize);
 	vgIfs.close();
 
+	g_metrics.bytesIn += vgSize;
+
 	if (*(int*)vgBuf.get() != 'GVt0')
 		return false;
 
@@ -330,12 +588,15 @@ static bool ConvertVGFile(const std::string& inputFile, const std::string& outpu
 	vgOutputPath.replace_extension(".vg");
 
 	ConvertVGData_12_1(vgBuf.get(), vgInputPath.string(), vgOutputPath.string());
+	AddOutputBytes(vgOutputPath);
 	printf("  VG converted: %s\n", vgOutputPath.filename().string().c_str());
 	return true;
 }
 
-static bool ConvertSingleModel(const std::string& inputPath, const std::string& outputPath, const std::string& version)
+// error gets why the model failed, when it fails before a converter had to Error() out
+static bool ConvertSingleModel(const std::string& inputPath, const std::string& outputPath, const std::string& version, std::string* const pError = nullptr)
 {
+	std::string error;
 	const VersionMapping* mapping = FindVersionMapping(version);
 	if (!mapping)
 	{
@@ -344,13 +605,24 @@ static bool ConvertSingleModel(const std::string& inputPath, const std::string&
 	}
 
 	uintmax_t fileSize = 0;
-	auto pMDL = ReadFileToBuffer(inputPath, fileSize);
+	std::unique_ptr<char[]> pMDL;
+	{
+		stagetimer timer(BatchStage_t::READ);
+		pMDL = ReadFileToBuffer(inputPath, fileSize);
+	}
+
 	if (!pMDL)
 	{
 		printf("ERROR: Could not read file '%s'\n", inputPath.c_str());
+
+		if (pError)
+			*pError = "could not read file";
+
 		return false;
 	}
 
+	g_metrics.bytesIn += fileSize;
+
 	// Create output directory if needed
 	std::filesystem::path outPath(outputPath);
 	if (outPath.has_parent_path())
@@ -358,12 +630,21 @@ static bool ConvertSingleModel(const std::string& inputPath, const std::string&
 
 	printf("Converting: %s (v%s)\n", inputPath.c_str(), version.c_str());
 
-	if (!ConvertModel(mapping, pMDL.get(), fileSize, inputPath, outputPath))
 	{
-		printf("ERROR: Conversion failed\n");
-		return false;
+		stagetimer timer(BatchStage_t::CONVERT);
+		if (!ConvertModel(mapping, pMDL.get(), fileSize, inputPath, outputPath, error))
+		{
+			printf("ERROR: Conversion failed: %s\n", error.c_str());
+
+			if (pError)
+				*pError = error;
+
+			return false;
+		}
 	}
 
+	AddOutputBytes(outPath);
+
 	if (mapping->hasVG)
 		ConvertVGFile(inputPath, outputPath);
 
@@ -396,6 +677,8 @@ void BatchConvertModels(const std::string& sourceVersion, const std::string& inp
 	int failCount = 0;
 	int totalCount = 0;
 
+	// collect the models first so the queue depth is known
+	std::vector<std::filesystem::path> modelPaths;
 	for (const auto& entry : std::filesystem::recursive_directory_iterator(inputPath))
 	{
 		if (!entry.is_regular_file())
@@ -407,67 +690,670 @@ void BatchConvertModels(const std::string& sourceVersion, const std::string& inp
 		if (ext != ".rmdl")
 			continue;
 
+		modelPaths.push_back(entry.path());
+	}
+
+	g_metrics.queueDepth = modelPaths.size();
+
+	for (const std::filesystem::path& modelPath : modelPaths)
+	{
 		totalCount++;
+		g_metrics.queueDepth--;
 
-		std::filesystem::path relativePath = std::filesystem::relative(entry.path(), inputPath);
+		std::filesystem::path relativePath = std::filesystem::relative(modelPath, inputPath);
 		std::filesystem::path outputFilePath = outputPath / relativePath;
 
 		std::filesystem::create_directories(outputFilePath.parent_path());
 
-		std::string inputFile = entry.path().string();
+		std::string inputFile = modelPath.string();
 		std::string outputFile = outputFilePath.string();
 
 		printf("[%d] Converting: %s\n", totalCount, relativePath.string().c_str());
 
 		try
 		{
-			uintmax_t fileSize = std::filesystem::file_size(entry.path());
+			uintmax_t fileSize = std::filesystem::file_size(modelPath);
 			std::unique_ptr<char[]> pMDL(new char[fileSize]);
 
-			std::ifstream ifs(inputFile, std::ios::in | std::ios::binary);
-			if (!ifs.is_open())
 			{
-				printf("  ERROR: Could not open file\n");
-				failCount++;
-				continue;
+				stagetimer timer(BatchStage_t::READ);
+
+				std::ifstream ifs(inputFile, std::ios::in | std::ios::binary);
+				if (!ifs.is_open())
+				{
+					printf("  ERROR: Could not open file\n");
+					failCount++;
+					AddModelResult(sourceVersion, false);
+					continue;
+				}
+				ifs.read(pMDL.get(), fileSize);
+				ifs.close();
 			}
-			ifs.read(pMDL.get(), fileSize);
-			ifs.close();
 
-			if (!ConvertModel(mapping, pMDL.get(), fileSize, inputFile, outputFile))
+			g_metrics.bytesIn += fileSize;
+
 			{
-				printf("  ERROR: Conversion failed\n");
-				failCount++;
-				continue;
+				stagetimer timer(BatchStage_t::CONVERT);
+				std::string error;
+				if (!ConvertModel(mapping, pMDL.get(), fileSize, inputFile, outputFile, error))
+				{
+					printf("  ERROR: Conversion failed: %s\n", error.c_str());
+					failCount++;
+					AddModelResult(sourceVersion, false);
+					continue;
+				}
 			}
 
+			AddOutputBytes(outputFilePath);
+
 			if (mapping->hasVG)
 				ConvertVGFile(inputFile, outputFile);
 
 			successCount++;
+			AddModelResult(sourceVersion, true);
 		}
 		catch (const std::exception& e)
 		{
 			printf("  ERROR: %s\n", e.what());
 			failCount++;
+			AddModelResult(sourceVersion, false);
 		}
 	}
 
+	FlushOutputFiles();
+
 	printf("\n");
 	printf("========================================\n");
 	printf("Batch conversion complete!\n");
 	printf("  Total:   %d\n", totalCount);
 	printf("  Success: %d\n", successCount);
 	printf("  Failed:  %d\n", failCount);
+	PrintOutputWriteStats();
 	printf("========================================\n");
 }
 
-int main(int argc, char** argv)
+//
+// JOB LISTS
+//
+
+struct ConvertJob
+{
+	std::string input;
+	std::string version;
+	std::string output;
+	std::string options;	// space separated flags, same as on the command line
+};
+
+struct ConvertJobResult
+{
+	bool success;
+	bool aborted;	// the process exited before this job finished
+	std::string error;
+	double seconds;
+	uintmax_t outputSize;
+};
+
+enum ConvertJobState_t : int
+{
+	JOB_QUEUED,
+	JOB_RUNNING,
+	JOB_DONE,	// its result is final
+};
+
+// what an exit from inside a converter needs to still write the summary of a running job list
+struct ConvertJobListState
+{
+	std::mutex mutex;
+	bool active;	// cleared once the regular summary takes over
+
+	const std::vector<ConvertJob>* jobs;
+	const std::vector<ConvertJobResult>* results;
+	const std::vector<std::atomic<int>>* states;
+
+	std::string summaryFile;
+	std::chrono::steady_clock::time_point start;
+};
+
+static ConvertJobListState s_jobList;
+
+// json: an array of objects with "input", "version", "output" and "options" (a string or an array of flags)
+static bool ReadJobListJSON(const std::string& text, std::vector<ConvertJob>& jobs, std::string& error)
+{
+	jsonvalue root;
+	if (!ParseJson(text, root, error))
+		return false;
+
+	if (!root.IsArray())
+	{
+		error = "expected an array of jobs";
+		return false;
+	}
+
+	for (size_t i = 0; i < root.array.size(); i++)
+	{
+		const jsonvalue& entry = root.array[i];
+		if (!entry.IsObject())
+		{
+			error = "job " + std::to_string(i) + " is not an object";
+			return false;
+		}
+
+		ConvertJob job;
+		for (const auto& it : entry.object)
+		{
+			const std::string& key = it.first;
+			const jsonvalue& value = it.second;
+
+			if (key == "options" && value.IsArray())
+			{
+				for (const jsonvalue& flag : value.array)
+				{
+					if (!flag.IsString())
+					{
+						error = "job " + std::to_string(i) + " has a non string option";
+						return false;
+					}
+
+					if (!job.options.empty())
+						job.options += ' ';
+					job.options += flag.string;
+				}
+
+				continue;
+			}
+
+			if (key != "input" && key != "version" && key != "output" && key != "options")
+				continue;
+
+			if (!value.IsString())
+			{
+				error = "job " + std::to_string(i) + " has a non string '" + key + "'";
+				return false;
+			}
+
+			if (key == "input")
+				job.input = value.string;
+			else if (key == "version")
+				job.version = value.string;
+			else if (key == "output")
+				job.output = value.string;
+			else
+				job.options = value.string;
+		}
+
+		jobs.push_back(job);
+	}
+
+	return true;
+}
+
+// tsv: input<TAB>version<TAB>output[<TAB>options], blank lines and lines starting with '#' are skipped
+static bool ReadJobListTSV(const std::string& text, std::vector<ConvertJob>& jobs, std::string& error)
+{
+	size_t lineStart = 0;
+	int lineNum = 0;
+
+	while (lineStart < text.size())
+	{
+		size_t lineEnd = text.find('\n', lineStart);
+		if (lineEnd == std::string::npos)
+			lineEnd = text.size();
+
+		std::string line = text.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 1;
+		lineNum++;
+
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::vector<std::string> fields;
+		size_t fieldStart = 0;
+		while (true)
+		{
+			const size_t tab = line.find('\t', fieldStart);
+			fields.push_back(line.substr(fieldStart, tab == std::string::npos ? std::string::npos : tab - fieldStart));
+
+			if (tab == std::string::npos)
+				break;
+
+			fieldStart = tab + 1;
+		}
+
+		if (fields.size() < 3 || fields.size() > 4)
+		{
+			error = "expected 3 or 4 tab separated fields on line " + std::to_string(lineNum);
+			return false;
+		}
+
+		ConvertJob job;
+		job.input = fields[0];
+		job.version = fields[1];
+		job.output = fields[2];
+		if (fields.size() == 4)
+			job.options = fields[3];
+
+		jobs.push_back(job);
+	}
+
+	return true;
+}
+
+static bool ReadJobList(const std::string& path, std::vector<ConvertJob>& jobs, std::string& error)
+{
+	std::ifstream ifs(path, std::ios::in | std::ios::binary);
+	if (!ifs.is_open())
+	{
+		error = "could not open file";
+		return false;
+	}
+
+	const std::string text((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+	const size_t first = text.find_first_not_of(" \t\r\n");
+	if (first != std::string::npos && text[first] == '[')
+		return ReadJobListJSON(text, jobs, error);
+
+	return ReadJobListTSV(text, jobs, error);
+}
+
+// job options use the same flags as the command line
+static void ParseJobOptions(const std::string& jobOptions, s_convertoptions_t& options)
+{
+	if (jobOptions.empty())
+		return;
+
+	// CommandLine skips argv[0]
+	std::vector<std::string> tokens{ "rmdlconv" };
+	size_t tokenStart = jobOptions.find_first_not_of(" \t");
+	while (tokenStart != std::string::npos)
+	{
+		const size_t tokenEnd = jobOptions.find_first_of(" \t", tokenStart);
+		tokens.push_back(jobOptions.substr(tokenStart, tokenEnd == std::string::npos ? std::string::npos : tokenEnd - tokenStart));
+		tokenStart = jobOptions.find_first_not_of(" \t", tokenEnd);
+	}
+
+	std::vector<char*> args;
+	for (std::string& token : tokens)
+		args.push_back(token.data());
+
+	const CommandLine jobCmdline(static_cast<int>(args.size()), args.data());
+	ParseConvertOptions(jobCmdline, options);
+}
+
+//
+// RunConvertJob
+// Purpose: convert one job on the calling thread, g_model and g_options are thread local
+//
+static void RunConvertJob(const ConvertJob& job, const s_convertoptions_t& baseOptions, ConvertJobResult& result)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	result.success = false;
+	result.aborted = false;
+	result.outputSize = 0;
+
+	g_options = baseOptions;
+	ParseJobOptions(job.options, g_options);
+
+	try
+	{
+		if (job.input.empty() || job.output.empty())
+			result.error = "missing input or output path";
+		else if (!FindVersionMapping(job.version))
+			result.error = "unknown version '" + job.version + "'";
+		else if (!std::filesystem::exists(job.input))
+			result.error = "input file does not exist";
+		else if (!ConvertSingleModel(job.input, job.output, job.version, &result.error))
+		{
+			if (result.error.empty())
+				result.error = "conversion failed";
+		}
+		else
+		{
+			result.success = true;
+			result.outputSize = std::filesystem::exists(job.output) ? std::filesystem::file_size(job.output) : 0;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		result.error = e.what();
+	}
+
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	AddModelResult(job.version, result.success);
+}
+
+static bool WriteJobSummary(const std::string& path, const std::vector<ConvertJob>& jobs, const std::vector<ConvertJobResult>& results,
+	const int successCount, const double seconds)
+{
+	std::ofstream ofs(path, std::ios::out | std::ios::binary);
+	if (!ofs.is_open())
+		return false;
+
+	size_t abortedCount = 0;
+	for (const ConvertJobResult& result : results)
+		abortedCount += result.aborted ? 1 : 0;
+
+	ofs << "{\n";
+	ofs << "\t\"total\": " << jobs.size() << ",\n";
+	ofs << "\t\"success\": " << successCount << ",\n";
+	ofs << "\t\"failed\": " << jobs.size() - successCount << ",\n";
+	ofs << "\t\"aborted\": " << abortedCount << ",\n";
+	ofs << "\t\"seconds\": " << seconds << ",\n";
+	ofs << "\t\"jobs\": [";
+
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		const ConvertJob& job = jobs[i];
+		const ConvertJobResult& result = results[i];
+
+		ofs << (i ? ",\n" : "\n");
+		ofs << "\t\t{ \"input\": \"" << JsonEscape(job.input) << "\", \"version\": \"" << JsonEscape(job.version)
+			<< "\", \"output\": \"" << JsonEscape(job.output) << "\", \"success\": " << (result.success ? "true" : "false")
+			<< ", \"aborted\": " << (result.aborted ? "true" : "false")
+			<< ", \"error\": \"" << JsonEscape(result.error) << "\", \"seconds\": " << result.seconds
+			<< ", \"outputSize\": " << result.outputSize << " }";
+	}
+
+	ofs << "\n\t]\n}\n";
+
+	return ofs.good();
+}
+
+//
+// WriteAbortedJobSummary
+// Purpose: atexit and terminate hook for job lists. converters still Error() out on malformed data the input checks
+//			don't catch, which exits the whole process. the summary is written with every job that hadn't finished marked aborted
+//
+static void WriteAbortedJobSummary()
+{
+	std::lock_guard<std::mutex> lock(s_jobList.mutex);
+
+	if (!s_jobList.active)
+		return;
+
+	s_jobList.active = false;
+
+	const std::vector<ConvertJob>& jobs = *s_jobList.jobs;
+	std::vector<ConvertJobResult> results(jobs.size());
+
+	int successCount = 0;
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		const int state = (*s_jobList.states)[i].load(std::memory_order_acquire);
+
+		if (state == JOB_DONE)
+			results[i] = (*s_jobList.results)[i];
+		else
+		{
+			results[i].aborted = true;
+			results[i].error = state == JOB_RUNNING ? "aborted while converting, a converter error ended the process" : "aborted before it started";
+		}
+
+		successCount += results[i].success ? 1 : 0;
+	}
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - s_jobList.start).count();
+
+	if (WriteJobSummary(s_jobList.summaryFile, jobs, results, successCount, seconds))
+		printf("Summary of the aborted job list written to: %s\n", s_jobList.summaryFile.c_str());
+	else
+		printf("ERROR: Could not write summary '%s'\n", s_jobList.summaryFile.c_str());
+}
+
+//
+// BatchConvertJobs
+// Purpose: convert an explicit job list (no directory walk) on a pool of worker threads
+// returns true if every job succeeded
+//
+bool BatchConvertJobs(const std::string& jobsFile, const std::string& summaryFile, int numThreads)
+{
+	std::vector<ConvertJob> jobs;
+	std::string error;
+
+	if (!ReadJobList(jobsFile, jobs, error))
+		Error("Failed to read job list '%s': %s\n", jobsFile.c_str(), error.c_str());
+
+	if (numThreads <= 0)
+		numThreads = max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+	numThreads = min(numThreads, max(static_cast<int>(jobs.size()), 1));
+
+	printf("Job list: %s\n", jobsFile.c_str());
+	printf("Jobs: %d, threads: %d\n", static_cast<int>(jobs.size()), numThreads);
+	printf("\n");
+
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<ConvertJobResult> results(jobs.size());
+	std::vector<std::atomic<int>> states(jobs.size());
+
+	{
+		std::lock_guard<std::mutex> lock(s_jobList.mutex);
+
+		s_jobList.jobs = &jobs;
+		s_jobList.results = &results;
+		s_jobList.states = &states;
+		s_jobList.summaryFile = summaryFile;
+		s_jobList.start = start;
+		s_jobList.active = true;
+	}
+
+	static std::once_flag s_hookOnce;
+	std::call_once(s_hookOnce, []()
+	{
+		atexit(WriteAbortedJobSummary);
+
+		static const std::terminate_handler s_defaultTerminate = std::get_terminate();
+		std::set_terminate([]()
+		{
+			WriteAbortedJobSummary();
+
+			if (s_defaultTerminate)
+				s_defaultTerminate();
+
+			std::abort();
+		});
+	});
+
+	g_metrics.queueDepth = jobs.size();
+
+	// the main thread's options are the base every job adds its own to
+	const s_convertoptions_t baseOptions = g_options;
+
+	ParallelFor(jobs.size(), numThreads, [&](const size_t i)
+	{
+		g_metrics.queueDepth--;
+
+		states[i].store(JOB_RUNNING, std::memory_order_relaxed);
+		RunConvertJob(jobs[i], baseOptions, results[i]);
+		states[i].store(JOB_DONE, std::memory_order_release);
+	});
+
+	// every job finished, the regular summary below replaces the abort hook's
+	{
+		std::lock_guard<std::mutex> lock(s_jobList.mutex);
+		s_jobList.active = false;
+	}
+
+	g_options = baseOptions;
+
+	FlushOutputFiles();
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	int successCount = 0;
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		if (results[i].success)
+			successCount++;
+		else
+			printf("  FAILED: %s (%s)\n", jobs[i].input.c_str(), results[i].error.c_str());
+	}
+
+	const int failCount = static_cast<int>(jobs.size()) - successCount;
+
+	printf("\n");
+	printf("========================================\n");
+	printf("Job list complete! (%.2fs)\n", seconds);
+	printf("  Total:   %d\n", static_cast<int>(jobs.size()));
+	printf("  Success: %d\n", successCount);
+	printf("  Failed:  %d\n", failCount);
+	PrintOutputWriteStats();
+	printf("========================================\n");
+
+	if (WriteJobSummary(summaryFile, jobs, results, successCount, seconds))
+		printf("Summary written to: %s\n", summaryFile.c_str());
+	else
+		printf("ERROR: Could not write summary '%s'\n", summaryFile.c_str());
+
+	return failCount == 0;
+}
+
+//
+// RunBenchmarkMode
+// Purpose: kernel benchmarks plus end to end conversions from -bench-jobs, optionally gated against a baseline
+// returns the process exit code
+//
+static int RunBenchmarkMode(const CommandLine& cmdline)
+{
+	const int samples = max(atoi(cmdline.GetParamValue("-bench-runs", "11")), 3);
+
+	std::vector<s_benchmark_t> benchmarks;
+
+	// synthetic mesh for the vertex kernels, strides match uv2 stripping on common vertex formats
+	constexpr uint32_t benchVertCount = 65536;
+	const std::pair<uint32_t, uint32_t> repackStrides[] = { { 56, 48 }, { 40, 32 } };
+
+	for (const auto& strides : repackStrides)
+	{
+		auto pSrc = std::make_shared<std::vector<char>>(static_cast<size_t>(strides.first) * benchVertCount);
+		auto pDst = std::make_shared<std::vector<char>>(static_cast<size_t>(strides.second) * benchVertCount);
+
+		for (size_t i = 0; i < pSrc->size(); i++)
+			(*pSrc)[i] = static_cast<char>(i * 31);
+
+		const std::string name = "kernel/repack_vertices_" + std::to_string(strides.first) + "_" + std::to_string(strides.second);
+		benchmarks.push_back({ name, [pSrc, pDst, strides]() {
+			g_kernels.RepackVertices(pDst->data(), strides.second, pSrc->data(), strides.first, benchVertCount);
+		}, true });
+	}
+
+	// positions at the start of a vvd sized vertex
+	{
+		auto pVerts = std::make_shared<std::vector<float>>(static_cast<size_t>(benchVertCount) * sizeof(vvd::mstudiovertex_t) / sizeof(float));
+
+		for (size_t i = 0; i < pVerts->size(); i++)
+			(*pVerts)[i] = static_cast<float>(i % 1021) - 510.0f;
+
+		benchmarks.push_back({ "kernel/extend_bounds_48", [pVerts]() {
+			float mins[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			float maxs[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			g_kernels.ExtendBounds(reinterpret_cast<const char*>(pVerts->data()), sizeof(vvd::mstudiovertex_t), benchVertCount, mins, maxs);
+		}, true });
+	}
+
+	if (cmdline.HasParam("-bench-jobs"))
+	{
+		const char* jobsFile = cmdline.GetParamValue("-bench-jobs", nullptr);
+
+		std::vector<ConvertJob> jobs;
+		std::string error;
+
+		if (!jobsFile || !ReadJobList(jobsFile, jobs, error))
+			Error("Failed to read benchmark job list: %s\n", jobsFile ? error.c_str() : "missing file");
+
+		const s_convertoptions_t baseOptions = g_options;
+		for (const ConvertJob& job : jobs)
+		{
+			if (!FindVersionMapping(job.version) || !std::filesystem::exists(job.input) || job.output.empty())
+			{
+				printf("WARNING: skipping benchmark job '%s', invalid version or path\n", job.input.c_str());
+				continue;
+			}
+
+			s_convertoptions_t options = baseOptions;
+			ParseJobOptions(job.options, options);
+
+			const std::string name = "convert/" + std::filesystem::path(job.input).filename().string() + "@" + job.version;
+			benchmarks.push_back({ name, [job, options]() {
+				g_options = options;
+				ConvertSingleModel(job.input, job.output, job.version);
+			}, false });
+		}
+	}
+
+	s_benchinfo_t info;
+	info.isa = GetIsaName(g_cpu.activeIsa);
+	info.revision = cmdline.HasParam("-bench-rev") ? cmdline.GetParamValue("-bench-rev", "unknown") : GetSourceRevision();
+
+	printf("Benchmarking %d benchmarks, %d samples each (isa: %s, revision: %s)\n", static_cast<int>(benchmarks.size()), samples, info.isa.c_str(), info.revision.c_str());
+
+	const s_convertoptions_t savedOptions = g_options;
+	const std::vector<s_benchresult_t> results = RunBenchmarks(benchmarks, samples);
+	g_options = savedOptions;
+
+	const std::string resultsFile = cmdline.GetParamValue("-bench-out", "bench_results.json");
+	if (WriteBenchResults(resultsFile, info, results))
+		printf("Results written to: %s\n", resultsFile.c_str());
+	else
+		printf("ERROR: Could not write benchmark results '%s'\n", resultsFile.c_str());
+
+	if (!cmdline.HasParam("-bench-baseline"))
+		return 0;
+
+	const char* baselineFile = cmdline.GetParamValue("-bench-baseline", nullptr);
+	if (!baselineFile)
+		Error("Missing file for '-bench-baseline'\n");
+
+	const double threshold = atof(cmdline.GetParamValue("-bench-threshold", "0.10"));
+	const int regressions = CompareBenchBaseline(baselineFile, info, results, threshold > 0.0 ? threshold : BENCH_DEFAULT_THRESHOLD);
+
+	if (regressions < 0)
+		return 1;
+
+	if (regressions > 0)
+	{
+		printf("\n%d benchmark(s) regressed\n", regressions);
+		return 1;
+	}
+
+	printf("\nNo regressions\n");
+	return 0;
+}
+
+static void StartMetricsFromCommandLine(const CommandLine& cmdline)
+{
+	if (!cmdline.HasParam("-metrics"))
+		return;
+
+	const char* metricsFile = cmdline.GetParamValue("-metrics", nullptr);
+	if (!metricsFile)
+		Error("Missing file for '-metrics'\n");
+
+	StartMetricsExport(metricsFile, atoi(cmdline.GetParamValue("-metrics-interval", "5")));
+}
+
+static void SetOutputWriteFromCommandLine(const CommandLine& cmdline)
 {
-	printf("rmdlconv - Copyright (c) %s, rexx\n", &__DATE__[7]);
+	const size_t chunkSize = static_cast<size_t>(max(atoi(cmdline.GetParamValue("-writechunk", "1024")), 4)) * 1024;
+	const int syncEvery = cmdline.HasParam("-syncoutputs") ? max(atoi(cmdline.GetParamValue("-syncoutputs", "0")), 0) : -1;
+
+	SetOutputWriteOptions(chunkSize, syncEvery);
+}
 
+int main(int argc, char** argv)
+{
 	CommandLine cmdline(argc, argv);
 
+	InitCpuDispatch(cmdline.HasParam("-isa") ? cmdline.GetParamValue("-isa") : nullptr);
+
+	printf("rmdlconv - Copyright (c) %s, rexx (isa: %s)\n", &__DATE__[7], GetIsaName(g_cpu.activeIsa));
+
 	if (argc < 2)
 	{
 		printf("%s", pszBatchHelpString);
@@ -481,6 +1367,44 @@ int main(int argc, char** argv)
 		return 0;
 	}
 
+	if (cmdline.HasParam("-bench"))
+	{
+		ParseConvertOptions(cmdline, g_options);
+		SetOutputWriteFromCommandLine(cmdline);
+
+		const int exitCode = RunBenchmarkMode(cmdline);
+
+		if (!cmdline.HasParam("-nopause"))
+			std::system("pause");
+
+		return exitCode;
+	}
+
+	if (cmdline.HasParam("-jobs-from"))
+	{
+		const char* jobsFile = cmdline.GetParamValue("-jobs-from", nullptr);
+		if (!jobsFile)
+		{
+			printf("%s", pszBatchHelpString);
+			Error("Missing job list file for '-jobs-from'\n");
+		}
+
+		const std::string summaryFile = cmdline.HasParam("-summary") ? cmdline.GetParamValue("-summary") : std::string(jobsFile) + ".summary.json";
+		const int numThreads = atoi(cmdline.GetParamValue("-threads", "0"));
+
+		ParseConvertOptions(cmdline, g_options);
+		SetOutputWriteFromCommandLine(cmdline);
+
+		StartMetricsFromCommandLine(cmdline);
+		const bool allSucceeded = BatchConvertJobs(jobsFile, summaryFile, numThreads);
+		StopMetricsExport();
+
+		if (!cmdline.HasParam("-nopause"))
+			std::system("pause");
+
+		return allSucceeded ? 0 : 1;
+	}
+
 	// Check for batch conversion flags (uses version mapping table)
 	for (const VersionMapping* m = s_versionMappings; m->version != nullptr; m++)
 	{
@@ -505,7 +1429,12 @@ int main(int argc, char** argv)
 			else
 				outputFolder = inputFolder + "_rmdlconv_out";
 
+			ParseConvertOptions(cmdline, g_options);
+			SetOutputWriteFromCommandLine(cmdline);
+
+			StartMetricsFromCommandLine(cmdline);
 			BatchConvertModels(m->version, inputFolder, outputFolder);
+			StopMetricsExport();
 
 			if (!cmdline.HasParam("-nopause"))
 				std::system("pause");
@@ -531,7 +1460,13 @@ int main(int argc, char** argv)
 			outputPath = std::string(customDir) + "/" + std::filesystem::path(modelPath).filename().string();
 		}
 
-		if (!ConvertSingleModel(modelPath, outputPath, sourceVersion))
+		ParseConvertOptions(cmdline, g_options);
+		SetOutputWriteFromCommandLine(cmdline);
+
+		const bool converted = ConvertSingleModel(modelPath, outputPath, sourceVersion);
+		FlushOutputFiles();
+
+		if (!converted)
 		{
 			if (!cmdline.HasParam("-nopause"))
 				std::system("pause");
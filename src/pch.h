@@ -6,9 +6,17 @@
 #include <fstream>
 #include <filesystem>
 #include <iostream>
+#include <algorithm>
 #include <map>
 #include <set>
 #include <vector>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 #include <cstdarg>
 #include <cassert>
 #include <cstdlib>
@@ -22,6 +30,11 @@
 
 #include <core/utils.h>
 #include <core/rmem.h>
+#include <core/bytemap.h>
+#include <core/cpu.h>
+#include <core/metrics.h>
+#include <core/outfile.h>
+#include <core/parallel.h>
 #include <core/BinaryIO.h>
 
 #include <core/math/mathlib.h>
@@ -0,0 +1,1482 @@
+#include <pch.h>
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <studio/studio.h>
+#include <studio/collision.h>
+
+//-----------------------------------------------------------------------------
+// Collision BVH generation
+//-----------------------------------------------------------------------------
+
+#define BVH_MAX_LEAF_TRIS	16 // limited by the 4 bit count in the leaf header
+#define BVH_MIN_LEAF_TRIS	4
+#define BVH_NUM_BINS		16
+
+// subtrees with fewer triangles than this are not worth a thread
+#define BVH_PARALLEL_MIN_TRIS 4096
+
+struct bvhbounds_t
+{
+	float mins[3];
+	float maxs[3];
+
+	inline void Clear()
+	{
+		mins[0] = mins[1] = mins[2] = FLT_MAX;
+		maxs[0] = maxs[1] = maxs[2] = -FLT_MAX;
+	}
+
+	inline void Add(const float* const point)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			mins[i] = min(mins[i], point[i]);
+			maxs[i] = max(maxs[i], point[i]);
+		}
+	}
+
+	inline void Add(const bvhbounds_t& bounds)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			mins[i] = min(mins[i], bounds.mins[i]);
+			maxs[i] = max(maxs[i], bounds.maxs[i]);
+		}
+	}
+
+	// half surface area, the factor doesn't matter for sah
+	inline float Area() const
+	{
+		const float x = maxs[0] - mins[0];
+		const float y = maxs[1] - mins[1];
+		const float z = maxs[2] - mins[2];
+
+		return (x * y) + (y * z) + (z * x);
+	}
+};
+
+struct bvhbuildtri_t
+{
+	int verts[3];
+	bvhbounds_t bounds;
+	float centroid[3];
+};
+
+struct bvhbuildnode_t
+{
+	bvhbounds_t bounds;
+	int children[2]; // -1 if this is a leaf
+	int firstTri;
+	int numTris;
+};
+
+struct bvhbuildstate_t
+{
+	std::vector<Vector> verts;
+	std::vector<bvhbuildtri_t> tris;
+	std::vector<int> triIndices; // partitioned in place while building, subtrees never overlap so threads can share it
+
+	int parallelDepth;
+};
+
+struct bvhemitstate_t
+{
+	const bvhbuildstate_t* build;
+	const std::vector<bvhbuildnode_t>* nodes;
+
+	float origin[3];
+	float invScale;
+
+	std::vector<r5::v8::mstudiocollbvhnode_t> outNodes;
+	std::vector<uint32_t> outLeaves;
+	std::vector<short> outVerts; // xyz
+
+	int numLeaves;
+	int maxDepth;
+	bool overflow;
+};
+
+//
+// GatherCollisionTris
+// Purpose: collects lod 0 triangles of the default model in each bodypart from vtx/vvd
+//
+static void GatherCollisionTris(r5::v8::studiohdr_t* const pHdr, OptimizedModel::FileHeader_t* const pVtx, vvd::vertexFileHeader_t* const pVVD, bvhbuildstate_t& state)
+{
+	std::vector<const vvd::mstudiovertex_t*> pVvdVertices;
+	std::vector<const Vector4D*> pVvdTangents;
+	std::vector<const Color32*> pVvcColors;
+	std::vector<const Vector2D*> pVvcUv2s;
+
+	GetVertexesFromVVD(pVVD, nullptr, 0, pVvdVertices, pVvdTangents, pVvcColors, pVvcUv2s);
+
+	state.verts.reserve(pVvdVertices.size());
+	for (const vvd::mstudiovertex_t* const pVvdVert : pVvdVertices)
+		state.verts.push_back(pVvdVert->m_vecPosition);
+
+	int localVertOffset = 0;
+	int sourceMeshIdx = 0;
+	for (int bodyPartIdx = 0; bodyPartIdx < pVtx->numBodyParts; bodyPartIdx++)
+	{
+		OptimizedModel::BodyPartHeader_t* pVtxBodyPart = pVtx->pBodyPart(bodyPartIdx);
+		r5::v8::mstudiobodyparts_t* pMdlBodyPart = pHdr->pBodypart(bodyPartIdx);
+
+		for (int modelIdx = 0; modelIdx < pVtxBodyPart->numModels; modelIdx++)
+		{
+			OptimizedModel::ModelLODHeader_t* pVtxLod = pVtxBodyPart->pModel(modelIdx)->pLOD(0);
+			r5::v8::mstudiomodel_t* pMdlModel = pMdlBodyPart->pModel(modelIdx);
+
+			for (int meshIdx = 0; meshIdx < pVtxLod->numMeshes; meshIdx++, sourceMeshIdx++)
+			{
+				OptimizedModel::MeshHeader_t* pVtxMesh = pVtxLod->pMesh(meshIdx);
+				const r5::v8::mstudiomesh_t* pMdlMesh = GetSourceMesh(pMdlModel, meshIdx, sourceMeshIdx);
+
+				// only the default model of a bodypart should collide
+				for (int stripGrpIdx = 0; modelIdx == 0 && stripGrpIdx < pVtxMesh->numStripGroups; stripGrpIdx++)
+				{
+					OptimizedModel::StripGroupHeader_t* pVtxStripGrp = pVtxMesh->pStripGroup(stripGrpIdx);
+
+					for (int idx = 0; idx + 2 < pVtxStripGrp->numIndices; idx += 3)
+					{
+						bvhbuildtri_t tri {};
+						bool valid = true;
+
+						for (int k = 0; k < 3; k++)
+						{
+							tri.verts[k] = localVertOffset + pVtxStripGrp->pVertex(pVtxStripGrp->Index(idx + k))->origMeshVertID;
+
+							if (tri.verts[k] >= static_cast<int>(state.verts.size()))
+								valid = false;
+						}
+
+						// drop degenerate triangles, they can never be hit
+						if (!valid || tri.verts[0] == tri.verts[1] || tri.verts[1] == tri.verts[2] || tri.verts[0] == tri.verts[2])
+							continue;
+
+						tri.bounds.Clear();
+						for (int k = 0; k < 3; k++)
+							tri.bounds.Add(&state.verts[tri.verts[k]].x);
+
+						for (int k = 0; k < 3; k++)
+							tri.centroid[k] = (tri.bounds.mins[k] + tri.bounds.maxs[k]) * 0.5f;
+
+						state.tris.push_back(tri);
+					}
+				}
+
+				int meshVertCount = pMdlMesh->vertexloddata.numLODVertexes[0];
+				if (meshVertCount == 0)
+					meshVertCount = pMdlMesh->numvertices;
+
+				localVertOffset += meshVertCount;
+			}
+		}
+	}
+}
+
+//
+// PartitionBVHTris
+// Purpose: binned sah split along the widest centroid axis
+// returns the first triangle of the right side, or -1 if a leaf is cheaper
+//
+static int PartitionBVHTris(bvhbuildstate_t& state, const int firstTri, const int numTris, const bvhbounds_t& bounds, const bvhbounds_t& centroidBounds)
+{
+	int axis = 0;
+	for (int i = 1; i < 3; i++)
+	{
+		if ((centroidBounds.maxs[i] - centroidBounds.mins[i]) > (centroidBounds.maxs[axis] - centroidBounds.mins[axis]))
+			axis = i;
+	}
+
+	int* const pTris = &state.triIndices[firstTri];
+	const float extent = centroidBounds.maxs[axis] - centroidBounds.mins[axis];
+
+	// every centroid is in the same spot, sah can't separate them
+	if (extent <= FLT_EPSILON)
+		return numTris <= BVH_MAX_LEAF_TRIS ? -1 : firstTri + (numTris / 2);
+
+	const float binMin = centroidBounds.mins[axis];
+	const float binScale = (BVH_NUM_BINS * 0.9999f) / extent;
+
+	auto BinForTri = [&](const int tri) -> int
+	{
+		const int bin = static_cast<int>((state.tris[tri].centroid[axis] - binMin) * binScale);
+		return std::clamp(bin, 0, BVH_NUM_BINS - 1);
+	};
+
+	bvhbounds_t binBounds[BVH_NUM_BINS];
+	int binCounts[BVH_NUM_BINS] {};
+
+	for (int i = 0; i < BVH_NUM_BINS; i++)
+		binBounds[i].Clear();
+
+	for (int i = 0; i < numTris; i++)
+	{
+		const int bin = BinForTri(pTris[i]);
+
+		binBounds[bin].Add(state.tris[pTris[i]].bounds);
+		binCounts[bin]++;
+	}
+
+	// sweep from the right to get the cost of every right side
+	float rightAreas[BVH_NUM_BINS] {};
+	int rightCounts[BVH_NUM_BINS] {};
+
+	bvhbounds_t accum;
+	accum.Clear();
+
+	int accumCount = 0;
+	for (int i = BVH_NUM_BINS - 1; i > 0; i--)
+	{
+		if (binCounts[i])
+			accum.Add(binBounds[i]);
+
+		accumCount += binCounts[i];
+
+		rightAreas[i] = accumCount ? accum.Area() : 0.0f;
+		rightCounts[i] = accumCount;
+	}
+
+	// then from the left, testing each plane between bins
+	accum.Clear();
+	accumCount = 0;
+
+	float bestCost = FLT_MAX;
+	int bestBin = -1;
+
+	for (int i = 0; i < BVH_NUM_BINS - 1; i++)
+	{
+		if (binCounts[i])
+			accum.Add(binBounds[i]);
+
+		accumCount += binCounts[i];
+
+		if (!accumCount || !rightCounts[i + 1])
+			continue;
+
+		const float cost = (accum.Area() * accumCount) + (rightAreas[i + 1] * rightCounts[i + 1]);
+		if (cost < bestCost)
+		{
+			bestCost = cost;
+			bestBin = i;
+		}
+	}
+
+	// one traversal step costs about the same as one triangle test
+	const float area = bounds.Area();
+	if (numTris <= BVH_MAX_LEAF_TRIS && (bestBin == -1 || area <= 0.0f || (1.0f + (bestCost / area)) >= numTris))
+		return -1;
+
+	if (bestBin == -1)
+	{
+		std::nth_element(pTris, pTris + (numTris / 2), pTris + numTris, [&](const int a, const int b) { return state.tris[a].centroid[axis] < state.tris[b].centroid[axis]; });
+		return firstTri + (numTris / 2);
+	}
+
+	const int* const pSplit = std::partition(pTris, pTris + numTris, [&](const int tri) { return BinForTri(tri) <= bestBin; });
+	return firstTri + static_cast<int>(pSplit - pTris);
+}
+
+//
+// BuildBVH2_r
+// Purpose: top down binary bvh build, the two sides of large subtrees are built as parallel sections
+//
+static int BuildBVH2_r(bvhbuildstate_t& state, std::vector<bvhbuildnode_t>& nodes, const int firstTri, const int numTris, const int depth)
+{
+	const int nodeIndex = static_cast<int>(nodes.size());
+
+	bvhbuildnode_t node {};
+	node.children[0] = -1;
+	node.children[1] = -1;
+	node.firstTri = firstTri;
+	node.numTris = numTris;
+
+	bvhbounds_t centroidBounds;
+	node.bounds.Clear();
+	centroidBounds.Clear();
+
+	for (int i = firstTri; i < firstTri + numTris; i++)
+	{
+		const bvhbuildtri_t& tri = state.tris[state.triIndices[i]];
+
+		node.bounds.Add(tri.bounds);
+		centroidBounds.Add(tri.centroid);
+	}
+
+	nodes.push_back(node);
+
+	if (numTris <= BVH_MIN_LEAF_TRIS)
+		return nodeIndex;
+
+	const int splitTri = PartitionBVHTris(state, firstTri, numTris, node.bounds, centroidBounds);
+	if (splitTri < 0)
+		return nodeIndex;
+
+	const int numLeft = splitTri - firstTri;
+	const int numRight = numTris - numLeft;
+
+	int leftIndex = -1;
+	int rightIndex = -1;
+
+	if (depth < state.parallelDepth && numTris >= BVH_PARALLEL_MIN_TRIS)
+	{
+		// each side gets its own node list so nothing is shared, appended left then right like the serial build
+		const int sideFirstTri[2] = { firstTri, splitTri };
+		const int sideNumTris[2] = { numLeft, numRight };
+		std::vector<bvhbuildnode_t> sideNodes[2];
+
+		ParallelForSections(2, [&](const size_t i)
+		{
+			BuildBVH2_r(state, sideNodes[i], sideFirstTri[i], sideNumTris[i], depth + 1);
+		});
+
+		int* const pSideIndex[2] = { &leftIndex, &rightIndex };
+		for (int i = 0; i < 2; i++)
+		{
+			*pSideIndex[i] = static_cast<int>(nodes.size());
+
+			for (bvhbuildnode_t sideNode : sideNodes[i])
+			{
+				if (sideNode.children[0] != -1)
+				{
+					sideNode.children[0] += *pSideIndex[i];
+					sideNode.children[1] += *pSideIndex[i];
+				}
+
+				nodes.push_back(sideNode);
+			}
+		}
+	}
+	else
+	{
+		leftIndex = BuildBVH2_r(state, nodes, firstTri, numLeft, depth + 1);
+		rightIndex = BuildBVH2_r(state, nodes, splitTri, numRight, depth + 1);
+	}
+
+	nodes[nodeIndex].children[0] = leftIndex;
+	nodes[nodeIndex].children[1] = rightIndex;
+
+	return nodeIndex;
+}
+
+static inline short QuantizeCollCoord(const float value, const float origin, const float invScale, const int rounding)
+{
+	float quantized = (value - origin) * invScale;
+
+	if (rounding < 0)
+		quantized = floorf(quantized);
+	else if (rounding > 0)
+		quantized = ceilf(quantized);
+	else
+		quantized = roundf(quantized);
+
+	return static_cast<short>(std::clamp(quantized, -32768.0f, 32767.0f));
+}
+
+//
+// EmitBVHLeaf
+// Purpose: writes a poly3 leaf and its verts, returns the leaf index in dwords.
+//			the layout is the apex bvh4 one as reverse engineered for rmdl/bsp collision by the r5 modding tools:
+//			v0 is 11 bits from the leaf's base vertex, v1 and v2 are 9 bit offsets from v0 minus one
+//
+static int EmitBVHLeaf(bvhemitstate_t& state, const bvhbuildnode_t& node)
+{
+	const int leafIndex = static_cast<int>(state.outLeaves.size());
+	const int baseVertex = static_cast<int>(state.outVerts.size() / 3);
+
+	// baseVertex is only 16 bits
+	if (baseVertex > 0xFFFF)
+	{
+		state.overflow = true;
+		return 0;
+	}
+
+	r5::v8::mstudiocollbvhpolyleaf_t leaf {};
+	leaf.surfPropIdx = 0;
+	leaf.numPolys = node.numTris - 1;
+	leaf.baseVertex = baseVertex;
+
+	uint32_t packed = 0;
+	memcpy(&packed, &leaf, sizeof(packed));
+	state.outLeaves.push_back(packed);
+
+	// verts are stored per leaf so every id fits in the packed triangle
+	int leafVerts[BVH_MAX_LEAF_TRIS * 3];
+	int numLeafVerts = 0;
+
+	for (int i = node.firstTri; i < node.firstTri + node.numTris; i++)
+	{
+		const bvhbuildtri_t& buildTri = state.build->tris[state.build->triIndices[i]];
+		uint32_t ids[3];
+
+		for (int k = 0; k < 3; k++)
+		{
+			int localId = 0;
+			while (localId < numLeafVerts && leafVerts[localId] != buildTri.verts[k])
+				localId++;
+
+			if (localId == numLeafVerts)
+			{
+				const Vector& pos = state.build->verts[buildTri.verts[k]];
+
+				leafVerts[numLeafVerts++] = buildTri.verts[k];
+
+				state.outVerts.push_back(QuantizeCollCoord(pos.x, state.origin[0], state.invScale, 0));
+				state.outVerts.push_back(QuantizeCollCoord(pos.y, state.origin[1], state.invScale, 0));
+				state.outVerts.push_back(QuantizeCollCoord(pos.z, state.origin[2], state.invScale, 0));
+			}
+
+			ids[k] = localId;
+		}
+
+		// offsets only go forward, rotating the smallest id to the front keeps the winding
+		const int first = ids[0] < ids[1] ? (ids[0] < ids[2] ? 0 : 2) : (ids[1] < ids[2] ? 1 : 2);
+		const uint32_t v0 = ids[first];
+		const uint32_t v1 = ids[(first + 1) % 3];
+		const uint32_t v2 = ids[(first + 2) % 3];
+
+		// degenerate triangles were dropped when building, so v1 and v2 are always past v0
+		if (v0 > 0x7FF || v1 <= v0 || v2 <= v0 || v1 - v0 - 1 > 0x1FF || v2 - v0 - 1 > 0x1FF)
+		{
+			state.overflow = true;
+			return 0;
+		}
+
+		r5::v8::mstudiocollbvhpoly3_t poly {};
+		poly.v0 = v0;
+		poly.v1Offset = v1 - v0 - 1;
+		poly.v2Offset = v2 - v0 - 1;
+
+		assert(poly.v0 + 1 + poly.v1Offset == v1 && poly.v0 + 1 + poly.v2Offset == v2);
+
+		memcpy(&packed, &poly, sizeof(packed));
+		state.outLeaves.push_back(packed);
+	}
+
+	state.numLeaves++;
+
+	return leafIndex;
+}
+
+//
+// EmitBVHNode_r
+// Purpose: collapses the binary tree into bvh4 nodes, returns the index of the written node
+//
+static int EmitBVHNode_r(bvhemitstate_t& state, const int bvh2Index, const int depth)
+{
+	const std::vector<bvhbuildnode_t>& nodes = *state.nodes;
+
+	int children[4];
+	int numChildren = 0;
+
+	if (nodes[bvh2Index].children[0] == -1)
+	{
+		// only happens when the root is a leaf
+		children[numChildren++] = bvh2Index;
+	}
+	else
+	{
+		children[numChildren++] = nodes[bvh2Index].children[0];
+		children[numChildren++] = nodes[bvh2Index].children[1];
+	}
+
+	// open up the largest inner child until all four slots are used
+	while (numChildren < 4)
+	{
+		int best = -1;
+		float bestArea = -1.0f;
+
+		for (int i = 0; i < numChildren; i++)
+		{
+			const bvhbuildnode_t& child = nodes[children[i]];
+
+			if (child.children[0] != -1 && child.bounds.Area() > bestArea)
+			{
+				best = i;
+				bestArea = child.bounds.Area();
+			}
+		}
+
+		if (best == -1)
+			break;
+
+		const bvhbuildnode_t& expand = nodes[children[best]];
+		children[best] = expand.children[0];
+		children[numChildren++] = expand.children[1];
+	}
+
+	state.maxDepth = max(state.maxDepth, depth);
+
+	const int outIndex = static_cast<int>(state.outNodes.size());
+	state.outNodes.emplace_back();
+
+	short bounds[24] {};
+	uint32_t types[4] = { r5::v8::BVH_CHILD_NONE, r5::v8::BVH_CHILD_NONE, r5::v8::BVH_CHILD_NONE, r5::v8::BVH_CHILD_NONE };
+	uint32_t indices[4] {};
+
+	for (int i = 0; i < numChildren; i++)
+	{
+		const bvhbuildnode_t& child = nodes[children[i]];
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			bounds[(axis * 8) + i] = QuantizeCollCoord(child.bounds.mins[axis], state.origin[axis], state.invScale, -1);
+			bounds[(axis * 8) + 4 + i] = QuantizeCollCoord(child.bounds.maxs[axis], state.origin[axis], state.invScale, 1);
+		}
+
+		if (child.children[0] == -1)
+		{
+			types[i] = r5::v8::BVH_CHILD_POLY3;
+			indices[i] = EmitBVHLeaf(state, child);
+		}
+		else
+		{
+			types[i] = r5::v8::BVH_CHILD_NODE;
+			indices[i] = EmitBVHNode_r(state, children[i], depth + 1);
+		}
+	}
+
+	// recursion may have moved the node array
+	r5::v8::mstudiocollbvhnode_t& outNode = state.outNodes[outIndex];
+	memcpy(outNode.bounds, bounds, sizeof(bounds));
+
+	outNode.cmIndex = 0;
+	outNode.index0 = indices[0];
+	outNode.index1 = indices[1];
+	outNode.index2 = indices[2];
+	outNode.index3 = indices[3];
+	outNode.childType0 = types[0];
+	outNode.childType1 = types[1];
+	outNode.childType2 = types[2];
+	outNode.childType3 = types[3];
+
+	return outIndex;
+}
+
+//
+// GenerateCollisionData_V8
+// Purpose: builds bvh collision from render geometry for models converted from mdl
+// must be called after the string table has been written
+//
+void GenerateCollisionData_V8(char* const vtxBuf, char* const vvdBuf)
+{
+	r5::v8::studiohdr_t* const pHdr = g_model.hdrV54();
+
+	if (!vtxBuf || !vvdBuf)
+		return;
+
+	// collision is built in bind pose, animated models would need a collision model per bone section
+	if (pHdr->numbones > 1)
+	{
+		printf("Skipping collision generation, only static props are supported (model has %i bones)...\n", pHdr->numbones);
+		return;
+	}
+
+	printf("Generating collision data...\n");
+
+	const system_clock::time_point buildStart = system_clock::now();
+
+	bvhbuildstate_t build {};
+	GatherCollisionTris(pHdr, reinterpret_cast<OptimizedModel::FileHeader_t*>(vtxBuf), reinterpret_cast<vvd::vertexFileHeader_t*>(vvdBuf), build);
+
+	if (build.tris.empty())
+	{
+		printf("  [BVH] model has no triangles, skipping\n");
+		return;
+	}
+
+	build.triIndices.resize(build.tris.size());
+	for (size_t i = 0; i < build.tris.size(); i++)
+		build.triIndices[i] = static_cast<int>(i);
+
+	// -serial builds it in one pass, otherwise deep enough to give every pool thread a subtree
+	const unsigned int numThreads = g_options.serialSections ? 1u : CParallelPool::Get().DefaultThreads();
+
+	build.parallelDepth = 0;
+	while ((1u << build.parallelDepth) < numThreads)
+		build.parallelDepth++;
+
+	std::vector<bvhbuildnode_t> bvh2;
+	bvh2.reserve(build.tris.size() / BVH_MIN_LEAF_TRIS * 2);
+
+	BuildBVH2_r(build, bvh2, 0, static_cast<int>(build.tris.size()), 0);
+
+	// quantize everything around the center of the root bounds
+	const bvhbounds_t& rootBounds = bvh2[0].bounds;
+
+	bvhemitstate_t emit {};
+	emit.build = &build;
+	emit.nodes = &bvh2;
+
+	float halfExtent = 0.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		emit.origin[i] = (rootBounds.mins[i] + rootBounds.maxs[i]) * 0.5f;
+		halfExtent = max(halfExtent, (rootBounds.maxs[i] - rootBounds.mins[i]) * 0.5f);
+	}
+
+	const float scale = halfExtent > 0.0f ? (halfExtent / 32767.0f) : 1.0f;
+	emit.invScale = 1.0f / scale;
+
+	EmitBVHNode_r(emit, 0, 1);
+
+	const float buildTime = duration_cast<microseconds>(system_clock::now() - buildStart).count() / 1000.f;
+
+	if (emit.overflow)
+	{
+		printf("  [BVH] WARNING: collision verts don't fit the 16 bit leaf base or poly3 offsets, skipping\n");
+		return;
+	}
+
+	const char* const surfaceProp = STRING_FROM_IDX(pHdr, pHdr->surfacepropindex);
+
+	ALIGN64(g_model.pData);
+	pHdr->bvhOffset = g_model.pData - g_model.pBase;
+
+	char* const pCollBase = g_model.pData;
+	r5::v8::mstudiocollmodel_t* const pCollModel = reinterpret_cast<r5::v8::mstudiocollmodel_t*>(g_model.pData);
+	pCollModel->headerCount = 1;
+	g_model.pData += sizeof(r5::v8::mstudiocollmodel_t);
+
+	r5::v8::mstudiocollheader_t* const pCollHeader = reinterpret_cast<r5::v8::mstudiocollheader_t*>(g_model.pData);
+	pCollHeader->unk = 0;
+	memcpy_s(pCollHeader->origin, sizeof(pCollHeader->origin), emit.origin, sizeof(emit.origin));
+	pCollHeader->scale = scale;
+	g_model.pData += sizeof(r5::v8::mstudiocollheader_t);
+
+	// a single surface property using the model's surfaceprop and contents
+	pCollModel->surfacePropsIndex = g_model.pData - pCollBase;
+	r5::v8::dsurfaceproperty_t* const pSurfProp = reinterpret_cast<r5::v8::dsurfaceproperty_t*>(g_model.pData);
+	pSurfProp->unk = 0;
+	pSurfProp->surfacePropId = 0;
+	pSurfProp->contentMaskOffset = 0;
+	pSurfProp->surfaceNameOffset = 0;
+	g_model.pData += sizeof(r5::v8::dsurfaceproperty_t);
+
+	pCollModel->contentMasksIndex = g_model.pData - pCollBase;
+	*reinterpret_cast<int*>(g_model.pData) = pHdr->contents ? pHdr->contents : 0x1; // CONTENTS_SOLID
+	g_model.pData += sizeof(int);
+
+	pCollModel->surfaceNamesIndex = g_model.pData - pCollBase;
+	const size_t surfacePropLength = strlen(surfaceProp) + 1;
+	strcpy_s(g_model.pData, surfacePropLength, surfaceProp);
+	g_model.pData += surfacePropLength;
+
+	ALIGN64(g_model.pData);
+	pCollHeader->vertIndex = g_model.pData - pCollBase;
+	memcpy(g_model.pData, emit.outVerts.data(), emit.outVerts.size() * sizeof(short));
+	g_model.pData += emit.outVerts.size() * sizeof(short);
+
+	ALIGN64(g_model.pData);
+	pCollHeader->bvhLeafIndex = g_model.pData - pCollBase;
+	memcpy(g_model.pData, emit.outLeaves.data(), emit.outLeaves.size() * sizeof(uint32_t));
+	g_model.pData += emit.outLeaves.size() * sizeof(uint32_t);
+
+	ALIGN64(g_model.pData);
+	pCollHeader->bvhNodeIndex = g_model.pData - pCollBase;
+	memcpy(g_model.pData, emit.outNodes.data(), emit.outNodes.size() * sizeof(r5::v8::mstudiocollbvhnode_t));
+	g_model.pData += emit.outNodes.size() * sizeof(r5::v8::mstudiocollbvhnode_t);
+
+	printf("  [BVH] %zu tris -> %zu nodes, %i leaves, depth %i, %zu verts (%u threads, built in %.3fms)\n",
+		build.tris.size(), emit.outNodes.size(), emit.numLeaves, emit.maxDepth, emit.outVerts.size() / 3, numThreads, buildTime);
+}
+
+//-----------------------------------------------------------------------------
+// PHY convex hull simplification
+//-----------------------------------------------------------------------------
+
+// ivp bitfields are read through masks so the layout doesn't depend on the compiler
+#define IVP_LEDGE_SIZE_SHIFT		8 // size_div_16 above has_children_flag:2, is_compact_flag:2, dummy:4
+#define IVP_EDGE_POINT_MASK			0xFFFF
+#define IVP_EDGE_OPPOSITE_SHIFT		16
+#define IVP_EDGE_OPPOSITE_MASK		0x7FFF
+#define IVP_TRI_INDEX_MASK			0xFFF
+#define IVP_TRI_PIERCE_SHIFT		12
+#define IVP_TRI_MATERIAL_MASK		0x7F000000 // material_index:7 above tri_index:12 and pierce_index:12
+
+#define PHY_MAX_HULL_TRIS			(IVP_TRI_INDEX_MASK + 1)
+
+// solid header of v10 phy files, the size counts the bytes after it
+struct phycompactsurfaceheader_t
+{
+	int size;
+	int vphysicsID; // 'VPHY'
+	short version;
+	short modelType; // 0 for ivp compact surfaces
+	int surfaceSize;
+	Vector dragAxisAreas;
+	int axisMapSize;
+};
+
+struct ivpcompactsurface_t
+{
+	float massCenter[3];
+	float rotationInertia[3];
+	float upperLimitRadius;
+	unsigned int byteSize; // max_factor_surface_deviation:8, byte_size:24
+	int offsetLedgetreeRoot;
+	int dummy[3]; // 'IVPS' in the last one
+};
+
+struct ivpcompactledge_t
+{
+	int pointOffset;
+	int ledgetreeNodeOffset;
+	unsigned int flags; // has_children_flag:2, is_compact_flag:2, dummy:4, size_div_16:24
+	short numTriangles;
+	short unused;
+};
+
+struct ivpcompacttriangle_t
+{
+	unsigned int info; // tri_index:12, pierce_index:12, material_index:7, is_virtual:1
+	unsigned int edges[3]; // start_point_index:16, opposite_index:15, is_virtual:1
+};
+
+struct ivpledgetreenode_t
+{
+	int offsetRightNode;
+	int offsetCompactLedge;
+	float center[3];
+	float radius;
+	unsigned char boxSizes[3];
+	unsigned char unused;
+};
+
+struct phyhullface_t
+{
+	int verts[3];
+	double normal[3];
+	double dist;
+};
+
+struct phyledgetri_t
+{
+	unsigned int info;
+	unsigned int edges[3]; // point index bits are replaced when the points are pooled
+	const char* points[3];
+};
+
+struct physimplifystats_t
+{
+	int numVerts;
+	int numSimplifiedVerts;
+	double volume;
+	double simplifiedVolume;
+};
+
+static inline void PhySub(const double* const a, const double* const b, double* const out)
+{
+	out[0] = a[0] - b[0];
+	out[1] = a[1] - b[1];
+	out[2] = a[2] - b[2];
+}
+
+static inline void PhyCross(const double* const a, const double* const b, double* const out)
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static inline double PhyDot(const double* const a, const double* const b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void SetHullFace(phyhullface_t& face, const std::vector<std::array<double, 3>>& points, const int a, const int b, const int c)
+{
+	face.verts[0] = a;
+	face.verts[1] = b;
+	face.verts[2] = c;
+
+	double ab[3], ac[3];
+	PhySub(points[b].data(), points[a].data(), ab);
+	PhySub(points[c].data(), points[a].data(), ac);
+	PhyCross(ab, ac, face.normal);
+
+	const double length = sqrt(PhyDot(face.normal, face.normal));
+	if (length > 0.0)
+	{
+		for (int i = 0; i < 3; i++)
+			face.normal[i] /= length;
+	}
+
+	face.dist = PhyDot(face.normal, points[a].data());
+}
+
+//
+// BuildHull
+// Purpose: incremental convex hull of the points in subset, faces wind counter clockwise seen from outside
+//			returns false for flat point sets
+//
+static bool BuildHull(const std::vector<std::array<double, 3>>& points, const std::vector<int>& subset, const double epsilon, std::vector<phyhullface_t>& faces)
+{
+	faces.clear();
+
+	if (subset.size() < 4)
+		return false;
+
+	// starting tetrahedron from the most spread out points
+	const int i0 = subset[0];
+	int i1 = -1, i2 = -1, i3 = -1;
+	double best = 0.0;
+
+	for (const int i : subset)
+	{
+		double d[3];
+		PhySub(points[i].data(), points[i0].data(), d);
+
+		if (PhyDot(d, d) > best)
+		{
+			best = PhyDot(d, d);
+			i1 = i;
+		}
+	}
+
+	if (i1 == -1 || sqrt(best) <= epsilon)
+		return false;
+
+	double edge[3];
+	PhySub(points[i1].data(), points[i0].data(), edge);
+
+	best = 0.0;
+	for (const int i : subset)
+	{
+		double d[3], c[3];
+		PhySub(points[i].data(), points[i0].data(), d);
+		PhyCross(edge, d, c);
+
+		if (PhyDot(c, c) > best)
+		{
+			best = PhyDot(c, c);
+			i2 = i;
+		}
+	}
+
+	if (i2 == -1 || sqrt(best) / sqrt(PhyDot(edge, edge)) <= epsilon)
+		return false;
+
+	phyhullface_t base;
+	SetHullFace(base, points, i0, i1, i2);
+
+	best = 0.0;
+	for (const int i : subset)
+	{
+		const double dist = fabs(PhyDot(base.normal, points[i].data()) - base.dist);
+		if (dist > best)
+		{
+			best = dist;
+			i3 = i;
+		}
+	}
+
+	if (i3 == -1 || best <= epsilon)
+		return false;
+
+	// base faces away from the fourth point
+	if (PhyDot(base.normal, points[i3].data()) - base.dist > 0.0)
+		std::swap(i1, i2);
+
+	faces.resize(4);
+	SetHullFace(faces[0], points, i0, i1, i2);
+	SetHullFace(faces[1], points, i0, i3, i1);
+	SetHullFace(faces[2], points, i1, i3, i2);
+	SetHullFace(faces[3], points, i2, i3, i0);
+
+	std::vector<bool> visible;
+	std::set<std::pair<int, int>> visibleEdges;
+
+	for (const int p : subset)
+	{
+		if (p == i0 || p == i1 || p == i2 || p == i3)
+			continue;
+
+		visible.assign(faces.size(), false);
+		visibleEdges.clear();
+
+		bool outside = false;
+		for (size_t i = 0; i < faces.size(); i++)
+		{
+			if (PhyDot(faces[i].normal, points[p].data()) - faces[i].dist <= epsilon)
+				continue;
+
+			visible[i] = true;
+			outside = true;
+
+			for (int j = 0; j < 3; j++)
+				visibleEdges.emplace(faces[i].verts[j], faces[i].verts[(j + 1) % 3]);
+		}
+
+		if (!outside)
+			continue;
+
+		std::vector<phyhullface_t> newFaces;
+		newFaces.reserve(faces.size() + 8);
+
+		for (size_t i = 0; i < faces.size(); i++)
+		{
+			if (!visible[i])
+				newFaces.push_back(faces[i]);
+		}
+
+		// edges of the visible region that only one visible face has make the horizon
+		for (const std::pair<int, int>& visibleEdge : visibleEdges)
+		{
+			if (visibleEdges.count({ visibleEdge.second, visibleEdge.first }))
+				continue;
+
+			newFaces.emplace_back();
+			SetHullFace(newFaces.back(), points, visibleEdge.first, visibleEdge.second, p);
+		}
+
+		faces = std::move(newFaces);
+	}
+
+	return true;
+}
+
+static double GetHullVolume(const std::vector<std::array<double, 3>>& points, const std::vector<phyhullface_t>& faces)
+{
+	if (faces.empty())
+		return 0.0;
+
+	// relative to a hull vertex to keep the products small
+	const double* const origin = points[faces[0].verts[0]].data();
+
+	double volume = 0.0;
+	for (const phyhullface_t& face : faces)
+	{
+		double a[3], b[3], c[3], bc[3];
+		PhySub(points[face.verts[0]].data(), origin, a);
+		PhySub(points[face.verts[1]].data(), origin, b);
+		PhySub(points[face.verts[2]].data(), origin, c);
+		PhyCross(b, c, bc);
+
+		volume += PhyDot(a, bc);
+	}
+
+	return volume / 6.0;
+}
+
+static std::vector<int> GetHullVerts(const std::vector<phyhullface_t>& faces)
+{
+	std::set<int> verts;
+	for (const phyhullface_t& face : faces)
+		verts.insert(face.verts, face.verts + 3);
+
+	return std::vector<int>(verts.begin(), verts.end());
+}
+
+//
+// SimplifyLedge
+// Purpose: removes the hull vertices that cost the least volume until the ledge is within the vertex budget or the next one
+//			would take the volume loss past the limit. the kept points are a subset of the old ones, so the ledge tree bounds still hold
+//
+static bool SimplifyLedge(std::vector<phyledgetri_t>& tris, physimplifystats_t& stats)
+{
+	// one entry per point of the ledge, faces index these
+	std::vector<const char*> pointAddrs;
+	std::vector<std::array<double, 3>> points;
+	std::map<const char*, int> pointIndices;
+
+	for (const phyledgetri_t& tri : tris)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			if (pointIndices.count(tri.points[i]))
+				continue;
+
+			const float* const pPoint = reinterpret_cast<const float*>(tri.points[i]);
+
+			pointIndices.emplace(tri.points[i], static_cast<int>(points.size()));
+			pointAddrs.push_back(tri.points[i]);
+			points.push_back({ pPoint[0], pPoint[1], pPoint[2] });
+		}
+	}
+
+	const int numVerts = static_cast<int>(points.size());
+
+	stats.numVerts += numVerts;
+	stats.numSimplifiedVerts += numVerts;
+
+	double extent = 0.0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		double lo = DBL_MAX, hi = -DBL_MAX;
+		for (const std::array<double, 3>& point : points)
+		{
+			lo = min(lo, point[axis]);
+			hi = max(hi, point[axis]);
+		}
+
+		extent = max(extent, hi - lo);
+	}
+
+	const double epsilon = extent * 1e-6;
+
+	std::vector<int> current(numVerts);
+	for (int i = 0; i < numVerts; i++)
+		current[i] = i;
+
+	std::vector<phyhullface_t> faces;
+	if (!BuildHull(points, current, epsilon, faces))
+		return false;
+
+	current = GetHullVerts(faces);
+
+	const double baseVolume = GetHullVolume(points, faces);
+	const double maxLoss = baseVolume * g_options.phyMaxVolumeLoss;
+	double volume = baseVolume;
+
+	stats.volume += baseVolume;
+	stats.simplifiedVolume += baseVolume;
+
+	if (baseVolume <= 0.0)
+		return false;
+
+	// volume lost by removing a vertex, the hull only changes around it so the others keep their cost
+	std::vector<double> costs(numVerts, -1.0);
+	std::vector<phyhullface_t> candidateFaces;
+	std::vector<int> candidate;
+
+	const int budget = max(g_options.phyHullVertexBudget, 4);
+	bool simplified = false;
+
+	while (static_cast<int>(current.size()) > budget)
+	{
+		int bestVert = -1;
+		for (const int vert : current)
+		{
+			if (costs[vert] < 0.0)
+			{
+				candidate.clear();
+				for (const int other : current)
+				{
+					if (other != vert)
+						candidate.push_back(other);
+				}
+
+				costs[vert] = BuildHull(points, candidate, epsilon, candidateFaces) ? max(volume - GetHullVolume(points, candidateFaces), 0.0) : DBL_MAX;
+			}
+
+			if (bestVert == -1 || costs[vert] < costs[bestVert])
+				bestVert = vert;
+		}
+
+		if (costs[bestVert] == DBL_MAX || (baseVolume - volume) + costs[bestVert] > maxLoss)
+			break;
+
+		// its neighbours get new faces
+		for (const phyhullface_t& face : faces)
+		{
+			if (face.verts[0] == bestVert || face.verts[1] == bestVert || face.verts[2] == bestVert)
+			{
+				for (int i = 0; i < 3; i++)
+					costs[face.verts[i]] = -1.0;
+			}
+		}
+
+		current.erase(std::find(current.begin(), current.end(), bestVert));
+
+		if (!BuildHull(points, current, epsilon, faces))
+			return false;
+
+		current = GetHullVerts(faces);
+		volume = GetHullVolume(points, faces);
+		simplified = true;
+	}
+
+	if (!simplified || faces.size() > PHY_MAX_HULL_TRIS)
+		return false;
+
+	// keep the winding the ledge came with
+	double center[3] = { 0.0, 0.0, 0.0 };
+	for (const std::array<double, 3>& point : points)
+	{
+		for (int i = 0; i < 3; i++)
+			center[i] += point[i] / numVerts;
+	}
+
+	phyhullface_t firstTri;
+	SetHullFace(firstTri, points, pointIndices[tris[0].points[0]], pointIndices[tris[0].points[1]], pointIndices[tris[0].points[2]]);
+	const bool flipWinding = PhyDot(firstTri.normal, center) - firstTri.dist > 0.0;
+
+	// each source triangle's outward plane and center, new faces take the material of the one lying closest to them
+	struct sourcetri_t
+	{
+		double normal[3];
+		double center[3];
+		unsigned int material;
+	};
+
+	std::vector<sourcetri_t> sourceTris(tris.size());
+	bool mixedMaterials = false;
+
+	for (size_t i = 0; i < tris.size(); i++)
+	{
+		phyhullface_t plane;
+		SetHullFace(plane, points, pointIndices[tris[i].points[0]], pointIndices[tris[i].points[1]], pointIndices[tris[i].points[2]]);
+
+		sourcetri_t& sourceTri = sourceTris[i];
+		for (int j = 0; j < 3; j++)
+		{
+			sourceTri.normal[j] = flipWinding ? -plane.normal[j] : plane.normal[j];
+			sourceTri.center[j] = (points[plane.verts[0]][j] + points[plane.verts[1]][j] + points[plane.verts[2]][j]) / 3.0;
+		}
+
+		sourceTri.material = tris[i].info & IVP_TRI_MATERIAL_MASK;
+		mixedMaterials |= sourceTri.material != sourceTris[0].material;
+	}
+
+	const int numTris = static_cast<int>(faces.size());
+
+	std::map<std::pair<int, int>, int> edgeIndices; // directed edge -> triangle * 3 + edge
+
+	std::vector<phyledgetri_t> newTris(numTris);
+	for (int i = 0; i < numTris; i++)
+	{
+		if (flipWinding)
+			std::swap(faces[i].verts[1], faces[i].verts[2]);
+
+		for (int j = 0; j < 3; j++)
+		{
+			newTris[i].points[j] = pointAddrs[faces[i].verts[j]];
+			edgeIndices[{ faces[i].verts[j], faces[i].verts[(j + 1) % 3] }] = i * 3 + j;
+		}
+	}
+
+	for (int i = 0; i < numTris; i++)
+	{
+		// the triangle facing the most away from this one
+		int pierce = i;
+		double pierceDot = DBL_MAX;
+
+		for (int j = 0; j < numTris; j++)
+		{
+			const double dot = PhyDot(faces[i].normal, faces[j].normal);
+			if (dot < pierceDot)
+			{
+				pierceDot = dot;
+				pierce = j;
+			}
+		}
+
+		// facing the same way matters most, distance mostly picks between source triangles of one plane
+		unsigned int material = sourceTris[0].material;
+		if (mixedMaterials)
+		{
+			constexpr double distanceWeight = 0.25;
+
+			double faceCenter[3];
+			for (int j = 0; j < 3; j++)
+				faceCenter[j] = (points[faces[i].verts[0]][j] + points[faces[i].verts[1]][j] + points[faces[i].verts[2]][j]) / 3.0;
+
+			double bestScore = -DBL_MAX;
+			for (const sourcetri_t& sourceTri : sourceTris)
+			{
+				double offset[3];
+				PhySub(sourceTri.center, faceCenter, offset);
+
+				const double score = PhyDot(faces[i].normal, sourceTri.normal) - (extent > 0.0 ? distanceWeight * sqrt(PhyDot(offset, offset)) / extent : 0.0);
+				if (score > bestScore)
+				{
+					bestScore = score;
+					material = sourceTri.material;
+				}
+			}
+		}
+
+		newTris[i].info = static_cast<unsigned int>(i) | (static_cast<unsigned int>(pierce) << IVP_TRI_PIERCE_SHIFT) | material;
+
+		// edges are counted in 4 byte steps from edge to edge, the triangle header takes one
+		for (int j = 0; j < 3; j++)
+		{
+			const auto opposite = edgeIndices.find({ faces[i].verts[(j + 1) % 3], faces[i].verts[j] });
+			if (opposite == edgeIndices.end())
+				return false;
+
+			const int oppositeTri = opposite->second / 3;
+			const int oppositeEdge = opposite->second % 3;
+			const int offset = (oppositeTri * 4 + 1 + oppositeEdge) - (i * 4 + 1 + j);
+
+			newTris[i].edges[j] = (static_cast<unsigned int>(offset) & IVP_EDGE_OPPOSITE_MASK) << IVP_EDGE_OPPOSITE_SHIFT;
+		}
+	}
+
+	tris = std::move(newTris);
+
+	stats.numSimplifiedVerts -= numVerts - static_cast<int>(current.size());
+	stats.simplifiedVolume -= baseVolume - volume;
+
+	return true;
+}
+
+//
+// SimplifyPhySolid
+// Purpose: rewrites one compact surface solid with its terminal ledges simplified, ledges that have children are hulls of
+//			their subtree and stay as they are. false leaves the solid to be copied
+//
+static bool SimplifyPhySolid(const char* const pSolid, const size_t solidSize, std::vector<char>& out, physimplifystats_t& stats)
+{
+	const phycompactsurfaceheader_t* const pHeader = reinterpret_cast<const phycompactsurfaceheader_t*>(pSolid);
+
+	if (solidSize < sizeof(phycompactsurfaceheader_t) + sizeof(ivpcompactsurface_t) || pHeader->vphysicsID != 'YHPV' || pHeader->modelType != 0)
+		return false;
+
+	const char* const pSurfaceData = pSolid + sizeof(phycompactsurfaceheader_t);
+	const ivpcompactsurface_t* const pSurface = reinterpret_cast<const ivpcompactsurface_t*>(pSurfaceData);
+	const size_t surfaceSize = pHeader->surfaceSize;
+
+	if (pHeader->surfaceSize <= 0 || sizeof(phycompactsurfaceheader_t) + surfaceSize > solidSize || (pSurface->byteSize >> 8) != surfaceSize)
+		return false;
+
+	auto InSurface = [pSurfaceData, surfaceSize](const void* const p, const size_t size)
+	{
+		const char* const pc = reinterpret_cast<const char*>(p);
+		return pc >= pSurfaceData && pc + size <= pSurfaceData + surfaceSize;
+	};
+
+	// nodes are stored depth first, the left child follows its parent
+	const ivpledgetreenode_t* const pRoot = reinterpret_cast<const ivpledgetreenode_t*>(pSurfaceData + pSurface->offsetLedgetreeRoot);
+
+	int numNodes = 0;
+	std::vector<int> stack{ 0 };
+	while (!stack.empty())
+	{
+		const int node = stack.back();
+		stack.pop_back();
+
+		if (node < 0 || !InSurface(pRoot + node, sizeof(ivpledgetreenode_t)) || node > static_cast<int>(surfaceSize / sizeof(ivpledgetreenode_t)))
+			return false;
+
+		numNodes = max(numNodes, node + 1);
+
+		if (pRoot[node].offsetRightNode)
+		{
+			// right children always come after the left subtree
+			if (pRoot[node].offsetRightNode <= 0 || pRoot[node].offsetRightNode % sizeof(ivpledgetreenode_t))
+				return false;
+
+			stack.push_back(node + 1);
+			stack.push_back(node + pRoot[node].offsetRightNode / static_cast<int>(sizeof(ivpledgetreenode_t)));
+		}
+	}
+
+	if (!InSurface(pRoot, numNodes * sizeof(ivpledgetreenode_t)))
+		return false;
+
+	// ledges in node order along with their triangles
+	std::vector<int> ledgeNodes;
+	std::vector<std::vector<phyledgetri_t>> ledgeTris;
+
+	for (int i = 0; i < numNodes; i++)
+	{
+		if (!pRoot[i].offsetCompactLedge)
+			continue;
+
+		const ivpcompactledge_t* const pLedge = reinterpret_cast<const ivpcompactledge_t*>(reinterpret_cast<const char*>(&pRoot[i]) + pRoot[i].offsetCompactLedge);
+		if (!InSurface(pLedge, sizeof(ivpcompactledge_t)) || pLedge->numTriangles <= 0 || !InSurface(pLedge + 1, pLedge->numTriangles * sizeof(ivpcompacttriangle_t)))
+			return false;
+
+		const ivpcompacttriangle_t* const pTris = reinterpret_cast<const ivpcompacttriangle_t*>(pLedge + 1);
+		const char* const pPoints = reinterpret_cast<const char*>(pLedge) + pLedge->pointOffset;
+
+		std::vector<phyledgetri_t> tris(pLedge->numTriangles);
+		for (int j = 0; j < pLedge->numTriangles; j++)
+		{
+			tris[j].info = pTris[j].info;
+
+			for (int k = 0; k < 3; k++)
+			{
+				tris[j].edges[k] = pTris[j].edges[k] & ~IVP_EDGE_POINT_MASK;
+				tris[j].points[k] = pPoints + (pTris[j].edges[k] & IVP_EDGE_POINT_MASK) * 16;
+
+				if (!InSurface(tris[j].points[k], 16))
+					return false;
+			}
+		}
+
+		ledgeNodes.push_back(i);
+		ledgeTris.push_back(std::move(tris));
+	}
+
+	bool simplified = false;
+	for (size_t i = 0; i < ledgeNodes.size(); i++)
+	{
+		const ivpledgetreenode_t& node = pRoot[ledgeNodes[i]];
+		if (node.offsetRightNode)
+			continue;
+
+		simplified |= SimplifyLedge(ledgeTris[i], stats);
+	}
+
+	if (!simplified)
+		return false;
+
+	// ledges, the points they use, then the tree
+	std::vector<const char*> pointPool;
+	std::map<const char*, int> pointPoolIndices;
+
+	size_t ledgeBytes = 0;
+	for (const std::vector<phyledgetri_t>& tris : ledgeTris)
+	{
+		ledgeBytes += sizeof(ivpcompactledge_t) + tris.size() * sizeof(ivpcompacttriangle_t);
+
+		for (const phyledgetri_t& tri : tris)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				if (pointPoolIndices.emplace(tri.points[k], static_cast<int>(pointPool.size())).second)
+					pointPool.push_back(tri.points[k]);
+			}
+		}
+	}
+
+	if (pointPool.size() > IVP_EDGE_POINT_MASK + 1)
+		return false;
+
+	const size_t pointsOffset = sizeof(ivpcompactsurface_t) + ledgeBytes;
+	const size_t nodesOffset = pointsOffset + pointPool.size() * 16;
+	const size_t newSurfaceSize = nodesOffset + numNodes * sizeof(ivpledgetreenode_t);
+
+	const size_t trailingSize = solidSize - sizeof(phycompactsurfaceheader_t) - surfaceSize;
+
+	out.assign(sizeof(phycompactsurfaceheader_t) + newSurfaceSize + trailingSize, 0);
+
+	phycompactsurfaceheader_t* const pNewHeader = reinterpret_cast<phycompactsurfaceheader_t*>(out.data());
+	*pNewHeader = *pHeader;
+	pNewHeader->size = static_cast<int>(out.size() - sizeof(int));
+	pNewHeader->surfaceSize = static_cast<int>(newSurfaceSize);
+
+	char* const pNewSurfaceData = out.data() + sizeof(phycompactsurfaceheader_t);
+	ivpcompactsurface_t* const pNewSurface = reinterpret_cast<ivpcompactsurface_t*>(pNewSurfaceData);
+	*pNewSurface = *pSurface;
+	pNewSurface->byteSize = (static_cast<unsigned int>(newSurfaceSize) << 8) | (pSurface->byteSize & 0xFF);
+	pNewSurface->offsetLedgetreeRoot = static_cast<int>(nodesOffset);
+
+	ivpledgetreenode_t* const pNewNodes = reinterpret_cast<ivpledgetreenode_t*>(pNewSurfaceData + nodesOffset);
+	memcpy(pNewNodes, pRoot, numNodes * sizeof(ivpledgetreenode_t));
+
+	for (size_t i = 0; i < pointPool.size(); i++)
+		memcpy(pNewSurfaceData + pointsOffset + i * 16, pointPool[i], 16);
+
+	size_t ledgeOffset = sizeof(ivpcompactsurface_t);
+	for (size_t i = 0; i < ledgeNodes.size(); i++)
+	{
+		const ivpledgetreenode_t& node = pRoot[ledgeNodes[i]];
+		const ivpcompactledge_t* const pLedge = reinterpret_cast<const ivpcompactledge_t*>(reinterpret_cast<const char*>(&node) + node.offsetCompactLedge);
+		const std::vector<phyledgetri_t>& tris = ledgeTris[i];
+
+		ivpcompactledge_t* const pNewLedge = reinterpret_cast<ivpcompactledge_t*>(pNewSurfaceData + ledgeOffset);
+		*pNewLedge = *pLedge;
+		pNewLedge->pointOffset = static_cast<int>(pointsOffset - ledgeOffset);
+		pNewLedge->numTriangles = static_cast<short>(tris.size());
+		pNewLedge->flags = (pLedge->flags & ((1u << IVP_LEDGE_SIZE_SHIFT) - 1)) | (static_cast<unsigned int>(tris.size() + 1) << IVP_LEDGE_SIZE_SHIFT);
+
+		ivpledgetreenode_t& newNode = pNewNodes[ledgeNodes[i]];
+		const int nodeOffset = static_cast<int>(nodesOffset + ledgeNodes[i] * sizeof(ivpledgetreenode_t));
+
+		newNode.offsetCompactLedge = static_cast<int>(ledgeOffset) - nodeOffset;
+
+		// only ledges that point back at their node
+		if (pLedge->ledgetreeNodeOffset == -node.offsetCompactLedge)
+			pNewLedge->ledgetreeNodeOffset = nodeOffset - static_cast<int>(ledgeOffset);
+
+		ivpcompacttriangle_t* const pNewTris = reinterpret_cast<ivpcompacttriangle_t*>(pNewLedge + 1);
+		for (size_t j = 0; j < tris.size(); j++)
+		{
+			pNewTris[j].info = tris[j].info;
+
+			for (int k = 0; k < 3; k++)
+				pNewTris[j].edges[k] = tris[j].edges[k] | static_cast<unsigned int>(pointPoolIndices[tris[j].points[k]]);
+		}
+
+		ledgeOffset += sizeof(ivpcompactledge_t) + tris.size() * sizeof(ivpcompacttriangle_t);
+	}
+
+	memcpy(out.data() + sizeof(phycompactsurfaceheader_t) + newSurfaceSize, pSurfaceData + surfaceSize, trailingSize);
+
+	return true;
+}
+
+//
+// SimplifyPhyHulls
+// Purpose: simplifies the convex pieces of every solid in a v10 phy (after its version's header was converted), out gets the whole file
+//			mass properties are kept from the source since the volume change is bounded by -phyvolumeloss
+//
+bool SimplifyPhyHulls(const char* const pPhy, const size_t phySize, std::vector<char>& out)
+{
+	if (phySize < 16)
+		return false;
+
+	// size, id, solidCount, checkSum, and keyValuesOffset in the respawn versions
+	const int headerSize = *reinterpret_cast<const int*>(pPhy);
+	const int solidCount = *reinterpret_cast<const int*>(pPhy + 8);
+
+	if (headerSize < 16 || static_cast<size_t>(headerSize) > phySize || solidCount <= 0)
+		return false;
+
+	out.assign(pPhy, pPhy + headerSize);
+
+	bool simplified = false;
+	physimplifystats_t totals {};
+
+	size_t offset = headerSize;
+	for (int i = 0; i < solidCount; i++)
+	{
+		if (offset + sizeof(int) > phySize)
+			return false;
+
+		const int size = *reinterpret_cast<const int*>(pPhy + offset);
+		if (size < 0 || offset + sizeof(int) + size > phySize)
+			return false;
+
+		const size_t solidSize = sizeof(int) + size;
+
+		physimplifystats_t stats {};
+		std::vector<char> solid;
+
+		if (SimplifyPhySolid(pPhy + offset, solidSize, solid, stats))
+		{
+			printf("  [PHY] solid %i: %i -> %i hull verts, volume %+.2f%%, %zu -> %zu bytes\n", i, stats.numVerts, stats.numSimplifiedVerts,
+				stats.volume > 0.0 ? (stats.simplifiedVolume - stats.volume) / stats.volume * 100.0 : 0.0, solidSize, solid.size());
+
+			out.insert(out.end(), solid.begin(), solid.end());
+			simplified = true;
+		}
+		else
+		{
+			out.insert(out.end(), pPhy + offset, pPhy + offset + solidSize);
+		}
+
+		totals.numVerts += stats.numVerts;
+		totals.numSimplifiedVerts += stats.numSimplifiedVerts;
+		totals.volume += stats.volume;
+		totals.simplifiedVolume += stats.simplifiedVolume;
+
+		offset += solidSize;
+	}
+
+	if (!simplified)
+	{
+		printf("  [PHY] no hulls over %i verts could be simplified within the volume limit\n", g_options.phyHullVertexBudget);
+		return false;
+	}
+
+	// keyvalues and anything else after the solids move with them
+	const ptrdiff_t shift = static_cast<ptrdiff_t>(out.size()) - static_cast<ptrdiff_t>(offset);
+	out.insert(out.end(), pPhy + offset, pPhy + phySize);
+
+	if (headerSize >= 20)
+	{
+		int* const pKeyValuesOffset = reinterpret_cast<int*>(out.data() + 16);
+		if (*pKeyValuesOffset >= static_cast<int>(offset))
+			*pKeyValuesOffset += static_cast<int>(shift);
+	}
+
+	printf("  [PHY] simplified hulls: %i -> %i verts, volume %+.2f%%, %zu -> %zu bytes\n", totals.numVerts, totals.numSimplifiedVerts,
+		totals.volume > 0.0 ? (totals.simplifiedVolume - totals.volume) / totals.volume * 100.0 : 0.0, phySize, out.size());
+
+	return true;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+extern void GenerateCollisionData_V8(char* const vtxBuf, char* const vvdBuf);
+
+// simplifies the convex hulls of a v10 phy to -simplifyphy's vertex budget, false when nothing changed and out should not be used
+extern bool SimplifyPhyHulls(const char* const pPhy, const size_t phySize, std::vector<char>& out);
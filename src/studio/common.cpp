@@ -73,8 +73,9 @@ static void CopyCollisionBuffers(r5::v8::mstudiocollmodel_t* const newCollModel,
 	g_model.pData += surfaceNamesSize;
 }
 
-template <typename T>
-void ConvertCollisionData_V120(const T* const oldStudioHdr, const char* const pOldBVHData)
+// rebuilds the collision at g_model.pData, the last header's nodes run for lastNodeSize bytes
+// as nothing in the collision data itself says where they end
+void ConvertCollisionData_V120(const char* const pOldBVHData, const __int64 lastNodeSize)
 {
 	g_model.hdrV54()->bvhOffset = g_model.pData - g_model.pBase;
 
@@ -100,6 +101,10 @@ void ConvertCollisionData_V120(const T* const oldStudioHdr, const char* const pO
 	// the collision buffers.
 	ConvertSurfaceProperties(pOldBVHData, reinterpret_cast<char*>(pNewCollModel));
 
+	// the layout is decided here, the data itself is copied in parallel afterwards
+	std::vector<s_sectioncopy_t> copies;
+	copies.reserve(headerCount * 3);
+
 	// convert each coll header and its data
 	for (int i = 0; i < headerCount; ++i)
 	{
@@ -117,7 +122,7 @@ void ConvertCollisionData_V120(const T* const oldStudioHdr, const char* const pO
 
 		ALIGN64(g_model.pData);
 		newHeader->vertIndex = g_model.pData - reinterpret_cast<char*>(pNewCollModel);
-		memcpy_s(g_model.pData, vertSize, vertData, vertSize);
+		copies.push_back({ g_model.pData, reinterpret_cast<const char*>(vertData), static_cast<size_t>(vertSize) });
 		g_model.pData += vertSize;
 
 		// --- copy coll leaf data ---
@@ -138,7 +143,7 @@ void ConvertCollisionData_V120(const T* const oldStudioHdr, const char* const pO
 
 		ALIGN64(g_model.pData);
 		newHeader->bvhLeafIndex = g_model.pData - reinterpret_cast<char*>(pNewCollModel);
-		memcpy_s(g_model.pData, leafSize, leafData, leafSize);
+		copies.push_back({ g_model.pData, reinterpret_cast<const char*>(leafData), static_cast<size_t>(leafSize) });
 		g_model.pData += leafSize;
 	}
 
@@ -160,21 +165,7 @@ void ConvertCollisionData_V120(const T* const oldStudioHdr, const char* const pO
 		}
 		else
 		{
-			// Calculate absolute offsets for validation
-			const size_t vgDataAbsoluteOffset = offsetof(r5::v140::studiohdr_t, vgLODOffset) + oldStudioHdr->vgLODOffset;
-			const size_t nodeAbsoluteOffset = oldStudioHdr->bvhOffset + oldHeader->bvhNodeIndex;
-
-			// Buffer boundary validation - ensure VG data comes after node data
-			if (vgDataAbsoluteOffset <= nodeAbsoluteOffset)
-			{
-				printf("ERROR: collision node data exceeds available buffer (vgOffset: 0x%zX <= nodeOffset: 0x%zX)\n",
-					vgDataAbsoluteOffset, nodeAbsoluteOffset);
-				nodeSize = 0;
-			}
-			else
-			{
-				nodeSize = vgDataAbsoluteOffset - nodeAbsoluteOffset;
-			}
+			nodeSize = lastNodeSize;
 		}
 
 		const void* nodeData = reinterpret_cast<const char*>(pOldCollModel) + oldHeader->bvhNodeIndex;
@@ -183,10 +174,42 @@ void ConvertCollisionData_V120(const T* const oldStudioHdr, const char* const pO
 
 		if (nodeSize > 0)
 		{
-			memcpy_s(g_model.pData, nodeSize, nodeData, nodeSize);
+			copies.push_back({ g_model.pData, reinterpret_cast<const char*>(nodeData), static_cast<size_t>(nodeSize) });
 			g_model.pData += nodeSize;
 		}
 	}
+
+	CopySections(copies);
+}
+
+template <typename T>
+void ConvertCollisionData_V120(const T* const oldStudioHdr, const char* const pOldBVHData)
+{
+	const r5::v8::mstudiocollmodel_t* const pOldCollModel = reinterpret_cast<const r5::v8::mstudiocollmodel_t*>(pOldBVHData);
+	const r5::v120::mstudiocollheader_t* const pOldCollHeaders = reinterpret_cast<const r5::v120::mstudiocollheader_t*>(pOldBVHData + sizeof(r5::v8::mstudiocollmodel_t));
+
+	__int64 lastNodeSize = 0;
+
+	// the last header's nodes run up to the embedded vg data
+	if (pOldCollModel->headerCount > 0)
+	{
+		// Calculate absolute offsets for validation
+		const size_t vgDataAbsoluteOffset = offsetof(r5::v140::studiohdr_t, vgLODOffset) + oldStudioHdr->vgLODOffset;
+		const size_t nodeAbsoluteOffset = oldStudioHdr->bvhOffset + pOldCollHeaders[pOldCollModel->headerCount - 1].bvhNodeIndex;
+
+		// Buffer boundary validation - ensure VG data comes after node data
+		if (vgDataAbsoluteOffset <= nodeAbsoluteOffset)
+		{
+			printf("ERROR: collision node data exceeds available buffer (vgOffset: 0x%zX <= nodeOffset: 0x%zX)\n",
+				vgDataAbsoluteOffset, nodeAbsoluteOffset);
+		}
+		else
+		{
+			lastNodeSize = vgDataAbsoluteOffset - nodeAbsoluteOffset;
+		}
+	}
+
+	ConvertCollisionData_V120(pOldBVHData, lastNodeSize);
 }
 
 // Only removes the new fields from the new headers and shifts the moved fields back
@@ -2,6 +2,7 @@
 
 extern void ConvertSurfaceProperties(const char* const pOldBVHData, char* const pNewBVHData);
 
+extern void ConvertCollisionData_V120(const char* const pOldBVHData, const __int64 lastNodeSize);
 template <typename T>
 extern void ConvertCollisionData_V120(const T* const oldStudioHdr, const char* const pOldBVHData);
 extern void ConvertCollisionData_V120_HeadersOnly(const char* const pOldBVHData, char* const newData);
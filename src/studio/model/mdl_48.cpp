@@ -4,6 +4,7 @@
 #include <pch.h>
 #include <studio/studio.h>
 #include <studio/versions.h>
+#include <studio/collision.h>
 
 //
 // ConvertStudioHdr
@@ -166,7 +167,7 @@ void ConvertBones_48(mstudiobone_t* pOldBones, int numBones, bool isRig)
 	if (proceduralBones.size() > 0)
 		printf("converting %lld procedural bones (jiggle bones)...\n", proceduralBones.size());
 
-	std::map<uint8_t, uint8_t> linearprocbones;
+	bytemap linearprocbones;
 
 	for (auto bone : proceduralBones)
 	{
@@ -223,9 +224,12 @@ void ConvertBones_48(mstudiobone_t* pOldBones, int numBones, bool isRig)
 	g_model.hdrV54()->procBoneCount = linearprocbones.size();
 	g_model.hdrV54()->procBoneTableOffset = g_model.pData - g_model.pBase;
 
-	for (auto& it : linearprocbones)
+	for (int i = 0; i < 256; i++)
 	{
-		*g_model.pData = it.first;
+		if (!linearprocbones.count(i))
+			continue;
+
+		*g_model.pData = static_cast<char>(i);
 		g_model.pData += sizeof(uint8_t);
 	}
 
@@ -233,19 +237,21 @@ void ConvertBones_48(mstudiobone_t* pOldBones, int numBones, bool isRig)
 
 	for (int i = 0; i < numBones; i++)
 	{
-		*g_model.pData = linearprocbones.count(i) ? linearprocbones.find(i)->second : 0xff;
+		*g_model.pData = linearprocbones.count(i) ? linearprocbones.at(i) : 0xff;
 		g_model.pData += sizeof(uint8_t);
 	}
 
 	ALIGN4(g_model.pData);
 }
 
-void ConvertHitboxes_48(mstudiohitboxset_t* pOldHitboxSets, int numHitboxSets)
+void ConvertHitboxes_48(mstudiohitboxset_t* pOldHitboxSets, int numHitboxSets, const s_boneextents_t* pBoneExtents = nullptr)
 {
 	printf("converting %i hitboxsets...\n", numHitboxSets);
 
 	g_model.hdrV54()->hitboxsetindex = g_model.pData - g_model.pBase;
 
+	s_hitboxfitstats_t fitStats{};
+
 	mstudiohitboxset_t* hboxsetStart = reinterpret_cast<mstudiohitboxset_t*>(g_model.pData);
 	for (int i = 0; i < numHitboxSets; ++i)
 	{
@@ -268,12 +274,25 @@ void ConvertHitboxes_48(mstudiohitboxset_t* pOldHitboxSets, int numHitboxSets)
 
 		mstudiobbox_t* oldHitboxes = reinterpret_cast<mstudiobbox_t*>((char*)oldhboxset + oldhboxset->hitboxindex);
 
-		for (int j = 0; j < newhboxset->numhitboxes; ++j)
+		std::vector<s_hitboxfit_t> fits(oldhboxset->numhitboxes);
+		for (int j = 0; j < oldhboxset->numhitboxes; ++j)
+			fits[j] = { oldHitboxes[j].bone, oldHitboxes[j].group, oldHitboxes[j].bbmin, oldHitboxes[j].bbmax, true };
+
+		FitHitboxSet(fits, pBoneExtents, fitStats);
+		newhboxset->numhitboxes = 0;
+
+		for (int j = 0; j < oldhboxset->numhitboxes; ++j)
 		{
+			if (!fits[j].keep)
+				continue;
+
 			mstudiobbox_t* oldHitbox = oldHitboxes + j;
 			r5::v8::mstudiobbox_t* newHitbox = reinterpret_cast<r5::v8::mstudiobbox_t*>(g_model.pData);
 
 			memcpy(g_model.pData, oldHitbox, sizeof(r5::v8::mstudiobbox_t));
+			newHitbox->bbmin = fits[j].bbmin;
+			newHitbox->bbmax = fits[j].bbmax;
+			newhboxset->numhitboxes++;
 
 			AddToStringTable((char*)newHitbox, &newHitbox->szhitboxnameindex, STRING_FROM_IDX(oldHitbox, oldHitbox->szhitboxnameindex));
 			AddToStringTable((char*)newHitbox, &newHitbox->hitdataGroupOffset, "");// STRING_FROM_IDX(oldHitbox, oldHitbox->keyvalueindex));
@@ -282,6 +301,8 @@ void ConvertHitboxes_48(mstudiohitboxset_t* pOldHitboxSets, int numHitboxSets)
 		}
 	}
 
+	PrintHitboxFitStats(fitStats);
+
 	ALIGN4(g_model.pData);
 }
 
@@ -422,8 +443,13 @@ void ConvertTextures_48(mstudiotexturedir_t* pCDTextures, int numCDTextures, mst
 	printf("converting %i textures...\n", numTextures);
 
 	g_model.hdrV54()->textureindex = g_model.pData - g_model.pBase;
+
+	int numNewTextures = 0;
 	for (int i = 0; i < numTextures; ++i)
 	{
+		if (IsTextureCulled(i))
+			continue;
+
 		mstudiotexture_t* oldTexture = &pOldTextures[i];
 
 		r5::v8::mstudiotexture_t* newTexture = reinterpret_cast<r5::v8::mstudiotexture_t*>(g_model.pData);
@@ -435,8 +461,11 @@ void ConvertTextures_48(mstudiotexturedir_t* pCDTextures, int numCDTextures, mst
 		newTexture->textureGuid = HashString(texName.c_str());
 
 		g_model.pData += sizeof(r5::v8::mstudiotexture_t);
+		numNewTextures++;
 	}
 
+	g_model.hdrV54()->numtextures = numNewTextures;
+
 	ALIGN4(g_model.pData);
 
 	// Material Shader Types
@@ -448,8 +477,8 @@ void ConvertTextures_48(mstudiotexturedir_t* pCDTextures, int numCDTextures, mst
 	if (g_model.hdrV54()->flags & STUDIOHDR_FLAGS_STATIC_PROP)
 		materialType = MaterialShaderType_t::RGDP;
 
-	memset(g_model.pData, materialType, numTextures);
-	g_model.pData += numTextures;
+	memset(g_model.pData, materialType, numNewTextures);
+	g_model.pData += numNewTextures;
 
 	ALIGN4(g_model.pData); // align data to 4 bytes
 
@@ -468,18 +497,18 @@ void ConvertSkins_48(char* pOldSkinData, int numSkinRef, int numSkinFamilies)
 
 	g_model.hdrV54()->skinindex = g_model.pData - g_model.pBase;
 
-	int skinIndexDataSize = sizeof(__int16) * numSkinRef * numSkinFamilies;
-	memcpy(g_model.pData, pOldSkinData, skinIndexDataSize);
-	g_model.pData += skinIndexDataSize;
+	std::vector<int> families;
+	g_model.hdrV54()->numskinref = WriteSkinTable(reinterpret_cast<const short*>(pOldSkinData), numSkinRef, numSkinFamilies, GetUsedSkinRefCount(g_model.hdrV54()), families);
+	g_model.hdrV54()->numskinfamilies = static_cast<int>(families.size());
 
 	ALIGN4(g_model.pData);
 
 	// write skin names
-	// skin 0 is unnamed
-	for (int i = 0; i < numSkinFamilies-1; ++i)
+	// skin 0 is unnamed, names stay with their source family when duplicates were dropped
+	for (size_t i = 1; i < families.size(); ++i)
 	{
 		char* skinNameBuf = new char[32];
-		sprintf_s(skinNameBuf, 32, "skin%i", i);
+		sprintf_s(skinNameBuf, 32, "skin%i", families[i] - 1);
 		AddToStringTable(g_model.pBase, (int*)g_model.pData, skinNameBuf);
 
 		g_model.pData += 4;
@@ -594,7 +623,6 @@ void ConvertMDL48To54(char* pMDL, const std::string& pathIn, const std::string&
 	//-| end vvd reading
 
 	std::string rmdlPath = ChangeExtension(pathOut, "rmdl");
-	std::ofstream out(rmdlPath, std::ios::out | std::ios::binary);
 
 	// allocate temp file buffer
 	g_model.pBase = new char[FILEBUFSIZE]{};
@@ -635,17 +663,16 @@ void ConvertMDL48To54(char* pMDL, const std::string& pathIn, const std::string&
 	g_model.hdrV54()->localattachmentindex = ConvertAttachmentTo54((mstudioattachment_t*)input.getPtr(), oldHeader->numlocalattachments);
 
 	// convert hitboxsets and hitboxes
+	s_boneextents_t boneExtents;
+	const bool hasBoneExtents = g_options.refitHitboxes && CalcBoneExtents_VVD(reinterpret_cast<const vvd::vertexFileHeader_t*>(vvdBuf.get()),
+		reinterpret_cast<const mstudiobone_t*>(pMDL + oldHeader->boneindex), oldHeader->numbones, boneExtents);
+
 	input.seek(oldHeader->hitboxsetindex, rseekdir::beg);
-	ConvertHitboxes_48((mstudiohitboxset_t*)input.getPtr(), oldHeader->numhitboxsets);
+	ConvertHitboxes_48((mstudiohitboxset_t*)input.getPtr(), oldHeader->numhitboxsets, hasBoneExtents ? &boneExtents : nullptr);
 
-	// copy bonebyname table (bone ids sorted alphabetically by name)
+	// regenerate bonebyname table (bone ids sorted alphabetically by name)
 	input.seek(oldHeader->bonetablebynameindex, rseekdir::beg);
-	input.read(g_model.pData, g_model.hdrV54()->numbones);
-
-	g_model.hdrV54()->bonetablebynameindex = g_model.pData - g_model.pBase;
-	g_model.pData += g_model.hdrV54()->numbones;
-
-	ALIGN4(g_model.pData);
+	WriteBoneTableByName<r5::v8::mstudiobone_t>(g_model.hdrV54(), oldHeader->bonetablebynameindex ? reinterpret_cast<const unsigned char*>(input.getPtr()) : nullptr);
 
 	ConvertAnims_48();
 
@@ -653,6 +680,10 @@ void ConvertMDL48To54(char* pMDL, const std::string& pathIn, const std::string&
 	input.seek(oldHeader->bodypartindex, rseekdir::beg);
 	ConvertBodyParts_48((mstudiobodyparts_t*)input.getPtr(), oldHeader->numbodyparts);
 
+	// before anything else is written after the bodyparts, the merged meshes take up less space
+	if (g_options.mergeMeshes)
+		MergeModelMeshes_V54(reinterpret_cast<OptimizedModel::FileHeader_t*>(vtxBuf.get()), reinterpret_cast<const vvd::vertexFileHeader_t*>(vvdBuf.get()));
+
 	input.seek(oldHeader->localposeparamindex, rseekdir::beg);
 	g_model.hdrV54()->localposeparamindex = ConvertPoseParams((mstudioposeparamdesc_t*)input.getPtr(), oldHeader->numlocalposeparameters, false);
 
@@ -663,6 +694,9 @@ void ConvertMDL48To54(char* pMDL, const std::string& pathIn, const std::string&
 	input.seek(oldHeader->cdtextureindex, rseekdir::beg);
 	void* pOldCDTextures = input.getPtr();
 
+	// find the textures no mesh can reach before they are written
+	BuildTextureRemap(reinterpret_cast<const short*>(pMDL + oldHeader->skinindex), oldHeader->numskinref, oldHeader->numskinfamilies, oldHeader->numtextures);
+
 	// convert textures
 	input.seek(oldHeader->textureindex, rseekdir::beg);
 	ConvertTextures_48((mstudiotexturedir_t*)pOldCDTextures, oldHeader->numcdtextures, (mstudiotexture_t*)input.getPtr(), oldHeader->numtextures);
@@ -691,12 +725,22 @@ void ConvertMDL48To54(char* pMDL, const std::string& pathIn, const std::string&
 		ConvertLinearBoneTableTo54(pLinearBones, (char*)pLinearBones + sizeof(mstudiolinearbone_t));
 	}
 
+	// every sequence is written and the bones are still in vvd order
+	if (g_options.tightBounds)
+		ApplyTightBounds_VVD(reinterpret_cast<const vvd::vertexFileHeader_t*>(vvdBuf.get()));
+
+	// the vg is built from the vvd below, so its bone states always follow the new bones
+	RemapBones_V54(true, reinterpret_cast<const vvd::vertexFileHeader_t*>(vvdBuf.get()));
+
 	g_model.pData = WriteStringTable(g_model.pData);
 	ALIGN4(g_model.pData);
 
+	if (g_options.generateBVH)
+		GenerateCollisionData_V8(vtxBuf.get(), vvdBuf.get());
+
 	pHdr->length = g_model.pData - g_model.pBase;
 
-	out.write(g_model.pBase, pHdr->length);
+	WriteOutputFile(rmdlPath, g_model.pBase, pHdr->length);
 
 	// now that rmdl is fully converted, convert vtx/vvd/vvc to VG
 	CreateVGFile(ChangeExtension(pathOut, "vg"), pHdr, vtxBuf.get(), vvdBuf.get(), nullptr, nullptr);
@@ -722,7 +766,6 @@ void ConvertMDL48To54(char* pMDL, const std::string& pathIn, const std::string&
 	printf("Creating rig from model...\n");
 
 	std::string rrigPath = ChangeExtension(filePath, "rrig");
-	std::ofstream rigOut(rrigPath, std::ios::out | std::ios::binary);
 
 	g_model.pBase = new char[FILEBUFSIZE] {};
 	g_model.pData = g_model.pBase;
@@ -774,7 +817,7 @@ void ConvertMDL48To54(char* pMDL, const std::string& pathIn, const std::string&
 
 	pHdr->length = g_model.pData - g_model.pBase;
 
-	rigOut.write(g_model.pBase, pHdr->length);
+	WriteOutputFile(rrigPath, g_model.pBase, pHdr->length);
 
 	delete[] g_model.pBase;
 
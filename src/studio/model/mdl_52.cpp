@@ -4,6 +4,7 @@
 #include <pch.h>
 #include <studio/studio.h>
 #include <studio/versions.h>
+#include <studio/collision.h>
 
 //
 // ConvertStudioHdr
@@ -348,23 +349,1127 @@ void ConvertIkChainsFromMDLTo53(mstudioikchain_t* pOldIkChains, int numIkChains)
 	ALIGN4(g_model.pData);
 }
 
-void ConvertIncludeModels(mstudiomodelgroup_t* pOldModelGroups, int numModelGroups)
+// include model names are relative to the game root, "models/" is optional in the search path
+static std::string NormalizeIncludeName(const char* pszName)
+{
+	std::string name = pszName;
+	std::replace(name.begin(), name.end(), '\\', '/');
+	std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+	if (name.rfind("models/", 0) == 0)
+		name = name.substr(7);
+
+	return name;
+}
+
+// sequence, animation, pose parameter and bone names are matched without case, as the runtime does
+static std::string NormalizeMergeName(const char* pszName)
+{
+	std::string name = pszName;
+	std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+	return name;
+}
+
+static r1::studiohdr_t* LoadIncludeModel(const std::string& name, std::vector<std::unique_ptr<char[]>>& includeBufs)
+{
+	std::string path = (std::filesystem::path(g_options.includeModelPath) / "models" / name).u8string();
+	if (!FILE_EXISTS(path))
+		path = (std::filesystem::path(g_options.includeModelPath) / name).u8string();
+
+	if (!FILE_EXISTS(path))
+		return nullptr;
+
+	const size_t fileSize = GetFileSize(path);
+	if (fileSize < sizeof(r1::studiohdr_t))
+		return nullptr;
+
+	std::unique_ptr<char[]> buf(new char[fileSize]);
+
+	std::ifstream fileIn(path, std::ios::in | std::ios::binary);
+	fileIn.read(buf.get(), fileSize);
+	fileIn.close();
+
+	r1::studiohdr_t* const pIncludeHdr = reinterpret_cast<r1::studiohdr_t*>(buf.get());
+	if (pIncludeHdr->id != 'TSDI' || pIncludeHdr->version != 52 || static_cast<size_t>(pIncludeHdr->length) > fileSize)
+	{
+		printf("  [INCLUDE] '%s' is not a v52 model, keeping the reference\n", name.c_str());
+		return nullptr;
+	}
+
+	// its sequences and animations are read while the model is written, so the file has to outlive the conversion
+	includeBufs.push_back(std::move(buf));
+
+	return pIncludeHdr;
+}
+
+// an include model reference as it is written
+struct s_includeref_t
+{
+	const char* pszLabel;
+	const char* pszName;
+};
+
+// a model whose sequences and animations are written into the converted one: the model itself first, then the include models merged into it
+struct s_mergemodel_t
+{
+	const r1::studiohdr_t* pHdr;
+	const char* pszName;
+
+	std::vector<int> boneRemap; // its bone -> our bone, -1 without a bone of the same name
+	std::vector<int> poseParamRemap; // its pose parameter -> ours
+	std::vector<int> ikChainRemap; // its ik chain -> ours, -1 without a chain of the same name
+	std::vector<int> seqRemap; // its sequence -> merged sequence, sequences named like an earlier one map to that one
+	std::vector<int> animRemap; // its animation -> merged animation, likewise by name
+
+	inline const r1::mstudioanimdesc_t* pAnimdesc(const int i) const { return reinterpret_cast<const r1::mstudioanimdesc_t*>((char*)pHdr + pHdr->localanimindex) + i; }
+	inline const r1::mstudioseqdesc_t* pSeqdesc(const int i) const { return reinterpret_cast<const r1::mstudioseqdesc_t*>((char*)pHdr + pHdr->localseqindex) + i; }
+	inline const char* pEnd() const { return (char*)pHdr + pHdr->length; }
+};
+
+//
+// ResolveIncludeModels
+// Purpose: with -includepath, walks the include models of this model and the ones they include in turn, depth first like the runtime
+//			models found there are merged into this one and dropped from its references, the rest stay references. duplicates and
+//			references back to this model are dropped. bones are matched to ours by name
+//
+static void ResolveIncludeModels(const r1::studiohdr_t* const pOldHdr, std::vector<std::unique_ptr<char[]>>& includeBufs, std::vector<s_mergemodel_t>& mergeModels, std::vector<s_includeref_t>& references)
+{
+	const mstudiomodelgroup_t* const pOldModelGroups = reinterpret_cast<const mstudiomodelgroup_t*>((char*)pOldHdr + pOldHdr->includemodelindex);
+
+	std::map<std::string, int> boneNames;
+	for (int i = 0; i < pOldHdr->numbones; i++)
+		boneNames.emplace(NormalizeMergeName(pOldHdr->pBone(i)->pszName()), i);
+
+	// the model itself maps onto itself
+	s_mergemodel_t& self = mergeModels.emplace_back();
+	self.pHdr = pOldHdr;
+	self.pszName = pOldHdr->name;
+
+	for (int i = 0; i < pOldHdr->numbones; i++)
+		self.boneRemap.push_back(i);
+
+	std::vector<s_includeref_t> pending;
+	for (int i = pOldHdr->numincludemodels - 1; i >= 0; i--)
+		pending.push_back({ STRING_FROM_IDX(&pOldModelGroups[i], pOldModelGroups[i].szlabelindex), STRING_FROM_IDX(&pOldModelGroups[i], pOldModelGroups[i].sznameindex) });
+
+	std::set<std::string> seenNames;
+	seenNames.insert(NormalizeIncludeName(pOldHdr->pszName() ? pOldHdr->pszName() : pOldHdr->name));
+
+	int numHoisted = 0;
+	int numDropped = 0;
+
+	while (!pending.empty())
+	{
+		const s_includeref_t include = pending.back();
+		pending.pop_back();
+
+		const std::string name = NormalizeIncludeName(include.pszName);
+		if (!seenNames.insert(name).second)
+		{
+			numDropped++;
+			continue;
+		}
+
+		const r1::studiohdr_t* const pIncludeHdr = LoadIncludeModel(name, includeBufs);
+		if (!pIncludeHdr)
+		{
+			references.push_back(include);
+			continue;
+		}
+
+		const mstudiomodelgroup_t* const pGroups = reinterpret_cast<const mstudiomodelgroup_t*>((char*)pIncludeHdr + pIncludeHdr->includemodelindex);
+		for (int i = pIncludeHdr->numincludemodels - 1; i >= 0; i--)
+		{
+			pending.push_back({ STRING_FROM_IDX(&pGroups[i], pGroups[i].szlabelindex), STRING_FROM_IDX(&pGroups[i], pGroups[i].sznameindex) });
+			numHoisted++;
+		}
+
+		s_mergemodel_t& model = mergeModels.emplace_back();
+		model.pHdr = pIncludeHdr;
+		model.pszName = include.pszName;
+
+		// tracks on bones we don't have are dropped
+		int numUnmatched = 0;
+		for (int i = 0; i < pIncludeHdr->numbones; i++)
+		{
+			const auto it = boneNames.find(NormalizeMergeName(pIncludeHdr->pBone(i)->pszName()));
+
+			model.boneRemap.push_back(it != boneNames.end() ? it->second : -1);
+			numUnmatched += it == boneNames.end();
+		}
+
+		if (numUnmatched)
+			printf("  [INCLUDE] '%s': %i of %i bones have no bone of the same name in this model, their tracks are dropped\n", include.pszName, numUnmatched, pIncludeHdr->numbones);
+	}
+
+	printf("  [INCLUDE] merging %zu include models, hoisted %i nested references, dropped %i, %zu stay references\n", mergeModels.size() - 1, numHoisted, numDropped, references.size());
+}
+
+//
+// AppendIncludePoseParams
+// Purpose: matches the pose parameters of the merged models to ours by name, the ones we don't have are written after ours
+//			like the runtime adds them to the virtual model
+//
+static void AppendIncludePoseParams(const r1::studiohdr_t* const pOldHdr, std::vector<s_mergemodel_t>& mergeModels)
+{
+	std::map<std::string, int> poseParamNames;
+	int numPoseParams = 0;
+
+	for (s_mergemodel_t& model : mergeModels)
+	{
+		mstudioposeparamdesc_t* const pPoseParams = reinterpret_cast<mstudioposeparamdesc_t*>((char*)model.pHdr + model.pHdr->localposeparamindex);
+
+		for (int i = 0; i < model.pHdr->numlocalposeparameters; i++)
+		{
+			const std::string name = NormalizeMergeName(STRING_FROM_IDX(&pPoseParams[i], pPoseParams[i].sznameindex));
+
+			// ours are already written, in order
+			if (model.pHdr == pOldHdr)
+			{
+				poseParamNames.emplace(name, i);
+				model.poseParamRemap.push_back(numPoseParams++);
+
+				continue;
+			}
+
+			const auto it = poseParamNames.find(name);
+			if (it != poseParamNames.end())
+			{
+				model.poseParamRemap.push_back(it->second);
+				continue;
+			}
+
+			ConvertPoseParams(&pPoseParams[i], 1, false);
+			g_model.hdrV53()->numlocalposeparameters++;
+
+			poseParamNames.emplace(name, numPoseParams);
+			model.poseParamRemap.push_back(numPoseParams++);
+		}
+	}
+}
+
+//
+// RemapIncludeIkChains
+// Purpose: matches the ik chains of the merged models to ours by name, ik locks on chains we don't have are dropped
+//
+static void RemapIncludeIkChains(const r1::studiohdr_t* const pOldHdr, std::vector<s_mergemodel_t>& mergeModels)
+{
+	std::map<std::string, int> ikChainNames;
+
+	const r1::mstudioikchain_t* const pOldIkChains = reinterpret_cast<const r1::mstudioikchain_t*>((char*)pOldHdr + pOldHdr->ikchainindex);
+	for (int i = 0; i < pOldHdr->numikchains; i++)
+		ikChainNames.emplace(NormalizeMergeName(pOldIkChains[i].pszName()), i);
+
+	for (s_mergemodel_t& model : mergeModels)
+	{
+		const r1::mstudioikchain_t* const pIkChains = reinterpret_cast<const r1::mstudioikchain_t*>((char*)model.pHdr + model.pHdr->ikchainindex);
+
+		for (int i = 0; i < model.pHdr->numikchains; i++)
+		{
+			const auto it = ikChainNames.find(NormalizeMergeName(pIkChains[i].pszName()));
+			model.ikChainRemap.push_back(it != ikChainNames.end() ? it->second : -1);
+		}
+	}
+}
+
+//
+// ConvertIncludeModels
+// Purpose: writes the include model references, with -includepath only the ones that weren't merged into this model
+//
+void ConvertIncludeModels(mstudiomodelgroup_t* pOldModelGroups, int numModelGroups, const std::vector<s_includeref_t>* const pReferences)
 {
 	g_model.hdrV53()->includemodelindex = g_model.pData - g_model.pBase;
 
+	if (pReferences)
+		numModelGroups = static_cast<int>(pReferences->size());
+
 	printf("converting %i includemodels...\n", numModelGroups);
 
 	for (int i = 0; i < numModelGroups; i++)
 	{
-		mstudiomodelgroup_t* oldGroup = &pOldModelGroups[i];
+		const char* const pszLabel = pReferences ? pReferences->at(i).pszLabel : STRING_FROM_IDX(&pOldModelGroups[i], pOldModelGroups[i].szlabelindex);
+		const char* const pszName = pReferences ? pReferences->at(i).pszName : STRING_FROM_IDX(&pOldModelGroups[i], pOldModelGroups[i].sznameindex);
 
 		mstudiomodelgroup_t* newGroup = reinterpret_cast<mstudiomodelgroup_t*>(g_model.pData);
 
-		AddToStringTable((char*)newGroup, &newGroup->szlabelindex, STRING_FROM_IDX(oldGroup, oldGroup->szlabelindex));
-		AddToStringTable((char*)newGroup, &newGroup->sznameindex, STRING_FROM_IDX(oldGroup, oldGroup->sznameindex));
+		AddToStringTable((char*)newGroup, &newGroup->szlabelindex, pszLabel);
+		AddToStringTable((char*)newGroup, &newGroup->sznameindex, pszName);
 
 		g_model.pData += sizeof(mstudiomodelgroup_t);
 	}
+
+	g_model.hdrV53()->numincludemodels = numModelGroups;
+}
+
+//-----------------------------------------------------------------------------
+// Sequences and animations
+//-----------------------------------------------------------------------------
+
+// one bone list of an animation and the frames its tracks cover
+struct s_animsection_t
+{
+	const r1::mstudio_rle_anim_t* pBones;
+	int numFrames;
+};
+
+//
+// GetAnimSections_52
+// Purpose: the bone lists of an animation, one per section. false if any of them is in an animblock (.ani) file, those aren't loaded
+//			a section covers its frames and the first frame of the next one, the extra last section only holds the last frame
+//
+static bool GetAnimSections_52(const r1::mstudioanimdesc_t* const pAnim, std::vector<s_animsection_t>& sections)
+{
+	if (!pAnim->sectionframes)
+	{
+		if (pAnim->animblock)
+			return false;
+
+		sections.push_back({ reinterpret_cast<const r1::mstudio_rle_anim_t*>((char*)pAnim + pAnim->animindex), pAnim->numframes });
+		return true;
+	}
+
+	const int numSections = pAnim->numframes > pAnim->sectionframes ? ((pAnim->numframes - 1) / pAnim->sectionframes) + 2 : 1;
+
+	for (int i = 0; i < numSections; i++)
+	{
+		const r1::mstudioanimsections_t* const pSection = pAnim->pSection(i);
+		if (pSection->animblock)
+			return false;
+
+		const int firstFrame = min(i * pAnim->sectionframes, pAnim->numframes - 1);
+		const int lastFrame = min((i + 1) * pAnim->sectionframes, pAnim->numframes - 1);
+
+		sections.push_back({ reinterpret_cast<const r1::mstudio_rle_anim_t*>((char*)pAnim + pSection->animindex), lastFrame - firstFrame + 1 });
+	}
+
+	return true;
+}
+
+//
+// GetAnimTrackLength_52
+// Purpose: the number of mstudioanimvalue_t in a track covering numFrames frames, 0 if it runs past the end of the model
+//
+static int GetAnimTrackLength_52(const r1::mstudioanimvalue_t* const pTrack, const char* const pEnd, const int numFrames)
+{
+	int length = 0;
+
+	for (int frame = 0; frame < numFrames;)
+	{
+		if (reinterpret_cast<const char*>(&pTrack[length + 1]) > pEnd)
+			return 0;
+
+		const int valid = static_cast<unsigned char>(pTrack[length].num.valid);
+		const int total = static_cast<unsigned char>(pTrack[length].num.total);
+
+		if (!valid || valid > total)
+			return 0;
+
+		length += 1 + valid;
+		frame += total;
+	}
+
+	if (reinterpret_cast<const char*>(&pTrack[length]) > pEnd)
+		return 0;
+
+	return length;
+}
+
+// the tracks of one bone in an r1 bone list
+struct s_r1bonetracks_t
+{
+	const r1::mstudioanim_valueptr_t* pTrack[3]; // rot, pos, scale. null without an animated track
+	const char* pRaw[3]; // rot, pos, scale. null without a constant value
+	bool rawRot64;
+};
+
+static s_r1bonetracks_t GetBoneTracks_52(const r1::mstudio_rle_anim_t* const pBone)
+{
+	s_r1bonetracks_t tracks{};
+	const char* pData = pBone->pData();
+
+	// each value follows the previous one, studiomdl never mixes constant and animated rotation and position
+	if (pBone->flags & r1::STUDIO_ANIM_ANIMROT)
+	{
+		tracks.pTrack[0] = reinterpret_cast<const r1::mstudioanim_valueptr_t*>(pData);
+		pData += sizeof(r1::mstudioanim_valueptr_t);
+	}
+	else if (pBone->flags & r1::STUDIO_ANIM_RAWROT)
+	{
+		tracks.pRaw[0] = pData;
+		pData += sizeof(Quaternion48);
+	}
+	else if (pBone->flags & r1::STUDIO_ANIM_RAWROT2)
+	{
+		tracks.pRaw[0] = pData;
+		tracks.rawRot64 = true;
+		pData += sizeof(Quaternion64);
+	}
+
+	if (pBone->flags & r1::STUDIO_ANIM_ANIMPOS)
+	{
+		tracks.pTrack[1] = reinterpret_cast<const r1::mstudioanim_valueptr_t*>(pData);
+		pData += sizeof(r1::mstudioanim_valueptr_t);
+	}
+	else if (pBone->flags & r1::STUDIO_ANIM_RAWPOS)
+	{
+		tracks.pRaw[1] = pData;
+		pData += sizeof(Vector48);
+	}
+
+	if (pBone->flags & r1::STUDIO_ANIM_ANIMSCALE)
+		tracks.pTrack[2] = reinterpret_cast<const r1::mstudioanim_valueptr_t*>(pData);
+	else if (pBone->flags & r1::STUDIO_ANIM_RAWSCALE)
+		tracks.pRaw[2] = pData;
+
+	return tracks;
+}
+
+// how the values of one track axis move from the source bone to ours: a stored value v is v * srcScale + srcBase in the source model
+struct s_trackaxis_t
+{
+	const r1::mstudioanimvalue_t* pTrack; // null when the axis has no track and only takes the source base
+	int length;
+
+	float srcScale;
+	float srcBase;
+	float dstBase;
+};
+
+//
+// GetTrackAxes_52
+// Purpose: the three axes of a rot (0), pos (1) or scale (2) track of a source bone against our bone. animated values of non delta
+//			animations are offsets from the bone's base values, delta animations have no base. false if a track can't be read
+//
+static bool GetTrackAxes_52(const s_r1bonetracks_t& tracks, const int type, const r1::mstudiobone_t& srcBone, const r2::mstudiobone_t& dstBone,
+	const bool isDelta, const int numFrames, const char* const pEnd, s_trackaxis_t* const pAxes)
+{
+	const Vector srcScale = type == 0 ? srcBone.rotscale : type == 1 ? srcBone.posscale : srcBone.scalescale;
+	const Vector srcBase = type == 0 ? Vector(srcBone.rot.x, srcBone.rot.y, srcBone.rot.z) : type == 1 ? srcBone.pos : srcBone.scale;
+	const Vector dstBase = type == 0 ? Vector(dstBone.rot.x, dstBone.rot.y, dstBone.rot.z) : type == 1 ? dstBone.pos : dstBone.scale;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		s_trackaxis_t& trackAxis = pAxes[axis];
+		trackAxis = {};
+
+		trackAxis.srcScale = srcScale[axis];
+		trackAxis.srcBase = isDelta ? 0.0f : srcBase[axis];
+		trackAxis.dstBase = isDelta ? 0.0f : dstBase[axis];
+
+		const r1::mstudioanim_valueptr_t* const pValuePtr = tracks.pTrack[type];
+		if (!pValuePtr || pValuePtr->offset[axis] <= 0)
+			continue;
+
+		trackAxis.pTrack = pValuePtr->pAnimvalue(axis);
+		trackAxis.length = GetAnimTrackLength_52(trackAxis.pTrack, pEnd, numFrames);
+
+		if (!trackAxis.length)
+			return false;
+	}
+
+	return true;
+}
+
+// the largest distance from our base value any frame of the axis takes, what our scale has to reach
+static float GetTrackAxisRange(const s_trackaxis_t& axis)
+{
+	float range = fabsf(axis.srcBase - axis.dstBase);
+
+	for (int i = 0; i < axis.length;)
+	{
+		const int valid = static_cast<unsigned char>(axis.pTrack[i].num.valid);
+
+		for (int j = 1; j <= valid; j++)
+			range = max(range, fabsf((axis.pTrack[i + j].value * axis.srcScale) + axis.srcBase - axis.dstBase));
+
+		i += 1 + valid;
+	}
+
+	return range;
+}
+
+// the stored value that decodes to the same as the source value against our scale and base
+static short RescaleTrackValue(const float value, const s_trackaxis_t& axis, const float dstScale, int& numClamped)
+{
+	const float scaled = dstScale > 0.0f ? roundf((value - axis.dstBase) / dstScale) : 0.0f;
+
+	if (scaled > 32767.0f || scaled < -32768.0f)
+	{
+		numClamped++;
+		return scaled > 0.0f ? 32767 : -32768;
+	}
+
+	return static_cast<short>(scaled);
+}
+
+//
+// WriteTrackAxis_52
+// Purpose: writes one axis of a track at g_model.pData against our scale and base. an axis without a source track only needs one
+//			when our base differs from the source's, it then holds the source base for every frame. returns false if nothing was written
+//
+static bool WriteTrackAxis_52(const s_trackaxis_t& axis, const float dstScale, const int numFrames, int& numClamped)
+{
+	r2::mstudioanimvalue_t* const pOut = reinterpret_cast<r2::mstudioanimvalue_t*>(g_model.pData);
+
+	if (!axis.pTrack)
+	{
+		const short value = RescaleTrackValue(axis.srcBase, axis, dstScale, numClamped);
+		if (!value)
+			return false;
+
+		int length = 0;
+		for (int frame = 0; frame < numFrames; frame += 255)
+		{
+			pOut[length].num.valid = 1;
+			pOut[length].num.total = static_cast<char>(min(numFrames - frame, 255));
+			pOut[length + 1].value = value;
+
+			length += 2;
+		}
+
+		g_model.pData += length * sizeof(r2::mstudioanimvalue_t);
+		return true;
+	}
+
+	for (int i = 0; i < axis.length;)
+	{
+		const int valid = static_cast<unsigned char>(axis.pTrack[i].num.valid);
+
+		pOut[i].value = axis.pTrack[i].value;
+		for (int j = 1; j <= valid; j++)
+			pOut[i + j].value = RescaleTrackValue((axis.pTrack[i + j].value * axis.srcScale) + axis.srcBase, axis, dstScale, numClamped);
+
+		i += 1 + valid;
+	}
+
+	g_model.pData += axis.length * sizeof(r2::mstudioanimvalue_t);
+	return true;
+}
+
+// a bone of a source bone list and the bone of ours it goes to
+struct s_mergebone_t
+{
+	const r1::mstudio_rle_anim_t* pBone;
+	int dstBone;
+};
+
+//
+// GetMergedBones_52
+// Purpose: the bones of a source bone list that have a bone of ours, in our bone order as the runtime walks them
+//
+static void GetMergedBones_52(const s_mergemodel_t& model, const s_animsection_t& section, std::vector<s_mergebone_t>& bones)
+{
+	bones.clear();
+
+	for (const r1::mstudio_rle_anim_t* pBone = section.pBones; pBone; pBone = pBone->nextoffset ? reinterpret_cast<const r1::mstudio_rle_anim_t*>((char*)pBone + pBone->nextoffset) : nullptr)
+	{
+		if (reinterpret_cast<const char*>(pBone + 1) > model.pEnd() || pBone->bone >= model.pHdr->numbones)
+			break;
+
+		if (model.boneRemap[pBone->bone] >= 0)
+			bones.push_back({ pBone, model.boneRemap[pBone->bone] });
+	}
+
+	std::stable_sort(bones.begin(), bones.end(), [](const s_mergebone_t& a, const s_mergebone_t& b) { return a.dstBone < b.dstBone; });
+}
+
+// what carrying an animation over has to leave behind
+struct s_mergestats_t
+{
+	int numUnreadable; // animations in animblock (.ani) files, frame animations or with tracks that can't be read
+	int numIkRules;
+	int numLocalHierarchies;
+	int numClamped; // track values outside of what our scales can store
+};
+
+//
+// WriteAnimBones_52
+// Purpose: writes one bone list of a merged animation at g_model.pData in the r2 layout: every bone has a fixed header with its
+//			constant rotation, position and scale or value pointers to their tracks, which follow it. false if a track can't be read
+//
+static bool WriteAnimBones_52(const s_mergemodel_t& model, const s_animsection_t& section, const bool isDelta, const std::vector<s_mergebone_t>& bones, s_mergestats_t& stats)
+{
+	const r2::mstudiobone_t* const pDstBones = reinterpret_cast<const r2::mstudiobone_t*>(g_model.pBase + g_model.hdrV53()->boneindex);
+
+	r2::mstudio_rle_anim_t* pPrevBone = nullptr;
+
+	for (const s_mergebone_t& bone : bones)
+	{
+		const r1::mstudiobone_t& srcBone = *model.pHdr->pBone(bone.pBone->bone);
+		const r2::mstudiobone_t& dstBone = pDstBones[bone.dstBone];
+
+		const s_r1bonetracks_t tracks = GetBoneTracks_52(bone.pBone);
+
+		s_trackaxis_t axes[3][3];
+		for (int type = 0; type < 3; type++)
+		{
+			if (!GetTrackAxes_52(tracks, type, srcBone, dstBone, isDelta, section.numFrames, model.pEnd(), axes[type]))
+				return false;
+		}
+
+		ALIGN4(g_model.pData);
+
+		r2::mstudio_rle_anim_t* const pNewBone = reinterpret_cast<r2::mstudio_rle_anim_t*>(g_model.pData);
+		g_model.pData = pNewBone->pData() + 24; // rot, pos and scale slots and the next offset
+
+		if (pPrevBone)
+			*pPrevBone->pNextOffset() = static_cast<int>((char*)pNewBone - (char*)pPrevBone);
+
+		pNewBone->bone = static_cast<unsigned char>(bone.dstBone);
+		pNewBone->flags = isDelta ? r2::STUDIO_ANIM_DELTA : 0;
+
+		// one position scale for all axes now, large enough for the coarsest source axis and for every value
+		float posScale = 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (axes[1][axis].pTrack)
+				posScale = max(posScale, axes[1][axis].srcScale);
+
+			if (!tracks.pRaw[1])
+				posScale = max(posScale, GetTrackAxisRange(axes[1][axis]) / 32767.0f);
+		}
+
+		pNewBone->posscale = posScale;
+
+		const float dstScales[3][3] = {
+			{ dstBone.rotscale.x, dstBone.rotscale.y, dstBone.rotscale.z },
+			{ posScale, posScale, posScale },
+			{ dstBone.scalescale.x, dstBone.scalescale.y, dstBone.scalescale.z }
+		};
+
+		static const int slotOffsets[3] = { 0, 8, 14 };
+		static const unsigned char rawFlags[3] = { r2::STUDIO_ANIM_RAWROT, r2::STUDIO_ANIM_RAWPOS, r2::STUDIO_ANIM_RAWSCALE };
+
+		bool hasRotation = false;
+
+		for (int type = 0; type < 3; type++)
+		{
+			char* const pSlot = pNewBone->pData() + slotOffsets[type];
+
+			// constant values don't depend on the bone, they carry over as they are
+			if (tracks.pRaw[type])
+			{
+				pNewBone->flags |= rawFlags[type];
+
+				if (type == 0)
+				{
+					Quaternion q;
+					if (tracks.rawRot64)
+					{
+						Quaternion64 q64;
+						memcpy(&q64, tracks.pRaw[type], sizeof(Quaternion64));
+						q = q64;
+					}
+					else
+					{
+						Quaternion48 q48;
+						memcpy(&q48, tracks.pRaw[type], sizeof(Quaternion48));
+						q = q48;
+					}
+
+					const Quaternion64 q64 = q;
+					memcpy(pSlot, &q64, sizeof(Quaternion64));
+					hasRotation = true;
+				}
+				else
+				{
+					memcpy(pSlot, tracks.pRaw[type], sizeof(Vector48));
+				}
+
+				continue;
+			}
+
+			// without a track rotation takes the base angles, position and scale decode to zero over the base values
+			if (type == 0 && !tracks.pTrack[0] && isDelta)
+				continue;
+
+			r2::mstudioanim_valueptr_t* const pValuePtr = reinterpret_cast<r2::mstudioanim_valueptr_t*>(pSlot);
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				ALIGN2(g_model.pData);
+				const int offset = static_cast<int>(g_model.pData - reinterpret_cast<char*>(pValuePtr));
+
+				if (offset > 32767)
+					return false;
+
+				if (WriteTrackAxis_52(axes[type][axis], dstScales[type][axis], section.numFrames, stats.numClamped))
+				{
+					pValuePtr->offset[axis] = static_cast<short>(offset);
+					hasRotation |= type == 0;
+				}
+			}
+		}
+
+		if (!hasRotation && !tracks.pTrack[0])
+			pNewBone->flags |= r2::STUDIO_ANIM_NOROT;
+
+		pPrevBone = pNewBone;
+	}
+
+	ALIGN4(g_model.pData);
+	return true;
+}
+
+//
+// RaiseRotationScales_52
+// Purpose: our bones' rotation and scale track scales have to reach every value the merged animations store against them,
+//			raised where an include model's bone swings further or sits on other base angles than ours
+//
+static void RaiseRotationScales_52(const std::vector<s_mergemodel_t>& mergeModels)
+{
+	r2::mstudiobone_t* const pDstBones = reinterpret_cast<r2::mstudiobone_t*>(g_model.pBase + g_model.hdrV53()->boneindex);
+
+	std::vector<s_animsection_t> sections;
+	std::vector<s_mergebone_t> bones;
+
+	int numRaised = 0;
+
+	for (const s_mergemodel_t& model : mergeModels)
+	{
+		for (int i = 0; i < model.pHdr->numlocalanim; i++)
+		{
+			const r1::mstudioanimdesc_t* const pAnim = model.pAnimdesc(i);
+
+			sections.clear();
+			if ((pAnim->flags & (STUDIO_ALLZEROS | STUDIO_FRAMEANIM)) || !GetAnimSections_52(pAnim, sections))
+				continue;
+
+			for (const s_animsection_t& section : sections)
+			{
+				GetMergedBones_52(model, section, bones);
+
+				for (const s_mergebone_t& bone : bones)
+				{
+					const s_r1bonetracks_t tracks = GetBoneTracks_52(bone.pBone);
+					r2::mstudiobone_t& dstBone = pDstBones[bone.dstBone];
+
+					for (int type = 0; type < 3; type += 2)
+					{
+						s_trackaxis_t axes[3];
+						if (tracks.pRaw[type] || !GetTrackAxes_52(tracks, type, *model.pHdr->pBone(bone.pBone->bone), dstBone, pAnim->flags & STUDIO_DELTA, section.numFrames, model.pEnd(), axes))
+							continue;
+
+						Vector& dstScale = type == 0 ? dstBone.rotscale : dstBone.scalescale;
+
+						for (int axis = 0; axis < 3; axis++)
+						{
+							const float scale = GetTrackAxisRange(axes[axis]) / 32767.0f;
+							if (scale <= dstScale[axis])
+								continue;
+
+							dstScale[axis] = scale;
+							numRaised++;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if (numRaised)
+		printf("  [INCLUDE] raised %i bone rotation or scale track scales to hold the merged animations\n", numRaised);
+}
+
+//
+// ConvertAnimationsFrom52To53
+// Purpose: writes the animations of the model and the include models merged into it, animations named like an earlier one are
+//			dropped for it as the runtime does. tracks move to our bones by name, ik rules and local hierarchies are not carried over
+//
+static void ConvertAnimationsFrom52To53(std::vector<s_mergemodel_t>& mergeModels)
+{
+	std::map<std::string, int> animNames;
+	std::vector<std::pair<const s_mergemodel_t*, const r1::mstudioanimdesc_t*>> anims;
+
+	for (s_mergemodel_t& model : mergeModels)
+	{
+		for (int i = 0; i < model.pHdr->numlocalanim; i++)
+		{
+			const r1::mstudioanimdesc_t* const pAnim = model.pAnimdesc(i);
+			const auto it = animNames.emplace(NormalizeMergeName(pAnim->pszName()), static_cast<int>(anims.size()));
+
+			// our own are all kept, our sequences index them
+			if (!it.second && &model != &mergeModels.front())
+			{
+				model.animRemap.push_back(it.first->second);
+				continue;
+			}
+
+			model.animRemap.push_back(static_cast<int>(anims.size()));
+			anims.push_back({ &model, pAnim });
+		}
+	}
+
+	printf("converting %zu animations...\n", anims.size());
+
+	RaiseRotationScales_52(mergeModels);
+
+	g_model.hdrV53()->localanimindex = g_model.pData - g_model.pBase;
+	g_model.hdrV53()->numlocalanim = static_cast<int>(anims.size());
+
+	r2::mstudioanimdesc_t* const pNewAnims = reinterpret_cast<r2::mstudioanimdesc_t*>(g_model.pData);
+	g_model.pData += anims.size() * sizeof(r2::mstudioanimdesc_t);
+
+	s_mergestats_t stats{};
+
+	std::vector<s_animsection_t> sections;
+	std::vector<s_mergebone_t> bones;
+
+	for (size_t i = 0; i < anims.size(); i++)
+	{
+		const s_mergemodel_t& model = *anims[i].first;
+		const r1::mstudioanimdesc_t* const pOldAnim = anims[i].second;
+		r2::mstudioanimdesc_t* const pNewAnim = &pNewAnims[i];
+
+		pNewAnim->baseptr = static_cast<int>(g_model.pBase - (char*)pNewAnim);
+		AddToStringTable((char*)pNewAnim, &pNewAnim->sznameindex, pOldAnim->pszName());
+
+		pNewAnim->fps = pOldAnim->fps;
+		pNewAnim->flags = pOldAnim->flags;
+		pNewAnim->numframes = pOldAnim->numframes;
+
+		stats.numIkRules += pOldAnim->numikrules;
+		stats.numLocalHierarchies += pOldAnim->numlocalhierarchy;
+
+		if (pOldAnim->nummovements)
+		{
+			pNewAnim->nummovements = pOldAnim->nummovements;
+			pNewAnim->movementindex = static_cast<int>(g_model.pData - (char*)pNewAnim);
+
+			memcpy(g_model.pData, (char*)pOldAnim + pOldAnim->movementindex, pOldAnim->nummovements * sizeof(r2::mstudiomovement_t));
+			g_model.pData += pOldAnim->nummovements * sizeof(r2::mstudiomovement_t);
+		}
+
+		// root motion doesn't depend on any bone, its tracks carry over as they are
+		if ((pOldAnim->flags & STUDIO_FRAMEMOVEMENT) && pOldAnim->framemovementindex)
+		{
+			const r1::mstudioframemovement_t* const pOldMovement = pOldAnim->pFrameMovement();
+			r2::mstudioframemovement_t* const pNewMovement = reinterpret_cast<r2::mstudioframemovement_t*>(g_model.pData);
+
+			pNewAnim->framemovementindex = static_cast<int>(g_model.pData - (char*)pNewAnim);
+			memcpy(pNewMovement->scale, pOldMovement->scale, sizeof(pNewMovement->scale));
+			g_model.pData += sizeof(r2::mstudioframemovement_t);
+
+			for (int axis = 0; axis < 4; axis++)
+			{
+				const int length = pOldMovement->offset[axis] > 0 ? GetAnimTrackLength_52(pOldMovement->pAnimvalue(axis), model.pEnd(), pOldAnim->numframes) : 0;
+				if (!length)
+					continue;
+
+				pNewMovement->offset[axis] = static_cast<short>(g_model.pData - (char*)pNewMovement);
+				memcpy(g_model.pData, pOldMovement->pAnimvalue(axis), length * sizeof(r2::mstudioanimvalue_t));
+				g_model.pData += length * sizeof(r2::mstudioanimvalue_t);
+			}
+
+			ALIGN4(g_model.pData);
+		}
+
+		if (pOldAnim->flags & STUDIO_ALLZEROS)
+			continue;
+
+		char* const pAnimData = g_model.pData;
+
+		// r2 has no frame animations, and animblock files aren't loaded
+		sections.clear();
+		bool readable = !(pOldAnim->flags & STUDIO_FRAMEANIM) && GetAnimSections_52(pOldAnim, sections);
+
+		if (readable && pOldAnim->sectionframes)
+		{
+			pNewAnim->sectionframes = pOldAnim->sectionframes;
+			pNewAnim->sectionindex = static_cast<int>(g_model.pData - (char*)pNewAnim);
+			g_model.pData += sections.size() * sizeof(r2::mstudioanimsections_t);
+		}
+
+		for (size_t j = 0; readable && j < sections.size(); j++)
+		{
+			GetMergedBones_52(model, sections[j], bones);
+
+			// every section needs a bone list of its own
+			if (bones.empty())
+			{
+				readable = false;
+				break;
+			}
+
+			const int animIndex = static_cast<int>(g_model.pData - (char*)pNewAnim);
+
+			if (pOldAnim->sectionframes)
+				const_cast<r2::mstudioanimsections_t*>(pNewAnim->pSection(static_cast<int>(j)))->animindex = animIndex;
+			else
+				pNewAnim->animindex = animIndex;
+
+			readable = WriteAnimBones_52(model, sections[j], pOldAnim->flags & STUDIO_DELTA, bones, stats);
+		}
+
+		if (!readable)
+		{
+			// drop whatever was written of it, the buffer is expected to be zeroed past pData
+			memset(pAnimData, 0, g_model.pData - pAnimData);
+			g_model.pData = pAnimData;
+
+			pNewAnim->flags = (pNewAnim->flags & ~STUDIO_FRAMEANIM) | STUDIO_ALLZEROS;
+			pNewAnim->animindex = 0;
+			pNewAnim->sectionindex = 0;
+			pNewAnim->sectionframes = 0;
+
+			stats.numUnreadable++;
+		}
+	}
+
+	if (stats.numUnreadable)
+		printf("  [INCLUDE] %i animations are in animblock files, frame animations or have no tracks on our bones, they are written without data\n", stats.numUnreadable);
+
+	if (stats.numIkRules || stats.numLocalHierarchies)
+		printf("  [INCLUDE] %i ik rules and %i local hierarchies are not carried over\n", stats.numIkRules, stats.numLocalHierarchies);
+
+	if (stats.numClamped)
+		printf("  [INCLUDE] %i track values were clamped to what our bones can store\n", stats.numClamped);
+}
+
+//
+// ConvertSequencesFrom52To53
+// Purpose: writes the sequences of the model and the include models merged into it, sequences named like an earlier one are dropped
+//			for it as the runtime does. weight lists move to our bones by name, transition nodes of include models are not carried over
+//
+static void ConvertSequencesFrom52To53(std::vector<s_mergemodel_t>& mergeModels)
+{
+	std::map<std::string, int> seqNames;
+	std::vector<std::pair<const s_mergemodel_t*, const r1::mstudioseqdesc_t*>> seqs;
+
+	for (s_mergemodel_t& model : mergeModels)
+	{
+		for (int i = 0; i < model.pHdr->numlocalseq; i++)
+		{
+			const r1::mstudioseqdesc_t* const pSeq = model.pSeqdesc(i);
+			const auto it = seqNames.emplace(NormalizeMergeName(STRING_FROM_IDX(pSeq, pSeq->szlabelindex)), static_cast<int>(seqs.size()));
+
+			// our own are all kept, game code may look them up by index
+			if (!it.second && &model != &mergeModels.front())
+			{
+				model.seqRemap.push_back(it.first->second);
+				continue;
+			}
+
+			model.seqRemap.push_back(static_cast<int>(seqs.size()));
+			seqs.push_back({ &model, pSeq });
+		}
+	}
+
+	printf("converting %zu sequences...\n", seqs.size());
+
+	const int numBones = g_model.hdrV53()->numbones;
+
+	g_model.hdrV53()->localseqindex = g_model.pData - g_model.pBase;
+	g_model.hdrV53()->numlocalseq = static_cast<int>(seqs.size());
+
+	r2::mstudioseqdesc_t* const pNewSeqs = reinterpret_cast<r2::mstudioseqdesc_t*>(g_model.pData);
+	g_model.pData += seqs.size() * sizeof(r2::mstudioseqdesc_t);
+
+	int numDroppedIkLocks = 0;
+
+	for (size_t i = 0; i < seqs.size(); i++)
+	{
+		const s_mergemodel_t& model = *seqs[i].first;
+		const bool isSelf = &model == &mergeModels[0];
+
+		const r1::mstudioseqdesc_t* const pOldSeq = seqs[i].second;
+		r2::mstudioseqdesc_t* const pNewSeq = &pNewSeqs[i];
+
+		const auto remapPoseParam = [&model](const int poseParam) { return poseParam >= 0 && poseParam < static_cast<int>(model.poseParamRemap.size()) ? model.poseParamRemap[poseParam] : -1; };
+
+		pNewSeq->baseptr = static_cast<int>(g_model.pBase - (char*)pNewSeq);
+
+		AddToStringTable((char*)pNewSeq, &pNewSeq->szlabelindex, STRING_FROM_IDX(pOldSeq, pOldSeq->szlabelindex));
+		AddToStringTable((char*)pNewSeq, &pNewSeq->szactivitynameindex, STRING_FROM_IDX(pOldSeq, pOldSeq->szactivitynameindex));
+
+		pNewSeq->flags = pOldSeq->flags;
+		pNewSeq->activity = pOldSeq->activity;
+		pNewSeq->actweight = pOldSeq->actweight;
+		pNewSeq->bbmin = pOldSeq->bbmin;
+		pNewSeq->bbmax = pOldSeq->bbmax;
+		pNewSeq->numblends = pOldSeq->numblends;
+		pNewSeq->groupsize[0] = pOldSeq->groupsize[0];
+		pNewSeq->groupsize[1] = pOldSeq->groupsize[1];
+
+		for (int j = 0; j < 2; j++)
+		{
+			pNewSeq->paramindex[j] = remapPoseParam(pOldSeq->paramindex[j]);
+			pNewSeq->paramstart[j] = pOldSeq->paramstart[j];
+			pNewSeq->paramend[j] = pOldSeq->paramend[j];
+		}
+
+		pNewSeq->paramparent = pOldSeq->paramparent;
+		pNewSeq->fadeintime = pOldSeq->fadeintime;
+		pNewSeq->fadeouttime = pOldSeq->fadeouttime;
+
+		// include models' transition nodes aren't merged into ours
+		pNewSeq->localentrynode = isSelf ? pOldSeq->localentrynode : 0;
+		pNewSeq->localexitnode = isSelf ? pOldSeq->localexitnode : 0;
+		pNewSeq->nodeflags = isSelf ? pOldSeq->nodeflags : 0;
+
+		pNewSeq->entryphase = pOldSeq->entryphase;
+		pNewSeq->exitphase = pOldSeq->exitphase;
+		pNewSeq->lastframe = pOldSeq->lastframe;
+		pNewSeq->nextseq = pOldSeq->nextseq > 0 && pOldSeq->nextseq < model.pHdr->numlocalseq ? model.seqRemap[pOldSeq->nextseq] : pOldSeq->nextseq;
+		pNewSeq->pose = pOldSeq->pose;
+		pNewSeq->cycleposeindex = remapPoseParam(pOldSeq->cycleposeindex);
+		pNewSeq->ikResetMask = pOldSeq->ikResetMask;
+		pNewSeq->unk1 = pOldSeq->unk1;
+
+		// events
+		pNewSeq->numevents = pOldSeq->numevents;
+		pNewSeq->eventindex = static_cast<int>(g_model.pData - (char*)pNewSeq);
+
+		for (int j = 0; j < pOldSeq->numevents; j++)
+		{
+			const r1::mstudioevent_t* const pOldEvent = PTR_FROM_IDX(const r1::mstudioevent_t, pOldSeq, pOldSeq->eventindex) + j;
+			r2::mstudioevent_t* const pNewEvent = reinterpret_cast<r2::mstudioevent_t*>(g_model.pData);
+
+			pNewEvent->cycle = pOldEvent->cycle;
+			pNewEvent->event = pOldEvent->event;
+			pNewEvent->type = pOldEvent->type;
+			memcpy(pNewEvent->options, pOldEvent->options, sizeof(pNewEvent->options));
+
+			AddToStringTable((char*)pNewEvent, &pNewEvent->szeventindex, STRING_FROM_IDX(pOldEvent, pOldEvent->szeventindex));
+
+			g_model.pData += sizeof(r2::mstudioevent_t);
+		}
+
+		// autolayers, their sequences and pose parameters move with the merge
+		pNewSeq->numautolayers = pOldSeq->numautolayers;
+		pNewSeq->autolayerindex = static_cast<int>(g_model.pData - (char*)pNewSeq);
+
+		for (int j = 0; j < pOldSeq->numautolayers; j++)
+		{
+			const r1::mstudioautolayer_t* const pOldLayer = PTR_FROM_IDX(const r1::mstudioautolayer_t, pOldSeq, pOldSeq->autolayerindex) + j;
+			r2::mstudioautolayer_t* const pNewLayer = reinterpret_cast<r2::mstudioautolayer_t*>(g_model.pData);
+
+			*reinterpret_cast<r1::mstudioautolayer_t*>(pNewLayer) = *pOldLayer;
+
+			if (pOldLayer->iSequence >= 0 && pOldLayer->iSequence < model.pHdr->numlocalseq)
+				pNewLayer->iSequence = static_cast<short>(model.seqRemap[pOldLayer->iSequence]);
+
+			pNewLayer->iPose = static_cast<short>(remapPoseParam(pOldLayer->iPose));
+
+			g_model.pData += sizeof(r2::mstudioautolayer_t);
+		}
+
+		// weight list, one weight per bone of ours. bones the source model doesn't have aren't touched by the sequence
+		pNewSeq->weightlistindex = static_cast<int>(g_model.pData - (char*)pNewSeq);
+
+		float* const pWeights = reinterpret_cast<float*>(g_model.pData);
+		const float* const pOldWeights = PTR_FROM_IDX(const float, pOldSeq, pOldSeq->weightlistindex);
+
+		memset(pWeights, 0, numBones * sizeof(float));
+		for (int j = 0; j < model.pHdr->numbones; j++)
+		{
+			if (model.boneRemap[j] >= 0)
+				pWeights[model.boneRemap[j]] = pOldWeights[j];
+		}
+
+		g_model.pData += numBones * sizeof(float);
+
+		// pose keys
+		if (pOldSeq->posekeyindex)
+		{
+			const int numPoseKeys = pOldSeq->groupsize[0] + pOldSeq->groupsize[1];
+
+			pNewSeq->posekeyindex = static_cast<int>(g_model.pData - (char*)pNewSeq);
+			memcpy(g_model.pData, (char*)pOldSeq + pOldSeq->posekeyindex, numPoseKeys * sizeof(float));
+			g_model.pData += numPoseKeys * sizeof(float);
+		}
+
+		// ik locks on chains we have
+		pNewSeq->iklockindex = static_cast<int>(g_model.pData - (char*)pNewSeq);
+
+		for (int j = 0; j < pOldSeq->numiklocks; j++)
+		{
+			const r1::mstudioiklock_t* const pOldLock = PTR_FROM_IDX(const r1::mstudioiklock_t, pOldSeq, pOldSeq->iklockindex) + j;
+
+			const int chain = pOldLock->chain >= 0 && pOldLock->chain < model.pHdr->numikchains ? model.ikChainRemap[pOldLock->chain] : -1;
+			if (chain < 0)
+			{
+				numDroppedIkLocks++;
+				continue;
+			}
+
+			r2::mstudioiklock_t* const pNewLock = reinterpret_cast<r2::mstudioiklock_t*>(g_model.pData);
+
+			pNewLock->chain = chain;
+			pNewLock->flPosWeight = pOldLock->flPosWeight;
+			pNewLock->flLocalQWeight = pOldLock->flLocalQWeight;
+			pNewLock->flags = pOldLock->flags;
+
+			pNewSeq->numiklocks++;
+			g_model.pData += sizeof(r2::mstudioiklock_t);
+		}
+
+		// blend animations
+		pNewSeq->animindexindex = static_cast<int>(g_model.pData - (char*)pNewSeq);
+
+		const int numBlends = pOldSeq->groupsize[0] * pOldSeq->groupsize[1];
+		for (int j = 0; j < numBlends; j++)
+		{
+			const short oldAnim = PTR_FROM_IDX(const short, pOldSeq, pOldSeq->animindexindex)[j];
+			reinterpret_cast<short*>(g_model.pData)[j] = static_cast<short>(oldAnim >= 0 && oldAnim < model.pHdr->numlocalanim ? model.animRemap[oldAnim] : 0);
+		}
+
+		g_model.pData += numBlends * sizeof(short);
+		ALIGN4(g_model.pData);
+
+		// activity modifiers
+		pNewSeq->numactivitymodifiers = pOldSeq->numactivitymodifiers;
+		pNewSeq->activitymodifierindex = static_cast<int>(g_model.pData - (char*)pNewSeq);
+
+		for (int j = 0; j < pOldSeq->numactivitymodifiers; j++)
+		{
+			const r1::mstudioactivitymodifier_t* const pOldModifier = PTR_FROM_IDX(const r1::mstudioactivitymodifier_t, pOldSeq, pOldSeq->activitymodifierindex) + j;
+			r2::mstudioactivitymodifier_t* const pNewModifier = reinterpret_cast<r2::mstudioactivitymodifier_t*>(g_model.pData);
+
+			AddToStringTable((char*)pNewModifier, &pNewModifier->sznameindex, STRING_FROM_IDX(pOldModifier, pOldModifier->sznameindex));
+			pNewModifier->negate = pOldModifier->negate;
+
+			g_model.pData += sizeof(r2::mstudioactivitymodifier_t);
+		}
+
+		// key values
+		if (pOldSeq->keyvaluesize)
+		{
+			pNewSeq->keyvalueindex = static_cast<int>(g_model.pData - (char*)pNewSeq);
+			pNewSeq->keyvaluesize = pOldSeq->keyvaluesize;
+
+			memcpy(g_model.pData, (char*)pOldSeq + pOldSeq->keyvalueindex, pOldSeq->keyvaluesize);
+			g_model.pData += pOldSeq->keyvaluesize;
+		}
+
+		ALIGN4(g_model.pData);
+	}
+
+	// our transition nodes, the sequences above index them
+	const r1::studiohdr_t* const pOldHdr = mergeModels[0].pHdr;
+	const int numNodes = pOldHdr->numlocalnodes;
+
+	g_model.hdrV53()->numlocalnodes = numNodes;
+	g_model.hdrV53()->localnodenameindex = g_model.pData - g_model.pBase;
+
+	for (int i = 0; i < numNodes; i++)
+	{
+		const int oldNameIndex = PTR_FROM_IDX(const int, pOldHdr, pOldHdr->localnodenameindex)[i];
+		AddToStringTable(g_model.pBase, reinterpret_cast<int*>(g_model.pData), STRING_FROM_IDX(pOldHdr, oldNameIndex));
+
+		g_model.pData += sizeof(int);
+	}
+
+	g_model.hdrV53()->localnodeindex = g_model.pData - g_model.pBase;
+
+	memcpy(g_model.pData, (char*)pOldHdr + pOldHdr->localnodeindex, numNodes * numNodes);
+	g_model.pData += numNodes * numNodes;
+
+	ALIGN4(g_model.pData);
+
+	if (numDroppedIkLocks)
+		printf("  [INCLUDE] %i ik locks are on ik chains this model doesn't have, they are dropped\n", numDroppedIkLocks);
 }
 
 void ConvertTexturesFrom52To53(mstudiotexturedir_t* pCDTextures, int numCDTextures, r1::mstudiotexture_t* pOldTextures, int numTextures, r1::studiohdr_t* pOldHdr)
@@ -418,9 +1523,10 @@ void ConvertSkinsFromMDL(char* pOldSkinData, int numSkinRef, int numSkinFamilies
 
 	g_model.hdrV53()->skinindex = g_model.pData - g_model.pBase;
 
-	int skinIndexDataSize = sizeof(__int16) * numSkinRef * numSkinFamilies;
-	memcpy(g_model.pData, pOldSkinData, skinIndexDataSize);
-	g_model.pData += skinIndexDataSize;
+	// v53 has no skin names to remap
+	std::vector<int> families;
+	g_model.hdrV53()->numskinref = WriteSkinTable(reinterpret_cast<const short*>(pOldSkinData), numSkinRef, numSkinFamilies, GetUsedSkinRefCount(g_model.hdrV53()), families);
+	g_model.hdrV53()->numskinfamilies = static_cast<int>(families.size());
 
 	ALIGN4(g_model.pData);
 }
@@ -464,7 +1570,6 @@ void ConvertMDL52To53(char* pMDL, const std::string& pathIn, const std::string&
 	r1::studiohdr_t* oldHeader = input.get<r1::studiohdr_t>();
 
 	std::string outPath = ChangeExtension(pathOut, "mdl_new");
-	std::ofstream out(outPath, std::ios::out | std::ios::binary);
 
 	// allocate temp file buffer
 	g_model.pBase = new char[FILEBUFSIZE] {};
@@ -493,6 +1598,14 @@ void ConvertMDL52To53(char* pMDL, const std::string& pathIn, const std::string&
 		phyIn.read(phyBuf.get(), phySize);
 		phyIn.close();
 
+		std::vector<char> simplifiedPhy;
+		if (g_options.simplifyPhy && SimplifyPhyHulls(phyBuf.get(), phySize, simplifiedPhy))
+		{
+			phySize = simplifiedPhy.size();
+			phyBuf = std::unique_ptr<char[]>(new char[phySize]);
+			memcpy(phyBuf.get(), simplifiedPhy.data(), phySize);
+		}
+
 		g_model.hdrV53()->phySize = phySize;
 	}
 	//-| end phy reading   |-----
@@ -556,6 +1669,9 @@ void ConvertMDL52To53(char* pMDL, const std::string& pathIn, const std::string&
 
 	// eventually we will need to load ani files
 
+	// include models resolved with -includepath, their data is read until the string table is written
+	std::vector<std::unique_ptr<char[]>> includeBufs;
+
 	// init string table so we can use 
 	BeginStringTable();
 
@@ -590,14 +1706,9 @@ void ConvertMDL52To53(char* pMDL, const std::string& pathIn, const std::string&
 	input.seek(oldHeader->hitboxsetindex, rseekdir::beg);
 	ConvertHitboxesFromMDLTo53((mstudiohitboxset_t*)input.getPtr(), oldHeader->numhitboxsets);
 
-	// copy bonebyname table (bone ids sorted alphabetically by name)
+	// regenerate bonebyname table (bone ids sorted alphabetically by name)
 	input.seek(oldHeader->bonetablebynameindex, rseekdir::beg);
-	input.read(g_model.pData, g_model.hdrV53()->numbones);
-
-	g_model.hdrV53()->bonetablebynameindex = g_model.pData - g_model.pBase;
-	g_model.pData += g_model.hdrV53()->numbones;
-
-	ALIGN4(g_model.pData);
+	WriteBoneTableByName<r2::mstudiobone_t>(g_model.hdrV53(), oldHeader->bonetablebynameindex ? reinterpret_cast<const unsigned char*>(input.getPtr()) : nullptr);
 
 	//ConvertAnims_49();
 
@@ -617,11 +1728,27 @@ void ConvertMDL52To53(char* pMDL, const std::string& pathIn, const std::string&
 	input.seek(oldHeader->localposeparamindex, rseekdir::beg);
 	g_model.hdrV53()->localposeparamindex = ConvertPoseParams((mstudioposeparamdesc_t*)input.getPtr(), oldHeader->numlocalposeparameters, false);
 
+	// with -includepath the include models found there are merged into this model, the rest stay references
+	std::vector<s_mergemodel_t> mergeModels;
+	std::vector<s_includeref_t> includeRefs;
+	if (!g_options.includeModelPath.empty())
+	{
+		ResolveIncludeModels(oldHeader, includeBufs, mergeModels, includeRefs);
+		AppendIncludePoseParams(oldHeader, mergeModels);
+		RemapIncludeIkChains(oldHeader, mergeModels);
+	}
+
 	// should be after meshes
 	pHdr->uiPanelOffset = g_model.pData - g_model.pBase;
 
 	input.seek(oldHeader->includemodelindex, rseekdir::beg);
-	ConvertIncludeModels((mstudiomodelgroup_t*)input.getPtr(), oldHeader->numincludemodels);
+	ConvertIncludeModels((mstudiomodelgroup_t*)input.getPtr(), oldHeader->numincludemodels, mergeModels.empty() ? nullptr : &includeRefs);
+
+	if (!mergeModels.empty())
+	{
+		ConvertAnimationsFrom52To53(mergeModels);
+		ConvertSequencesFrom52To53(mergeModels);
+	}
 
 	// get cdtextures pointer for converting textures
 	input.seek(oldHeader->cdtextureindex, rseekdir::beg);
@@ -653,6 +1780,16 @@ void ConvertMDL52To53(char* pMDL, const std::string& pathIn, const std::string&
 	{
 		mstudiolinearbone_t* pLinearBones = reinterpret_cast<mstudiolinearbone_t*>(oldHeader->pStudioHdr2()->pLinearBones());
 		ConvertLinearBoneTableTo53(pLinearBones, (char*)pLinearBones + sizeof(mstudiolinearbone_t));
+
+		// the runtime reads rotation scales from here, merged animations may have raised them
+		if (!mergeModels.empty())
+		{
+			const mstudiolinearbone_t* const pNewLinearBones = reinterpret_cast<mstudiolinearbone_t*>(g_model.pBase + g_model.hdrV53()->linearboneindex);
+			const r2::mstudiobone_t* const pNewBones = reinterpret_cast<r2::mstudiobone_t*>(g_model.pBase + g_model.hdrV53()->boneindex);
+
+			for (int i = 0; i < pNewLinearBones->numbones; i++)
+				reinterpret_cast<Vector*>((char*)pNewLinearBones + pNewLinearBones->rotscaleindex)[i] = pNewBones[i].rotscale;
+		}
 	}
 
 	r1::mstudiopertrihdr_t* pPerTriAABB = oldHeader->pStudioHdr2()->pPerTriHdr();
@@ -706,7 +1843,7 @@ void ConvertMDL52To53(char* pMDL, const std::string& pathIn, const std::string&
 
 	pHdr->length = g_model.pData - g_model.pBase;
 
-	out.write(g_model.pBase, pHdr->length);
+	WriteOutputFile(outPath, g_model.pBase, pHdr->length);
 
 	delete[] g_model.pBase;
 
@@ -24,35 +24,307 @@
 //	}
 //}
 
+//
+// GetCollisionEnd_V120
+// Purpose: the file offset the v12.0 collision data ends at, which is where the last header's nodes stop.
+//			collision is the last lump of these files, unless one of the old vertex or physics lumps was left after it
+//
+static int GetCollisionEnd_V120(const r5::v8::studiohdr_t* const pHdr)
+{
+	const char* const pBVHData = reinterpret_cast<const char*>(pHdr) + pHdr->bvhOffset;
+	const r5::v8::mstudiocollmodel_t* const pCollModel = reinterpret_cast<const r5::v8::mstudiocollmodel_t*>(pBVHData);
+	const r5::v120::mstudiocollheader_t* const pCollHeaders = reinterpret_cast<const r5::v120::mstudiocollheader_t*>(pBVHData + sizeof(r5::v8::mstudiocollmodel_t));
+
+	const int lastNodeOffset = pHdr->bvhOffset + pCollHeaders[pCollModel->headerCount - 1].bvhNodeIndex;
+
+	int collisionEnd = pHdr->length;
+	for (const int lumpOffset : { pHdr->vtxOffset, pHdr->vvdOffset, pHdr->vvcOffset, pHdr->phyOffset, pHdr->vvwOffset })
+	{
+		if (lumpOffset > lastNodeOffset && lumpOffset < collisionEnd)
+			collisionEnd = lumpOffset;
+	}
+
+	return collisionEnd;
+}
+
+//
+// ShiftTrailingLumps_V120
+// Purpose: move the offsets of the lumps after the collision data back by the bytes the collision shrank
+//
+static void ShiftTrailingLumps_V120(r5::v8::studiohdr_t* const pHdr, const int collisionEnd, const int shrink)
+{
+	for (int* const pLumpOffset : { &pHdr->vtxOffset, &pHdr->vvdOffset, &pHdr->vvcOffset, &pHdr->phyOffset, &pHdr->vvwOffset })
+	{
+		if (*pLumpOffset >= collisionEnd && *pLumpOffset < pHdr->length)
+			*pLumpOffset -= shrink;
+	}
+
+	pHdr->length -= shrink;
+}
+
+//
+// HasCollision_V120
+// Purpose: only models with collision headers have anything to convert, the rest are already v10 as they are
+//
+static bool HasCollision_V120(const r5::v8::studiohdr_t* const pHdr)
+{
+	return pHdr->bvhOffset && reinterpret_cast<const r5::v8::mstudiocollmodel_t*>(reinterpret_cast<const char*>(pHdr) + pHdr->bvhOffset)->headerCount > 0;
+}
+
+//
+// ConvertRMDL120To10_Copy
+// Purpose: the allocate and rebuild v12.0 conversion the in place path replaced, kept as the reference it is verified against.
+//			copies everything before the collision and rebuilds the collision with the converter the 12.1+ models use
+//
+static std::unique_ptr<char[]> ConvertRMDL120To10_Copy(const char* const pMDL, const size_t fileSize, const char*& pOut)
+{
+	// Header is the same as v8
+	const r5::v8::studiohdr_t* const oldHeader = reinterpret_cast<const r5::v8::studiohdr_t*>(pMDL);
+
+	if (!HasCollision_V120(oldHeader))
+	{
+		std::unique_ptr<char[]> pCopy(new char[fileSize] {});
+		memcpy(pCopy.get(), pMDL, fileSize);
+
+		pOut = pCopy.get();
+		return pCopy;
+	}
+
+	const char* const pOldBVHData = &pMDL[oldHeader->bvhOffset];
+	const r5::v8::mstudiocollmodel_t* const pOldCollModel = reinterpret_cast<const r5::v8::mstudiocollmodel_t*>(pOldBVHData);
+	const r5::v120::mstudiocollheader_t* const pOldCollHeaders = reinterpret_cast<const r5::v120::mstudiocollheader_t*>(pOldBVHData + sizeof(r5::v8::mstudiocollmodel_t));
+
+	// verts, leaves and nodes are each 64 byte aligned, leave room for their worst case padding.
+	// the base is aligned too so that alignment is relative to the file, as it is for the in place path
+	const size_t bufferSize = fileSize + (pOldCollModel->headerCount * 3 * 63) + 63;
+	std::unique_ptr<char[]> pBuffer(new char[bufferSize] {});
+
+	g_model.pBase = pBuffer.get();
+	ALIGN64(g_model.pBase);
+	g_model.pHdr = g_model.pBase;
+
+	memcpy(g_model.pBase, pMDL, oldHeader->bvhOffset);
+	g_model.pData = g_model.pBase + oldHeader->bvhOffset;
+
+	const int collisionEnd = GetCollisionEnd_V120(oldHeader);
+	ConvertCollisionData_V120(pOldBVHData, collisionEnd - (oldHeader->bvhOffset + pOldCollHeaders[pOldCollModel->headerCount - 1].bvhNodeIndex));
+
+	// whatever came after the collision follows it directly
+	const int shrink = collisionEnd - static_cast<int>(g_model.pData - g_model.pBase);
+	memcpy(g_model.pData, &pMDL[collisionEnd], oldHeader->length - collisionEnd);
+	ShiftTrailingLumps_V120(g_model.hdrV54(), collisionEnd, shrink);
+
+	pOut = g_model.pBase;
+
+	g_model.pBase = nullptr;
+	g_model.pData = nullptr;
+	g_model.pHdr = nullptr;
+
+	return pBuffer;
+}
+
+//
+// CompactCollisionData_V120
+// Purpose: convert the v12.0 collision data where it is, shifting each region down to where the rebuilding converter places it.
+//			the headers shrink and the v12 surface property data is dropped, so the buffers, verts, leaves and nodes only ever
+//			move towards the start of the file. returns false without touching the model if one of them would have to move up
+//
+static bool CompactCollisionData_V120(char* const pMDL)
+{
+	r5::v8::studiohdr_t* const pHdr = reinterpret_cast<r5::v8::studiohdr_t*>(pMDL);
+
+	char* const pBVHData = &pMDL[pHdr->bvhOffset];
+	r5::v8::mstudiocollmodel_t* const pCollModel = reinterpret_cast<r5::v8::mstudiocollmodel_t*>(pBVHData);
+
+	const int headerCount = pCollModel->headerCount;
+	const r5::v120::mstudiocollheader_t* const pCollHeaders = reinterpret_cast<const r5::v120::mstudiocollheader_t*>(pBVHData + sizeof(r5::v8::mstudiocollmodel_t));
+
+	// the new headers overlap the old ones, keep a copy of them to read from
+	const r5::v8::mstudiocollmodel_t oldCollModel = *pCollModel;
+	const std::vector<r5::v120::mstudiocollheader_t> oldHeaders(pCollHeaders, pCollHeaders + headerCount);
+
+	const int collisionEnd = GetCollisionEnd_V120(pHdr);
+
+	// aligned like ALIGN64 on a file loaded at a 64 byte boundary
+	const auto alignRegion = [pHdr](const int offset) { return IALIGN(pHdr->bvhOffset + offset, 64) - pHdr->bvhOffset; };
+
+	// regions are relative to the collision model, planned in the order the rebuilding converter writes them
+	struct RegionMove_t
+	{
+		int src;
+		int dst;
+		int size;
+	};
+
+	std::vector<RegionMove_t> moves;
+	moves.reserve(1 + (headerCount * 3));
+
+	int pos = sizeof(r5::v8::mstudiocollmodel_t) + (headerCount * sizeof(r5::v8::mstudiocollheader_t));
+
+	// surface props, content masks and surface names, the v12 surface property data after them is dropped
+	moves.push_back({ oldCollModel.surfacePropsIndex, pos, oldHeaders[0].surfacePropDataIndex - oldCollModel.surfacePropsIndex });
+	pos += moves.back().size;
+
+	for (int i = 0; i < headerCount; i++)
+	{
+		const r5::v120::mstudiocollheader_t& oldHeader = oldHeaders[i];
+
+		pos = alignRegion(pos);
+		moves.push_back({ oldHeader.vertIndex, pos, oldHeader.bvhLeafIndex - oldHeader.vertIndex });
+		pos += moves.back().size;
+
+		// leaves run up to the next header's verts, the last header's up to the first header's nodes
+		const int leafEnd = i != headerCount - 1 ? oldHeaders[i + 1].vertIndex : oldHeaders[0].bvhNodeIndex;
+
+		pos = alignRegion(pos);
+		moves.push_back({ oldHeader.bvhLeafIndex, pos, leafEnd - oldHeader.bvhLeafIndex });
+		pos += moves.back().size;
+	}
+
+	for (int i = 0; i < headerCount; i++)
+	{
+		const r5::v120::mstudiocollheader_t& oldHeader = oldHeaders[i];
+
+		const int nodeEnd = i != headerCount - 1 ? oldHeaders[i + 1].bvhNodeIndex : collisionEnd - pHdr->bvhOffset;
+
+		pos = alignRegion(pos);
+		moves.push_back({ oldHeader.bvhNodeIndex, pos, max(nodeEnd - oldHeader.bvhNodeIndex, 0) });
+		pos += moves.back().size;
+	}
+
+	// moving the regions front to back is only safe if they are in file order and none of them moves up
+	int lastSrcEnd = 0;
+	for (const RegionMove_t& move : moves)
+	{
+		if (move.size < 0 || move.dst > move.src || move.src < lastSrcEnd)
+			return false;
+
+		lastSrcEnd = move.src + move.size;
+	}
+
+	// every surface property only reads and writes itself, so this is safe before anything moves
+	ConvertSurfaceProperties(pBVHData, pBVHData);
+
+	int writtenEnd = moves.front().dst;
+	for (const RegionMove_t& move : moves)
+	{
+		// the rebuilding converter leaves its alignment padding zeroed
+		memset(&pBVHData[writtenEnd], 0, move.dst - writtenEnd);
+		memmove(&pBVHData[move.dst], &pBVHData[move.src], move.size);
+
+		writtenEnd = move.dst + move.size;
+	}
+
+	// pos and writtenEnd only differ when the last header has no nodes, its index still points at the aligned end
+	memset(&pBVHData[writtenEnd], 0, pos - writtenEnd);
+
+	pCollModel->surfacePropsIndex = moves[0].dst;
+	pCollModel->contentMasksIndex = moves[0].dst + (oldCollModel.contentMasksIndex - oldCollModel.surfacePropsIndex);
+	pCollModel->surfaceNamesIndex = moves[0].dst + (oldCollModel.surfaceNamesIndex - oldCollModel.surfacePropsIndex);
+
+	r5::v8::mstudiocollheader_t* const pNewCollHeaders = reinterpret_cast<r5::v8::mstudiocollheader_t*>(pBVHData + sizeof(r5::v8::mstudiocollmodel_t));
+	memset(pNewCollHeaders, 0, headerCount * sizeof(r5::v8::mstudiocollheader_t));
+
+	for (int i = 0; i < headerCount; i++)
+	{
+		const r5::v120::mstudiocollheader_t& oldHeader = oldHeaders[i];
+		r5::v8::mstudiocollheader_t* const newHeader = &pNewCollHeaders[i];
+
+		newHeader->unk = oldHeader.unk;
+		memcpy_s(newHeader->origin, sizeof(newHeader->origin), oldHeader.origin, sizeof(oldHeader.origin));
+
+		newHeader->scale = oldHeader.scale;
+
+		newHeader->vertIndex = moves[1 + (i * 2)].dst;
+		newHeader->bvhLeafIndex = moves[2 + (i * 2)].dst;
+		newHeader->bvhNodeIndex = moves[1 + (headerCount * 2) + i].dst;
+	}
+
+	// whatever came after the collision follows it directly
+	const int newCollisionEnd = pHdr->bvhOffset + pos;
+	memmove(&pMDL[newCollisionEnd], &pMDL[collisionEnd], pHdr->length - collisionEnd);
+	ShiftTrailingLumps_V120(pHdr, collisionEnd, collisionEnd - newCollisionEnd);
+
+	return true;
+}
+
+//
+// VerifyFastPath
+// Purpose: compare the whole in place output against the rebuilding converter's output for the same input
+//
+static bool VerifyFastPath(const char* const pReference, const size_t referenceSize, const char* const pPatched, const size_t size)
+{
+	if (referenceSize != size)
+	{
+		printf("  [FASTPATH] ERROR: %zu bytes written, the rebuilding converter wrote %zu\n", size, referenceSize);
+		return false;
+	}
+
+	size_t mismatchCount = 0;
+	size_t firstMismatch = 0;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		if (pReference[i] == pPatched[i])
+			continue;
+
+		if (!mismatchCount)
+			firstMismatch = i;
+
+		mismatchCount++;
+	}
+
+	if (mismatchCount)
+	{
+		printf("  [FASTPATH] ERROR: %zu of %zu bytes differ from the rebuilding converter (first at 0x%zX)\n", mismatchCount, size, firstMismatch);
+		return false;
+	}
+
+	printf("  [FASTPATH] verified: %zu bytes identical to the rebuilding converter\n", size);
+	return true;
+}
+
 //
 // ConvertRMDL120To10
 // Purpose: converts mdl data from rmdl v53 subversion 12.0 (Season 6) to rmdl v9 (Apex Legends Season 2/3)
+// the layout only differs in the collision data, so the input buffer is patched in place and written back out
+// instead of being rebuilt: the collision headers and surface properties are converted where they are and the
+// regions after the headers are shifted down over the bytes the conversion frees
 //
 void ConvertRMDL120To10(char* pMDL, const size_t fileSize, const std::string& pathIn, const std::string& pathOut)
 {
-	//std::string rawModelName = std::filesystem::path(pathIn).filename().u8string();
+	std::string rawModelName = std::filesystem::path(pathIn).filename().u8string();
 
-	//printf("Converting model '%s' from version 54 (subversion 12.1) to version 54 (subversion 10)...\n", rawModelName.c_str());
+	printf("Converting model '%s' from version 54 (subversion 12.0) to version 54 (subversion 10)...\n", rawModelName.c_str());
 
 	TIME_SCOPE(__FUNCTION__);
 
-	//std::string rmdlPath = ChangeExtension(pathOut, "rmdl_conv");
-	std::ofstream out(pathOut, std::ios::out | std::ios::binary | std::ios::trunc);
+	// Header is the same as v8
+	const r5::v8::studiohdr_t* const pHdr = reinterpret_cast<r5::v8::studiohdr_t*>(pMDL);
 
-	// allocate temp file buffer
-	g_model.pBase = new char[fileSize] {};
-	g_model.pData = g_model.pBase;
+	// the reference has to be converted before the input is patched
+	std::unique_ptr<char[]> pReferenceBuffer;
+	const char* pReference = nullptr;
+	if (g_options.verifyFastPath)
+		pReferenceBuffer = ConvertRMDL120To10_Copy(pMDL, fileSize, pReference);
 
-	memcpy(g_model.pBase, pMDL, fileSize);
+	if (HasCollision_V120(pHdr) && !CompactCollisionData_V120(pMDL))
+	{
+		// a region would have to move up over data that has yet to be read, rebuild it instead
+		printf("  [FASTPATH] collision regions can't be shifted in place, rebuilding them\n");
 
-	// Header is the same as v8
-	r5::v8::studiohdr_t* const oldHeader = reinterpret_cast<r5::v8::studiohdr_t*>(pMDL);
+		const char* pRebuilt = nullptr;
+		const std::unique_ptr<char[]> pRebuiltBuffer = ConvertRMDL120To10_Copy(pMDL, fileSize, pRebuilt);
 
-	if (oldHeader->bvhOffset)
+		WriteOutputFile(pathOut, pRebuilt, reinterpret_cast<const r5::v8::studiohdr_t*>(pRebuilt)->length);
+	}
+	else
 	{
-		ConvertSurfaceProperties(&pMDL[oldHeader->bvhOffset], &g_model.pData[oldHeader->bvhOffset]);
-		ConvertCollisionData_V120_HeadersOnly(&pMDL[oldHeader->bvhOffset], &g_model.pData[oldHeader->bvhOffset]);
+		WriteOutputFile(pathOut, pMDL, pHdr->length);
+
+		if (pReference)
+			VerifyFastPath(pReference, reinterpret_cast<const r5::v8::studiohdr_t*>(pReference)->length, pMDL, pHdr->length);
 	}
 
-	out.write(g_model.pBase, oldHeader->length);
+	printf("Finished converting model '%s', proceeding...\n\n", rawModelName.c_str());
 }
@@ -89,6 +89,8 @@ void ConvertVGData_12_1(char* buf, const std::string& filePath, const std::strin
 
 	rmem submeshes(meshBuf.get());
 
+	s_weightprunestats_t pruneStats {};
+
 	// populate buffers fr
 	for (int i = 0; i < vghInput.lodCount; ++i)
 	{
@@ -121,19 +123,34 @@ void ConvertVGData_12_1(char* buf, const std::string& filePath, const std::strin
 			submesh.legacyWeightOffset = static_cast<uint32_t>(externalWeightsBufSize) / sizeof(vvd::mstudioboneweight_t);
 			submesh.stripOffset = static_cast<uint32_t>(stripsBufSize) / sizeof(OptimizedModel::StripHeader_t);
 
-			submeshes.write(submesh);
-			
 			void* vtxPtr = (thisSubmeshPointer + offsetof(vg::rev2::MeshHeader_t, vertOffset) + submeshInput.vertOffset);
 			std::memcpy(vertexBuf.get() + vertexBufSize, vtxPtr, submeshInput.vertBufferSize);
-			vertexBufSize += submeshInput.vertBufferSize;
 
 			void* indexPtr = (thisSubmeshPointer + offsetof(vg::rev2::MeshHeader_t, indexOffset) + submeshInput.indexOffset);
 			std::memcpy(indexBuf.get() + indexBufSize, indexPtr, submeshInput.indexCount * 2);
 			indexBufSize += submeshInput.indexCount * 2;
 
 			void* extendedWeightsPtr = (thisSubmeshPointer + offsetof(vg::rev2::MeshHeader_t, externalWeightOffset) + submeshInput.externalWeightOffset);
-			std::memcpy(extendedWeightsBuf.get() + extendedWeightsBufSize, extendedWeightsPtr, submeshInput.externalWeightSize);
-			extendedWeightsBufSize += submeshInput.externalWeightSize;
+
+			if (g_options.pruneWeights)
+			{
+				// vertices were copied above so they can be edited in place, the pruned weights can only be smaller
+				std::vector<vvw::mstudioboneweightextra_t> prunedExtraWeights;
+				PruneMeshWeights_VG(vertexBuf.get() + vertexBufSize, submesh.vertCount, submesh.vertCacheSize, submesh.flags,
+					reinterpret_cast<const vvw::mstudioboneweightextra_t*>(extendedWeightsPtr), static_cast<int>(submeshInput.externalWeightSize / sizeof(vvw::mstudioboneweightextra_t)),
+					prunedExtraWeights, pruneStats);
+
+				submesh.extraBoneWeightSize = static_cast<uint32_t>(prunedExtraWeights.size() * sizeof(vvw::mstudioboneweightextra_t));
+				std::memcpy(extendedWeightsBuf.get() + extendedWeightsBufSize, prunedExtraWeights.data(), submesh.extraBoneWeightSize);
+				extendedWeightsBufSize += submesh.extraBoneWeightSize;
+			}
+			else
+			{
+				std::memcpy(extendedWeightsBuf.get() + extendedWeightsBufSize, extendedWeightsPtr, submeshInput.externalWeightSize);
+				extendedWeightsBufSize += submeshInput.externalWeightSize;
+			}
+
+			vertexBufSize += submeshInput.vertBufferSize;
 
 			void* externalWeightsPtr = (thisSubmeshPointer + offsetof(vg::rev2::MeshHeader_t, legacyWeightOffset) + submeshInput.legacyWeightOffset);
 			std::memcpy(externalWeightsBuf.get() + externalWeightsBufSize, externalWeightsPtr, submeshInput.legacyWeightCount * sizeof(vvd::mstudioboneweight_t));
@@ -142,9 +159,14 @@ void ConvertVGData_12_1(char* buf, const std::string& filePath, const std::strin
 			void* stripsPtr = (thisSubmeshPointer + offsetof(vg::rev2::MeshHeader_t, stripOffset) + submeshInput.stripOffset);
 			std::memcpy(stripsBuf.get() + stripsBufSize, stripsPtr, submeshInput.stripCount * sizeof(OptimizedModel::StripHeader_t));
 			stripsBufSize += submeshInput.stripCount * sizeof(OptimizedModel::StripHeader_t);
+
+			submeshes.write(submesh);
 		}
 	}
 
+	if (g_options.pruneWeights)
+		PrintWeightPruneStats(pruneStats);
+
 	std::string rmdlPath = ChangeExtension(filePath, "rmdl");
 
 	char* boneRemapBuf = nullptr;
@@ -183,6 +205,19 @@ void ConvertVGData_12_1(char* buf, const std::string& filePath, const std::strin
 		ifs.close();
 	}
 
+	if (g_options.minimizePalette && boneRemapCount > 0)
+	{
+		std::vector<unsigned char> boneStates(boneRemapBuf, boneRemapBuf + boneRemapCount);
+
+		if (MinimizeBonePalette_VG(vertexBuf.get(), extendedWeightsBuf.get(), reinterpret_cast<vg::rev1::MeshHeader_t*>(meshBuf.get()), lodSubmeshCount, boneStates))
+		{
+			memcpy(boneRemapBuf, boneStates.data(), boneStates.size());
+			boneRemapCount = static_cast<unsigned int>(boneStates.size());
+		}
+	}
+
+	RemapBoneStates(reinterpret_cast<unsigned char*>(boneRemapBuf), boneRemapCount);
+
 	vg::rev1::VertexGroupHeader_t vgh{};
 	vgh.id = 'GVt0';
 	vgh.version = 1;
@@ -321,6 +356,8 @@ void ConvertVGData_Rev3(char* buf, const std::string& filePath, const std::strin
 
 	rmem submeshes(meshBuf.get());
 
+	s_weightprunestats_t pruneStats {};
+
 	// populate buffers
 	for (int i = 0; i < vghInput.lodCount; ++i)
 	{
@@ -354,20 +391,35 @@ void ConvertVGData_Rev3(char* buf, const std::string& filePath, const std::strin
 			submesh.legacyWeightOffset = static_cast<uint32_t>(externalWeightsBufSize) / sizeof(vvd::mstudioboneweight_t);
 			submesh.stripOffset = static_cast<uint32_t>(stripsBufSize) / sizeof(OptimizedModel::StripHeader_t);
 
-			submeshes.write(submesh);
-
 			// Key difference: use rev3::MeshHeader_t for offsetof calculations
 			void* vtxPtr = (thisSubmeshPointer + offsetof(vg::rev3::MeshHeader_t, vertOffset) + submeshInput.vertOffset);
 			std::memcpy(vertexBuf.get() + vertexBufSize, vtxPtr, submeshInput.vertBufferSize);
-			vertexBufSize += submeshInput.vertBufferSize;
 
 			void* indexPtr = (thisSubmeshPointer + offsetof(vg::rev3::MeshHeader_t, indexOffset) + submeshInput.indexOffset);
 			std::memcpy(indexBuf.get() + indexBufSize, indexPtr, submeshInput.indexCount * 2);
 			indexBufSize += submeshInput.indexCount * 2;
 
 			void* extendedWeightsPtr = (thisSubmeshPointer + offsetof(vg::rev3::MeshHeader_t, externalWeightOffset) + submeshInput.externalWeightOffset);
-			std::memcpy(extendedWeightsBuf.get() + extendedWeightsBufSize, extendedWeightsPtr, submeshInput.externalWeightSize);
-			extendedWeightsBufSize += submeshInput.externalWeightSize;
+
+			if (g_options.pruneWeights)
+			{
+				// vertices were copied above so they can be edited in place, the pruned weights can only be smaller
+				std::vector<vvw::mstudioboneweightextra_t> prunedExtraWeights;
+				PruneMeshWeights_VG(vertexBuf.get() + vertexBufSize, submesh.vertCount, submesh.vertCacheSize, submesh.flags,
+					reinterpret_cast<const vvw::mstudioboneweightextra_t*>(extendedWeightsPtr), static_cast<int>(submeshInput.externalWeightSize / sizeof(vvw::mstudioboneweightextra_t)),
+					prunedExtraWeights, pruneStats);
+
+				submesh.extraBoneWeightSize = static_cast<uint32_t>(prunedExtraWeights.size() * sizeof(vvw::mstudioboneweightextra_t));
+				std::memcpy(extendedWeightsBuf.get() + extendedWeightsBufSize, prunedExtraWeights.data(), submesh.extraBoneWeightSize);
+				extendedWeightsBufSize += submesh.extraBoneWeightSize;
+			}
+			else
+			{
+				std::memcpy(extendedWeightsBuf.get() + extendedWeightsBufSize, extendedWeightsPtr, submeshInput.externalWeightSize);
+				extendedWeightsBufSize += submeshInput.externalWeightSize;
+			}
+
+			vertexBufSize += submeshInput.vertBufferSize;
 
 			void* externalWeightsPtr = (thisSubmeshPointer + offsetof(vg::rev3::MeshHeader_t, legacyWeightOffset) + submeshInput.legacyWeightOffset);
 			std::memcpy(externalWeightsBuf.get() + externalWeightsBufSize, externalWeightsPtr, submeshInput.legacyWeightCount * sizeof(vvd::mstudioboneweight_t));
@@ -376,9 +428,14 @@ void ConvertVGData_Rev3(char* buf, const std::string& filePath, const std::strin
 			void* stripsPtr = (thisSubmeshPointer + offsetof(vg::rev3::MeshHeader_t, stripOffset) + submeshInput.stripOffset);
 			std::memcpy(stripsBuf.get() + stripsBufSize, stripsPtr, submeshInput.stripCount * sizeof(OptimizedModel::StripHeader_t));
 			stripsBufSize += submeshInput.stripCount * sizeof(OptimizedModel::StripHeader_t);
+
+			submeshes.write(submesh);
 		}
 	}
 
+	if (g_options.pruneWeights)
+		PrintWeightPruneStats(pruneStats);
+
 	std::string rmdlPath = ChangeExtension(filePath, "rmdl");
 
 	char* boneRemapBuf = nullptr;
@@ -418,6 +475,19 @@ void ConvertVGData_Rev3(char* buf, const std::string& filePath, const std::strin
 		ifs.close();
 	}
 
+	if (g_options.minimizePalette && boneRemapCount > 0)
+	{
+		std::vector<unsigned char> boneStates(boneRemapBuf, boneRemapBuf + boneRemapCount);
+
+		if (MinimizeBonePalette_VG(vertexBuf.get(), extendedWeightsBuf.get(), reinterpret_cast<vg::rev1::MeshHeader_t*>(meshBuf.get()), lodSubmeshCount, boneStates))
+		{
+			memcpy(boneRemapBuf, boneStates.data(), boneStates.size());
+			boneRemapCount = static_cast<unsigned int>(boneStates.size());
+		}
+	}
+
+	RemapBoneStates(reinterpret_cast<unsigned char*>(boneRemapBuf), boneRemapCount);
+
 	vg::rev1::VertexGroupHeader_t vgh{};
 	vgh.id = 'GVt0';
 	vgh.version = 1;
@@ -654,7 +724,7 @@ void ConvertBones_121(r5::v121::mstudiobone_t* pOldBones, int numBones, bool isR
 
 	printf("copying %lld procedural bones (jiggle bones)...\n", proceduralBones.size());
 
-	std::map<uint8_t, uint8_t> linearprocbones;
+	bytemap linearprocbones;
 
 	for (auto bone : proceduralBones)
 	{
@@ -680,9 +750,12 @@ void ConvertBones_121(r5::v121::mstudiobone_t* pOldBones, int numBones, bool isR
 	g_model.hdrV54()->procBoneCount = linearprocbones.size();
 	g_model.hdrV54()->procBoneTableOffset = g_model.pData - g_model.pBase;
 
-	for (auto& it : linearprocbones)
+	for (int i = 0; i < 256; i++)
 	{
-		*g_model.pData = it.first;
+		if (!linearprocbones.count(i))
+			continue;
+
+		*g_model.pData = static_cast<char>(i);
 		g_model.pData += sizeof(uint8_t);
 	}
 
@@ -690,7 +763,7 @@ void ConvertBones_121(r5::v121::mstudiobone_t* pOldBones, int numBones, bool isR
 
 	for (int i = 0; i < numBones; i++)
 	{
-		*g_model.pData = linearprocbones.count(i) ? linearprocbones.find(i)->second : 0xff;
+		*g_model.pData = linearprocbones.count(i) ? linearprocbones.at(i) : 0xff;
 		g_model.pData += sizeof(uint8_t);
 	}
 
@@ -703,6 +776,8 @@ void ConvertHitboxes_121(mstudiohitboxset_t* pOldHitboxSets, int numHitboxSets)
 
 	g_model.hdrV54()->hitboxsetindex = g_model.pData - g_model.pBase;
 
+	s_hitboxfitstats_t fitStats{};
+
 	mstudiohitboxset_t* hboxsetStart = reinterpret_cast<mstudiohitboxset_t*>(g_model.pData);
 	for (int i = 0; i < numHitboxSets; ++i)
 	{
@@ -725,12 +800,25 @@ void ConvertHitboxes_121(mstudiohitboxset_t* pOldHitboxSets, int numHitboxSets)
 
 		r5::v8::mstudiobbox_t* oldHitboxes = reinterpret_cast<r5::v8::mstudiobbox_t*>((char*)oldhboxset + oldhboxset->hitboxindex);
 
-		for (int j = 0; j < newhboxset->numhitboxes; ++j)
+		std::vector<s_hitboxfit_t> fits(oldhboxset->numhitboxes);
+		for (int j = 0; j < oldhboxset->numhitboxes; ++j)
+			fits[j] = { oldHitboxes[j].bone, oldHitboxes[j].group, oldHitboxes[j].bbmin, oldHitboxes[j].bbmax, true };
+
+		FitHitboxSet(fits, nullptr, fitStats);
+		newhboxset->numhitboxes = 0;
+
+		for (int j = 0; j < oldhboxset->numhitboxes; ++j)
 		{
+			if (!fits[j].keep)
+				continue;
+
 			r5::v8::mstudiobbox_t* oldHitbox = oldHitboxes + j;
 			r5::v8::mstudiobbox_t* newHitbox = reinterpret_cast<r5::v8::mstudiobbox_t*>(g_model.pData);
 
 			memcpy(g_model.pData, oldHitbox, sizeof(r5::v8::mstudiobbox_t));
+			newHitbox->bbmin = fits[j].bbmin;
+			newHitbox->bbmax = fits[j].bbmax;
+			newhboxset->numhitboxes++;
 
 			AddToStringTable((char*)newHitbox, &newHitbox->szhitboxnameindex, STRING_FROM_IDX(oldHitbox, oldHitbox->szhitboxnameindex));
 			AddToStringTable((char*)newHitbox, &newHitbox->hitdataGroupOffset, STRING_FROM_IDX(oldHitbox, oldHitbox->hitdataGroupOffset));
@@ -739,6 +827,8 @@ void ConvertHitboxes_121(mstudiohitboxset_t* pOldHitboxSets, int numHitboxSets)
 		}
 	}
 
+	PrintHitboxFitStats(fitStats);
+
 	ALIGN4(g_model.pData);
 }
 
@@ -962,8 +1052,13 @@ void ConvertTextures_121(mstudiotexturedir_t* pCDTextures, int numCDTextures, r5
 	printf("converting %i textures...\n", numTextures);
 
 	g_model.hdrV54()->textureindex = g_model.pData - g_model.pBase;
+
+	int numNewTextures = 0;
 	for (int i = 0; i < numTextures; ++i)
 	{
+		if (IsTextureCulled(i))
+			continue;
+
 		r5::v8::mstudiotexture_t* oldTexture = &pOldTextures[i];
 
 		r5::v8::mstudiotexture_t* newTexture = reinterpret_cast<r5::v8::mstudiotexture_t*>(g_model.pData);
@@ -974,8 +1069,11 @@ void ConvertTextures_121(mstudiotexturedir_t* pCDTextures, int numCDTextures, r5
 		newTexture->textureGuid = oldTexture->textureGuid;
 
 		g_model.pData += sizeof(r5::v8::mstudiotexture_t);
+		numNewTextures++;
 	}
 
+	g_model.hdrV54()->numtextures = numNewTextures;
+
 	if (shaderTypes)
 	{
 		ALIGN4(g_model.pData);
@@ -985,8 +1083,11 @@ void ConvertTextures_121(mstudiotexturedir_t* pCDTextures, int numCDTextures, r5
 		// Must be set properly otherwise the materials will not be found
 		g_model.hdrV54()->materialtypesindex = g_model.pData - g_model.pBase;
 
-		memcpy(g_model.pData, shaderTypes, numTextures);
-		g_model.pData += numTextures;
+		for (int i = 0; i < numTextures; ++i)
+		{
+			if (!IsTextureCulled(i))
+				*g_model.pData++ = static_cast<char>(shaderTypes[i]);
+		}
 	}
 	else
 	{
@@ -995,8 +1096,8 @@ void ConvertTextures_121(mstudiotexturedir_t* pCDTextures, int numCDTextures, r5
 		// needs further research to decide how to convert these.
 		g_model.hdrV54()->materialtypesindex = g_model.pData - g_model.pBase;
 
-		memset(g_model.pData, RGDP, numTextures);
-		g_model.pData += numTextures;
+		memset(g_model.pData, RGDP, numNewTextures);
+		g_model.pData += numNewTextures;
 	}
 
 	ALIGN4(g_model.pData); // align data to 4 bytes
@@ -1017,9 +1118,11 @@ void ConvertSkins_121(char* pOldModelBase, char* pOldSkinData, int numSkinRef, i
 	g_model.hdrV54()->skinindex = g_model.pData - g_model.pBase;
 
 	int skinIndexDataSize = sizeof(__int16) * numSkinRef * numSkinFamilies;
-	memcpy(g_model.pData, pOldSkinData, skinIndexDataSize);
 
-	g_model.pData += skinIndexDataSize;
+	std::vector<int> families;
+	g_model.hdrV54()->numskinref = WriteSkinTable(reinterpret_cast<const short*>(pOldSkinData), numSkinRef, numSkinFamilies, GetUsedSkinRefCount(g_model.hdrV54()), families);
+	g_model.hdrV54()->numskinfamilies = static_cast<int>(families.size());
+
 	pOldSkinData += skinIndexDataSize;
 
 	ALIGN4(g_model.pData);
@@ -1027,10 +1130,10 @@ void ConvertSkins_121(char* pOldModelBase, char* pOldSkinData, int numSkinRef, i
 
 	int* oldSkinData = reinterpret_cast<int*>(pOldSkinData);
 	// write skin names
-	// skin 0 is unnamed
-	for (int i = 0; i < numSkinFamilies - 1; ++i)
+	// skin 0 is unnamed, names stay with their source family when duplicates were dropped
+	for (size_t i = 1; i < families.size(); ++i)
 	{
-		AddToStringTable(g_model.pBase, (int*)g_model.pData, STRING_FROM_IDX(pOldModelBase, oldSkinData[i]));
+		AddToStringTable(g_model.pBase, (int*)g_model.pData, STRING_FROM_IDX(pOldModelBase, oldSkinData[families[i] - 1]));
 		g_model.pData += sizeof(int);
 	}
 
@@ -1176,7 +1279,6 @@ void ConvertRMDL121To10(char* pMDL, const std::string& pathIn, const std::string
 	}
 
 	printf("Output: %s\n", rmdlPath.c_str());
-	std::ofstream out(rmdlPath, std::ios::out | std::ios::binary);
 
 	// allocate temp file buffer
 	g_model.pBase = new char[FILEBUFSIZE] {};
@@ -1232,14 +1334,9 @@ void ConvertRMDL121To10(char* pMDL, const std::string& pathIn, const std::string
 	input.seek(oldHeader->hitboxsetindex, rseekdir::beg);
 	ConvertHitboxes_121((mstudiohitboxset_t*)input.getPtr(), oldHeader->numhitboxsets);
 
-	// copy bonebyname table (bone ids sorted alphabetically by name)
+	// regenerate bonebyname table (bone ids sorted alphabetically by name)
 	input.seek(oldHeader->bonetablebynameindex, rseekdir::beg);
-	input.read(g_model.pData, g_model.hdrV54()->numbones);
-
-	g_model.hdrV54()->bonetablebynameindex = g_model.pData - g_model.pBase;
-	g_model.pData += g_model.hdrV54()->numbones;
-
-	ALIGN4(g_model.pData);
+	WriteBoneTableByName<r5::v8::mstudiobone_t>(g_model.hdrV54(), oldHeader->bonetablebynameindex ? reinterpret_cast<const unsigned char*>(input.getPtr()) : nullptr);
 
 	input.seek(oldHeader->localseqindex, rseekdir::beg);
 	ConvertAnims_121<r5::v121::mstudioanimdesc_t>((const char*)input.getPtr(), oldHeader->numlocalseq);
@@ -1278,6 +1375,9 @@ void ConvertRMDL121To10(char* pMDL, const std::string& pathIn, const std::string
 	// So I think in these cases we should just keep materialtypesindex 0.
 	// ConvertTextures_121 will keep it 0 if matTypes is nullptr.
 
+	// find the textures no mesh can reach before they are written
+	BuildTextureRemap(reinterpret_cast<const short*>(pMDL + oldHeader->skinindex), oldHeader->numskinref, oldHeader->numskinfamilies, oldHeader->numtextures);
+
 	// convert textures
 	input.seek(oldHeader->textureindex, rseekdir::beg);
 	ConvertTextures_121((mstudiotexturedir_t*)pOldCDTextures, oldHeader->numcdtextures, (r5::v8::mstudiotexture_t*)input.getPtr(), oldHeader->numtextures, matTypes);
@@ -1306,6 +1406,9 @@ void ConvertRMDL121To10(char* pMDL, const std::string& pathIn, const std::string
 		CopyLinearBoneTableTo54(reinterpret_cast<const r5::v8::mstudiolinearbone_t* const>(input.getPtr()));
 	}
 
+	// a vg that isn't converted below would keep the old bone states
+	RemapBones_V54(CanRemapVGBones(ChangeExtension(pathIn, "vg"), false));
+
 	g_model.pData = WriteStringTable(g_model.pData);
 	ALIGN64(g_model.pData);
 
@@ -1319,7 +1422,7 @@ void ConvertRMDL121To10(char* pMDL, const std::string& pathIn, const std::string
 
 	pHdr->length = g_model.pData - g_model.pBase;
 
-	out.write(g_model.pBase, pHdr->length);
+	WriteOutputFile(rmdlPath, g_model.pBase, pHdr->length);
 
 	// now that rmdl is fully converted, convert vtx/vvd/vvc to VG
 	//CreateVGFile(ChangeExtension(pathOut, "vg"), pHdr, vtxBuf.get(), vvdBuf.get(), vvcBuf.get(), nullptr);
@@ -1370,7 +1473,6 @@ void ConvertRMDL121To10(char* pMDL, const std::string& pathIn, const std::string
 	printf("Creating rig from model...\n");
 
 	std::string rrigPath = (outputDir / (inputPath.stem().string() + ".rrig")).string();
-	std::ofstream rigOut(rrigPath, std::ios::out | std::ios::binary);
 
 	g_model.pBase = new char[FILEBUFSIZE] {};
 	g_model.pData = g_model.pBase;
@@ -1401,14 +1503,9 @@ void ConvertRMDL121To10(char* pMDL, const std::string& pathIn, const std::string
 	input.seek(oldHeader->hitboxsetindex, rseekdir::beg);
 	ConvertHitboxes_121((mstudiohitboxset_t*)input.getPtr(), oldHeader->numhitboxsets);
 
-	// copy bonebyname table (bone ids sorted alphabetically by name)
+	// regenerate bonebyname table (bone ids sorted alphabetically by name)
 	input.seek(oldHeader->bonetablebynameindex, rseekdir::beg);
-	input.read(g_model.pData, g_model.hdrV54()->numbones);
-
-	g_model.hdrV54()->bonetablebynameindex = g_model.pData - g_model.pBase;
-	g_model.pData += g_model.hdrV54()->numbones;
-
-	ALIGN4(g_model.pData);
+	WriteBoneTableByName<r5::v8::mstudiobone_t>(g_model.hdrV54(), oldHeader->bonetablebynameindex ? reinterpret_cast<const unsigned char*>(input.getPtr()) : nullptr);
 
 	input.seek(oldHeader->localposeparamindex, rseekdir::beg);
 	g_model.hdrV54()->localposeparamindex = ConvertPoseParams((mstudioposeparamdesc_t*)input.getPtr(), oldHeader->numlocalposeparameters, true);
@@ -1421,7 +1518,7 @@ void ConvertRMDL121To10(char* pMDL, const std::string& pathIn, const std::string
 
 	pHdr->length = g_model.pData - g_model.pBase;
 
-	rigOut.write(g_model.pBase, pHdr->length);
+	WriteOutputFile(rrigPath, g_model.pBase, pHdr->length);
 
 	delete[] g_model.pBase;
 #endif
@@ -1470,7 +1567,6 @@ void ConvertRMDL122To10(char* pMDL, const std::string& pathIn, const std::string
 	}
 
 	printf("Output: %s\n", rmdlPath.c_str());
-	std::ofstream out(rmdlPath, std::ios::out | std::ios::binary);
 
 	// allocate temp file buffer
 	g_model.pBase = new char[FILEBUFSIZE] {};
@@ -1526,14 +1622,9 @@ void ConvertRMDL122To10(char* pMDL, const std::string& pathIn, const std::string
 	input.seek(oldHeader->hitboxsetindex, rseekdir::beg);
 	ConvertHitboxes_121((mstudiohitboxset_t*)input.getPtr(), oldHeader->numhitboxsets);
 
-	// copy bonebyname table (bone ids sorted alphabetically by name)
+	// regenerate bonebyname table (bone ids sorted alphabetically by name)
 	input.seek(oldHeader->bonetablebynameindex, rseekdir::beg);
-	input.read(g_model.pData, g_model.hdrV54()->numbones);
-
-	g_model.hdrV54()->bonetablebynameindex = g_model.pData - g_model.pBase;
-	g_model.pData += g_model.hdrV54()->numbones;
-
-	ALIGN4(g_model.pData);
+	WriteBoneTableByName<r5::v8::mstudiobone_t>(g_model.hdrV54(), oldHeader->bonetablebynameindex ? reinterpret_cast<const unsigned char*>(input.getPtr()) : nullptr);
 
 	input.seek(oldHeader->localseqindex, rseekdir::beg);
 	ConvertAnims_121<r5::v121::mstudioanimdesc_t>((const char*)input.getPtr(), oldHeader->numlocalseq);
@@ -1559,6 +1650,9 @@ void ConvertRMDL122To10(char* pMDL, const std::string& pathIn, const std::string
 	if (oldHeader->materialtypesindex > 0)
 		matTypes = reinterpret_cast<MaterialShaderType_t*>(&pMDL[oldHeader->materialtypesindex]);
 
+	// find the textures no mesh can reach before they are written
+	BuildTextureRemap(reinterpret_cast<const short*>(pMDL + oldHeader->skinindex), oldHeader->numskinref, oldHeader->numskinfamilies, oldHeader->numtextures);
+
 	// convert textures
 	input.seek(oldHeader->textureindex, rseekdir::beg);
 	ConvertTextures_121((mstudiotexturedir_t*)pOldCDTextures, oldHeader->numcdtextures, (r5::v8::mstudiotexture_t*)input.getPtr(), oldHeader->numtextures, matTypes);
@@ -1587,6 +1681,9 @@ void ConvertRMDL122To10(char* pMDL, const std::string& pathIn, const std::string
 		CopyLinearBoneTableTo54(reinterpret_cast<const r5::v8::mstudiolinearbone_t* const>(input.getPtr()));
 	}
 
+	// a vg that isn't converted below would keep the old bone states
+	RemapBones_V54(CanRemapVGBones(ChangeExtension(pathIn, "vg"), false));
+
 	g_model.pData = WriteStringTable(g_model.pData);
 	ALIGN64(g_model.pData);
 
@@ -1600,7 +1697,7 @@ void ConvertRMDL122To10(char* pMDL, const std::string& pathIn, const std::string
 
 	pHdr->length = g_model.pData - g_model.pBase;
 
-	out.write(g_model.pBase, pHdr->length);
+	WriteOutputFile(rmdlPath, g_model.pBase, pHdr->length);
 
 	// convert v12.2 vg to v9 vg
 	std::string vgFilePath = ChangeExtension(pathIn, "vg");
@@ -1646,7 +1743,6 @@ void ConvertRMDL122To10(char* pMDL, const std::string& pathIn, const std::string
 	printf("Creating rig from model...\n");
 
 	std::string rrigPath = (outputDir / (inputPath.stem().string() + ".rrig")).string();
-	std::ofstream rigOut(rrigPath, std::ios::out | std::ios::binary);
 
 	g_model.pBase = new char[FILEBUFSIZE] {};
 	g_model.pData = g_model.pBase;
@@ -1672,14 +1768,9 @@ void ConvertRMDL122To10(char* pMDL, const std::string& pathIn, const std::string
 	input.seek(oldHeader->hitboxsetindex, rseekdir::beg);
 	ConvertHitboxes_121((mstudiohitboxset_t*)input.getPtr(), oldHeader->numhitboxsets);
 
-	// copy bonebyname table (bone ids sorted alphabetically by name)
+	// regenerate bonebyname table (bone ids sorted alphabetically by name)
 	input.seek(oldHeader->bonetablebynameindex, rseekdir::beg);
-	input.read(g_model.pData, g_model.hdrV54()->numbones);
-
-	g_model.hdrV54()->bonetablebynameindex = g_model.pData - g_model.pBase;
-	g_model.pData += g_model.hdrV54()->numbones;
-
-	ALIGN4(g_model.pData);
+	WriteBoneTableByName<r5::v8::mstudiobone_t>(g_model.hdrV54(), oldHeader->bonetablebynameindex ? reinterpret_cast<const unsigned char*>(input.getPtr()) : nullptr);
 
 	input.seek(oldHeader->localseqindex, rseekdir::beg);
 	ConvertAnims_121<r5::v121::mstudioanimdesc_t>((const char*)input.getPtr(), oldHeader->numlocalseq);
@@ -1705,7 +1796,7 @@ void ConvertRMDL122To10(char* pMDL, const std::string& pathIn, const std::string
 
 	pHdr->length = g_model.pData - g_model.pBase;
 
-	rigOut.write(g_model.pBase, pHdr->length);
+	WriteOutputFile(rrigPath, g_model.pBase, pHdr->length);
 
 	delete[] g_model.pBase;
 #endif
@@ -1750,7 +1841,6 @@ void ConvertRMDL124To10(char* pMDL, const std::string& pathIn, const std::string
 	}
 
 	printf("Output: %s\n", rmdlPath.c_str());
-	std::ofstream out(rmdlPath, std::ios::out | std::ios::binary);
 
 	g_model.pBase = new char[FILEBUFSIZE] {};
 	g_model.pData = g_model.pBase;
@@ -1798,13 +1888,9 @@ void ConvertRMDL124To10(char* pMDL, const std::string& pathIn, const std::string
 	input.seek(oldHeader->hitboxsetindex, rseekdir::beg);
 	ConvertHitboxes_121((mstudiohitboxset_t*)input.getPtr(), oldHeader->numhitboxsets);
 
+	// regenerate bonebyname table (bone ids sorted alphabetically by name)
 	input.seek(oldHeader->bonetablebynameindex, rseekdir::beg);
-	input.read(g_model.pData, g_model.hdrV54()->numbones);
-
-	g_model.hdrV54()->bonetablebynameindex = g_model.pData - g_model.pBase;
-	g_model.pData += g_model.hdrV54()->numbones;
-
-	ALIGN4(g_model.pData);
+	WriteBoneTableByName<r5::v8::mstudiobone_t>(g_model.hdrV54(), oldHeader->bonetablebynameindex ? reinterpret_cast<const unsigned char*>(input.getPtr()) : nullptr);
 
 	input.seek(oldHeader->localseqindex, rseekdir::beg);
 	ConvertAnims_121<r5::v121::mstudioanimdesc_t>((const char*)input.getPtr(), oldHeader->numlocalseq);
@@ -1828,6 +1914,9 @@ void ConvertRMDL124To10(char* pMDL, const std::string& pathIn, const std::string
 	if (oldHeader->materialtypesindex > 0)
 		matTypes = reinterpret_cast<MaterialShaderType_t*>(&pMDL[oldHeader->materialtypesindex]);
 
+	// find the textures no mesh can reach before they are written
+	BuildTextureRemap(reinterpret_cast<const short*>(pMDL + oldHeader->skinindex), oldHeader->numskinref, oldHeader->numskinfamilies, oldHeader->numtextures);
+
 	input.seek(oldHeader->textureindex, rseekdir::beg);
 	ConvertTextures_121((mstudiotexturedir_t*)pOldCDTextures, oldHeader->numcdtextures, (r5::v8::mstudiotexture_t*)input.getPtr(), oldHeader->numtextures, matTypes);
 
@@ -1852,6 +1941,9 @@ void ConvertRMDL124To10(char* pMDL, const std::string& pathIn, const std::string
 		CopyLinearBoneTableTo54(reinterpret_cast<const r5::v8::mstudiolinearbone_t* const>(input.getPtr()));
 	}
 
+	// a vg that isn't converted below would keep the old bone states
+	RemapBones_V54(CanRemapVGBones(ChangeExtension(pathIn, "vg"), false));
+
 	g_model.pData = WriteStringTable(g_model.pData);
 	ALIGN64(g_model.pData);
 
@@ -1865,7 +1957,7 @@ void ConvertRMDL124To10(char* pMDL, const std::string& pathIn, const std::string
 
 	pHdr->length = g_model.pData - g_model.pBase;
 
-	out.write(g_model.pBase, pHdr->length);
+	WriteOutputFile(rmdlPath, g_model.pBase, pHdr->length);
 
 	std::string vgFilePath = ChangeExtension(pathIn, "vg");
 
@@ -1931,7 +2023,6 @@ void ConvertRMDL125To10(char* pMDL, const std::string& pathIn, const std::string
 	}
 
 	printf("Output: %s\n", rmdlPath.c_str());
-	std::ofstream out(rmdlPath, std::ios::out | std::ios::binary);
 
 	g_model.pBase = new char[FILEBUFSIZE] {};
 	g_model.pData = g_model.pBase;
@@ -1979,13 +2070,9 @@ void ConvertRMDL125To10(char* pMDL, const std::string& pathIn, const std::string
 	input.seek(oldHeader->hitboxsetindex, rseekdir::beg);
 	ConvertHitboxes_121((mstudiohitboxset_t*)input.getPtr(), oldHeader->numhitboxsets);
 
+	// regenerate bonebyname table (bone ids sorted alphabetically by name)
 	input.seek(oldHeader->bonetablebynameindex, rseekdir::beg);
-	input.read(g_model.pData, g_model.hdrV54()->numbones);
-
-	g_model.hdrV54()->bonetablebynameindex = g_model.pData - g_model.pBase;
-	g_model.pData += g_model.hdrV54()->numbones;
-
-	ALIGN4(g_model.pData);
+	WriteBoneTableByName<r5::v8::mstudiobone_t>(g_model.hdrV54(), oldHeader->bonetablebynameindex ? reinterpret_cast<const unsigned char*>(input.getPtr()) : nullptr);
 
 	input.seek(oldHeader->localseqindex, rseekdir::beg);
 	ConvertAnims_121<r5::v121::mstudioanimdesc_t>((const char*)input.getPtr(), oldHeader->numlocalseq);
@@ -2009,6 +2096,9 @@ void ConvertRMDL125To10(char* pMDL, const std::string& pathIn, const std::string
 	if (oldHeader->materialtypesindex > 0)
 		matTypes = reinterpret_cast<MaterialShaderType_t*>(&pMDL[oldHeader->materialtypesindex]);
 
+	// find the textures no mesh can reach before they are written
+	BuildTextureRemap(reinterpret_cast<const short*>(pMDL + oldHeader->skinindex), oldHeader->numskinref, oldHeader->numskinfamilies, oldHeader->numtextures);
+
 	input.seek(oldHeader->textureindex, rseekdir::beg);
 	ConvertTextures_121((mstudiotexturedir_t*)pOldCDTextures, oldHeader->numcdtextures, (r5::v8::mstudiotexture_t*)input.getPtr(), oldHeader->numtextures, matTypes);
 
@@ -2033,6 +2123,9 @@ void ConvertRMDL125To10(char* pMDL, const std::string& pathIn, const std::string
 		CopyLinearBoneTableTo54(reinterpret_cast<const r5::v8::mstudiolinearbone_t* const>(input.getPtr()));
 	}
 
+	// a vg that isn't converted below would keep the old bone states
+	RemapBones_V54(CanRemapVGBones(ChangeExtension(pathIn, "vg"), false));
+
 	g_model.pData = WriteStringTable(g_model.pData);
 	ALIGN64(g_model.pData);
 
@@ -2046,7 +2139,7 @@ void ConvertRMDL125To10(char* pMDL, const std::string& pathIn, const std::string
 
 	pHdr->length = g_model.pData - g_model.pBase;
 
-	out.write(g_model.pBase, pHdr->length);
+	WriteOutputFile(rmdlPath, g_model.pBase, pHdr->length);
 
 	std::string vgFilePath = ChangeExtension(pathIn, "vg");
 
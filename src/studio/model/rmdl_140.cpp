@@ -490,7 +490,6 @@ void ConvertRMDL140To10(char* pMDL, const std::string& pathIn, const std::string
 	}
 
 	printf("Output: %s\n", rmdlPath.c_str());
-	std::ofstream out(rmdlPath, std::ios::out | std::ios::binary);
 
 	g_model.pBase = new char[FILEBUFSIZE] {};
 	g_model.pData = g_model.pBase;
@@ -542,14 +541,9 @@ void ConvertRMDL140To10(char* pMDL, const std::string& pathIn, const std::string
 	input.seek(oldHeader->hitboxsetindex, rseekdir::beg);
 	ConvertHitboxes_121((mstudiohitboxset_t*)input.getPtr(), oldHeader->numhitboxsets);
 
-	// copy bonebyname table
+	// regenerate bonebyname table (bone ids sorted alphabetically by name)
 	input.seek(oldHeader->bonetablebynameindex, rseekdir::beg);
-	input.read(g_model.pData, g_model.hdrV54()->numbones);
-
-	g_model.hdrV54()->bonetablebynameindex = g_model.pData - g_model.pBase;
-	g_model.pData += g_model.hdrV54()->numbones;
-
-	ALIGN4(g_model.pData);
+	WriteBoneTableByName<r5::v8::mstudiobone_t>(g_model.hdrV54(), oldHeader->bonetablebynameindex ? reinterpret_cast<const unsigned char*>(input.getPtr()) : nullptr);
 
 	input.seek(oldHeader->localseqindex, rseekdir::beg);
 	ConvertAnims_140<r5::v121::mstudioanimdesc_t>((const char*)input.getPtr(), oldHeader->numlocalseq);
@@ -575,6 +569,9 @@ void ConvertRMDL140To10(char* pMDL, const std::string& pathIn, const std::string
 	if (oldHeader->materialtypesindex > 0)
 		matTypes = reinterpret_cast<MaterialShaderType_t*>(&pMDL[oldHeader->materialtypesindex]);
 
+	// find the textures no mesh can reach before they are written
+	BuildTextureRemap(reinterpret_cast<const short*>(pMDL + oldHeader->skinindex), oldHeader->numskinref, oldHeader->numskinfamilies, oldHeader->numtextures);
+
 	// convert textures
 	input.seek(oldHeader->textureindex, rseekdir::beg);
 	ConvertTextures_121((mstudiotexturedir_t*)pOldCDTextures, oldHeader->numcdtextures, (r5::v8::mstudiotexture_t*)input.getPtr(), oldHeader->numtextures, matTypes);
@@ -603,6 +600,9 @@ void ConvertRMDL140To10(char* pMDL, const std::string& pathIn, const std::string
 		CopyLinearBoneTableTo54(reinterpret_cast<const r5::v8::mstudiolinearbone_t* const>(input.getPtr()));
 	}
 
+	// a vg that isn't converted below would keep the old bone states
+	RemapBones_V54(CanRemapVGBones(ChangeExtension(pathIn, "vg"), false));
+
 	g_model.pData = WriteStringTable(g_model.pData);
 	ALIGN64(g_model.pData);
 
@@ -616,7 +616,7 @@ void ConvertRMDL140To10(char* pMDL, const std::string& pathIn, const std::string
 
 	pHdr->length = g_model.pData - g_model.pBase;
 
-	out.write(g_model.pBase, pHdr->length);
+	WriteOutputFile(rmdlPath, g_model.pBase, pHdr->length);
 
 	// convert v14/v14.1 vg to v9 vg using rev3 conversion
 	std::string vgFilePath = ChangeExtension(pathIn, "vg");
@@ -661,7 +661,6 @@ void ConvertRMDL140To10(char* pMDL, const std::string& pathIn, const std::string
 	printf("Creating rig from model...\n");
 
 	std::string rrigPath = (outputDir / (inputPath.stem().string() + ".rrig")).string();
-	std::ofstream rigOut(rrigPath, std::ios::out | std::ios::binary);
 
 	g_model.pBase = new char[FILEBUFSIZE] {};
 	g_model.pData = g_model.pBase;
@@ -685,13 +684,9 @@ void ConvertRMDL140To10(char* pMDL, const std::string& pathIn, const std::string
 	input.seek(oldHeader->hitboxsetindex, rseekdir::beg);
 	ConvertHitboxes_121((mstudiohitboxset_t*)input.getPtr(), oldHeader->numhitboxsets);
 
+	// regenerate bonebyname table (bone ids sorted alphabetically by name)
 	input.seek(oldHeader->bonetablebynameindex, rseekdir::beg);
-	input.read(g_model.pData, g_model.hdrV54()->numbones);
-
-	g_model.hdrV54()->bonetablebynameindex = g_model.pData - g_model.pBase;
-	g_model.pData += g_model.hdrV54()->numbones;
-
-	ALIGN4(g_model.pData);
+	WriteBoneTableByName<r5::v8::mstudiobone_t>(g_model.hdrV54(), oldHeader->bonetablebynameindex ? reinterpret_cast<const unsigned char*>(input.getPtr()) : nullptr);
 
 	input.seek(oldHeader->localseqindex, rseekdir::beg);
 	ConvertAnims_140<r5::v121::mstudioanimdesc_t>((const char*)input.getPtr(), oldHeader->numlocalseq);
@@ -716,7 +711,7 @@ void ConvertRMDL140To10(char* pMDL, const std::string& pathIn, const std::string
 
 	pHdr->length = g_model.pData - g_model.pBase;
 
-	rigOut.write(g_model.pBase, pHdr->length);
+	WriteOutputFile(rrigPath, g_model.pBase, pHdr->length);
 
 	delete[] g_model.pBase;
 #endif
@@ -761,7 +756,6 @@ void ConvertRMDL150To10(char* pMDL, const std::string& pathIn, const std::string
 	}
 
 	printf("Output: %s\n", rmdlPath.c_str());
-	std::ofstream out(rmdlPath, std::ios::out | std::ios::binary);
 
 	g_model.pBase = new char[FILEBUFSIZE] {};
 	g_model.pData = g_model.pBase;
@@ -810,13 +804,9 @@ void ConvertRMDL150To10(char* pMDL, const std::string& pathIn, const std::string
 	input.seek(oldHeader->hitboxsetindex, rseekdir::beg);
 	ConvertHitboxes_121((mstudiohitboxset_t*)input.getPtr(), oldHeader->numhitboxsets);
 
+	// regenerate bonebyname table (bone ids sorted alphabetically by name)
 	input.seek(oldHeader->bonetablebynameindex, rseekdir::beg);
-	input.read(g_model.pData, g_model.hdrV54()->numbones);
-
-	g_model.hdrV54()->bonetablebynameindex = g_model.pData - g_model.pBase;
-	g_model.pData += g_model.hdrV54()->numbones;
-
-	ALIGN4(g_model.pData);
+	WriteBoneTableByName<r5::v8::mstudiobone_t>(g_model.hdrV54(), oldHeader->bonetablebynameindex ? reinterpret_cast<const unsigned char*>(input.getPtr()) : nullptr);
 
 	input.seek(oldHeader->localseqindex, rseekdir::beg);
 	ConvertAnims_140<r5::v121::mstudioanimdesc_t>((const char*)input.getPtr(), oldHeader->numlocalseq);
@@ -841,6 +831,9 @@ void ConvertRMDL150To10(char* pMDL, const std::string& pathIn, const std::string
 	if (oldHeader->materialtypesindex > 0)
 		matTypes = reinterpret_cast<MaterialShaderType_t*>(&pMDL[oldHeader->materialtypesindex]);
 
+	// find the textures no mesh can reach before they are written
+	BuildTextureRemap(reinterpret_cast<const short*>(pMDL + oldHeader->skinindex), oldHeader->numskinref, oldHeader->numskinfamilies, oldHeader->numtextures);
+
 	input.seek(oldHeader->textureindex, rseekdir::beg);
 	ConvertTextures_121((mstudiotexturedir_t*)pOldCDTextures, oldHeader->numcdtextures, (r5::v8::mstudiotexture_t*)input.getPtr(), oldHeader->numtextures, matTypes);
 
@@ -865,6 +858,9 @@ void ConvertRMDL150To10(char* pMDL, const std::string& pathIn, const std::string
 		CopyLinearBoneTableTo54(reinterpret_cast<const r5::v8::mstudiolinearbone_t* const>(input.getPtr()));
 	}
 
+	// a vg that isn't converted below would keep the old bone states
+	RemapBones_V54(CanRemapVGBones(ChangeExtension(pathIn, "vg"), false));
+
 	g_model.pData = WriteStringTable(g_model.pData);
 	ALIGN64(g_model.pData);
 
@@ -878,7 +874,7 @@ void ConvertRMDL150To10(char* pMDL, const std::string& pathIn, const std::string
 
 	pHdr->length = g_model.pData - g_model.pBase;
 
-	out.write(g_model.pBase, pHdr->length);
+	WriteOutputFile(rmdlPath, g_model.pBase, pHdr->length);
 
 	std::string vgFilePath = ChangeExtension(pathIn, "vg");
 
@@ -920,7 +916,6 @@ void ConvertRMDL150To10(char* pMDL, const std::string& pathIn, const std::string
 	printf("Creating rig from model...\n");
 
 	std::string rrigPath = (outputDir / (inputPath.stem().string() + ".rrig")).string();
-	std::ofstream rigOut(rrigPath, std::ios::out | std::ios::binary);
 
 	g_model.pBase = new char[FILEBUFSIZE] {};
 	g_model.pData = g_model.pBase;
@@ -943,13 +938,9 @@ void ConvertRMDL150To10(char* pMDL, const std::string& pathIn, const std::string
 	input.seek(oldHeader->hitboxsetindex, rseekdir::beg);
 	ConvertHitboxes_121((mstudiohitboxset_t*)input.getPtr(), oldHeader->numhitboxsets);
 
+	// regenerate bonebyname table (bone ids sorted alphabetically by name)
 	input.seek(oldHeader->bonetablebynameindex, rseekdir::beg);
-	input.read(g_model.pData, g_model.hdrV54()->numbones);
-
-	g_model.hdrV54()->bonetablebynameindex = g_model.pData - g_model.pBase;
-	g_model.pData += g_model.hdrV54()->numbones;
-
-	ALIGN4(g_model.pData);
+	WriteBoneTableByName<r5::v8::mstudiobone_t>(g_model.hdrV54(), oldHeader->bonetablebynameindex ? reinterpret_cast<const unsigned char*>(input.getPtr()) : nullptr);
 
 	input.seek(oldHeader->localseqindex, rseekdir::beg);
 	ConvertAnims_140<r5::v121::mstudioanimdesc_t>((const char*)input.getPtr(), oldHeader->numlocalseq);
@@ -974,7 +965,7 @@ void ConvertRMDL150To10(char* pMDL, const std::string& pathIn, const std::string
 
 	pHdr->length = g_model.pData - g_model.pBase;
 
-	rigOut.write(g_model.pBase, pHdr->length);
+	WriteOutputFile(rrigPath, g_model.pBase, pHdr->length);
 
 	delete[] g_model.pBase;
 
@@ -6,6 +6,7 @@
 #include <studio/versions.h>
 #include <studio/common.h>
 #include <studio/optimize.h>
+#include <studio/collision.h>
 
 /*
 	Type:    RMDL
@@ -19,6 +20,8 @@
 
 #define V10_BONE_USED_BY_BONE_MERGE 0x00040000
 
+static const char s_szModelKeyValues[] = "mdlkeyvalue{prop_data{base \"\"}}\n";
+
 static int TranslateBoneFlags_160(int flags)
 {
 	return flags & ~V10_BONE_USED_BY_BONE_MERGE;
@@ -71,22 +74,23 @@ static const uint8_t* FindBoneStateData_160(const char* rmdlData, size_t rmdlSiz
 	// from bone name tables and other data earlier in the file.
 	const size_t searchStart = 0x1000;  // Don't search in header area
 
+	byteset uniqueValues;
+
 	for (size_t off = rmdlSize - boneStateCount; off >= searchStart; off--)
 	{
 		const uint8_t* p = reinterpret_cast<const uint8_t*>(rmdlData + off);
 
 		// Check if all values are valid bone indices AND all unique
-		std::set<uint8_t> uniqueValues;
+		uniqueValues.clear();
 		bool valid = true;
 
 		for (uint16_t i = 0; i < boneStateCount; i++)
 		{
-			if (p[i] >= totalBones)
+			if (p[i] >= totalBones || !uniqueValues.insert(p[i]))
 			{
 				valid = false;
 				break;
 			}
-			uniqueValues.insert(p[i]);
 		}
 
 		// Must have ALL unique values (each hardware bone maps to different model bone)
@@ -117,17 +121,16 @@ static const uint8_t* FindBoneStateData_160(const char* rmdlData, size_t rmdlSiz
 	{
 		const uint8_t* p = reinterpret_cast<const uint8_t*>(rmdlData + off);
 
-		std::set<uint8_t> uniqueValues;
+		uniqueValues.clear();
 		bool valid = true;
 
 		for (uint16_t i = 0; i < boneStateCount; i++)
 		{
-			if (p[i] >= totalBones)
+			if (p[i] >= totalBones || !uniqueValues.insert(p[i]))
 			{
 				valid = false;
 				break;
 			}
-			uniqueValues.insert(p[i]);
 		}
 
 		if (valid && uniqueValues.size() == boneStateCount)
@@ -139,6 +142,63 @@ static const uint8_t* FindBoneStateData_160(const char* rmdlData, size_t rmdlSiz
 	return nullptr;
 }
 
+//
+// CalcVGLayout_160
+// Purpose: exact rev1 section offsets for a rev4 vg, mirrors the section order ConvertVGData_160 writes
+//
+static s_vglayout_t CalcVGLayout_160(const vg::rev4::VertexGroupHeader_t* pGroupHdr, const size_t boneStateChangeCount)
+{
+	size_t meshCount = 0;
+	size_t indexSize = 0;
+	size_t vertexSize = 0;
+	size_t extraWeightSize = 0;
+	size_t vertexCount = 0;
+	size_t stripCount = 0;
+
+	for (int lodIdx = 0; lodIdx < pGroupHdr->lodCount; lodIdx++)
+	{
+		const vg::rev4::ModelLODHeader_t* pLodHdr = pGroupHdr->pLod(lodIdx);
+		if (!pLodHdr) continue;
+
+		for (int meshIdx = 0; meshIdx < pLodHdr->meshCount; meshIdx++)
+		{
+			const vg::rev4::MeshHeader_t* pMesh = pLodHdr->pMesh(meshIdx);
+			if (!pMesh) continue;
+
+			meshCount++;
+			vertexCount += pMesh->vertCount;
+
+			if (pMesh->pIndices() && pMesh->indexCount > 0)
+				indexSize += pMesh->indexCount * sizeof(uint16_t);
+
+			if (pMesh->pVertices() && pMesh->vertBufferSize > 0)
+				vertexSize += static_cast<size_t>(CalculateVertexSize_160(ConvertMeshFlags_160(pMesh->flags))) * pMesh->vertCount;
+
+			if (pMesh->pBoneWeights() && pMesh->extraBoneWeightSize > 0)
+				extraWeightSize += pMesh->extraBoneWeightSize;
+
+			if (pMesh->flags != 0 && pMesh->vertCount > 0)
+				stripCount++;
+		}
+	}
+
+	const size_t unknownCount = meshCount / pGroupHdr->lodCount;
+
+	s_vglayout_t layout {};
+	layout.boneStateChangeOffset = sizeof(vg::rev1::VertexGroupHeader_t);
+	layout.meshOffset = layout.boneStateChangeOffset + boneStateChangeCount;
+	layout.indexOffset = AlignVGOffset(layout.meshOffset + meshCount * sizeof(vg::rev1::MeshHeader_t));
+	layout.vertOffset = AlignVGOffset(layout.indexOffset + indexSize);
+	layout.extraBoneWeightOffset = layout.vertOffset + vertexSize;
+	layout.unknownOffset = layout.extraBoneWeightOffset + extraWeightSize;
+	layout.lodOffset = layout.unknownOffset + unknownCount * sizeof(vg::rev1::UnkVgData_t);
+	layout.legacyWeightOffset = layout.lodOffset + pGroupHdr->lodCount * sizeof(vg::rev1::ModelLODHeader_t);
+	layout.stripOffset = layout.legacyWeightOffset + vertexCount * 16;
+	layout.size = layout.stripOffset + stripCount * sizeof(OptimizedModel::StripHeader_t);
+
+	return layout;
+}
+
 // Rev1 layout order (from working v10 VG analysis):
 // 1. Header (224 bytes)
 // 2. BoneStateChange data (1 byte per unique bone used) - FROM RMDL boneState table!
@@ -167,9 +227,6 @@ static void ConvertVGData_160(const char* vgInputBuf, uintmax_t vgInputSize, con
 	// Calculate total sizes needed for output
 	size_t totalMeshCount = 0;
 	size_t totalVertexCount = 0;
-	size_t totalVertexBufSize = 0;
-	size_t totalIndexBufSize = 0;
-	size_t totalExtraWeightSize = 0;
 	size_t totalStripCount = 0;
 
 	// Collect all unique bone indices used by vertices (for boneStateChange)
@@ -190,13 +247,6 @@ static void ConvertVGData_160(const char* vgInputBuf, uintmax_t vgInputSize, con
 			totalMeshCount++;
 			totalVertexCount += pMesh->vertCount;
 
-			uint64_t v10Flags = ConvertMeshFlags_160(pMesh->flags);
-			uint32_t v10VertCacheSize = CalculateVertexSize_160(v10Flags);
-			totalVertexBufSize += v10VertCacheSize * pMesh->vertCount;
-
-			totalIndexBufSize += pMesh->indexCount * sizeof(uint16_t);
-			totalExtraWeightSize += pMesh->extraBoneWeightSize;
-
 			if (pMesh->flags != 0 && pMesh->vertCount > 0)
 				totalStripCount++;
 
@@ -243,7 +293,7 @@ static void ConvertVGData_160(const char* vgInputBuf, uintmax_t vgInputSize, con
 
 			// Validate the data
 			bool validData = true;
-			std::set<uint8_t> uniqueCheck;
+			byteset uniqueCheck;
 			for (size_t i = 0; i < boneStateChangeCount && validData; i++)
 			{
 				if (pBoneStateData[i] >= pRmdlHdr->boneCount)
@@ -273,7 +323,6 @@ static void ConvertVGData_160(const char* vgInputBuf, uintmax_t vgInputSize, con
 	// v16 vertices already have local bone indices that map through boneStateChange
 
 	size_t unknownCount = (pGroupHdr->lodCount > 0) ? (totalMeshCount / pGroupHdr->lodCount) : 0;
-	size_t legacyWeightSize = totalVertexCount * 16;
 
 	// Rev1 layout order (based on working v10 VG analysis):
 	// 1. Header (224 bytes)
@@ -287,18 +336,9 @@ static void ConvertVGData_160(const char* vgInputBuf, uintmax_t vgInputSize, con
 	// 9. LegacyWeight (16 bytes per vertex)
 	// 10. Strip data (0x23 bytes each)
 
-	// Allocate output buffer
-	size_t outputBufSize = sizeof(vg::rev1::VertexGroupHeader_t)
-		+ boneStateChangeCount  // boneStateChange
-		+ (totalMeshCount * sizeof(vg::rev1::MeshHeader_t))
-		+ totalIndexBufSize + 16  // indices + alignment
-		+ totalVertexBufSize + 16 // vertices + alignment
-		+ totalExtraWeightSize
-		+ (unknownCount * sizeof(vg::rev1::UnkVgData_t))
-		+ (pGroupHdr->lodCount * sizeof(vg::rev1::ModelLODHeader_t))
-		+ legacyWeightSize  // legacyWeight
-		+ (totalStripCount * sizeof(OptimizedModel::StripHeader_t))
-		+ 4096; // Extra padding
+	// every section is sized up front, the buffer is allocated exactly once
+	const s_vglayout_t layout = CalcVGLayout_160(pGroupHdr, boneStateChangeCount);
+	const size_t outputBufSize = layout.size;
 
 	std::unique_ptr<char[]> outputBuf(new char[outputBufSize]);
 	memset(outputBuf.get(), 0, outputBufSize);
@@ -363,7 +403,8 @@ static void ConvertVGData_160(const char* vgInputBuf, uintmax_t vgInputSize, con
 	char* pVertexData = pWrite;
 	pOutHdr->vertOffset = pVertexData - outputBuf.get();
 
-	// Copy vertex data (stripping UV2 if present)
+	// meshes in write order, the vertex pass below runs one task per mesh
+	std::vector<const vg::rev4::MeshHeader_t*> vertexMeshes;
 	for (int lodIdx = 0; lodIdx < pGroupHdr->lodCount; lodIdx++)
 	{
 		const vg::rev4::ModelLODHeader_t* pLodHdr = pGroupHdr->pLod(lodIdx);
@@ -374,46 +415,65 @@ static void ConvertVGData_160(const char* vgInputBuf, uintmax_t vgInputSize, con
 			const vg::rev4::MeshHeader_t* pMesh = pLodHdr->pMesh(meshIdx);
 			if (!pMesh) continue;
 
-			const char* pSrcVerts = pMesh->pVertices();
-			if (pSrcVerts && pMesh->vertBufferSize > 0)
-			{
-				uint64_t v16Flags = pMesh->flags;
-				uint64_t v10Flags = ConvertMeshFlags_160(v16Flags);
-				uint32_t v16VertSize = pMesh->vertCacheSize;
-				uint32_t v10VertSize = CalculateVertexSize_160(v10Flags);
+			vertexMeshes.push_back(pMesh);
+		}
+	}
 
-				bool hasWeights = (v16Flags & 0x1000);  // VERT_BLENDINDICES
-				uint32_t boneOffset = hasWeights ? GetBoneOffset_160(v16Flags) : 0;
+	// lay out the vertex data first so every mesh knows where it goes
+	std::vector<char*> meshVertexData(vertexMeshes.size());
+	for (size_t i = 0; i < vertexMeshes.size(); i++)
+	{
+		const vg::rev4::MeshHeader_t* pMesh = vertexMeshes[i];
+		meshVertexData[i] = pWrite;
 
-				// If v16 has UV2 and we're stripping it, need to remove 8 bytes per vertex
-				if ((v16Flags & VERTEX_HAS_UV2_FLAG) && v16VertSize > v10VertSize)
-				{
-					// UV2 at end of vertex - copy without it
-					for (uint32_t v = 0; v < pMesh->vertCount; v++)
-					{
-						const char* pSrcVert = pSrcVerts + v * v16VertSize;
-						memcpy(pWrite, pSrcVert, v10VertSize);
-						pWrite += v10VertSize;
-					}
-				}
-				else
-				{
-					// No UV2 to strip, copy vertices as-is
-					for (uint32_t v = 0; v < pMesh->vertCount; v++)
-					{
-						const char* pSrcVert = pSrcVerts + v * v16VertSize;
-						memcpy(pWrite, pSrcVert, min(v16VertSize, v10VertSize));
-						pWrite += v10VertSize;
-					}
-				}
-			}
-		}
+		if (pMesh->pVertices() && pMesh->vertBufferSize > 0)
+			pWrite += static_cast<size_t>(CalculateVertexSize_160(ConvertMeshFlags_160(pMesh->flags))) * pMesh->vertCount;
 	}
 
+	// pruned extra bone weights, one entry per mesh in write order
+	std::vector<std::vector<vvw::mstudioboneweightextra_t>> prunedExtraWeights(g_options.pruneWeights ? vertexMeshes.size() : 0);
+	std::vector<s_weightprunestats_t> meshPruneStats(prunedExtraWeights.size());
+
+	// Copy vertex data (stripping UV2 if present)
+	ParallelForSections(vertexMeshes.size(), [&](const size_t i)
+	{
+		const vg::rev4::MeshHeader_t* pMesh = vertexMeshes[i];
+		char* const pMeshVerts = meshVertexData[i];
+
+		const char* pSrcVerts = pMesh->pVertices();
+		if (pSrcVerts && pMesh->vertBufferSize > 0)
+		{
+			uint64_t v16Flags = pMesh->flags;
+			uint64_t v10Flags = ConvertMeshFlags_160(v16Flags);
+			uint32_t v16VertSize = pMesh->vertCacheSize;
+			uint32_t v10VertSize = CalculateVertexSize_160(v10Flags);
+
+			// if v16 has UV2 it's at the end of the vertex, copying min(v16VertSize, v10VertSize) bytes strips it
+			g_kernels.RepackVertices(pMeshVerts, v10VertSize, pSrcVerts, v16VertSize, pMesh->vertCount);
+		}
+
+		if (g_options.pruneWeights)
+		{
+			const uint64_t v10Flags = ConvertMeshFlags_160(pMesh->flags);
+
+			PruneMeshWeights_VG(pMeshVerts, pMesh->vertCount, CalculateVertexSize_160(v10Flags), v10Flags,
+				reinterpret_cast<const vvw::mstudioboneweightextra_t*>(pMesh->pBoneWeights()), pMesh->extraBoneWeightSize / sizeof(vvw::mstudioboneweightextra_t),
+				prunedExtraWeights[i], meshPruneStats[i]);
+		}
+	});
+
+	s_weightprunestats_t pruneStats {};
+	for (const s_weightprunestats_t& meshStats : meshPruneStats)
+		AddWeightPruneStats(pruneStats, meshStats);
+
+	if (g_options.pruneWeights)
+		PrintWeightPruneStats(pruneStats);
+
 	// Extra bone weight data - copy as-is (bone IDs are already local indices)
 	char* pWeightData = pWrite;
 	pOutHdr->extraBoneWeightOffset = pWeightData - outputBuf.get();
 
+	size_t weightMeshIdx = 0;
 	for (int lodIdx = 0; lodIdx < pGroupHdr->lodCount; lodIdx++)
 	{
 		const vg::rev4::ModelLODHeader_t* pLodHdr = pGroupHdr->pLod(lodIdx);
@@ -424,6 +484,15 @@ static void ConvertVGData_160(const char* vgInputBuf, uintmax_t vgInputSize, con
 			const vg::rev4::MeshHeader_t* pMesh = pLodHdr->pMesh(meshIdx);
 			if (!pMesh) continue;
 
+			if (g_options.pruneWeights)
+			{
+				const std::vector<vvw::mstudioboneweightextra_t>& meshWeights = prunedExtraWeights[weightMeshIdx++];
+
+				memcpy(pWrite, meshWeights.data(), meshWeights.size() * sizeof(vvw::mstudioboneweightextra_t));
+				pWrite += meshWeights.size() * sizeof(vvw::mstudioboneweightextra_t);
+				continue;
+			}
+
 			const vvw::mstudioboneweightextra_t* pSrcWeights =
 				reinterpret_cast<const vvw::mstudioboneweightextra_t*>(pMesh->pBoneWeights());
 
@@ -517,7 +586,7 @@ static void ConvertVGData_160(const char* vgInputBuf, uintmax_t vgInputSize, con
 		vg::rev1::ModelLODHeader_t* pOutLod = reinterpret_cast<vg::rev1::ModelLODHeader_t*>(pLodStart) + lodIdx;
 		pOutLod->meshOffset = meshStartIdx;
 		pOutLod->meshCount = pLodHdr->meshCount;
-		pOutLod->switchPoint = 0.0f;
+		pOutLod->switchPoint = 0.0f; // set once every lod is written when -lodswitch is used
 
 		for (int meshIdx = 0; meshIdx < pLodHdr->meshCount; meshIdx++)
 		{
@@ -537,8 +606,11 @@ static void ConvertVGData_160(const char* vgInputBuf, uintmax_t vgInputSize, con
 			pOutMesh->vertCount = static_cast<uint32_t>(pMesh->vertCount);
 			pOutMesh->indexOffset = static_cast<int>(indexOffset / sizeof(uint16_t));
 			pOutMesh->indexCount = static_cast<int>(pMesh->indexCount);
+			// pruning may have shrunk or dropped this mesh's extra weights
+			const int extraBoneWeightSize = g_options.pruneWeights ? static_cast<int>(prunedExtraWeights[meshStartIdx].size() * sizeof(vvw::mstudioboneweightextra_t)) : static_cast<int>(pMesh->extraBoneWeightSize);
+
 			pOutMesh->extraBoneWeightOffset = static_cast<int>(weightOffset);
-			pOutMesh->extraBoneWeightSize = static_cast<int>(pMesh->extraBoneWeightSize);
+			pOutMesh->extraBoneWeightSize = extraBoneWeightSize;
 
 			// Set legacyWeight offsets for this mesh
 			pOutMesh->legacyWeightOffset = static_cast<int>(legacyWeightIdx);
@@ -555,23 +627,49 @@ static void ConvertVGData_160(const char* vgInputBuf, uintmax_t vgInputSize, con
 			// Update running offsets using v10 sizes
 			indexOffset += pMesh->indexCount * sizeof(uint16_t);
 			vertexOffset += v10VertCacheSize * pMesh->vertCount;
-			weightOffset += pMesh->extraBoneWeightSize;
+			weightOffset += extraBoneWeightSize;
 			legacyWeightIdx += pMesh->vertCount;
 
 			// Update header totals
 			pOutHdr->indexCount += pMesh->indexCount;
 			pOutHdr->vertBufferSize += v10VertCacheSize * pMesh->vertCount;
-			pOutHdr->extraBoneWeightSize += pMesh->extraBoneWeightSize;
+			pOutHdr->extraBoneWeightSize += extraBoneWeightSize;
 
 			meshStartIdx++;
 		}
 	}
 
+	// mesh headers now point into the written index and vertex data
+	if (g_options.computeLODSwitchPoints)
+		ComputeLODSwitchPoints_VG(pIndexData, pVertexData, reinterpret_cast<vg::rev1::MeshHeader_t*>(pMeshStart), static_cast<int>(totalMeshCount),
+			reinterpret_cast<vg::rev1::ModelLODHeader_t*>(pLodStart), pGroupHdr->lodCount, g_options.lodPixelError);
+
+	if (g_options.optimizeOverdraw)
+		OptimizeOverdraw_VG(pIndexData, pVertexData, reinterpret_cast<vg::rev1::MeshHeader_t*>(pMeshStart), static_cast<int>(totalMeshCount), g_options.overdrawCacheThreshold);
+
+	// the palette section was sized for the old palette, a smaller one just leaves padding behind it
+	if (g_options.minimizePalette && MinimizeBonePalette_VG(pVertexData, pWeightData, reinterpret_cast<vg::rev1::MeshHeader_t*>(pMeshStart), static_cast<int>(totalMeshCount), boneStates))
+	{
+		memset(pBoneStateChange, 0, pOutHdr->boneStateChangeCount);
+		memcpy(pBoneStateChange, boneStates.data(), boneStates.size());
+		pOutHdr->boneStateChangeCount = boneStates.size();
+	}
+
+	RemapBoneStates(reinterpret_cast<unsigned char*>(pBoneStateChange), pOutHdr->boneStateChangeCount);
+
+	// bone states are in the rmdl's final bone order from here on
+	if (g_options.tightBounds)
+	{
+		ApplyTightBounds_VG(pVertexData, reinterpret_cast<const vg::rev1::MeshHeader_t*>(pMeshStart), static_cast<int>(totalMeshCount),
+			reinterpret_cast<const vg::rev1::ModelLODHeader_t*>(pLodStart), pGroupHdr->lodCount,
+			reinterpret_cast<const unsigned char*>(pBoneStateChange), static_cast<int>(pOutHdr->boneStateChangeCount));
+	}
+
 	pOutHdr->dataSize = static_cast<int>(pWrite - outputBuf.get());
 
-	std::ofstream vgOut(vgOutPath, std::ios::out | std::ios::binary);
-	vgOut.write(outputBuf.get(), pOutHdr->dataSize);
-	vgOut.close();
+	CheckVGLayout(layout, pOutHdr);
+
+	WriteOutputFile(vgOutPath, outputBuf.get(), pOutHdr->dataSize);
 
 	printf("VG: %d LODs, %zu meshes, %zu strips, %d bytes\n",
 		pGroupHdr->lodCount, totalMeshCount, totalStripCount, pOutHdr->dataSize);
@@ -659,7 +757,7 @@ static void ConvertStudioHdr_160(r5::v8::studiohdr_t* out, const r5::v160::studi
 	out->vvdSize = 0;
 	out->vvcSize = 0;
 	out->vvwSize = 0;
-	out->phySize = 0;  // Will be set later if .phy file exists
+	out->phySize = 0;  // Set from the converted .phy before the rmdl is written
 
 	out->surfacepropLookup = static_cast<int>(hdr->surfacepropLookup);
 
@@ -779,7 +877,7 @@ static void ConvertBones_160(const r5::v160::studiohdr_t* pOldHdr, const char* p
 
 	printf("copying %lld jiggle bones...\n", proceduralBones.size());
 
-	std::map<uint8_t, uint8_t> linearprocbones;
+	bytemap linearprocbones;
 
 	for (auto bone : proceduralBones)
 	{
@@ -807,9 +905,12 @@ static void ConvertBones_160(const r5::v160::studiohdr_t* pOldHdr, const char* p
 	g_model.hdrV54()->procBoneCount = static_cast<int>(linearprocbones.size());
 	g_model.hdrV54()->procBoneTableOffset = static_cast<int>(g_model.pData - g_model.pBase);
 
-	for (auto& it : linearprocbones)
+	for (int i = 0; i < 256; i++)
 	{
-		*g_model.pData = it.first;
+		if (!linearprocbones.count(i))
+			continue;
+
+		*g_model.pData = static_cast<char>(i);
 		g_model.pData += sizeof(uint8_t);
 	}
 
@@ -817,7 +918,7 @@ static void ConvertBones_160(const r5::v160::studiohdr_t* pOldHdr, const char* p
 
 	for (int i = 0; i < numBones; i++)
 	{
-		*g_model.pData = linearprocbones.count(i) ? linearprocbones.find(i)->second : 0xff;
+		*g_model.pData = linearprocbones.count(i) ? linearprocbones.at(i) : 0xff;
 		g_model.pData += sizeof(uint8_t);
 	}
 
@@ -833,6 +934,8 @@ static void ConvertHitboxes_160(const r5::v160::studiohdr_t* pOldHdr, const char
 	const r5::v160::mstudiohitboxset_t* pOldHitboxSets = reinterpret_cast<const r5::v160::mstudiohitboxset_t*>(
 		(const char*)pOldHdr + FIX_OFFSET(pOldHdr->hitboxsetindex));
 
+	s_hitboxfitstats_t fitStats{};
+
 	mstudiohitboxset_t* hboxsetStart = reinterpret_cast<mstudiohitboxset_t*>(g_model.pData);
 
 	// Write hitbox set headers
@@ -856,15 +959,30 @@ static void ConvertHitboxes_160(const r5::v160::studiohdr_t* pOldHdr, const char
 
 		newhboxset->hitboxindex = static_cast<int>(g_model.pData - (char*)newhboxset);
 
+		std::vector<s_hitboxfit_t> fits(oldhboxset->numhitboxes);
 		for (int j = 0; j < oldhboxset->numhitboxes; ++j)
 		{
+			const r5::v160::mstudiobbox_t* oldHitbox = oldhboxset->pHitbox(j);
+			fits[j] = { oldHitbox->bone, oldHitbox->group, oldHitbox->bbmin, oldHitbox->bbmax, true };
+		}
+
+		// no vertex data is decoded before the vg is converted, so these can only be compacted
+		FitHitboxSet(fits, nullptr, fitStats);
+		newhboxset->numhitboxes = 0;
+
+		for (int j = 0; j < oldhboxset->numhitboxes; ++j)
+		{
+			if (!fits[j].keep)
+				continue;
+
 			const r5::v160::mstudiobbox_t* oldHitbox = oldhboxset->pHitbox(j);
 			r5::v8::mstudiobbox_t* newHitbox = reinterpret_cast<r5::v8::mstudiobbox_t*>(g_model.pData);
 
 			newHitbox->bone = oldHitbox->bone;
 			newHitbox->group = oldHitbox->group;
-			newHitbox->bbmin = oldHitbox->bbmin;
-			newHitbox->bbmax = oldHitbox->bbmax;
+			newHitbox->bbmin = fits[j].bbmin;
+			newHitbox->bbmax = fits[j].bbmax;
+			newhboxset->numhitboxes++;
 
 			AddToStringTable((char*)newHitbox, &newHitbox->szhitboxnameindex, oldHitbox->pszHitboxName());
 
@@ -876,6 +994,8 @@ static void ConvertHitboxes_160(const r5::v160::studiohdr_t* pOldHdr, const char
 		}
 	}
 
+	PrintHitboxFitStats(fitStats);
+
 	ALIGN4(g_model.pData);
 }
 
@@ -907,6 +1027,20 @@ static int ConvertAttachments_160(const r5::v160::studiohdr_t* pOldHdr, const ch
 	return index;
 }
 
+//
+// GetBodyPartDataSize_160
+// Purpose: bytes ConvertBodyParts_160 writes after the headers for one bodypart
+//
+static size_t GetBodyPartDataSize_160(const r5::v160::mstudiobodyparts_t* oldbodypart)
+{
+	size_t size = oldbodypart->nummodels * sizeof(r5::v8::mstudiomodel_t);
+
+	for (int j = 0; j < oldbodypart->nummodels; ++j)
+		size += oldbodypart->pModel(j)->meshCountTotal * sizeof(r5::v8::mstudiomesh_t);
+
+	return size;
+}
+
 //
 // ConvertBodyParts_160
 static void ConvertBodyParts_160(const r5::v160::studiohdr_t* pOldHdr, const char* pOldData, int numBodyParts)
@@ -932,13 +1066,15 @@ static void ConvertBodyParts_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 		g_model.pData += sizeof(mstudiobodyparts_t);
 	}
 
-	// Write models and meshes for each bodypart
-	for (int i = 0; i < numBodyParts; ++i)
+	// Write models and meshes for each bodypart, each as its own task
+	WriteSections("bodyparts", reinterpret_cast<char*>(bodypartStart), numBodyParts, 1,
+		[&](const size_t i) { return GetBodyPartDataSize_160(pOldHdr->pBodypart(static_cast<int>(i))); },
+		[&](const size_t i)
 	{
-		const r5::v160::mstudiobodyparts_t* oldbodypart = pOldHdr->pBodypart(i);
+		const r5::v160::mstudiobodyparts_t* oldbodypart = pOldHdr->pBodypart(static_cast<int>(i));
 		mstudiobodyparts_t* newbodypart = bodypartStart + i;
 
-		newbodypart->modelindex = static_cast<int>(g_model.pData - (char*)newbodypart);
+		SetSectionOffset(&newbodypart->modelindex, (char*)newbodypart, g_model.pData);
 
 		r5::v8::mstudiomodel_t* newModels = reinterpret_cast<r5::v8::mstudiomodel_t*>(g_model.pData);
 
@@ -1004,7 +1140,7 @@ static void ConvertBodyParts_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 
 			g_model.pData += oldModel->meshCountTotal * sizeof(r5::v8::mstudiomesh_t);
 		}
-	}
+	});
 
 	ALIGN4(g_model.pData);
 }
@@ -1023,8 +1159,12 @@ static void ConvertTextures_160(const r5::v160::studiohdr_t* pOldHdr, const char
 	const uint64_t* pOldTextureGuids = reinterpret_cast<const uint64_t*>(
 		(const char*)pOldHdr + textureDataOffset);
 
+	int numNewTextures = 0;
 	for (int i = 0; i < numTextures; ++i)
 	{
+		if (IsTextureCulled(i))
+			continue;
+
 		uint64_t materialGuid = pOldTextureGuids[i];
 		r5::v8::mstudiotexture_t* newTexture = reinterpret_cast<r5::v8::mstudiotexture_t*>(g_model.pData);
 
@@ -1040,14 +1180,17 @@ static void ConvertTextures_160(const r5::v160::studiohdr_t* pOldHdr, const char
 		printf("  texture %d: GUID=0x%016llX\n", i, materialGuid);
 
 		g_model.pData += sizeof(r5::v8::mstudiotexture_t);
+		numNewTextures++;
 	}
 
+	g_model.hdrV54()->numtextures = numNewTextures;
+
 	// Material shader types - use RGDP for static props
 	ALIGN4(g_model.pData);
 
 	g_model.hdrV54()->materialtypesindex = static_cast<int>(g_model.pData - g_model.pBase);
-	memset(g_model.pData, RGDP, numTextures);
-	g_model.pData += numTextures;
+	memset(g_model.pData, RGDP, numNewTextures);
+	g_model.pData += numNewTextures;
 
 	ALIGN4(g_model.pData);
 
@@ -1070,17 +1213,19 @@ static void ConvertSkins_160(const r5::v160::studiohdr_t* pOldHdr, const char* p
 	const char* pOldSkinData = (const char*)pOldHdr + FIX_OFFSET(pOldHdr->skinindex);
 
 	const int skinIndexDataSize = sizeof(short) * numSkinRef * numSkinFamilies;
-	memcpy(g_model.pData, pOldSkinData, skinIndexDataSize);
-	g_model.pData += skinIndexDataSize;
+
+	std::vector<int> families;
+	g_model.hdrV54()->numskinref = WriteSkinTable(reinterpret_cast<const short*>(pOldSkinData), numSkinRef, numSkinFamilies, GetUsedSkinRefCount(g_model.hdrV54()), families);
+	g_model.hdrV54()->numskinfamilies = static_cast<int>(families.size());
 
 	ALIGN4(g_model.pData);
 
 	// V16 stores skin name offsets as uint16_t immediately after skin data (no alignment)
 	const uint16_t* pOldSkinNameOffsets = reinterpret_cast<const uint16_t*>(pOldSkinData + skinIndexDataSize);
 
-	for (int i = 0; i < numSkinFamilies - 1; ++i)
+	for (size_t i = 1; i < families.size(); ++i)
 	{
-		const uint16_t nameOffset = pOldSkinNameOffsets[i];
+		const uint16_t nameOffset = pOldSkinNameOffsets[families[i] - 1];
 		const char* skinName = (const char*)pOldHdr + FIX_OFFSET(nameOffset);
 
 		if (nameOffset > 0 && skinName[0] != '\0' && strlen(skinName) < 256)
@@ -1090,7 +1235,7 @@ static void ConvertSkins_160(const r5::v160::studiohdr_t* pOldHdr, const char* p
 		else
 		{
 			char skinNameBuf[32];
-			sprintf_s(skinNameBuf, 32, "skin%d", i + 1);
+			sprintf_s(skinNameBuf, 32, "skin%d", families[i]);
 			AddToStringTable(g_model.pBase, (int*)g_model.pData, skinNameBuf);
 		}
 		g_model.pData += sizeof(int);
@@ -1186,6 +1331,86 @@ static int ConvertPoseParams_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 	return index;
 }
 
+//
+// GetSequenceDataSize_160
+// Purpose: most bytes ConvertSequences_160 writes after the descriptors for one sequence, alignment padding included
+//
+static size_t GetSequenceDataSize_160(const r5::v160::mstudioseqdesc_t* oldSeq, const int numBones)
+{
+	int numAnims = oldSeq->groupsize[0] * oldSeq->groupsize[1];
+	if (numAnims <= 0)
+		numAnims = 1;
+
+	const size_t flagSize = static_cast<size_t>(((4 * numBones + 7) / 8 + 1) & 0xFFFFFFFE);
+
+	size_t size = 3 + numAnims * sizeof(int);
+
+	const uint16_t* v16AnimIndices = oldSeq->animindexindex > 0 ? reinterpret_cast<const uint16_t*>((char*)oldSeq + FIX_OFFSET(oldSeq->animindexindex)) : nullptr;
+
+	for (int animIdx = 0; animIdx < numAnims; animIdx++)
+	{
+		size += 3 + sizeof(r5::v8::mstudioanimdesc_t) + 3 + flagSize + 1;
+
+		if (!v16AnimIndices || v16AnimIndices[animIdx] <= 0)
+			continue;
+
+		const r5::v160::mstudioanimdesc_t* oldAnimDesc = reinterpret_cast<const r5::v160::mstudioanimdesc_t*>((char*)oldSeq + FIX_OFFSET(v16AnimIndices[animIdx]));
+
+		if (oldAnimDesc->numikrules > 0 && oldAnimDesc->ikruleindex > 0)
+			size += 3 + oldAnimDesc->numikrules * sizeof(r5::v8::mstudioikrule_t);
+
+		// the rle data copied after the bone flags, walked the same way the writer does
+		if (oldAnimDesc->animindex > 0)
+		{
+			const char* pV16AnimData = (char*)oldAnimDesc + oldAnimDesc->animindex;
+			const uint8_t* boneFlagArray = reinterpret_cast<const uint8_t*>(pV16AnimData);
+			const char* pRead = pV16AnimData + flagSize;
+
+			for (int bone = 0; bone < numBones; bone++)
+			{
+				if (!(((boneFlagArray[bone / 2] >> (4 * (bone % 2))) & 0xF) & 0x7))
+					continue;
+
+				const int boneSize = reinterpret_cast<const r5::mstudio_rle_anim_t*>(pRead)->size;
+				if (boneSize > 0 && boneSize < 4096)
+				{
+					pRead += boneSize;
+					size += boneSize;
+				}
+			}
+		}
+
+		if (oldAnimDesc->sectionindex > 0)
+		{
+			int numSections = 1;
+			if (oldAnimDesc->sectionframes > 0)
+				numSections = ((oldAnimDesc->numframes - oldAnimDesc->sectionstallframes - 1) / oldAnimDesc->sectionframes) + 2;
+
+			size += 1 + max(numSections, 0) * sizeof(r5::v8::mstudioanimsections_t);
+		}
+	}
+
+	if (oldSeq->numautolayers > 0 && oldSeq->autolayerindex > 0)
+		size += 3 + oldSeq->numautolayers * sizeof(r5::v8::mstudioautolayer_t);
+
+	if (oldSeq->numevents > 0 && oldSeq->eventindex > 0)
+		size += 3 + oldSeq->numevents * sizeof(r5::v8::mstudioevent_t);
+
+	if (oldSeq->weightlistindex > 0)
+		size += 3 + max(numBones, 0) * sizeof(float);
+
+	if (oldSeq->posekeyindex > 0)
+		size += 3 + max(oldSeq->groupsize[0] + oldSeq->groupsize[1], 0) * sizeof(float);
+
+	if (oldSeq->numiklocks > 0 && oldSeq->iklockindex > 0)
+		size += 3 + oldSeq->numiklocks * sizeof(r1::mstudioiklock_t);
+
+	if (oldSeq->numactivitymodifiers > 0 && oldSeq->activitymodifierindex > 0)
+		size += 3 + oldSeq->numactivitymodifiers * (sizeof(r1::mstudioactivitymodifier_t) + 3);
+
+	return size;
+}
+
 static void ConvertSequences_160(const r5::v160::studiohdr_t* pOldHdr, const char* pOldData, int numSeqs, int subversion)
 {
 	g_model.hdrV54()->localseqindex = static_cast<int>(g_model.pData - g_model.pBase);
@@ -1306,8 +1531,12 @@ static void ConvertSequences_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 
 	g_model.pData += numSeqs * sizeof(r5::v8::mstudioseqdesc_t);
 
-	// Write animation data for each sequence
-	for (int i = 0; i < numSeqs; i++)
+	const int numBones = g_model.hdrV54()->numbones;
+
+	// Write animation data for each sequence, each as its own task
+	WriteSections("sequences", reinterpret_cast<char*>(newSeqBase), numSeqs, 4,
+		[&](const size_t i) { return GetSequenceDataSize_160(reinterpret_cast<const r5::v160::mstudioseqdesc_t*>(pOldSeqBase + (i * seqStride)), numBones); },
+		[&](const size_t i)
 	{
 		// Use manual pointer arithmetic with correct stride for the subversion
 		const r5::v160::mstudioseqdesc_t* oldSeq =
@@ -1321,7 +1550,7 @@ static void ConvertSequences_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 
 		// Write animation index array (offsets to animation descriptors)
 		ALIGN4(g_model.pData);
-		newSeq->animindexindex = static_cast<int>(g_model.pData - (char*)newSeq);
+		SetSectionOffset(&newSeq->animindexindex, (char*)newSeq, g_model.pData);
 		int* newAnimIndices = reinterpret_cast<int*>(g_model.pData);
 		g_model.pData += numAnims * sizeof(int);
 
@@ -1337,7 +1566,7 @@ static void ConvertSequences_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 		{
 			ALIGN4(g_model.pData);
 			r5::v8::mstudioanimdesc_t* newAnim = reinterpret_cast<r5::v8::mstudioanimdesc_t*>(g_model.pData);
-			newAnimIndices[animIdx] = static_cast<int>((char*)newAnim - (char*)newSeq);
+			SetSectionOffset(&newAnimIndices[animIdx], (char*)newSeq, (char*)newAnim);
 			memset(newAnim, 0, sizeof(r5::v8::mstudioanimdesc_t));
 			g_model.pData += sizeof(r5::v8::mstudioanimdesc_t);
 
@@ -1442,7 +1671,6 @@ static void ConvertSequences_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 					newAnim->animindex = static_cast<int>(g_model.pData - (char*)newAnim);
 
 					const char* pV16AnimData = (char*)oldAnimDesc + oldAnimDesc->animindex;
-					int numBones = g_model.hdrV54()->numbones;
 
 					// Calculate bone flags array size: 4 bits per bone, aligned to 2 bytes
 					// Formula: ((4 * numBones + 7) / 8 + 1) & ~1
@@ -1478,14 +1706,14 @@ static void ConvertSequences_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 							}
 							else
 							{
-								printf("    WARNING: Invalid RLE size %d for bone %d (flags 0x%X)\n",
+								SectionLog("    WARNING: Invalid RLE size %d for bone %d (flags 0x%X)\n",
 									boneSize, bone, boneFlags);
 							}
 						}
 						// Note: bones without flags have NO RLE data - don't write anything
 					}
 
-					printf("    Copied %d bytes bone flags + %zd bytes RLE animation data for %d bones\n",
+					SectionLog("    Copied %d bytes bone flags + %zd bytes RLE animation data for %d bones\n",
 						flagSize, g_model.pData - pWriteStart, numBones);
 				}
 				else
@@ -1495,7 +1723,6 @@ static void ConvertSequences_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 					newAnim->animindex = static_cast<int>(g_model.pData - (char*)newAnim);
 
 					// Write minimal bone flags array for STUDIO_ALLZEROS
-					int numBones = g_model.hdrV54()->numbones;
 					if (numBones > 0)
 					{
 						int flagSize = ((4 * numBones + 7) / 8 + 1) & 0xFFFFFFFE;
@@ -1545,7 +1772,6 @@ static void ConvertSequences_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 				ALIGN4(g_model.pData);
 				newAnim->animindex = static_cast<int>(g_model.pData - (char*)newAnim);
 
-				int numBones = g_model.hdrV54()->numbones;
 				if (numBones > 0)
 				{
 					int flagSize = ((4 * numBones + 7) / 8 + 1) & 0xFFFFFFFE;
@@ -1561,7 +1787,7 @@ static void ConvertSequences_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 		if (oldSeq->numautolayers > 0 && oldSeq->autolayerindex > 0)
 		{
 			ALIGN4(g_model.pData);
-			newSeq->autolayerindex = static_cast<int>(g_model.pData - (char*)newSeq);
+			SetSectionOffset(&newSeq->autolayerindex, (char*)newSeq, g_model.pData);
 
 			// v16 autolayer has 8-byte assetSequence prefix, v8 doesn't
 			// v16: assetSequence(8) + iSequence(2) + iPose(2) + flags(4) + start(4) + peak(4) + tail(4) + end(4) = 32 bytes
@@ -1596,12 +1822,12 @@ static void ConvertSequences_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 		if (oldSeq->numevents > 0 && oldSeq->eventindex > 0)
 		{
 			ALIGN4(g_model.pData);
-			newSeq->eventindex = static_cast<int>(g_model.pData - (char*)newSeq);
+			SetSectionOffset(&newSeq->eventindex, (char*)newSeq, g_model.pData);
 			newSeq->numevents = oldSeq->numevents;
 
 			const char* pOldEvents = reinterpret_cast<const char*>(oldSeq) + FIX_OFFSET(oldSeq->eventindex);
 
-			printf("    Converting %d events from v16 to v10...\n", oldSeq->numevents);
+			SectionLog("    Converting %d events from v16 to v10...\n", oldSeq->numevents);
 
 			for (int e = 0; e < oldSeq->numevents; e++)
 			{
@@ -1639,11 +1865,11 @@ static void ConvertSequences_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 		if (oldSeq->weightlistindex > 0)
 		{
 			ALIGN4(g_model.pData);
-			const size_t copyCount = g_model.hdrV54()->numbones * sizeof(float);
+			const size_t copyCount = numBones * sizeof(float);
 			const char* pOldWeightlist = reinterpret_cast<const char*>(oldSeq) + FIX_OFFSET(oldSeq->weightlistindex);
 
 			memcpy(g_model.pData, pOldWeightlist, copyCount);
-			newSeq->weightlistindex = static_cast<int>(g_model.pData - reinterpret_cast<const char*>(newSeq));
+			SetSectionOffset(&newSeq->weightlistindex, (char*)newSeq, g_model.pData);
 			g_model.pData += copyCount;
 		}
 
@@ -1659,7 +1885,7 @@ static void ConvertSequences_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 			const char* pOldPosekey = reinterpret_cast<const char*>(oldSeq) + FIX_OFFSET(oldSeq->posekeyindex);
 
 			memcpy(g_model.pData, pOldPosekey, copyCount);
-			newSeq->posekeyindex = static_cast<int>(g_model.pData - reinterpret_cast<const char*>(newSeq));
+			SetSectionOffset(&newSeq->posekeyindex, (char*)newSeq, g_model.pData);
 			g_model.pData += copyCount;
 		}
 
@@ -1669,7 +1895,7 @@ static void ConvertSequences_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 		if (oldSeq->numiklocks > 0 && oldSeq->iklockindex > 0)
 		{
 			ALIGN4(g_model.pData);
-			newSeq->iklockindex = static_cast<int>(g_model.pData - reinterpret_cast<const char*>(newSeq));
+			SetSectionOffset(&newSeq->iklockindex, (char*)newSeq, g_model.pData);
 
 			const char* pOldIkLocks = reinterpret_cast<const char*>(oldSeq) + FIX_OFFSET(oldSeq->iklockindex);
 
@@ -1697,7 +1923,7 @@ static void ConvertSequences_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 		if (oldSeq->numactivitymodifiers > 0 && oldSeq->activitymodifierindex > 0)
 		{
 			ALIGN4(g_model.pData);
-			newSeq->activitymodifierindex = static_cast<int>(g_model.pData - reinterpret_cast<const char*>(newSeq));
+			SetSectionOffset(&newSeq->activitymodifierindex, (char*)newSeq, g_model.pData);
 
 			const char* pOldActMods = reinterpret_cast<const char*>(oldSeq) + FIX_OFFSET(oldSeq->activitymodifierindex);
 
@@ -1719,7 +1945,7 @@ static void ConvertSequences_160(const r5::v160::studiohdr_t* pOldHdr, const cha
 				ALIGN4(g_model.pData);
 			}
 		}
-	}
+	});
 
 	ALIGN4(g_model.pData);
 }
@@ -1974,6 +2200,10 @@ static void ConvertCollisionData_V160(const r5::v160::studiohdr_t* const oldStud
 		}
 	}
 
+	// the layout is decided here, the data itself is copied in parallel afterwards
+	std::vector<s_sectioncopy_t> copies;
+	copies.reserve(headerCount * 3);
+
 	// Convert each collision header and copy its data
 	for (int i = 0; i < headerCount; ++i)
 	{
@@ -1990,7 +2220,7 @@ static void ConvertCollisionData_V160(const r5::v160::studiohdr_t* const oldStud
 
 		ALIGN64(g_model.pData);
 		newHeader->vertIndex = static_cast<int>(g_model.pData - reinterpret_cast<char*>(pNewCollModel));
-		memcpy_s(g_model.pData, vertSize, vertData, vertSize);
+		copies.push_back({ g_model.pData, reinterpret_cast<const char*>(vertData), static_cast<size_t>(vertSize) });
 		g_model.pData += vertSize;
 
 		// Copy leaf data
@@ -2004,7 +2234,7 @@ static void ConvertCollisionData_V160(const r5::v160::studiohdr_t* const oldStud
 
 		ALIGN64(g_model.pData);
 		newHeader->bvhLeafIndex = static_cast<int>(g_model.pData - reinterpret_cast<char*>(pNewCollModel));
-		memcpy_s(g_model.pData, leafSize, leafData, leafSize);
+		copies.push_back({ g_model.pData, reinterpret_cast<const char*>(leafData), static_cast<size_t>(leafSize) });
 		g_model.pData += leafSize;
 	}
 
@@ -2040,15 +2270,353 @@ static void ConvertCollisionData_V160(const r5::v160::studiohdr_t* const oldStud
 		const void* nodeData = reinterpret_cast<const char*>(pOldCollModel) + oldHeader->bvhNodeIndex;
 		ALIGN64(g_model.pData);
 		newHeader->bvhNodeIndex = static_cast<int>(g_model.pData - reinterpret_cast<char*>(pNewCollModel));
-		memcpy_s(g_model.pData, nodeSize, nodeData, nodeSize);
+		copies.push_back({ g_model.pData, reinterpret_cast<const char*>(nodeData), static_cast<size_t>(nodeSize) });
 		g_model.pData += nodeSize;
 	}
 
+	CopySections(copies);
+
 	size_t totalCollSize = g_model.pData - reinterpret_cast<char*>(pNewCollModel);
 	printf("  Collision converted: V16 -> V10, %zu bytes written at offset 0x%X\n",
 		totalCollSize, g_model.hdrV54()->bvhOffset);
 }
 
+//
+// ConvertPHY_160
+// Purpose: write the v10 phy for the model's phy file, returns its size for the rmdl header or 0 without a phy file
+//
+static size_t ConvertPHY_160(const std::string& phyFilePath, const std::string& phyOutPath, const r5::v160::studiohdr_t* oldHeader)
+{
+	if (!FILE_EXISTS(phyFilePath))
+		return 0;
+
+	printf("Found PHY file, converting to v10 format...\n");
+
+	uintmax_t phyInputSize = GetFileSize(phyFilePath);
+	char* phyInputBuf = new char[phyInputSize];
+
+	std::ifstream phyIfs(phyFilePath, std::ios::in | std::ios::binary);
+	phyIfs.read(phyInputBuf, phyInputSize);
+	phyIfs.close();
+
+	// v16/v17 PHY header is 4 bytes: [solidCount: uint16][keyValuesOffset: uint16].
+	// v10 IVPS header is 20 bytes: size, id, solidCount, checkSum, keyValuesOffset (all int32).
+	// Data after the header is identical, just shifted by 16 bytes.
+	uint16_t v16SolidCount = *reinterpret_cast<uint16_t*>(phyInputBuf);
+	uint16_t v16KeyValuesOffset = *reinterpret_cast<uint16_t*>(phyInputBuf + 2);
+
+	printf("  V16 PHY: solidCount=%d, keyValuesOffset=%d\n", v16SolidCount, v16KeyValuesOffset);
+
+	struct IVPSHeader {
+		int32_t size;
+		int32_t id;
+		int32_t solidCount;
+		int32_t checkSum;
+		int32_t keyValuesOffset;
+	};
+
+	IVPSHeader v10Header;
+	v10Header.size = 20;
+	v10Header.id = 1;
+	v10Header.solidCount = v16SolidCount;
+	v10Header.checkSum = oldHeader->checksum;
+	v10Header.keyValuesOffset = v16KeyValuesOffset + 16;
+
+	printf("  V10 PHY: size=%d, id=%d, solidCount=%d, checkSum=0x%08X, keyValuesOffset=%d\n",
+		v10Header.size, v10Header.id, v10Header.solidCount, v10Header.checkSum, v10Header.keyValuesOffset);
+
+	// Calculate output size: 20-byte header + (v16 data - 4-byte v16 header)
+	size_t v10PhySize = sizeof(IVPSHeader) + (phyInputSize - 4);
+
+	// v10 IVPS header, then the v16 data without its 4-byte header
+	std::vector<char> simplifiedPhy;
+	if (g_options.simplifyPhy)
+	{
+		std::vector<char> v10Phy(v10PhySize);
+		memcpy(v10Phy.data(), &v10Header, sizeof(IVPSHeader));
+		memcpy(v10Phy.data() + sizeof(IVPSHeader), phyInputBuf + 4, phyInputSize - 4);
+
+		if (SimplifyPhyHulls(v10Phy.data(), v10Phy.size(), simplifiedPhy))
+			v10PhySize = simplifiedPhy.size();
+		else
+			simplifiedPhy.clear();
+	}
+
+	if (!simplifiedPhy.empty())
+		WriteOutputFile(phyOutPath, simplifiedPhy.data(), simplifiedPhy.size());
+	else
+		WriteOutputFile(phyOutPath, { { reinterpret_cast<char*>(&v10Header), sizeof(IVPSHeader) }, { phyInputBuf + 4, phyInputSize - 4 } });
+
+	delete[] phyInputBuf;
+
+	printf("  PHY converted successfully (v16: %llu bytes -> v10: %zu bytes)\n", phyInputSize, v10PhySize);
+
+	return v10PhySize;
+}
+
+//
+// GetCollisionDataSize_V160
+// Purpose: bytes ConvertCollisionData_V160 writes, alignment padding included
+//
+static size_t GetCollisionDataSize_V160(const r5::v160::studiohdr_t* const oldStudioHdr, const char* const pOldBVHData, const size_t fileSize)
+{
+	const r5::v8::mstudiocollmodel_t* const pOldCollModel = reinterpret_cast<const r5::v8::mstudiocollmodel_t*>(pOldBVHData);
+	const r5::v120::mstudiocollheader_t* const pOldCollHeaders = reinterpret_cast<const r5::v120::mstudiocollheader_t*>(pOldBVHData + sizeof(r5::v8::mstudiocollmodel_t));
+	const int headerCount = pOldCollModel->headerCount;
+
+	// surface props, content masks and surface names are copied as one run
+	__int64 size = sizeof(r5::v8::mstudiocollmodel_t) + headerCount * sizeof(r5::v8::mstudiocollheader_t);
+	size += pOldCollHeaders[0].surfacePropDataIndex - pOldCollModel->surfacePropsIndex;
+
+	for (int i = 0; i < headerCount; ++i)
+	{
+		const r5::v120::mstudiocollheader_t* const oldHeader = &pOldCollHeaders[i];
+		const __int64 leafEnd = i != headerCount - 1 ? pOldCollHeaders[i + 1].vertIndex : pOldCollHeaders[0].bvhNodeIndex;
+
+		size += 63 + (oldHeader->bvhLeafIndex - oldHeader->vertIndex);
+		size += 63 + (leafEnd - oldHeader->bvhLeafIndex);
+	}
+
+	for (int i = 0; i < headerCount; ++i)
+	{
+		const r5::v120::mstudiocollheader_t* const oldHeader = &pOldCollHeaders[i];
+
+		__int64 nodeSize;
+		if (i != headerCount - 1)
+		{
+			nodeSize = pOldCollHeaders[i + 1].bvhNodeIndex - oldHeader->bvhNodeIndex;
+		}
+		else
+		{
+			const size_t collisionOffset = pOldBVHData - reinterpret_cast<const char*>(oldStudioHdr);
+			nodeSize = fileSize - collisionOffset - oldHeader->bvhNodeIndex;
+
+			if (nodeSize > 1024 * 1024)
+				nodeSize = 1024 * 1024;
+		}
+
+		size += 63 + nodeSize;
+	}
+
+	return static_cast<size_t>(size);
+}
+
+//
+// CalcModelSize_160
+// Purpose: most bytes ConvertRMDL160To10 writes into the model image, summed from the v16 headers before anything is written
+//
+static size_t CalcModelSize_160(const r5::v160::studiohdr_t* const pOldHdr, const size_t fileSize, const std::string& modelName, const int subversion)
+{
+	s_modelsize_t size;
+
+	const int numBones = pOldHdr->boneCount;
+
+	size.Add(sizeof(r5::v8::studiohdr_t));
+	size.AddString(modelName.c_str());
+	size.AddString((const char*)pOldHdr + FIX_OFFSET(pOldHdr->surfacepropindex));
+	size.AddString("");
+
+	// bones, then at most every bone as a jiggle bone with the two proc bone tables
+	size.Add(numBones * sizeof(r5::v8::mstudiobone_t), 4);
+	size.Add(numBones * sizeof(r5::v8::mstudiojigglebone_t), 4);
+	size.Add(256 + numBones, 4);
+
+	for (int i = 0; i < numBones; ++i)
+	{
+		const r5::v160::mstudiobonehdr_t* const oldBoneHdr = r5::v160::GetBoneHdr(pOldHdr, i);
+
+		size.AddString(oldBoneHdr->pszName());
+		size.AddString((char*)oldBoneHdr + FIX_OFFSET(oldBoneHdr->surfacepropidx));
+	}
+
+	// attachments
+	const r5::v160::mstudioattachment_t* const pOldAttachments = reinterpret_cast<const r5::v160::mstudioattachment_t*>((const char*)pOldHdr + FIX_OFFSET(pOldHdr->localattachmentindex));
+
+	size.Add(pOldHdr->numlocalattachments * sizeof(r5::v8::mstudioattachment_t), 4);
+
+	for (int i = 0; i < pOldHdr->numlocalattachments; ++i)
+		size.AddString(pOldAttachments[i].pszName());
+
+	// hitbox sets and hitboxes, before any are merged away
+	const r5::v160::mstudiohitboxset_t* const pOldHitboxSets = reinterpret_cast<const r5::v160::mstudiohitboxset_t*>((const char*)pOldHdr + FIX_OFFSET(pOldHdr->hitboxsetindex));
+
+	size.Add(pOldHdr->numhitboxsets * sizeof(mstudiohitboxset_t), 4);
+
+	for (int i = 0; i < pOldHdr->numhitboxsets; ++i)
+	{
+		const r5::v160::mstudiohitboxset_t* const oldhboxset = &pOldHitboxSets[i];
+
+		size.Add(oldhboxset->numhitboxes * sizeof(r5::v8::mstudiobbox_t));
+		size.AddString(oldhboxset->pszName());
+
+		for (int j = 0; j < oldhboxset->numhitboxes; ++j)
+		{
+			const r5::v160::mstudiobbox_t* const oldHitbox = oldhboxset->pHitbox(j);
+
+			size.AddString(oldHitbox->pszHitboxName());
+			size.AddString((char*)oldHitbox + FIX_OFFSET(oldHitbox->hitdataGroupOffset));
+		}
+	}
+
+	// bone name table
+	size.Add(numBones, 4);
+
+	// sequences, their data goes through WriteSections with a start alignment of 4. v18 and up have longer descriptors
+	const size_t seqStride = (subversion >= 18) ? sizeof(r5::v180::mstudioseqdesc_t) : sizeof(r5::v160::mstudioseqdesc_t);
+	const char* const pOldSeqBase = (const char*)pOldHdr + FIX_OFFSET(pOldHdr->localseqindex);
+
+	size.Add(pOldHdr->numlocalseq * sizeof(r5::v8::mstudioseqdesc_t), 4);
+
+	for (int i = 0; i < pOldHdr->numlocalseq; i++)
+	{
+		const r5::v160::mstudioseqdesc_t* const oldSeq = reinterpret_cast<const r5::v160::mstudioseqdesc_t*>(pOldSeqBase + (i * seqStride));
+
+		size.Add(GetSequenceDataSize_160(oldSeq, numBones), 4);
+		size.AddString(oldSeq->pszLabel());
+
+		if (oldSeq->szactivitynameindex > 0)
+			size.AddString(oldSeq->pszActivity());
+
+		const int numAnims = max(oldSeq->groupsize[0] * oldSeq->groupsize[1], 1);
+		const uint16_t* const v16AnimIndices = oldSeq->animindexindex > 0 ? reinterpret_cast<const uint16_t*>((char*)oldSeq + FIX_OFFSET(oldSeq->animindexindex)) : nullptr;
+
+		for (int animIdx = 0; animIdx < numAnims; animIdx++)
+		{
+			if (!v16AnimIndices || v16AnimIndices[animIdx] <= 0)
+			{
+				size.AddString(oldSeq->pszLabel());
+				continue;
+			}
+
+			const r5::v160::mstudioanimdesc_t* const oldAnimDesc = reinterpret_cast<const r5::v160::mstudioanimdesc_t*>((char*)oldSeq + FIX_OFFSET(v16AnimIndices[animIdx]));
+			size.AddString(oldAnimDesc->sznameindex > 0 ? oldAnimDesc->pszName() : oldSeq->pszLabel());
+
+			if (oldAnimDesc->numikrules <= 0 || oldAnimDesc->ikruleindex <= 0)
+				continue;
+
+			const r5::v160::mstudioikrule_t* const oldIKRules = reinterpret_cast<const r5::v160::mstudioikrule_t*>((char*)oldAnimDesc + FIX_OFFSET(oldAnimDesc->ikruleindex));
+
+			for (int ikIdx = 0; ikIdx < oldAnimDesc->numikrules; ikIdx++)
+			{
+				if (oldIKRules[ikIdx].szattachmentindex > 0)
+					size.AddString((char*)&oldIKRules[ikIdx] + FIX_OFFSET(oldIKRules[ikIdx].szattachmentindex));
+			}
+		}
+
+		if (oldSeq->numevents > 0 && oldSeq->eventindex > 0)
+		{
+			const r5::v160::mstudioevent_t* const pOldEvents = reinterpret_cast<const r5::v160::mstudioevent_t*>((char*)oldSeq + FIX_OFFSET(oldSeq->eventindex));
+
+			for (int e = 0; e < oldSeq->numevents; e++)
+			{
+				if (pOldEvents[e].szeventindex > 0)
+					size.AddString((char*)&pOldEvents[e] + FIX_OFFSET(pOldEvents[e].szeventindex));
+			}
+		}
+
+		if (oldSeq->numactivitymodifiers > 0 && oldSeq->activitymodifierindex > 0)
+		{
+			const r5::v160::mstudioactivitymodifier_t* const pOldActMods = reinterpret_cast<const r5::v160::mstudioactivitymodifier_t*>((char*)oldSeq + FIX_OFFSET(oldSeq->activitymodifierindex));
+
+			for (int am = 0; am < oldSeq->numactivitymodifiers; am++)
+				size.AddString((char*)&pOldActMods[am] + FIX_OFFSET(pOldActMods[am].sznameindex));
+		}
+	}
+
+	size.Add(0, 4);
+
+	// bodyparts, their models and meshes go through WriteSections
+	size.Add(pOldHdr->numbodyparts * sizeof(mstudiobodyparts_t));
+
+	for (int i = 0; i < pOldHdr->numbodyparts; ++i)
+	{
+		size.Add(GetBodyPartDataSize_160(pOldHdr->pBodypart(i)));
+		size.AddString(pOldHdr->pBodypart(i)->pszName());
+	}
+
+	size.Add(0, 4);
+
+	// pose parameters
+	const r5::v160::mstudioposeparamdesc_t* const pOldParams = reinterpret_cast<const r5::v160::mstudioposeparamdesc_t*>((const char*)pOldHdr + FIX_OFFSET(pOldHdr->localposeparamindex));
+
+	size.Add(pOldHdr->numlocalposeparameters * sizeof(mstudioposeparamdesc_t), 4);
+
+	for (int i = 0; i < pOldHdr->numlocalposeparameters; i++)
+		size.AddString(pOldParams[i].pszName());
+
+	// ik chains and their links
+	const r5::v160::mstudioikchain_t* const pOldChains = reinterpret_cast<const r5::v160::mstudioikchain_t*>((const char*)pOldHdr + FIX_OFFSET(pOldHdr->ikchainindex));
+
+	size.Add(pOldHdr->numikchains * sizeof(r5::v8::mstudioikchain_t), 4);
+
+	for (int i = 0; i < pOldHdr->numikchains; i++)
+	{
+		size.Add(pOldChains[i].numlinks * sizeof(r5::v8::mstudioiklink_t));
+		size.AddString(pOldChains[i].pszName());
+	}
+
+	// textures, their shader types and the cdtexture, before any are culled
+	size.Add(pOldHdr->numtextures * sizeof(r5::v8::mstudiotexture_t), 4);
+	size.Add(pOldHdr->numtextures, 4);
+	size.Add(sizeof(int));
+
+	for (int i = 0; i < pOldHdr->numtextures; ++i)
+		size.AddString("dev/empty");
+
+	size.AddString("");
+
+	// skins, before they are compacted. a skin name is either under 256 characters or made up as "skin%d"
+	const int numSkinFamilies = max(pOldHdr->numskinfamilies, 0);
+
+	size.Add(sizeof(short) * pOldHdr->numskinref * numSkinFamilies, 4);
+	size.Add(max(numSkinFamilies - 1, 0) * (sizeof(int) + 256), 4);
+
+	// ui panel meshes, the headers are copied as they are and their meshes aligned to 16
+	if (pOldHdr->uiPanelCount > 0)
+	{
+		const char* const pOldUIPanelData = reinterpret_cast<const char*>(pOldHdr) + pOldHdr->uiPanelOffset;
+
+		size.Add(pOldHdr->uiPanelCount * sizeof(r5::v8::mstudiorruiheader_t), 16);
+
+		for (int i = 0; i < pOldHdr->uiPanelCount; i++)
+		{
+			const r5::v8::mstudiorruiheader_t* const ruiHeader = reinterpret_cast<const r5::v8::mstudiorruiheader_t*>(pOldUIPanelData) + i;
+			const r5::v8::mstudioruimesh_t* const pOldMeshHdr = reinterpret_cast<const r5::v8::mstudioruimesh_t*>(reinterpret_cast<const char*>(ruiHeader) + ruiHeader->ruimeshindex);
+
+			size.Add(sizeof(r5::v8::mstudioruimesh_t) + pOldMeshHdr->parentindex + pOldMeshHdr->numparents * sizeof(short));
+			size.Add(pOldMeshHdr->numfaces * (sizeof(r5::v8::mstudioruivertmap_t) + sizeof(r5::v8::mstudioruifourthvert_t) + sizeof(r5::v8::mstudioruimeshface_t)));
+			size.Add(pOldMeshHdr->numvertices * sizeof(r5::v8::mstudioruivert_t));
+		}
+
+		size.Add(0, 4);
+	}
+
+	// keyvalues
+	size.Add(sizeof(s_szModelKeyValues), 4);
+
+	// linear bone table
+	if (pOldHdr->linearboneindex != 0 && numBones > 1)
+	{
+		size.Add(sizeof(r5::v8::mstudiolinearbone_t));
+		size.Add(numBones * (sizeof(int) * 2 + sizeof(Vector) + sizeof(Quaternion) + sizeof(RadianEuler) + sizeof(matrix3x4_t)) + 7 * 3);
+	}
+
+	// string table, the empty string the table starts with included
+	size.AddString("");
+	size.Add(0, 64);
+
+	if (pOldHdr->bvhOffset > 0)
+	{
+		const char* const pOldCollision = reinterpret_cast<const char*>(pOldHdr) + FIX_OFFSET(pOldHdr->bvhOffset);
+		const int headerCount = reinterpret_cast<const r5::v8::mstudiocollmodel_t*>(pOldCollision)->headerCount;
+
+		if (headerCount > 0 && headerCount < 100)
+			size.Add(GetCollisionDataSize_V160(pOldHdr, pOldCollision, fileSize));
+	}
+
+	return size.size;
+}
+
 //
 // ConvertRMDL160To10
 void ConvertRMDL160To10(char* pMDL, const size_t fileSize, const std::string& pathIn, const std::string& pathOut, int subversion)
@@ -2102,20 +2670,6 @@ void ConvertRMDL160To10(char* pMDL, const size_t fileSize, const std::string& pa
 	}
 
 	printf("Output: %s\n", rmdlPath.c_str());
-	std::ofstream out(rmdlPath, std::ios::out | std::ios::binary);
-
-	// Allocate temp file buffer
-	g_model.pBase = new char[FILEBUFSIZE]{};
-	g_model.pData = g_model.pBase;
-
-	// Convert mdl header
-	r5::v8::studiohdr_t* pHdr = reinterpret_cast<r5::v8::studiohdr_t*>(g_model.pData);
-	ConvertStudioHdr_160(pHdr, oldHeader, pMDL);
-	g_model.pHdr = pHdr;
-	g_model.pData += sizeof(r5::v8::studiohdr_t);
-
-	// Init string table
-	BeginStringTable();
 
 	// v16 stores a truncated name in the inline name[33] field (max 32 chars + null)
 	// Use the input filename to get the full model name since inline name is often truncated
@@ -2138,6 +2692,20 @@ void ConvertRMDL160To10(char* pMDL, const size_t fileSize, const std::string& pa
 		modelName += ".rmdl";
 	}
 
+	// Allocate the model image at the size planned from the v16 headers
+	const size_t modelSize = CalcModelSize_160(oldHeader, fileSize, modelName, subversion);
+	g_model.pBase = new char[modelSize]{};
+	g_model.pData = g_model.pBase;
+
+	// Convert mdl header
+	r5::v8::studiohdr_t* pHdr = reinterpret_cast<r5::v8::studiohdr_t*>(g_model.pData);
+	ConvertStudioHdr_160(pHdr, oldHeader, pMDL);
+	g_model.pHdr = pHdr;
+	g_model.pData += sizeof(r5::v8::studiohdr_t);
+
+	// Init string table
+	BeginStringTable();
+
 	memcpy_s(&pHdr->name, 64, modelName.c_str(), min(modelName.length(), 64));
 	AddToStringTable((char*)pHdr, &pHdr->sznameindex, modelName.c_str());
 
@@ -2155,15 +2723,9 @@ void ConvertRMDL160To10(char* pMDL, const size_t fileSize, const std::string& pa
 	// Convert hitboxsets and hitboxes
 	ConvertHitboxes_160(oldHeader, pMDL, oldHeader->numhitboxsets);
 
-	// Copy bonebyname table
-	if (oldHeader->bonetablebynameindex > 0)
-	{
-		const char* pOldBoneTable = (const char*)oldHeader + FIX_OFFSET(oldHeader->bonetablebynameindex);
-		memcpy(g_model.pData, pOldBoneTable, oldHeader->boneCount);
-		g_model.hdrV54()->bonetablebynameindex = static_cast<int>(g_model.pData - g_model.pBase);
-		g_model.pData += oldHeader->boneCount;
-		ALIGN4(g_model.pData);
-	}
+	// Regenerate bonebyname table
+	const unsigned char* const pOldBoneTable = oldHeader->bonetablebynameindex > 0 ? reinterpret_cast<const unsigned char*>(oldHeader) + FIX_OFFSET(oldHeader->bonetablebynameindex) : nullptr;
+	WriteBoneTableByName<r5::v8::mstudiobone_t>(g_model.hdrV54(), pOldBoneTable);
 
 	// Convert sequences and animations
 	ConvertSequences_160(oldHeader, pMDL, oldHeader->numlocalseq, subversion);
@@ -2177,6 +2739,9 @@ void ConvertRMDL160To10(char* pMDL, const size_t fileSize, const std::string& pa
 	// Convert IK chains
 	ConvertIkChains_160(oldHeader, pMDL, oldHeader->numikchains, false);
 
+	// find the textures no mesh can reach before they are written
+	BuildTextureRemap(reinterpret_cast<const short*>((const char*)oldHeader + FIX_OFFSET(oldHeader->skinindex)), oldHeader->numskinref, oldHeader->numskinfamilies, oldHeader->numtextures);
+
 	// Convert textures
 	ConvertTextures_160(oldHeader, pMDL, oldHeader->numtextures);
 
@@ -2187,7 +2752,7 @@ void ConvertRMDL160To10(char* pMDL, const size_t fileSize, const std::string& pa
 	ConvertUIPanelMeshes_160(oldHeader);
 
 	// Write keyvalues
-	std::string keyValues = "mdlkeyvalue{prop_data{base \"\"}}\n";
+	std::string keyValues = s_szModelKeyValues;
 	strcpy_s(g_model.pData, keyValues.length() + 1, keyValues.c_str());
 	pHdr->keyvalueindex = static_cast<int>(g_model.pData - g_model.pBase);
 	pHdr->keyvaluesize = IALIGN2(static_cast<int>(keyValues.length() + 1));
@@ -2197,6 +2762,9 @@ void ConvertRMDL160To10(char* pMDL, const size_t fileSize, const std::string& pa
 	// Convert linear bone table
 	ConvertLinearBoneTable_160(oldHeader);
 
+	// Remap bones if the VG below gets converted, a copied VG would keep the old bone states
+	RemapBones_V54(CanRemapVGBones(ChangeExtension(pathIn, "vg"), true));
+
 	// Write string table
 	g_model.pData = WriteStringTable(g_model.pData);
 	ALIGN64(g_model.pData);
@@ -2231,92 +2799,14 @@ void ConvertRMDL160To10(char* pMDL, const size_t fileSize, const std::string& pa
 		pHdr->bvhOffset = 0;
 	}
 
-	pHdr->length = static_cast<int>(g_model.pData - g_model.pBase);
-
-	out.write(g_model.pBase, pHdr->length);
-
-	delete[] g_model.pBase;
-
-	// RRIG generation disabled - not needed for converted models
-	// The game loads animation data from external .rseq files via RPak
-#if 0
-	///////////////
-	// ANIM RIGS //
-	///////////////
-
-	std::string rigName = originalModelName;
-	if (rigName.rfind("animrig/", 0) != 0)
-		rigName = "animrig/" + rigName;
-	if (EndsWith(rigName, ".mdl"))
-	{
-		rigName = rigName.substr(0, rigName.length() - 4);
-		rigName += ".rrig";
-	}
-
-	printf("Creating rig from model...\n");
-
-	std::string rrigPath = baseOutputPath + ".rrig";
-	std::ofstream rigOut(rrigPath, std::ios::out | std::ios::binary);
-
-	g_model.pBase = new char[FILEBUFSIZE]{};
-	g_model.pData = g_model.pBase;
-
-	// Generate rig header
-	pHdr = reinterpret_cast<r5::v8::studiohdr_t*>(g_model.pData);
-	GenerateRigHdr_160(pHdr, oldHeader);
-	g_model.pHdr = pHdr;
-	g_model.pData += sizeof(r5::v8::studiohdr_t);
-
-	// Reset string table for rig
-	BeginStringTable();
-
-	memcpy_s(&pHdr->name, 64, rigName.c_str(), min(rigName.length(), 64));
-	AddToStringTable((char*)pHdr, &pHdr->sznameindex, rigName.c_str());
-	AddToStringTable((char*)pHdr, &pHdr->surfacepropindex, surfaceProp);
-	AddToStringTable((char*)pHdr, &pHdr->unkStringOffset, "");
-
-	// Convert bones for rig
-	ConvertBones_160(oldHeader, pMDL, oldHeader->boneCount, true);
-
-	// Convert attachments for rig
-	g_model.hdrV54()->localattachmentindex = ConvertAttachments_160(oldHeader, pMDL, oldHeader->numlocalattachments);
-
-	// Convert hitboxsets for rig
-	ConvertHitboxes_160(oldHeader, pMDL, oldHeader->numhitboxsets);
-
-	// Copy bonebyname table
-	if (oldHeader->bonetablebynameindex > 0)
-	{
-		const char* pOldBoneTable = (const char*)oldHeader + FIX_OFFSET(oldHeader->bonetablebynameindex);
-		memcpy(g_model.pData, pOldBoneTable, oldHeader->boneCount);
-		g_model.hdrV54()->bonetablebynameindex = static_cast<int>(g_model.pData - g_model.pBase);
-		g_model.pData += oldHeader->boneCount;
-		ALIGN4(g_model.pData);
-	}
-
-	// Convert pose parameters for rig
-	g_model.hdrV54()->localposeparamindex = ConvertPoseParams_160(oldHeader, pMDL, oldHeader->numlocalposeparameters, true);
-
-	// Convert IK chains for rig
-	ConvertIkChains_160(oldHeader, pMDL, oldHeader->numikchains, true);
-	ALIGN4(g_model.pData);
-
-	g_model.pData = WriteStringTable(g_model.pData);
-
-	pHdr->length = static_cast<int>(g_model.pData - g_model.pBase);
-
-	rigOut.write(g_model.pBase, pHdr->length);
-
-	delete[] g_model.pBase;
-
-	g_model.stringTable.clear();
-#endif
+	// the phy goes first so the rmdl is written once, with the phy's size in its header
+	pHdr->phySize = static_cast<int>(ConvertPHY_160(ChangeExtension(pathIn, "phy"), baseOutputPath + ".phy", oldHeader));
 
 	///////////////
 	// VG FILE   //
 	///////////////
 
-	// Check for VG file alongside the RMDL
+	// Check for VG file alongside the RMDL, converted before the rmdl is written so -tightbounds can bound it from the vg's vertices
 	std::string vgFilePath = ChangeExtension(pathIn, "vg");
 	std::string vgOutPath = baseOutputPath + ".vg";
 
@@ -2343,9 +2833,7 @@ void ConvertRMDL160To10(char* pMDL, const size_t fileSize, const std::string& pa
 		{
 			// Already v8/v9 format - copy as-is
 			printf("VG file appears to be v8/v9 format, copying as-is...\n");
-			std::ofstream vgOut(vgOutPath, std::ios::out | std::ios::binary);
-			vgOut.write(vgInputBuf, vgInputSize);
-			vgOut.close();
+			WriteOutputFile(vgOutPath, vgInputBuf, vgInputSize);
 			delete[] vgInputBuf;
 		}
 		else
@@ -2365,9 +2853,7 @@ void ConvertRMDL160To10(char* pMDL, const size_t fileSize, const std::string& pa
 			{
 				// Unknown format - try to copy anyway
 				printf("WARNING: VG file has unknown magic 0x%08X, copying as-is...\n", vgMagic);
-				std::ofstream vgOut(vgOutPath, std::ios::out | std::ios::binary);
-				vgOut.write(vgInputBuf, vgInputSize);
-				vgOut.close();
+				WriteOutputFile(vgOutPath, vgInputBuf, vgInputSize);
 				delete[] vgInputBuf;
 			}
 		}
@@ -2379,83 +2865,81 @@ void ConvertRMDL160To10(char* pMDL, const size_t fileSize, const std::string& pa
 		printf("         You may need to extract the VG data separately using Legion or similar tools.\n");
 	}
 
+	CheckModelSize(modelSize);
+
+	pHdr->length = static_cast<int>(g_model.pData - g_model.pBase);
+
+	WriteOutputFile(rmdlPath, g_model.pBase, pHdr->length);
+
+	delete[] g_model.pBase;
+
+	// RRIG generation disabled - not needed for converted models
+	// The game loads animation data from external .rseq files via RPak
+#if 0
 	///////////////
-	// PHY FILE  //
+	// ANIM RIGS //
 	///////////////
 
-	// Check for PHY file alongside the RMDL and convert to v10 format
-	std::string phyFilePath = ChangeExtension(pathIn, "phy");
-	std::string phyOutPath = baseOutputPath + ".phy";
-
-	if (FILE_EXISTS(phyFilePath))
+	std::string rigName = originalModelName;
+	if (rigName.rfind("animrig/", 0) != 0)
+		rigName = "animrig/" + rigName;
+	if (EndsWith(rigName, ".mdl"))
 	{
-		printf("Found PHY file, converting to v10 format...\n");
+		rigName = rigName.substr(0, rigName.length() - 4);
+		rigName += ".rrig";
+	}
+
+	printf("Creating rig from model...\n");
+
+	std::string rrigPath = baseOutputPath + ".rrig";
+
+	g_model.pBase = new char[FILEBUFSIZE]{};
+	g_model.pData = g_model.pBase;
+
+	// Generate rig header
+	pHdr = reinterpret_cast<r5::v8::studiohdr_t*>(g_model.pData);
+	GenerateRigHdr_160(pHdr, oldHeader);
+	g_model.pHdr = pHdr;
+	g_model.pData += sizeof(r5::v8::studiohdr_t);
 
-		uintmax_t phyInputSize = GetFileSize(phyFilePath);
-		char* phyInputBuf = new char[phyInputSize];
+	// Reset string table for rig
+	BeginStringTable();
 
-		std::ifstream phyIfs(phyFilePath, std::ios::in | std::ios::binary);
-		phyIfs.read(phyInputBuf, phyInputSize);
-		phyIfs.close();
+	memcpy_s(&pHdr->name, 64, rigName.c_str(), min(rigName.length(), 64));
+	AddToStringTable((char*)pHdr, &pHdr->sznameindex, rigName.c_str());
+	AddToStringTable((char*)pHdr, &pHdr->surfacepropindex, surfaceProp);
+	AddToStringTable((char*)pHdr, &pHdr->unkStringOffset, "");
 
-		// v16/v17 PHY header is 4 bytes: [solidCount: uint16][keyValuesOffset: uint16].
-		// v10 IVPS header is 20 bytes: size, id, solidCount, checkSum, keyValuesOffset (all int32).
-		// Data after the header is identical, just shifted by 16 bytes.
-		uint16_t v16SolidCount = *reinterpret_cast<uint16_t*>(phyInputBuf);
-		uint16_t v16KeyValuesOffset = *reinterpret_cast<uint16_t*>(phyInputBuf + 2);
+	// Convert bones for rig
+	ConvertBones_160(oldHeader, pMDL, oldHeader->boneCount, true);
 
-		printf("  V16 PHY: solidCount=%d, keyValuesOffset=%d\n", v16SolidCount, v16KeyValuesOffset);
+	// Convert attachments for rig
+	g_model.hdrV54()->localattachmentindex = ConvertAttachments_160(oldHeader, pMDL, oldHeader->numlocalattachments);
 
-		struct IVPSHeader {
-			int32_t size;
-			int32_t id;
-			int32_t solidCount;
-			int32_t checkSum;
-			int32_t keyValuesOffset;
-		};
+	// Convert hitboxsets for rig
+	ConvertHitboxes_160(oldHeader, pMDL, oldHeader->numhitboxsets);
 
-		IVPSHeader v10Header;
-		v10Header.size = 20;
-		v10Header.id = 1;
-		v10Header.solidCount = v16SolidCount;
-		v10Header.checkSum = oldHeader->checksum;
-		v10Header.keyValuesOffset = v16KeyValuesOffset + 16;
+	// Regenerate bonebyname table
+	const unsigned char* const pOldBoneTable = oldHeader->bonetablebynameindex > 0 ? reinterpret_cast<const unsigned char*>(oldHeader) + FIX_OFFSET(oldHeader->bonetablebynameindex) : nullptr;
+	WriteBoneTableByName<r5::v8::mstudiobone_t>(g_model.hdrV54(), pOldBoneTable);
 
-		printf("  V10 PHY: size=%d, id=%d, solidCount=%d, checkSum=0x%08X, keyValuesOffset=%d\n",
-			v10Header.size, v10Header.id, v10Header.solidCount, v10Header.checkSum, v10Header.keyValuesOffset);
+	// Convert pose parameters for rig
+	g_model.hdrV54()->localposeparamindex = ConvertPoseParams_160(oldHeader, pMDL, oldHeader->numlocalposeparameters, true);
 
-		// Calculate output size: 20-byte header + (v16 data - 4-byte v16 header)
-		size_t v10PhySize = sizeof(IVPSHeader) + (phyInputSize - 4);
+	// Convert IK chains for rig
+	ConvertIkChains_160(oldHeader, pMDL, oldHeader->numikchains, true);
+	ALIGN4(g_model.pData);
 
-		std::ofstream phyOut(phyOutPath, std::ios::out | std::ios::binary);
+	g_model.pData = WriteStringTable(g_model.pData);
 
-		// Write v10 IVPS header
-		phyOut.write(reinterpret_cast<char*>(&v10Header), sizeof(IVPSHeader));
+	pHdr->length = static_cast<int>(g_model.pData - g_model.pBase);
 
-		// Copy v16 data (skip the 4-byte v16 header)
-		phyOut.write(phyInputBuf + 4, phyInputSize - 4);
+	WriteOutputFile(rrigPath, g_model.pBase, pHdr->length);
 
-		phyOut.close();
-		delete[] phyInputBuf;
+	delete[] g_model.pBase;
 
-		// Update phySize in the rmdl header
-		std::fstream rmdlUpdate(rmdlPath, std::ios::in | std::ios::out | std::ios::binary);
-		if (rmdlUpdate.is_open())
-		{
-			// Seek to phySize offset in studiohdr_t and write the size
-			size_t phySizeOffset = offsetof(r5::v8::studiohdr_t, phySize);
-			int phySizeValue = static_cast<int>(v10PhySize);
-			rmdlUpdate.seekp(phySizeOffset);
-			rmdlUpdate.write(reinterpret_cast<char*>(&phySizeValue), sizeof(int));
-			rmdlUpdate.close();
-			printf("  PHY converted successfully (v16: %llu bytes -> v10: %zu bytes)\n",
-				phyInputSize, v10PhySize);
-		}
-		else
-		{
-			printf("  PHY converted but could not update phySize in header.\n");
-		}
-	}
+	g_model.stringTable.clear();
+#endif
 
 	printf("Finished converting model '%s', proceeding...\n\n", rawModelName.c_str());
 }
@@ -6,6 +6,7 @@
 #include <studio/versions.h>
 #include <studio/common.h>
 #include <studio/optimize.h>
+#include <studio/collision.h>
 
 /*
 	Type:    RMDL
@@ -19,6 +20,8 @@
 
 #define V10_BONE_USED_BY_BONE_MERGE  0x00040000
 
+static const char s_szModelKeyValues[] = "mdlkeyvalue{prop_data{base \"\"}}\n";
+
 static int TranslateBoneFlags_191(int flags)
 {
 	return flags & ~V10_BONE_USED_BY_BONE_MERGE;
@@ -58,22 +61,23 @@ static const uint8_t* FindBoneStateData_191(const char* rmdlData, size_t rmdlSiz
 	// from bone name tables and other data earlier in the file.
 	const size_t searchStart = 0x1000;  // Don't search in header area
 
+	byteset uniqueValues;
+
 	for (size_t off = rmdlSize - boneStateCount; off >= searchStart; off--)
 	{
 		const uint8_t* p = reinterpret_cast<const uint8_t*>(rmdlData + off);
 
 		// Check if all values are valid bone indices AND all unique
-		std::set<uint8_t> uniqueValues;
+		uniqueValues.clear();
 		bool valid = true;
 
 		for (uint16_t i = 0; i < boneStateCount; i++)
 		{
-			if (p[i] >= totalBones)
+			if (p[i] >= totalBones || !uniqueValues.insert(p[i]))
 			{
 				valid = false;
 				break;
 			}
-			uniqueValues.insert(p[i]);
 		}
 
 		// Must have ALL unique values (each hardware bone maps to different model bone)
@@ -104,17 +108,16 @@ static const uint8_t* FindBoneStateData_191(const char* rmdlData, size_t rmdlSiz
 	{
 		const uint8_t* p = reinterpret_cast<const uint8_t*>(rmdlData + off);
 
-		std::set<uint8_t> uniqueValues;
+		uniqueValues.clear();
 		bool valid = true;
 
 		for (uint16_t i = 0; i < boneStateCount; i++)
 		{
-			if (p[i] >= totalBones)
+			if (p[i] >= totalBones || !uniqueValues.insert(p[i]))
 			{
 				valid = false;
 				break;
 			}
-			uniqueValues.insert(p[i]);
 		}
 
 		if (valid && uniqueValues.size() == boneStateCount)
@@ -126,6 +129,67 @@ static const uint8_t* FindBoneStateData_191(const char* rmdlData, size_t rmdlSiz
 	return nullptr;
 }
 
+//
+// CalcVGLayout_191
+// Purpose: exact rev1 section offsets for a rev4 vg, mirrors the section order ConvertVGData_191 writes
+//
+static s_vglayout_t CalcVGLayout_191(const vg::rev4::VertexGroupHeader_t* pGroupHdr, const size_t boneStateChangeCount)
+{
+	size_t meshCount = 0;
+	size_t indexSize = 0;
+	size_t vertexSize = 0;
+	size_t extraWeightSize = 0;
+	size_t vertexCount = 0;
+	size_t stripCount = 0;
+
+	for (int lodIdx = 0; lodIdx < pGroupHdr->lodCount; lodIdx++)
+	{
+		const vg::rev4::ModelLODHeader_t* pLodHdr = pGroupHdr->pLod(lodIdx);
+		if (!pLodHdr) continue;
+
+		for (int meshIdx = 0; meshIdx < pLodHdr->meshCount; meshIdx++)
+		{
+			const vg::rev4::MeshHeader_t* pMesh = pLodHdr->pMesh(meshIdx);
+			if (!pMesh) continue;
+
+			meshCount++;
+			vertexCount += pMesh->vertCount;
+
+			if (pMesh->pIndices() && pMesh->indexCount > 0)
+				indexSize += pMesh->indexCount * sizeof(uint16_t);
+
+			// same stride meshes are copied with their whole source buffer
+			if (pMesh->pVertices() && pMesh->vertCount > 0)
+			{
+				const uint32_t v10VertSize = CalculateVertexSize_191(ConvertMeshFlags_191(pMesh->flags));
+				vertexSize += pMesh->vertCacheSize != v10VertSize ? static_cast<size_t>(v10VertSize) * pMesh->vertCount : pMesh->vertBufferSize;
+			}
+
+			if (pMesh->pBoneWeights() && pMesh->extraBoneWeightSize > 0)
+				extraWeightSize += pMesh->extraBoneWeightSize;
+
+			if (pMesh->flags != 0 && pMesh->vertCount > 0)
+				stripCount++;
+		}
+	}
+
+	const size_t unknownCount = meshCount / pGroupHdr->lodCount;
+
+	s_vglayout_t layout {};
+	layout.boneStateChangeOffset = sizeof(vg::rev1::VertexGroupHeader_t);
+	layout.meshOffset = layout.boneStateChangeOffset + boneStateChangeCount;
+	layout.indexOffset = AlignVGOffset(layout.meshOffset + meshCount * sizeof(vg::rev1::MeshHeader_t));
+	layout.vertOffset = AlignVGOffset(layout.indexOffset + indexSize);
+	layout.extraBoneWeightOffset = AlignVGOffset(layout.vertOffset + vertexSize);
+	layout.unknownOffset = layout.extraBoneWeightOffset + extraWeightSize;
+	layout.lodOffset = layout.unknownOffset + unknownCount * sizeof(vg::rev1::UnkVgData_t);
+	layout.legacyWeightOffset = layout.lodOffset + pGroupHdr->lodCount * sizeof(vg::rev1::ModelLODHeader_t);
+	layout.stripOffset = layout.legacyWeightOffset + vertexCount * 16;
+	layout.size = layout.stripOffset + stripCount * sizeof(OptimizedModel::StripHeader_t);
+
+	return layout;
+}
+
 static void ConvertVGData_191(const char* vgInputBuf, uintmax_t vgInputSize, const std::string& vgOutPath,
 	const r5::v191::studiohdr_t* pRmdlHdr = nullptr, const char* rmdlData = nullptr, size_t rmdlSize = 0)
 {
@@ -145,9 +209,6 @@ static void ConvertVGData_191(const char* vgInputBuf, uintmax_t vgInputSize, con
 	// Calculate total sizes needed for output
 	size_t totalMeshCount = 0;
 	size_t totalVertexCount = 0;  // For legacyWeight
-	size_t totalVertexBufSize = 0;
-	size_t totalIndexBufSize = 0;
-	size_t totalExtraWeightSize = 0;
 	size_t totalStripCount = 0;
 
 	// BoneStateChange data collection
@@ -177,10 +238,6 @@ static void ConvertVGData_191(const char* vgInputBuf, uintmax_t vgInputSize, con
 			uint32_t v191VertSize = pMesh->vertCacheSize;
 			uint32_t v10VertSize = CalculateVertexSize_191(v10Flags);
 
-			totalVertexBufSize += v10VertSize * pMesh->vertCount;
-			totalIndexBufSize += pMesh->indexCount * sizeof(uint16_t);
-			totalExtraWeightSize += pMesh->extraBoneWeightSize;
-
 			// Scan vertices for bone indices if no RMDL bone state data
 			if (pBoneStateData == nullptr && (pMesh->flags & 0x1000))  // VERTEX_HAS_WEIGHT_BONES
 			{
@@ -248,7 +305,7 @@ static void ConvertVGData_191(const char* vgInputBuf, uintmax_t vgInputSize, con
 
 			// Validate the data from header offset
 			bool validData = true;
-			std::set<uint8_t> uniqueCheck;
+			byteset uniqueCheck;
 			for (size_t i = 0; i < boneStateChangeCount && validData; i++)
 			{
 				if (pBoneStateData[i] >= pRmdlHdr->boneCount)
@@ -289,19 +346,10 @@ static void ConvertVGData_191(const char* vgInputBuf, uintmax_t vgInputSize, con
 	size_t legacyWeightSize = totalVertexCount * 16;
 	printf("  LegacyWeight size: %zu bytes (%zu vertices * 16)\n", legacyWeightSize, totalVertexCount);
 
-	// Allocate output buffer
 	// Structure: [Header][BoneStateChange][Meshes][Indices][Vertices][Weights][Unknown][LODs][LegacyWeight][Strips]
-	size_t outputBufSize = sizeof(vg::rev1::VertexGroupHeader_t)
-		+ boneStates.size()  // BoneStateChange section
-		+ (totalMeshCount * sizeof(vg::rev1::MeshHeader_t))
-		+ totalIndexBufSize + 16  // indices + alignment
-		+ totalVertexBufSize + 16 // vertices + alignment
-		+ totalExtraWeightSize
-		+ (unknownCount * sizeof(vg::rev1::UnkVgData_t))
-		+ (pGroupHdr->lodCount * sizeof(vg::rev1::ModelLODHeader_t))
-		+ legacyWeightSize  // LegacyWeight section
-		+ (totalStripCount * sizeof(OptimizedModel::StripHeader_t))
-		+ 4096; // Extra padding
+	// every section is sized up front, the buffer is allocated exactly once
+	const s_vglayout_t layout = CalcVGLayout_191(pGroupHdr, boneStates.size());
+	const size_t outputBufSize = layout.size;
 
 	std::unique_ptr<char[]> outputBuf(new char[outputBufSize]);
 	memset(outputBuf.get(), 0, outputBufSize);
@@ -371,8 +419,8 @@ static void ConvertVGData_191(const char* vgInputBuf, uintmax_t vgInputSize, con
 	pWrite = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(pWrite) + 15) & ~15);
 	pVertexData = pWrite;
 
-	// Copy vertex data
-	size_t vertexOffset = 0;
+	// meshes in write order, the vertex pass below runs one task per mesh
+	std::vector<const vg::rev4::MeshHeader_t*> vertexMeshes;
 	for (int lodIdx = 0; lodIdx < pGroupHdr->lodCount; lodIdx++)
 	{
 		const vg::rev4::ModelLODHeader_t* pLodHdr = pGroupHdr->pLod(lodIdx);
@@ -383,41 +431,74 @@ static void ConvertVGData_191(const char* vgInputBuf, uintmax_t vgInputSize, con
 			const vg::rev4::MeshHeader_t* pMesh = pLodHdr->pMesh(meshIdx);
 			if (!pMesh) continue;
 
-			const char* pSrcVerts = pMesh->pVertices();
-			if (pSrcVerts && pMesh->vertCount > 0)
-			{
-				uint64_t v191Flags = pMesh->flags;
-				uint64_t v10Flags = ConvertMeshFlags_191(v191Flags);
-				uint32_t v191VertSize = pMesh->vertCacheSize;
-				uint32_t v10VertSize = CalculateVertexSize_191(v10Flags);
+			vertexMeshes.push_back(pMesh);
+		}
+	}
 
-				// If source vertex size differs from output, need to copy vertex by vertex
-				if (v191VertSize != v10VertSize)
-				{
-					// Copy each vertex with the correct output size
-					// This handles UV2 stripping and any other size differences
-					for (uint32_t v = 0; v < pMesh->vertCount; v++)
-					{
-						memcpy(pWrite, pSrcVerts + v * v191VertSize, v10VertSize);
-						pWrite += v10VertSize;
-					}
-				}
-				else
-				{
-					// Same size, copy as-is
-					memcpy(pWrite, pSrcVerts, pMesh->vertBufferSize);
-					pWrite += pMesh->vertBufferSize;
-				}
-			}
+	// lay out the vertex data first so every mesh knows where it goes
+	std::vector<char*> meshVertexData(vertexMeshes.size());
+	for (size_t i = 0; i < vertexMeshes.size(); i++)
+	{
+		const vg::rev4::MeshHeader_t* pMesh = vertexMeshes[i];
+		meshVertexData[i] = pWrite;
+
+		if (pMesh->pVertices() && pMesh->vertCount > 0)
+		{
+			const uint32_t v10VertSize = CalculateVertexSize_191(ConvertMeshFlags_191(pMesh->flags));
+			pWrite += pMesh->vertCacheSize != v10VertSize ? static_cast<size_t>(v10VertSize) * pMesh->vertCount : pMesh->vertBufferSize;
 		}
 	}
 
+	// pruned extra bone weights, one entry per mesh in write order
+	std::vector<std::vector<vvw::mstudioboneweightextra_t>> prunedExtraWeights(g_options.pruneWeights ? vertexMeshes.size() : 0);
+	std::vector<s_weightprunestats_t> meshPruneStats(prunedExtraWeights.size());
+
+	// Copy vertex data
+	ParallelForSections(vertexMeshes.size(), [&](const size_t i)
+	{
+		const vg::rev4::MeshHeader_t* pMesh = vertexMeshes[i];
+		char* const pMeshVerts = meshVertexData[i];
+
+		const char* pSrcVerts = pMesh->pVertices();
+		if (pSrcVerts && pMesh->vertCount > 0)
+		{
+			uint64_t v191Flags = pMesh->flags;
+			uint64_t v10Flags = ConvertMeshFlags_191(v191Flags);
+			uint32_t v191VertSize = pMesh->vertCacheSize;
+			uint32_t v10VertSize = CalculateVertexSize_191(v10Flags);
+
+			// If source vertex size differs from output, need to copy vertex by vertex
+			// This handles UV2 stripping and any other size differences
+			if (v191VertSize != v10VertSize)
+				g_kernels.RepackVertices(pMeshVerts, v10VertSize, pSrcVerts, v191VertSize, pMesh->vertCount);
+			else
+				memcpy(pMeshVerts, pSrcVerts, pMesh->vertBufferSize);
+		}
+
+		if (g_options.pruneWeights)
+		{
+			const uint64_t v10Flags = ConvertMeshFlags_191(pMesh->flags);
+
+			PruneMeshWeights_VG(pMeshVerts, pMesh->vertCount, CalculateVertexSize_191(v10Flags), v10Flags,
+				reinterpret_cast<const vvw::mstudioboneweightextra_t*>(pMesh->pBoneWeights()), pMesh->extraBoneWeightSize / sizeof(vvw::mstudioboneweightextra_t),
+				prunedExtraWeights[i], meshPruneStats[i]);
+		}
+	});
+
+	s_weightprunestats_t pruneStats {};
+	for (const s_weightprunestats_t& meshStats : meshPruneStats)
+		AddWeightPruneStats(pruneStats, meshStats);
+
+	if (g_options.pruneWeights)
+		PrintWeightPruneStats(pruneStats);
+
 	// Align
 	pWrite = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(pWrite) + 15) & ~15);
 	pWeightData = pWrite;
 
 	// Copy extra bone weight data
 	size_t weightOffset = 0;
+	size_t weightMeshIdx = 0;
 	for (int lodIdx = 0; lodIdx < pGroupHdr->lodCount; lodIdx++)
 	{
 		const vg::rev4::ModelLODHeader_t* pLodHdr = pGroupHdr->pLod(lodIdx);
@@ -428,6 +509,15 @@ static void ConvertVGData_191(const char* vgInputBuf, uintmax_t vgInputSize, con
 			const vg::rev4::MeshHeader_t* pMesh = pLodHdr->pMesh(meshIdx);
 			if (!pMesh) continue;
 
+			if (g_options.pruneWeights)
+			{
+				const std::vector<vvw::mstudioboneweightextra_t>& meshWeights = prunedExtraWeights[weightMeshIdx++];
+
+				memcpy(pWrite, meshWeights.data(), meshWeights.size() * sizeof(vvw::mstudioboneweightextra_t));
+				pWrite += meshWeights.size() * sizeof(vvw::mstudioboneweightextra_t);
+				continue;
+			}
+
 			const char* pSrcWeights = pMesh->pBoneWeights();
 			if (pSrcWeights && pMesh->extraBoneWeightSize > 0)
 			{
@@ -514,7 +604,7 @@ static void ConvertVGData_191(const char* vgInputBuf, uintmax_t vgInputSize, con
 	// Fill in LOD and mesh headers with correct offsets
 	short meshStartIdx = 0;
 	indexOffset = 0;
-	vertexOffset = 0;
+	size_t vertexOffset = 0;
 	weightOffset = 0;
 	size_t legacyWeightIdx = 0;  // Running index into legacyWeight buffer
 	stripIndex = 0;
@@ -527,7 +617,7 @@ static void ConvertVGData_191(const char* vgInputBuf, uintmax_t vgInputSize, con
 		vg::rev1::ModelLODHeader_t* pOutLod = reinterpret_cast<vg::rev1::ModelLODHeader_t*>(pLodStart) + lodIdx;
 		pOutLod->meshOffset = meshStartIdx;
 		pOutLod->meshCount = pLodHdr->meshCount;
-		pOutLod->switchPoint = 0.0f; // Default switch point
+		pOutLod->switchPoint = 0.0f; // set once every lod is written when -lodswitch is used
 
 		for (int meshIdx = 0; meshIdx < pLodHdr->meshCount; meshIdx++)
 		{
@@ -547,8 +637,11 @@ static void ConvertVGData_191(const char* vgInputBuf, uintmax_t vgInputSize, con
 			pOutMesh->vertCount = static_cast<uint32_t>(pMesh->vertCount);
 			pOutMesh->indexOffset = static_cast<int>(indexOffset / sizeof(uint16_t));
 			pOutMesh->indexCount = static_cast<int>(pMesh->indexCount);
+			// pruning may have shrunk or dropped this mesh's extra weights
+			const int extraBoneWeightSize = g_options.pruneWeights ? static_cast<int>(prunedExtraWeights[meshStartIdx].size() * sizeof(vvw::mstudioboneweightextra_t)) : static_cast<int>(pMesh->extraBoneWeightSize);
+
 			pOutMesh->extraBoneWeightOffset = static_cast<int>(weightOffset);
-			pOutMesh->extraBoneWeightSize = static_cast<int>(pMesh->extraBoneWeightSize);
+			pOutMesh->extraBoneWeightSize = extraBoneWeightSize;
 
 			// Set legacyWeight offsets for this mesh
 			pOutMesh->legacyWeightOffset = static_cast<int>(legacyWeightIdx);
@@ -570,18 +663,44 @@ static void ConvertVGData_191(const char* vgInputBuf, uintmax_t vgInputSize, con
 			// Update running offsets
 			indexOffset += pMesh->indexCount * sizeof(uint16_t);
 			vertexOffset += v10VertCacheSize * pMesh->vertCount;  // Use v10 size
-			weightOffset += pMesh->extraBoneWeightSize;
+			weightOffset += extraBoneWeightSize;
 			legacyWeightIdx += pMesh->vertCount;
 
 			// Update header totals
 			pOutHdr->indexCount += pMesh->indexCount;
 			pOutHdr->vertBufferSize += v10VertCacheSize * pMesh->vertCount;  // Use v10 size
-			pOutHdr->extraBoneWeightSize += pMesh->extraBoneWeightSize;
+			pOutHdr->extraBoneWeightSize += extraBoneWeightSize;
 
 			meshStartIdx++;
 		}
 	}
 
+	// mesh headers now point into the written index and vertex data
+	if (g_options.computeLODSwitchPoints)
+		ComputeLODSwitchPoints_VG(pIndexData, pVertexData, reinterpret_cast<vg::rev1::MeshHeader_t*>(pMeshStart), static_cast<int>(totalMeshCount),
+			reinterpret_cast<vg::rev1::ModelLODHeader_t*>(pLodStart), pGroupHdr->lodCount, g_options.lodPixelError);
+
+	if (g_options.optimizeOverdraw)
+		OptimizeOverdraw_VG(pIndexData, pVertexData, reinterpret_cast<vg::rev1::MeshHeader_t*>(pMeshStart), static_cast<int>(totalMeshCount), g_options.overdrawCacheThreshold);
+
+	// the palette section was sized for the old palette, a smaller one just leaves padding behind it
+	if (g_options.minimizePalette && MinimizeBonePalette_VG(pVertexData, pWeightData, reinterpret_cast<vg::rev1::MeshHeader_t*>(pMeshStart), static_cast<int>(totalMeshCount), boneStates))
+	{
+		memset(pBoneStateChange, 0, pOutHdr->boneStateChangeCount);
+		memcpy(pBoneStateChange, boneStates.data(), boneStates.size());
+		pOutHdr->boneStateChangeCount = boneStates.size();
+	}
+
+	RemapBoneStates(reinterpret_cast<unsigned char*>(pBoneStateChange), pOutHdr->boneStateChangeCount);
+
+	// bone states are in the rmdl's final bone order from here on
+	if (g_options.tightBounds)
+	{
+		ApplyTightBounds_VG(pVertexData, reinterpret_cast<const vg::rev1::MeshHeader_t*>(pMeshStart), static_cast<int>(totalMeshCount),
+			reinterpret_cast<const vg::rev1::ModelLODHeader_t*>(pLodStart), pGroupHdr->lodCount,
+			reinterpret_cast<const unsigned char*>(pBoneStateChange), static_cast<int>(pOutHdr->boneStateChangeCount));
+	}
+
 	// Set data size
 	pOutHdr->dataSize = static_cast<int>(pWrite - outputBuf.get());
 
@@ -592,10 +711,10 @@ static void ConvertVGData_191(const char* vgInputBuf, uintmax_t vgInputSize, con
 			(long long)(pWrite - pBufferEnd));
 	}
 
+	CheckVGLayout(layout, pOutHdr);
+
 	// Write output file
-	std::ofstream vgOut(vgOutPath, std::ios::out | std::ios::binary);
-	vgOut.write(outputBuf.get(), pOutHdr->dataSize);
-	vgOut.close();
+	WriteOutputFile(vgOutPath, outputBuf.get(), pOutHdr->dataSize);
 
 	printf("VG conversion complete: %d LODs, %zu meshes, %zu unknowns, %zu strips, %d bytes\n",
 		pGroupHdr->lodCount, totalMeshCount, unknownCount, totalStripCount, pOutHdr->dataSize);
@@ -683,7 +802,7 @@ static void ConvertStudioHdr_191(r5::v8::studiohdr_t* out, const r5::v191::studi
 	out->vvdSize = 0;
 	out->vvcSize = 0;
 	out->vvwSize = 0;
-	out->phySize = 0;  // Will be set later if .phy file exists
+	out->phySize = 0;  // Set from the converted .phy before the rmdl is written
 }
 
 //
@@ -797,7 +916,7 @@ static void ConvertBones_191(const r5::v191::studiohdr_t* pOldHdr, const char* p
 
 	printf("copying %lld jiggle bones...\n", proceduralBones.size());
 
-	std::map<uint8_t, uint8_t> linearprocbones;
+	bytemap linearprocbones;
 
 	for (auto bone : proceduralBones)
 	{
@@ -825,9 +944,12 @@ static void ConvertBones_191(const r5::v191::studiohdr_t* pOldHdr, const char* p
 	g_model.hdrV54()->procBoneCount = static_cast<int>(linearprocbones.size());
 	g_model.hdrV54()->procBoneTableOffset = static_cast<int>(g_model.pData - g_model.pBase);
 
-	for (auto& it : linearprocbones)
+	for (int i = 0; i < 256; i++)
 	{
-		*g_model.pData = it.first;
+		if (!linearprocbones.count(i))
+			continue;
+
+		*g_model.pData = static_cast<char>(i);
 		g_model.pData += sizeof(uint8_t);
 	}
 
@@ -835,7 +957,7 @@ static void ConvertBones_191(const r5::v191::studiohdr_t* pOldHdr, const char* p
 
 	for (int i = 0; i < numBones; i++)
 	{
-		*g_model.pData = linearprocbones.count(i) ? linearprocbones.find(i)->second : 0xff;
+		*g_model.pData = linearprocbones.count(i) ? linearprocbones.at(i) : 0xff;
 		g_model.pData += sizeof(uint8_t);
 	}
 
@@ -853,6 +975,8 @@ static void ConvertHitboxes_191(const r5::v191::studiohdr_t* pOldHdr, const char
 	const r5::v191::mstudiohitboxset_t* pOldHitboxSets = reinterpret_cast<const r5::v191::mstudiohitboxset_t*>(
 		(const char*)pOldHdr + FIX_OFFSET(pOldHdr->hitboxsetindex));
 
+	s_hitboxfitstats_t fitStats{};
+
 	mstudiohitboxset_t* hboxsetStart = reinterpret_cast<mstudiohitboxset_t*>(g_model.pData);
 
 	// Write hitbox set headers
@@ -876,15 +1000,30 @@ static void ConvertHitboxes_191(const r5::v191::studiohdr_t* pOldHdr, const char
 
 		newhboxset->hitboxindex = static_cast<int>(g_model.pData - (char*)newhboxset);
 
+		std::vector<s_hitboxfit_t> fits(oldhboxset->numhitboxes);
+		for (int j = 0; j < oldhboxset->numhitboxes; ++j)
+		{
+			const r5::v191::mstudiobbox_t* oldHitbox = oldhboxset->pHitbox(j);
+			fits[j] = { oldHitbox->bone, oldHitbox->group, oldHitbox->bbmin, oldHitbox->bbmax, true };
+		}
+
+		// no vertex data is decoded before the vg is converted, so these can only be compacted
+		FitHitboxSet(fits, nullptr, fitStats);
+		newhboxset->numhitboxes = 0;
+
 		for (int j = 0; j < oldhboxset->numhitboxes; ++j)
 		{
+			if (!fits[j].keep)
+				continue;
+
 			const r5::v191::mstudiobbox_t* oldHitbox = oldhboxset->pHitbox(j);
 			r5::v8::mstudiobbox_t* newHitbox = reinterpret_cast<r5::v8::mstudiobbox_t*>(g_model.pData);
 
 			newHitbox->bone = oldHitbox->bone;
 			newHitbox->group = oldHitbox->group;
-			newHitbox->bbmin = oldHitbox->bbmin;
-			newHitbox->bbmax = oldHitbox->bbmax;
+			newHitbox->bbmin = fits[j].bbmin;
+			newHitbox->bbmax = fits[j].bbmax;
+			newhboxset->numhitboxes++;
 
 			AddToStringTable((char*)newHitbox, &newHitbox->szhitboxnameindex, oldHitbox->pszHitboxName());
 
@@ -896,6 +1035,8 @@ static void ConvertHitboxes_191(const r5::v191::studiohdr_t* pOldHdr, const char
 		}
 	}
 
+	PrintHitboxFitStats(fitStats);
+
 	ALIGN4(g_model.pData);
 }
 
@@ -927,6 +1068,20 @@ static int ConvertAttachments_191(const r5::v191::studiohdr_t* pOldHdr, const ch
 	return index;
 }
 
+//
+// GetBodyPartDataSize_191
+// Purpose: bytes ConvertBodyParts_191 writes after the headers for one bodypart
+//
+static size_t GetBodyPartDataSize_191(const r5::v191::mstudiobodyparts_t* oldbodypart)
+{
+	size_t size = oldbodypart->nummodels * sizeof(r5::v8::mstudiomodel_t);
+
+	for (int j = 0; j < oldbodypart->nummodels; ++j)
+		size += oldbodypart->pModel(j)->meshCountTotal * sizeof(r5::v8::mstudiomesh_t);
+
+	return size;
+}
+
 //
 // ConvertBodyParts_191
 static void ConvertBodyParts_191(const r5::v191::studiohdr_t* pOldHdr, const char* pOldData, int numBodyParts)
@@ -952,13 +1107,15 @@ static void ConvertBodyParts_191(const r5::v191::studiohdr_t* pOldHdr, const cha
 		g_model.pData += sizeof(mstudiobodyparts_t);
 	}
 
-	// Write models and meshes for each bodypart
-	for (int i = 0; i < numBodyParts; ++i)
+	// Write models and meshes for each bodypart, each as its own task
+	WriteSections("bodyparts", reinterpret_cast<char*>(bodypartStart), numBodyParts, 1,
+		[&](const size_t i) { return GetBodyPartDataSize_191(pOldHdr->pBodypart(static_cast<int>(i))); },
+		[&](const size_t i)
 	{
-		const r5::v191::mstudiobodyparts_t* oldbodypart = pOldHdr->pBodypart(i);
+		const r5::v191::mstudiobodyparts_t* oldbodypart = pOldHdr->pBodypart(static_cast<int>(i));
 		mstudiobodyparts_t* newbodypart = bodypartStart + i;
 
-		newbodypart->modelindex = static_cast<int>(g_model.pData - (char*)newbodypart);
+		SetSectionOffset(&newbodypart->modelindex, (char*)newbodypart, g_model.pData);
 
 		r5::v8::mstudiomodel_t* newModels = reinterpret_cast<r5::v8::mstudiomodel_t*>(g_model.pData);
 
@@ -1024,7 +1181,7 @@ static void ConvertBodyParts_191(const r5::v191::studiohdr_t* pOldHdr, const cha
 
 			g_model.pData += oldModel->meshCountTotal * sizeof(r5::v8::mstudiomesh_t);
 		}
-	}
+	});
 
 	ALIGN4(g_model.pData);
 }
@@ -1042,8 +1199,12 @@ static void ConvertTextures_191(const r5::v191::studiohdr_t* pOldHdr, const char
 	const uint64_t* pOldTextureGuids = reinterpret_cast<const uint64_t*>(
 		(const char*)pOldHdr + textureDataOffset);
 
+	int numNewTextures = 0;
 	for (int i = 0; i < numTextures; ++i)
 	{
+		if (IsTextureCulled(i))
+			continue;
+
 		uint64_t materialGuid = pOldTextureGuids[i];
 		r5::v8::mstudiotexture_t* newTexture = reinterpret_cast<r5::v8::mstudiotexture_t*>(g_model.pData);
 
@@ -1057,14 +1218,17 @@ static void ConvertTextures_191(const r5::v191::studiohdr_t* pOldHdr, const char
 
 		printf("  texture %d: GUID=0x%016llX\n", i, materialGuid);
 		g_model.pData += sizeof(r5::v8::mstudiotexture_t);
+		numNewTextures++;
 	}
 
+	g_model.hdrV54()->numtextures = numNewTextures;
+
 	// Material shader types - use RGDP for static props
 	ALIGN4(g_model.pData);
 
 	g_model.hdrV54()->materialtypesindex = static_cast<int>(g_model.pData - g_model.pBase);
-	memset(g_model.pData, RGDP, numTextures);
-	g_model.pData += numTextures;
+	memset(g_model.pData, RGDP, numNewTextures);
+	g_model.pData += numNewTextures;
 
 	ALIGN4(g_model.pData);
 
@@ -1087,17 +1251,19 @@ static void ConvertSkins_191(const r5::v191::studiohdr_t* pOldHdr, const char* p
 	const char* pOldSkinData = (const char*)pOldHdr + FIX_OFFSET(pOldHdr->skinindex);
 
 	const int skinIndexDataSize = sizeof(short) * numSkinRef * numSkinFamilies;
-	memcpy(g_model.pData, pOldSkinData, skinIndexDataSize);
-	g_model.pData += skinIndexDataSize;
+
+	std::vector<int> families;
+	g_model.hdrV54()->numskinref = WriteSkinTable(reinterpret_cast<const short*>(pOldSkinData), numSkinRef, numSkinFamilies, GetUsedSkinRefCount(g_model.hdrV54()), families);
+	g_model.hdrV54()->numskinfamilies = static_cast<int>(families.size());
 
 	ALIGN4(g_model.pData);
 
 	// V19.1 stores skin name offsets as uint16_t immediately after skin data (no alignment)
 	const uint16_t* pOldSkinNameOffsets = reinterpret_cast<const uint16_t*>(pOldSkinData + skinIndexDataSize);
 
-	for (int i = 0; i < numSkinFamilies - 1; ++i)
+	for (size_t i = 1; i < families.size(); ++i)
 	{
-		const uint16_t nameOffset = pOldSkinNameOffsets[i];
+		const uint16_t nameOffset = pOldSkinNameOffsets[families[i] - 1];
 		const char* skinName = (const char*)pOldHdr + FIX_OFFSET(nameOffset);
 
 		if (nameOffset > 0 && skinName[0] != '\0' && strlen(skinName) < 256)
@@ -1107,7 +1273,7 @@ static void ConvertSkins_191(const r5::v191::studiohdr_t* pOldHdr, const char* p
 		else
 		{
 			char skinNameBuf[32];
-			sprintf_s(skinNameBuf, 32, "skin%d", i + 1);
+			sprintf_s(skinNameBuf, 32, "skin%d", families[i]);
 			AddToStringTable(g_model.pBase, (int*)g_model.pData, skinNameBuf);
 		}
 		g_model.pData += sizeof(int);
@@ -1203,6 +1369,59 @@ static int ConvertPoseParams_191(const r5::v191::studiohdr_t* pOldHdr, const cha
 	return index;
 }
 
+//
+// GetSequenceDataSize_191
+// Purpose: most bytes ConvertSequences_191 writes after the descriptors for one sequence, alignment padding included
+//
+static size_t GetSequenceDataSize_191(const r5::v191::mstudioseqdesc_t* oldSeq, const int numBones)
+{
+	int numAnims = oldSeq->groupsize[0] * oldSeq->groupsize[1];
+	if (numAnims <= 0)
+		numAnims = 1;
+
+	const size_t flagSize = numBones > 0 ? static_cast<size_t>(((4 * numBones + 7) / 8 + 1) & 0xFFFFFFFE) : 0;
+
+	size_t size = 3 + numAnims * sizeof(int);
+
+	const uint16_t* v19AnimIndices = oldSeq->animindexindex > 0 ? reinterpret_cast<const uint16_t*>((char*)oldSeq + FIX_OFFSET(oldSeq->animindexindex)) : nullptr;
+
+	for (int animIdx = 0; animIdx < numAnims; animIdx++)
+	{
+		size += 3 + sizeof(r5::v8::mstudioanimdesc_t) + 3 + flagSize + 1;
+
+		if (!v19AnimIndices || v19AnimIndices[animIdx] <= 0)
+			continue;
+
+		const r5::v191::mstudioanimdesc_t* oldAnimDesc = reinterpret_cast<const r5::v191::mstudioanimdesc_t*>((char*)oldSeq + FIX_OFFSET(v19AnimIndices[animIdx]));
+
+		if (oldAnimDesc->numikrules > 0 && oldAnimDesc->ikruleindex > 0)
+			size += 3 + oldAnimDesc->numikrules * sizeof(r5::v8::mstudioikrule_t);
+
+		if (oldAnimDesc->sectionindex > 0)
+		{
+			int numSections = 1;
+			if (oldAnimDesc->sectionframes > 0)
+				numSections = ((oldAnimDesc->numframes - oldAnimDesc->sectionstallframes - 1) / oldAnimDesc->sectionframes) + 2;
+
+			size += 1 + max(numSections, 0) * sizeof(r5::v8::mstudioanimsections_t);
+		}
+	}
+
+	if (oldSeq->numautolayers > 0 && oldSeq->autolayerindex > 0)
+		size += 3 + oldSeq->numautolayers * sizeof(r5::v8::mstudioautolayer_t);
+
+	if (oldSeq->numevents > 0 && oldSeq->eventindex > 0)
+		size += 3 + oldSeq->numevents * sizeof(r5::v8::mstudioevent_t);
+
+	if (oldSeq->weightlistindex > 0)
+		size += 3 + max(numBones, 0) * sizeof(float);
+
+	if (oldSeq->posekeyindex > 0)
+		size += 3 + max(oldSeq->groupsize[0] + oldSeq->groupsize[1], 0) * sizeof(float);
+
+	return size;
+}
+
 static void ConvertSequences_191(const r5::v191::studiohdr_t* pOldHdr, const char* pOldData, int numSeqs)
 {
 	g_model.hdrV54()->localseqindex = static_cast<int>(g_model.pData - g_model.pBase);
@@ -1317,8 +1536,12 @@ static void ConvertSequences_191(const r5::v191::studiohdr_t* pOldHdr, const cha
 
 	g_model.pData += numSeqs * sizeof(r5::v8::mstudioseqdesc_t);
 
-	// Write animation data for each sequence
-	for (int i = 0; i < numSeqs; i++)
+	const int numBones = g_model.hdrV54()->numbones;
+
+	// Write animation data for each sequence, each as its own task
+	WriteSections("sequences", reinterpret_cast<char*>(newSeqBase), numSeqs, 4,
+		[&](const size_t i) { return GetSequenceDataSize_191(&pOldSeqs[i], numBones); },
+		[&](const size_t i)
 	{
 		const r5::v191::mstudioseqdesc_t* oldSeq = &pOldSeqs[i];
 		r5::v8::mstudioseqdesc_t* newSeq = &newSeqBase[i];
@@ -1330,7 +1553,7 @@ static void ConvertSequences_191(const r5::v191::studiohdr_t* pOldHdr, const cha
 
 		// Write animation index array (offsets to animation descriptors)
 		ALIGN4(g_model.pData);
-		newSeq->animindexindex = static_cast<int>(g_model.pData - (char*)newSeq);
+		SetSectionOffset(&newSeq->animindexindex, (char*)newSeq, g_model.pData);
 		int* newAnimIndices = reinterpret_cast<int*>(g_model.pData);
 		g_model.pData += numAnims * sizeof(int);
 
@@ -1346,7 +1569,7 @@ static void ConvertSequences_191(const r5::v191::studiohdr_t* pOldHdr, const cha
 		{
 			ALIGN4(g_model.pData);
 			r5::v8::mstudioanimdesc_t* newAnim = reinterpret_cast<r5::v8::mstudioanimdesc_t*>(g_model.pData);
-			newAnimIndices[animIdx] = static_cast<int>((char*)newAnim - (char*)newSeq);
+			SetSectionOffset(&newAnimIndices[animIdx], (char*)newSeq, (char*)newAnim);
 			memset(newAnim, 0, sizeof(r5::v8::mstudioanimdesc_t));
 			g_model.pData += sizeof(r5::v8::mstudioanimdesc_t);
 
@@ -1382,22 +1605,22 @@ static void ConvertSequences_191(const r5::v191::studiohdr_t* pOldHdr, const cha
 				// Track animation GUID if present (v19.1 uses external assets)
 				if (oldAnimDesc->animDataAsset != 0)
 				{
-					printf("    Animation %d ('%s') has external GUID asset: 0x%016llX\n",
+					SectionLog("    Animation %d ('%s') has external GUID asset: 0x%016llX\n",
 						animIdx,
 						oldAnimDesc->sznameindex > 0 ? oldAnimDesc->pszName() : oldSeq->pszLabel(),
 						oldAnimDesc->animDataAsset);
-					printf("      WARNING: External animation data not loaded - placeholder conversion only\n");
+					SectionLog("      WARNING: External animation data not loaded - placeholder conversion only\n");
 					
 					// Check if external section data is loaded at runtime
 					if (oldAnimDesc->sectionDataExternal != nullptr)
 					{
-						printf("      External section data pointer: %p (runtime-loaded)\n", 
+						SectionLog("      External section data pointer: %p (runtime-loaded)\n", 
 							oldAnimDesc->sectionDataExternal);
 					}
 				}
 
 				// Animation section conversion placeholder
-				printf("    WARNING: Animation conversion is PLACEHOLDER - animation sections not fully converted\n");
+				SectionLog("    WARNING: Animation conversion is PLACEHOLDER - animation sections not fully converted\n");
 
 				// Frame movement - v19.1 structure is incompatible, skip
 
@@ -1469,7 +1692,6 @@ static void ConvertSequences_191(const r5::v191::studiohdr_t* pOldHdr, const cha
 				newAnim->animindex = static_cast<int>(g_model.pData - (char*)newAnim);
 
 				// Write minimal bone flags array for STUDIO_ALLZEROS
-				int numBones = g_model.hdrV54()->numbones;
 				if (numBones > 0)
 				{
 					int flagSize = ((4 * numBones + 7) / 8 + 1) & 0xFFFFFFFE;
@@ -1519,7 +1741,6 @@ static void ConvertSequences_191(const r5::v191::studiohdr_t* pOldHdr, const cha
 				ALIGN4(g_model.pData);
 				newAnim->animindex = static_cast<int>(g_model.pData - (char*)newAnim);
 
-				int numBones = g_model.hdrV54()->numbones;
 				if (numBones > 0)
 				{
 					int flagSize = ((4 * numBones + 7) / 8 + 1) & 0xFFFFFFFE;
@@ -1535,7 +1756,7 @@ static void ConvertSequences_191(const r5::v191::studiohdr_t* pOldHdr, const cha
 		if (oldSeq->numautolayers > 0 && oldSeq->autolayerindex > 0)
 		{
 			ALIGN4(g_model.pData);
-			newSeq->autolayerindex = static_cast<int>(g_model.pData - (char*)newSeq);
+			SetSectionOffset(&newSeq->autolayerindex, (char*)newSeq, g_model.pData);
 
 			const r5::v191::mstudioautolayer_t* oldAutoLayers =
 				reinterpret_cast<const r5::v191::mstudioautolayer_t*>(
@@ -1566,12 +1787,12 @@ static void ConvertSequences_191(const r5::v191::studiohdr_t* pOldHdr, const cha
 		if (oldSeq->numevents > 0 && oldSeq->eventindex > 0)
 		{
 			ALIGN4(g_model.pData);
-			newSeq->eventindex = static_cast<int>(g_model.pData - (char*)newSeq);
+			SetSectionOffset(&newSeq->eventindex, (char*)newSeq, g_model.pData);
 			newSeq->numevents = oldSeq->numevents;
 
 			const char* pOldEvents = reinterpret_cast<const char*>(oldSeq) + FIX_OFFSET(oldSeq->eventindex);
 
-			printf("    Converting %d events from v19.1 to v10...\n", oldSeq->numevents);
+			SectionLog("    Converting %d events from v19.1 to v10...\n", oldSeq->numevents);
 
 			for (int e = 0; e < oldSeq->numevents; e++)
 			{
@@ -1608,12 +1829,11 @@ static void ConvertSequences_191(const r5::v191::studiohdr_t* pOldHdr, const cha
 		if (oldSeq->weightlistindex > 0)
 		{
 			ALIGN4(g_model.pData);
-			newSeq->weightlistindex = static_cast<int>(g_model.pData - (char*)newSeq);
+			SetSectionOffset(&newSeq->weightlistindex, (char*)newSeq, g_model.pData);
 
 			const float* oldWeights = reinterpret_cast<const float*>(
 				(char*)oldSeq + FIX_OFFSET(oldSeq->weightlistindex));
 
-			int numBones = g_model.hdrV54()->numbones;
 			memcpy(g_model.pData, oldWeights, numBones * sizeof(float));
 			g_model.pData += numBones * sizeof(float);
 		}
@@ -1629,10 +1849,10 @@ static void ConvertSequences_191(const r5::v191::studiohdr_t* pOldHdr, const cha
 			const char* pOldPosekey = reinterpret_cast<const char*>(oldSeq) + FIX_OFFSET(oldSeq->posekeyindex);
 
 			memcpy(g_model.pData, pOldPosekey, copyCount);
-			newSeq->posekeyindex = static_cast<int>(g_model.pData - reinterpret_cast<const char*>(newSeq));
+			SetSectionOffset(&newSeq->posekeyindex, (char*)newSeq, g_model.pData);
 			g_model.pData += copyCount;
 		}
-	}
+	});
 
 	ALIGN4(g_model.pData);
 }
@@ -1889,6 +2109,10 @@ static void ConvertCollisionData_V191(const r5::v191::studiohdr_t* const oldStud
 		}
 	}
 
+	// the layout is decided here, the data itself is copied in parallel afterwards
+	std::vector<s_sectioncopy_t> copies;
+	copies.reserve(headerCount * 3);
+
 	// Convert each collision header and copy its data
 	for (int i = 0; i < headerCount; ++i)
 	{
@@ -1906,7 +2130,7 @@ static void ConvertCollisionData_V191(const r5::v191::studiohdr_t* const oldStud
 
 		ALIGN64(g_model.pData);
 		newHeader->vertIndex = static_cast<int>(g_model.pData - reinterpret_cast<char*>(pNewCollModel));
-		memcpy_s(g_model.pData, vertSize, vertData, vertSize);
+		copies.push_back({ g_model.pData, reinterpret_cast<const char*>(vertData), static_cast<size_t>(vertSize) });
 		g_model.pData += vertSize;
 
 		// Copy leaf data
@@ -1920,7 +2144,7 @@ static void ConvertCollisionData_V191(const r5::v191::studiohdr_t* const oldStud
 
 		ALIGN64(g_model.pData);
 		newHeader->bvhLeafIndex = static_cast<int>(g_model.pData - reinterpret_cast<char*>(pNewCollModel));
-		memcpy_s(g_model.pData, leafSize, leafData, leafSize);
+		copies.push_back({ g_model.pData, reinterpret_cast<const char*>(leafData), static_cast<size_t>(leafSize) });
 		g_model.pData += leafSize;
 	}
 
@@ -1952,15 +2176,356 @@ static void ConvertCollisionData_V191(const r5::v191::studiohdr_t* const oldStud
 		const void* nodeData = reinterpret_cast<const char*>(pOldCollModel) + oldHeader->nodesOfs;
 		ALIGN64(g_model.pData);
 		newHeader->bvhNodeIndex = static_cast<int>(g_model.pData - reinterpret_cast<char*>(pNewCollModel));
-		memcpy_s(g_model.pData, nodeSize, nodeData, nodeSize);
+		copies.push_back({ g_model.pData, reinterpret_cast<const char*>(nodeData), static_cast<size_t>(nodeSize) });
 		g_model.pData += nodeSize;
 	}
 
+	CopySections(copies);
+
 	size_t totalCollSize = g_model.pData - reinterpret_cast<char*>(pNewCollModel);
 	printf("  Collision converted: V19.1 -> V10, %zu bytes written at offset 0x%X\n",
 		totalCollSize, g_model.hdrV54()->bvhOffset);
 }
 
+//
+// ConvertPHY_191
+// Purpose: write the v10 phy for the model's phy file, returns its size for the rmdl header or 0 without a phy file
+//
+static size_t ConvertPHY_191(const std::string& phyFilePath, const std::string& phyOutPath, const r5::v191::studiohdr_t* oldHeader)
+{
+	if (!FILE_EXISTS(phyFilePath))
+		return 0;
+
+	printf("Found PHY file, converting to v10 format...\n");
+
+	uintmax_t phyInputSize = GetFileSize(phyFilePath);
+	char* phyInputBuf = new char[phyInputSize];
+
+	std::ifstream phyIfs(phyFilePath, std::ios::in | std::ios::binary);
+	phyIfs.read(phyInputBuf, phyInputSize);
+	phyIfs.close();
+
+	// V19.1 PHY format has a compact 4-byte header:
+	//   [0-1]: version (uint16) = 1
+	//   [2-3]: keyValuesOffset (uint16) - offset to text data
+	//
+	// V10 PHY format has a 20-byte IVPS header:
+	//   [0-3]: size (int32) = 20
+	//   [4-7]: id (int32) = 1
+	//   [8-11]: solidCount (int32) = 1
+	//   [12-15]: checkSum (int32) = model checksum
+	//   [16-19]: keyValuesOffset (int32) = v19_offset + 16
+	//
+	// Data after header is identical, just offset by 16 bytes
+
+	// Read v19 header
+	uint16_t v19Version = *reinterpret_cast<uint16_t*>(phyInputBuf);
+	uint16_t v19KeyValuesOffset = *reinterpret_cast<uint16_t*>(phyInputBuf + 2);
+
+	printf("  V19 PHY: version=%d, keyValuesOffset=%d\n", v19Version, v19KeyValuesOffset);
+
+	// Create v10 IVPS header
+	struct IVPSHeader {
+		int32_t size;           // 20
+		int32_t id;             // 1
+		int32_t solidCount;     // 1
+		int32_t checkSum;       // model checksum
+		int32_t keyValuesOffset; // v19_offset + 16
+	};
+
+	IVPSHeader v10Header;
+	v10Header.size = 20;
+	v10Header.id = 1;
+	v10Header.solidCount = 1;
+	v10Header.checkSum = oldHeader->checksum;  // Use model's checksum
+	v10Header.keyValuesOffset = v19KeyValuesOffset + 16;  // Adjust for header size difference
+
+	printf("  V10 PHY: size=%d, id=%d, solidCount=%d, checkSum=0x%08X, keyValuesOffset=%d\n",
+		v10Header.size, v10Header.id, v10Header.solidCount, v10Header.checkSum, v10Header.keyValuesOffset);
+
+	// Calculate output size: 20-byte header + (v19 data - 4-byte v19 header)
+	size_t v10PhySize = sizeof(IVPSHeader) + (phyInputSize - 4);
+
+	// v10 IVPS header, then the v19 data without its 4-byte header
+	std::vector<char> simplifiedPhy;
+	if (g_options.simplifyPhy)
+	{
+		std::vector<char> v10Phy(v10PhySize);
+		memcpy(v10Phy.data(), &v10Header, sizeof(IVPSHeader));
+		memcpy(v10Phy.data() + sizeof(IVPSHeader), phyInputBuf + 4, phyInputSize - 4);
+
+		if (SimplifyPhyHulls(v10Phy.data(), v10Phy.size(), simplifiedPhy))
+			v10PhySize = simplifiedPhy.size();
+		else
+			simplifiedPhy.clear();
+	}
+
+	if (!simplifiedPhy.empty())
+		WriteOutputFile(phyOutPath, simplifiedPhy.data(), simplifiedPhy.size());
+	else
+		WriteOutputFile(phyOutPath, { { reinterpret_cast<char*>(&v10Header), sizeof(IVPSHeader) }, { phyInputBuf + 4, phyInputSize - 4 } });
+
+	delete[] phyInputBuf;
+
+	printf("  PHY converted successfully (v19: %llu bytes -> v10: %zu bytes)\n", phyInputSize, v10PhySize);
+
+	return v10PhySize;
+}
+
+//
+// GetCollisionDataSize_V191
+// Purpose: bytes ConvertCollisionData_V191 writes, alignment padding included
+//
+static size_t GetCollisionDataSize_V191(const r5::v191::studiohdr_t* const oldStudioHdr, const char* const pOldBVHData, const size_t fileSize)
+{
+	const r5::v8::mstudiocollmodel_t* const pOldCollModel = reinterpret_cast<const r5::v8::mstudiocollmodel_t*>(pOldBVHData);
+	const r5::v191::mstudiocollheader_t* const pOldCollHeaders = reinterpret_cast<const r5::v191::mstudiocollheader_t*>(pOldBVHData + sizeof(r5::v8::mstudiocollmodel_t));
+	const int headerCount = pOldCollModel->headerCount;
+
+	// surface props, content masks and surface names are copied as one run
+	__int64 size = sizeof(r5::v8::mstudiocollmodel_t) + headerCount * sizeof(r5::v8::mstudiocollheader_t);
+	size += pOldCollHeaders[0].vertsOfs - pOldCollModel->surfacePropsIndex;
+
+	for (int i = 0; i < headerCount; ++i)
+	{
+		const r5::v191::mstudiocollheader_t* const oldHeader = &pOldCollHeaders[i];
+		const __int64 leafEnd = i != headerCount - 1 ? pOldCollHeaders[i + 1].vertsOfs : pOldCollHeaders[0].nodesOfs;
+
+		size += 63 + (oldHeader->leafDataOfs - oldHeader->vertsOfs);
+		size += 63 + (leafEnd - oldHeader->leafDataOfs);
+	}
+
+	for (int i = 0; i < headerCount; ++i)
+	{
+		const r5::v191::mstudiocollheader_t* const oldHeader = &pOldCollHeaders[i];
+
+		__int64 nodeSize;
+		if (i != headerCount - 1)
+		{
+			nodeSize = pOldCollHeaders[i + 1].nodesOfs - oldHeader->nodesOfs;
+		}
+		else
+		{
+			const size_t collisionOffset = pOldBVHData - reinterpret_cast<const char*>(oldStudioHdr);
+			nodeSize = fileSize - collisionOffset - oldHeader->nodesOfs;
+
+			if (nodeSize > 1024 * 1024)
+				nodeSize = 1024 * 1024;
+		}
+
+		size += 63 + nodeSize;
+	}
+
+	return static_cast<size_t>(size);
+}
+
+//
+// CalcModelSize_191
+// Purpose: most bytes ConvertRMDL191To10 writes into the model image, summed from the v19.1 headers before anything is written
+//
+static size_t CalcModelSize_191(const r5::v191::studiohdr_t* const pOldHdr, const size_t fileSize, const std::string& modelName)
+{
+	s_modelsize_t size;
+
+	const int numBones = pOldHdr->boneCount;
+
+	size.Add(sizeof(r5::v8::studiohdr_t));
+	size.AddString(modelName.c_str());
+	size.AddString((const char*)pOldHdr + FIX_OFFSET(pOldHdr->surfacepropindex));
+	size.AddString("");
+
+	// bones, then at most every bone as a jiggle bone with the two proc bone tables
+	size.Add(numBones * sizeof(r5::v8::mstudiobone_t), 4);
+	size.Add(numBones * sizeof(r5::v8::mstudiojigglebone_t), 4);
+	size.Add(256 + numBones, 4);
+
+	for (int i = 0; i < numBones; ++i)
+	{
+		const r5::v191::mstudiobonehdr_t* const oldBoneHdr = r5::v191::GetBoneHdr(pOldHdr, i);
+
+		size.AddString(oldBoneHdr->pszName());
+		size.AddString((char*)oldBoneHdr + FIX_OFFSET(oldBoneHdr->surfacepropidx));
+	}
+
+	// attachments
+	const r5::v191::mstudioattachment_t* const pOldAttachments = reinterpret_cast<const r5::v191::mstudioattachment_t*>((const char*)pOldHdr + FIX_OFFSET(pOldHdr->localattachmentindex));
+
+	size.Add(pOldHdr->numlocalattachments * sizeof(r5::v8::mstudioattachment_t), 4);
+
+	for (int i = 0; i < pOldHdr->numlocalattachments; ++i)
+		size.AddString(pOldAttachments[i].pszName());
+
+	// hitbox sets and hitboxes, before any are merged away
+	const r5::v191::mstudiohitboxset_t* const pOldHitboxSets = reinterpret_cast<const r5::v191::mstudiohitboxset_t*>((const char*)pOldHdr + FIX_OFFSET(pOldHdr->hitboxsetindex));
+
+	size.Add(pOldHdr->numhitboxsets * sizeof(mstudiohitboxset_t), 4);
+
+	for (int i = 0; i < pOldHdr->numhitboxsets; ++i)
+	{
+		const r5::v191::mstudiohitboxset_t* const oldhboxset = &pOldHitboxSets[i];
+
+		size.Add(oldhboxset->numhitboxes * sizeof(r5::v8::mstudiobbox_t));
+		size.AddString(oldhboxset->pszName());
+
+		for (int j = 0; j < oldhboxset->numhitboxes; ++j)
+		{
+			const r5::v191::mstudiobbox_t* const oldHitbox = oldhboxset->pHitbox(j);
+
+			size.AddString(oldHitbox->pszHitboxName());
+			size.AddString((char*)oldHitbox + FIX_OFFSET(oldHitbox->hitdataGroupOffset));
+		}
+	}
+
+	// bone name table
+	size.Add(numBones, 4);
+
+	// sequences, their data goes through WriteSections with a start alignment of 4
+	const r5::v191::mstudioseqdesc_t* const pOldSeqs = reinterpret_cast<const r5::v191::mstudioseqdesc_t*>((const char*)pOldHdr + FIX_OFFSET(pOldHdr->localseqindex));
+
+	size.Add(pOldHdr->numlocalseq * sizeof(r5::v8::mstudioseqdesc_t), 4);
+
+	for (int i = 0; i < pOldHdr->numlocalseq; i++)
+	{
+		const r5::v191::mstudioseqdesc_t* const oldSeq = &pOldSeqs[i];
+
+		size.Add(GetSequenceDataSize_191(oldSeq, numBones), 4);
+		size.AddString(oldSeq->pszLabel());
+
+		if (oldSeq->szactivitynameindex > 0)
+			size.AddString(oldSeq->pszActivity());
+
+		const int numAnims = max(oldSeq->groupsize[0] * oldSeq->groupsize[1], 1);
+		const uint16_t* const v19AnimIndices = oldSeq->animindexindex > 0 ? reinterpret_cast<const uint16_t*>((char*)oldSeq + FIX_OFFSET(oldSeq->animindexindex)) : nullptr;
+
+		for (int animIdx = 0; animIdx < numAnims; animIdx++)
+		{
+			if (!v19AnimIndices || v19AnimIndices[animIdx] <= 0)
+			{
+				size.AddString(oldSeq->pszLabel());
+				continue;
+			}
+
+			const r5::v191::mstudioanimdesc_t* const oldAnimDesc = reinterpret_cast<const r5::v191::mstudioanimdesc_t*>((char*)oldSeq + FIX_OFFSET(v19AnimIndices[animIdx]));
+			size.AddString(oldAnimDesc->sznameindex > 0 ? oldAnimDesc->pszName() : oldSeq->pszLabel());
+
+			if (oldAnimDesc->numikrules <= 0 || oldAnimDesc->ikruleindex <= 0)
+				continue;
+
+			const r5::v191::mstudioikrule_t* const oldIKRules = reinterpret_cast<const r5::v191::mstudioikrule_t*>((char*)oldAnimDesc + FIX_OFFSET(oldAnimDesc->ikruleindex));
+
+			for (int ikIdx = 0; ikIdx < oldAnimDesc->numikrules; ikIdx++)
+			{
+				if (oldIKRules[ikIdx].szattachmentindex > 0)
+					size.AddString((char*)&oldIKRules[ikIdx] + FIX_OFFSET(oldIKRules[ikIdx].szattachmentindex));
+			}
+		}
+
+		if (oldSeq->numevents > 0 && oldSeq->eventindex > 0)
+		{
+			const r5::v191::mstudioevent_t* const pOldEvents = reinterpret_cast<const r5::v191::mstudioevent_t*>((char*)oldSeq + FIX_OFFSET(oldSeq->eventindex));
+
+			for (int e = 0; e < oldSeq->numevents; e++)
+			{
+				if (pOldEvents[e].szeventindex > 0)
+					size.AddString((char*)&pOldEvents[e] + FIX_OFFSET(pOldEvents[e].szeventindex));
+			}
+		}
+	}
+
+	size.Add(0, 4);
+
+	// bodyparts, their models and meshes go through WriteSections
+	size.Add(pOldHdr->numbodyparts * sizeof(mstudiobodyparts_t));
+
+	for (int i = 0; i < pOldHdr->numbodyparts; ++i)
+	{
+		size.Add(GetBodyPartDataSize_191(pOldHdr->pBodypart(i)));
+		size.AddString(pOldHdr->pBodypart(i)->pszName());
+	}
+
+	size.Add(0, 4);
+
+	// pose parameters
+	const r5::v191::mstudioposeparamdesc_t* const pOldParams = reinterpret_cast<const r5::v191::mstudioposeparamdesc_t*>((const char*)pOldHdr + FIX_OFFSET(pOldHdr->localposeparamindex));
+
+	size.Add(pOldHdr->numlocalposeparameters * sizeof(mstudioposeparamdesc_t), 4);
+
+	for (int i = 0; i < pOldHdr->numlocalposeparameters; i++)
+		size.AddString(pOldParams[i].pszName());
+
+	// ik chains and their links
+	const r5::v191::mstudioikchain_t* const pOldChains = reinterpret_cast<const r5::v191::mstudioikchain_t*>((const char*)pOldHdr + FIX_OFFSET(pOldHdr->ikchainindex));
+
+	size.Add(pOldHdr->numikchains * sizeof(r5::v8::mstudioikchain_t), 4);
+
+	for (int i = 0; i < pOldHdr->numikchains; i++)
+	{
+		size.Add(pOldChains[i].numlinks * sizeof(r5::v8::mstudioiklink_t));
+		size.AddString(pOldChains[i].pszName());
+	}
+
+	// textures, their shader types and the cdtexture, before any are culled
+	size.Add(pOldHdr->numtextures * sizeof(r5::v8::mstudiotexture_t), 4);
+	size.Add(pOldHdr->numtextures, 4);
+	size.Add(sizeof(int));
+
+	for (int i = 0; i < pOldHdr->numtextures; ++i)
+		size.AddString("dev/empty");
+
+	size.AddString("");
+
+	// skins, before they are compacted. a skin name is either under 256 characters or made up as "skin%d"
+	const int numSkinFamilies = max(pOldHdr->numskinfamilies, 0);
+
+	size.Add(sizeof(short) * pOldHdr->numskinref * numSkinFamilies, 4);
+	size.Add(max(numSkinFamilies - 1, 0) * (sizeof(int) + 256), 4);
+
+	// ui panel meshes, the headers are copied as they are and their meshes aligned to 16
+	if (pOldHdr->uiPanelCount > 0)
+	{
+		const char* const pOldUIPanelData = reinterpret_cast<const char*>(pOldHdr) + pOldHdr->uiPanelOffset;
+
+		size.Add(pOldHdr->uiPanelCount * sizeof(r5::v8::mstudiorruiheader_t), 16);
+
+		for (int i = 0; i < pOldHdr->uiPanelCount; i++)
+		{
+			const r5::v8::mstudiorruiheader_t* const ruiHeader = reinterpret_cast<const r5::v8::mstudiorruiheader_t*>(pOldUIPanelData) + i;
+			const r5::v8::mstudioruimesh_t* const pOldMeshHdr = reinterpret_cast<const r5::v8::mstudioruimesh_t*>(reinterpret_cast<const char*>(ruiHeader) + ruiHeader->ruimeshindex);
+
+			size.Add(sizeof(r5::v8::mstudioruimesh_t) + pOldMeshHdr->parentindex + pOldMeshHdr->numparents * sizeof(short));
+			size.Add(pOldMeshHdr->numfaces * (sizeof(r5::v8::mstudioruivertmap_t) + sizeof(r5::v8::mstudioruifourthvert_t) + sizeof(r5::v8::mstudioruimeshface_t)));
+			size.Add(pOldMeshHdr->numvertices * sizeof(r5::v8::mstudioruivert_t));
+		}
+
+		size.Add(0, 4);
+	}
+
+	// keyvalues
+	size.Add(sizeof(s_szModelKeyValues), 4);
+
+	// linear bone table
+	if (pOldHdr->linearboneindex != 0 && numBones > 1)
+	{
+		size.Add(sizeof(r5::v8::mstudiolinearbone_t));
+		size.Add(numBones * (sizeof(int) * 2 + sizeof(Vector) + sizeof(Quaternion) + sizeof(RadianEuler) + sizeof(matrix3x4_t)) + 7 * 3);
+	}
+
+	// string table, the empty string the table starts with included
+	size.AddString("");
+	size.Add(0, 64);
+
+	if (pOldHdr->bvhOffset > 0)
+	{
+		const char* const pOldCollision = reinterpret_cast<const char*>(pOldHdr) + FIX_OFFSET(pOldHdr->bvhOffset);
+		const int headerCount = reinterpret_cast<const r5::v8::mstudiocollmodel_t*>(pOldCollision)->headerCount;
+
+		if (headerCount > 0 && headerCount < 100)
+			size.Add(GetCollisionDataSize_V191(pOldHdr, pOldCollision, fileSize));
+	}
+
+	return size.size;
+}
+
 //
 // ConvertRMDL191To10
 void ConvertRMDL191To10(char* pMDL, const size_t fileSize, const std::string& pathIn, const std::string& pathOut)
@@ -2014,20 +2579,6 @@ void ConvertRMDL191To10(char* pMDL, const size_t fileSize, const std::string& pa
 	}
 
 	printf("Output: %s\n", rmdlPath.c_str());
-	std::ofstream out(rmdlPath, std::ios::out | std::ios::binary);
-
-	// Allocate temp file buffer
-	g_model.pBase = new char[FILEBUFSIZE]{};
-	g_model.pData = g_model.pBase;
-
-	// Convert mdl header
-	r5::v8::studiohdr_t* pHdr = reinterpret_cast<r5::v8::studiohdr_t*>(g_model.pData);
-	ConvertStudioHdr_191(pHdr, oldHeader, pMDL);
-	g_model.pHdr = pHdr;
-	g_model.pData += sizeof(r5::v8::studiohdr_t);
-
-	// Init string table
-	BeginStringTable();
 
 	// v19.1 stores a truncated name in the inline name[33] field (max 32 chars + null)
 	// Use the input filename to get the full model name since inline name is often truncated
@@ -2047,6 +2598,20 @@ void ConvertRMDL191To10(char* pMDL, const size_t fileSize, const std::string& pa
 		modelName += ".rmdl";
 	}
 
+	// Allocate the model image at the size planned from the v19.1 headers
+	const size_t modelSize = CalcModelSize_191(oldHeader, fileSize, modelName);
+	g_model.pBase = new char[modelSize]{};
+	g_model.pData = g_model.pBase;
+
+	// Convert mdl header
+	r5::v8::studiohdr_t* pHdr = reinterpret_cast<r5::v8::studiohdr_t*>(g_model.pData);
+	ConvertStudioHdr_191(pHdr, oldHeader, pMDL);
+	g_model.pHdr = pHdr;
+	g_model.pData += sizeof(r5::v8::studiohdr_t);
+
+	// Init string table
+	BeginStringTable();
+
 	memcpy_s(&pHdr->name, 64, modelName.c_str(), min(modelName.length(), 64));
 	AddToStringTable((char*)pHdr, &pHdr->sznameindex, modelName.c_str());
 
@@ -2064,15 +2629,9 @@ void ConvertRMDL191To10(char* pMDL, const size_t fileSize, const std::string& pa
 	// Convert hitboxsets and hitboxes
 	ConvertHitboxes_191(oldHeader, pMDL, oldHeader->numhitboxsets);
 
-	// Copy bonebyname table
-	if (oldHeader->bonetablebynameindex > 0)
-	{
-		const char* pOldBoneTable = (const char*)oldHeader + FIX_OFFSET(oldHeader->bonetablebynameindex);
-		memcpy(g_model.pData, pOldBoneTable, oldHeader->boneCount);
-		g_model.hdrV54()->bonetablebynameindex = static_cast<int>(g_model.pData - g_model.pBase);
-		g_model.pData += oldHeader->boneCount;
-		ALIGN4(g_model.pData);
-	}
+	// Regenerate bonebyname table
+	const unsigned char* const pOldBoneTable = oldHeader->bonetablebynameindex > 0 ? reinterpret_cast<const unsigned char*>(oldHeader) + FIX_OFFSET(oldHeader->bonetablebynameindex) : nullptr;
+	WriteBoneTableByName<r5::v8::mstudiobone_t>(g_model.hdrV54(), pOldBoneTable);
 
 	// Convert sequences and animations
 	ConvertSequences_191(oldHeader, pMDL, oldHeader->numlocalseq);
@@ -2086,6 +2645,9 @@ void ConvertRMDL191To10(char* pMDL, const size_t fileSize, const std::string& pa
 	// Convert IK chains
 	ConvertIkChains_191(oldHeader, pMDL, oldHeader->numikchains, false);
 
+	// find the textures no mesh can reach before they are written
+	BuildTextureRemap(reinterpret_cast<const short*>((const char*)oldHeader + FIX_OFFSET(oldHeader->skinindex)), oldHeader->numskinref, oldHeader->numskinfamilies, oldHeader->numtextures);
+
 	// Convert textures
 	ConvertTextures_191(oldHeader, pMDL, oldHeader->numtextures);
 
@@ -2096,7 +2658,7 @@ void ConvertRMDL191To10(char* pMDL, const size_t fileSize, const std::string& pa
 	ConvertUIPanelMeshes_191(oldHeader);
 
 	// Write keyvalues
-	std::string keyValues = "mdlkeyvalue{prop_data{base \"\"}}\n";
+	std::string keyValues = s_szModelKeyValues;
 	strcpy_s(g_model.pData, keyValues.length() + 1, keyValues.c_str());
 	pHdr->keyvalueindex = static_cast<int>(g_model.pData - g_model.pBase);
 	pHdr->keyvaluesize = IALIGN2(static_cast<int>(keyValues.length() + 1));
@@ -2106,6 +2668,9 @@ void ConvertRMDL191To10(char* pMDL, const size_t fileSize, const std::string& pa
 	// Convert linear bone table
 	ConvertLinearBoneTable_191(oldHeader);
 
+	// Remap bones if the VG below gets converted, a copied VG would keep the old bone states
+	RemapBones_V54(CanRemapVGBones(ChangeExtension(pathIn, "vg"), true));
+
 	// Write string table
 	g_model.pData = WriteStringTable(g_model.pData);
 	ALIGN64(g_model.pData);
@@ -2140,91 +2705,14 @@ void ConvertRMDL191To10(char* pMDL, const size_t fileSize, const std::string& pa
 		pHdr->bvhOffset = 0;
 	}
 
-	pHdr->length = static_cast<int>(g_model.pData - g_model.pBase);
-
-	out.write(g_model.pBase, pHdr->length);
-	delete[] g_model.pBase;
-
-	// RRIG generation disabled - not needed for converted models
-	// The game loads animation data from external .rseq files via RPak
-#if 0
-	///////////////
-	// ANIM RIGS //
-	///////////////
-
-	std::string rigName = originalModelName;
-	if (rigName.rfind("animrig/", 0) != 0)
-		rigName = "animrig/" + rigName;
-	if (EndsWith(rigName, ".mdl"))
-	{
-		rigName = rigName.substr(0, rigName.length() - 4);
-		rigName += ".rrig";
-	}
-
-	printf("Creating rig from model...\n");
-
-	std::string rrigPath = baseOutputPath + ".rrig";
-	std::ofstream rigOut(rrigPath, std::ios::out | std::ios::binary);
-
-	g_model.pBase = new char[FILEBUFSIZE]{};
-	g_model.pData = g_model.pBase;
-
-	// Generate rig header
-	pHdr = reinterpret_cast<r5::v8::studiohdr_t*>(g_model.pData);
-	GenerateRigHdr_191(pHdr, oldHeader);
-	g_model.pHdr = pHdr;
-	g_model.pData += sizeof(r5::v8::studiohdr_t);
-
-	// Reset string table for rig
-	BeginStringTable();
-
-	memcpy_s(&pHdr->name, 64, rigName.c_str(), min(rigName.length(), 64));
-	AddToStringTable((char*)pHdr, &pHdr->sznameindex, rigName.c_str());
-	AddToStringTable((char*)pHdr, &pHdr->surfacepropindex, surfaceProp);
-	AddToStringTable((char*)pHdr, &pHdr->unkStringOffset, "");
-
-	// Convert bones for rig
-	ConvertBones_191(oldHeader, pMDL, oldHeader->boneCount, true);
-
-	// Convert attachments for rig
-	g_model.hdrV54()->localattachmentindex = ConvertAttachments_191(oldHeader, pMDL, oldHeader->numlocalattachments);
-
-	// Convert hitboxsets for rig
-	ConvertHitboxes_191(oldHeader, pMDL, oldHeader->numhitboxsets);
-
-	// Copy bonebyname table
-	if (oldHeader->bonetablebynameindex > 0)
-	{
-		const char* pOldBoneTable = (const char*)oldHeader + FIX_OFFSET(oldHeader->bonetablebynameindex);
-		memcpy(g_model.pData, pOldBoneTable, oldHeader->boneCount);
-		g_model.hdrV54()->bonetablebynameindex = static_cast<int>(g_model.pData - g_model.pBase);
-		g_model.pData += oldHeader->boneCount;
-		ALIGN4(g_model.pData);
-	}
-
-	// Convert pose parameters for rig
-	g_model.hdrV54()->localposeparamindex = ConvertPoseParams_191(oldHeader, pMDL, oldHeader->numlocalposeparameters, true);
-
-	// Convert IK chains for rig
-	ConvertIkChains_191(oldHeader, pMDL, oldHeader->numikchains, true);
-	ALIGN4(g_model.pData);
-
-	g_model.pData = WriteStringTable(g_model.pData);
-
-	pHdr->length = static_cast<int>(g_model.pData - g_model.pBase);
-
-	rigOut.write(g_model.pBase, pHdr->length);
-
-	delete[] g_model.pBase;
-
-	g_model.stringTable.clear();
-#endif
+	// the phy goes first so the rmdl is written once, with the phy's size in its header
+	pHdr->phySize = static_cast<int>(ConvertPHY_191(ChangeExtension(pathIn, "phy"), baseOutputPath + ".phy", oldHeader));
 
 	///////////////
 	// VG FILE   //
 	///////////////
 
-	// Check for VG file alongside the RMDL
+	// Check for VG file alongside the RMDL, converted before the rmdl is written so -tightbounds can bound it from the vg's vertices
 	std::string vgFilePath = ChangeExtension(pathIn, "vg");
 	std::string vgOutPath = baseOutputPath + ".vg";
 
@@ -2251,9 +2739,7 @@ void ConvertRMDL191To10(char* pMDL, const size_t fileSize, const std::string& pa
 		{
 			// Already v8/v9 format - copy as-is
 			printf("VG file appears to be v8/v9 format, copying as-is...\n");
-			std::ofstream vgOut(vgOutPath, std::ios::out | std::ios::binary);
-			vgOut.write(vgInputBuf, vgInputSize);
-			vgOut.close();
+			WriteOutputFile(vgOutPath, vgInputBuf, vgInputSize);
 			delete[] vgInputBuf;
 		}
 		else
@@ -2273,9 +2759,7 @@ void ConvertRMDL191To10(char* pMDL, const size_t fileSize, const std::string& pa
 			{
 				// Unknown format - try to copy anyway
 				printf("WARNING: VG file has unknown magic 0x%08X, copying as-is...\n", vgMagic);
-				std::ofstream vgOut(vgOutPath, std::ios::out | std::ios::binary);
-				vgOut.write(vgInputBuf, vgInputSize);
-				vgOut.close();
+				WriteOutputFile(vgOutPath, vgInputBuf, vgInputSize);
 				delete[] vgInputBuf;
 			}
 		}
@@ -2287,95 +2771,80 @@ void ConvertRMDL191To10(char* pMDL, const size_t fileSize, const std::string& pa
 		printf("         You may need to extract the VG data separately using Legion or similar tools.\n");
 	}
 
+	CheckModelSize(modelSize);
+
+	pHdr->length = static_cast<int>(g_model.pData - g_model.pBase);
+
+	WriteOutputFile(rmdlPath, g_model.pBase, pHdr->length);
+	delete[] g_model.pBase;
+
+	// RRIG generation disabled - not needed for converted models
+	// The game loads animation data from external .rseq files via RPak
+#if 0
 	///////////////
-	// PHY FILE  //
+	// ANIM RIGS //
 	///////////////
 
-	// Check for PHY file alongside the RMDL and convert to v10 format
-	std::string phyFilePath = ChangeExtension(pathIn, "phy");
-	std::string phyOutPath = baseOutputPath + ".phy";
-
-	if (FILE_EXISTS(phyFilePath))
+	std::string rigName = originalModelName;
+	if (rigName.rfind("animrig/", 0) != 0)
+		rigName = "animrig/" + rigName;
+	if (EndsWith(rigName, ".mdl"))
 	{
-		printf("Found PHY file, converting to v10 format...\n");
+		rigName = rigName.substr(0, rigName.length() - 4);
+		rigName += ".rrig";
+	}
 
-		uintmax_t phyInputSize = GetFileSize(phyFilePath);
-		char* phyInputBuf = new char[phyInputSize];
+	printf("Creating rig from model...\n");
+
+	std::string rrigPath = baseOutputPath + ".rrig";
 
-		std::ifstream phyIfs(phyFilePath, std::ios::in | std::ios::binary);
-		phyIfs.read(phyInputBuf, phyInputSize);
-		phyIfs.close();
+	g_model.pBase = new char[FILEBUFSIZE]{};
+	g_model.pData = g_model.pBase;
+
+	// Generate rig header
+	pHdr = reinterpret_cast<r5::v8::studiohdr_t*>(g_model.pData);
+	GenerateRigHdr_191(pHdr, oldHeader);
+	g_model.pHdr = pHdr;
+	g_model.pData += sizeof(r5::v8::studiohdr_t);
+
+	// Reset string table for rig
+	BeginStringTable();
 
-		// V19.1 PHY format has a compact 4-byte header:
-		//   [0-1]: version (uint16) = 1
-		//   [2-3]: keyValuesOffset (uint16) - offset to text data
-		//
-		// V10 PHY format has a 20-byte IVPS header:
-		//   [0-3]: size (int32) = 20
-		//   [4-7]: id (int32) = 1
-		//   [8-11]: solidCount (int32) = 1
-		//   [12-15]: checkSum (int32) = model checksum
-		//   [16-19]: keyValuesOffset (int32) = v19_offset + 16
-		//
-		// Data after header is identical, just offset by 16 bytes
+	memcpy_s(&pHdr->name, 64, rigName.c_str(), min(rigName.length(), 64));
+	AddToStringTable((char*)pHdr, &pHdr->sznameindex, rigName.c_str());
+	AddToStringTable((char*)pHdr, &pHdr->surfacepropindex, surfaceProp);
+	AddToStringTable((char*)pHdr, &pHdr->unkStringOffset, "");
 
-		// Read v19 header
-		uint16_t v19Version = *reinterpret_cast<uint16_t*>(phyInputBuf);
-		uint16_t v19KeyValuesOffset = *reinterpret_cast<uint16_t*>(phyInputBuf + 2);
+	// Convert bones for rig
+	ConvertBones_191(oldHeader, pMDL, oldHeader->boneCount, true);
 
-		printf("  V19 PHY: version=%d, keyValuesOffset=%d\n", v19Version, v19KeyValuesOffset);
+	// Convert attachments for rig
+	g_model.hdrV54()->localattachmentindex = ConvertAttachments_191(oldHeader, pMDL, oldHeader->numlocalattachments);
 
-		// Create v10 IVPS header
-		struct IVPSHeader {
-			int32_t size;           // 20
-			int32_t id;             // 1
-			int32_t solidCount;     // 1
-			int32_t checkSum;       // model checksum
-			int32_t keyValuesOffset; // v19_offset + 16
-		};
+	// Convert hitboxsets for rig
+	ConvertHitboxes_191(oldHeader, pMDL, oldHeader->numhitboxsets);
 
-		IVPSHeader v10Header;
-		v10Header.size = 20;
-		v10Header.id = 1;
-		v10Header.solidCount = 1;
-		v10Header.checkSum = oldHeader->checksum;  // Use model's checksum
-		v10Header.keyValuesOffset = v19KeyValuesOffset + 16;  // Adjust for header size difference
+	// Regenerate bonebyname table
+	const unsigned char* const pOldBoneTable = oldHeader->bonetablebynameindex > 0 ? reinterpret_cast<const unsigned char*>(oldHeader) + FIX_OFFSET(oldHeader->bonetablebynameindex) : nullptr;
+	WriteBoneTableByName<r5::v8::mstudiobone_t>(g_model.hdrV54(), pOldBoneTable);
 
-		printf("  V10 PHY: size=%d, id=%d, solidCount=%d, checkSum=0x%08X, keyValuesOffset=%d\n",
-			v10Header.size, v10Header.id, v10Header.solidCount, v10Header.checkSum, v10Header.keyValuesOffset);
+	// Convert pose parameters for rig
+	g_model.hdrV54()->localposeparamindex = ConvertPoseParams_191(oldHeader, pMDL, oldHeader->numlocalposeparameters, true);
 
-		// Calculate output size: 20-byte header + (v19 data - 4-byte v19 header)
-		size_t v10PhySize = sizeof(IVPSHeader) + (phyInputSize - 4);
+	// Convert IK chains for rig
+	ConvertIkChains_191(oldHeader, pMDL, oldHeader->numikchains, true);
+	ALIGN4(g_model.pData);
 
-		std::ofstream phyOut(phyOutPath, std::ios::out | std::ios::binary);
+	g_model.pData = WriteStringTable(g_model.pData);
 
-		// Write v10 IVPS header
-		phyOut.write(reinterpret_cast<char*>(&v10Header), sizeof(IVPSHeader));
+	pHdr->length = static_cast<int>(g_model.pData - g_model.pBase);
 
-		// Copy v19 data (skip the 4-byte v19 header)
-		phyOut.write(phyInputBuf + 4, phyInputSize - 4);
+	WriteOutputFile(rrigPath, g_model.pBase, pHdr->length);
 
-		phyOut.close();
-		delete[] phyInputBuf;
+	delete[] g_model.pBase;
 
-		// Update phySize in the rmdl header
-		std::fstream rmdlUpdate(rmdlPath, std::ios::in | std::ios::out | std::ios::binary);
-		if (rmdlUpdate.is_open())
-		{
-			// Seek to phySize offset in studiohdr_t and write the size
-			size_t phySizeOffset = offsetof(r5::v8::studiohdr_t, phySize);
-			int phySizeValue = static_cast<int>(v10PhySize);
-			rmdlUpdate.seekp(phySizeOffset);
-			rmdlUpdate.write(reinterpret_cast<char*>(&phySizeValue), sizeof(int));
-			rmdlUpdate.close();
-			printf("  PHY converted successfully (v19: %llu bytes -> v10: %zu bytes)\n",
-				phyInputSize, v10PhySize);
-		}
-		else
-		{
-			printf("  PHY converted but could not update phySize in header.\n");
-		}
-	}
+	g_model.stringTable.clear();
+#endif
 
 	printf("Finished converting model '%s', proceeding...\n\n", rawModelName.c_str());
 }
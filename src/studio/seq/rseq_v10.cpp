@@ -59,7 +59,6 @@ void ConvertRSEQFrom10To7(char* buf, char* externalbuf, const std::string& fileP
 	r5::v8::mstudioseqdesc_t* oldSeqDesc = input.get<r5::v8::mstudioseqdesc_t>();
 
 	std::string newSeqPath = ChangeExtension(filePath, "rseq_conv");
-	std::ofstream out(newSeqPath, std::ios::out | std::ios::binary);
 
 	int numBones = (oldSeqDesc->activitymodifierindex - oldSeqDesc->weightlistindex) / 4;
 
@@ -120,7 +119,7 @@ void ConvertRSEQFrom10To7(char* buf, char* externalbuf, const std::string& fileP
 	g_model.pData = WriteStringTable(g_model.pData);
 	ALIGN4(g_model.pData);
 
-	out.write(g_model.pBase, g_model.pData - g_model.pBase);
+	WriteOutputFile(newSeqPath, g_model.pBase, g_model.pData - g_model.pBase);
 
 	delete[] g_model.pBase;
 
@@ -2,6 +2,7 @@
 // See LICENSE.txt for licensing information (GPL v3)
 
 #include <pch.h>
+#include <cfloat>
 #include <studio/studio.h>
 #include <studio/versions.h>
 
@@ -219,7 +220,7 @@ void CVertexHardwareDataFile_V1::SetupBoneStateFromDiskFile(vvd::vertexFileHeade
 		{
 			if (boneIdx < 3 && !boneMap.count(pVvdWeight->bone[boneIdx]))
 			{
-				boneMap.insert(std::pair<unsigned char, unsigned char>(pVvdWeight->bone[boneIdx], boneStates.size()));
+				boneMap.emplace(pVvdWeight->bone[boneIdx], static_cast<unsigned char>(boneStates.size()));
 				boneStates.push_back(pVvdWeight->bone[boneIdx]);
 			}
 			else if (boneIdx >= 3) // don't try to read extended weights if below this amount, will cause issues
@@ -235,7 +236,7 @@ void CVertexHardwareDataFile_V1::SetupBoneStateFromDiskFile(vvd::vertexFileHeade
 
 				if (!boneMap.count(boneId))
 				{
-					boneMap.insert(std::pair<uint8_t, uint8_t>(boneId, boneStates.size()));
+					boneMap.emplace(boneId, static_cast<unsigned char>(boneStates.size()));
 					boneStates.push_back(boneId);
 				}
 			}
@@ -243,23 +244,3071 @@ void CVertexHardwareDataFile_V1::SetupBoneStateFromDiskFile(vvd::vertexFileHeade
 	}
 }
 
+// max influences a single vertex can carry, packed bone count is 4 bits
+#define MAX_VERT_INFLUENCES 16
+
+struct vertexinfluence_t
+{
+	float weight;
+	short bone;
+};
+
+//
+// PruneInfluences
+// Purpose: drop influences below the prune threshold and cap them to MAX_PRUNED_BONES_PER_VERT, the heaviest influence is always kept.
+//			weights that remain are renormalized, returns the new influence count
+//
+static int PruneInfluences(vertexinfluence_t* pInfluences, const int count, s_weightprunestats_t& stats)
+{
+	const float threshold = g_options.pruneWeightThreshold;
+
+	stats.numVertices++;
+
+	if (count > 2)
+		stats.extraWeightsIn += count - 2;
+
+	bool needsPrune = count > MAX_PRUNED_BONES_PER_VERT;
+	for (int i = 0; i < count && count > 1 && !needsPrune; i++)
+	{
+		if (pInfluences[i].weight < threshold)
+			needsPrune = true;
+	}
+
+	if (!needsPrune)
+	{
+		if (count > 2)
+			stats.extraWeightsOut += count - 2;
+
+		return count;
+	}
+
+	std::stable_sort(pInfluences, pInfluences + count, [](const vertexinfluence_t& a, const vertexinfluence_t& b) { return a.weight > b.weight; });
+
+	int newCount = 1;
+	while (newCount < count && newCount < MAX_PRUNED_BONES_PER_VERT && pInfluences[newCount].weight >= threshold)
+		newCount++;
+
+	float sum = 0.0f;
+	for (int i = 0; i < newCount; i++)
+		sum += pInfluences[i].weight;
+
+	// error is how much weight moved, dropped influences lose all of theirs
+	float error = 0.0f;
+	for (int i = 0; i < count; i++)
+	{
+		if (i >= newCount)
+		{
+			error += pInfluences[i].weight;
+			continue;
+		}
+
+		const float weight = sum > 0.0f ? pInfluences[i].weight / sum : 1.0f / newCount;
+
+		error += fabsf(weight - pInfluences[i].weight);
+		pInfluences[i].weight = weight;
+	}
+
+	if (newCount > 2)
+		stats.extraWeightsOut += newCount - 2;
+
+	stats.numPrunedVertices += (newCount != count) ? 1 : 0;
+	stats.numDroppedInfluences += count - newCount;
+	stats.errorSum += error;
+	stats.errorMax = max(stats.errorMax, error);
+
+	return newCount;
+}
+
+static short PackInfluenceWeight(const float weight)
+{
+	return static_cast<short>(std::clamp(weight, 0.0f, 1.0f) * 32767.0f + 0.5f);
+}
+
+//
+// PruneVertexWeights_VVD
+// Purpose: prune a vvd vertex's weights, out keeps the layout of in ('complex' shorts or floats) with no vvw entries.
+//			returns false if the weights were left untouched
+//
+bool PruneVertexWeights_VVD(const vvd::mstudioboneweight_t& in, vvd::mstudioboneweight_t& out, const vvw::vertexBoneWeightsExtraFileHeader_t* pVVW, const bool extraWeights, s_weightprunestats_t& stats)
+{
+	vertexinfluence_t influences[MAX_VERT_INFLUENCES];
+	const int count = min(static_cast<int>(in.numbones), MAX_VERT_INFLUENCES);
+
+	for (int n = 0; n < count; n++)
+	{
+		if (!extraWeights)
+		{
+			influences[n] = { in.weight[n], in.bone[n] };
+		}
+		else if (n < 3)
+		{
+			influences[n] = { in.weightextra.weight[n] / 32767.0f, in.bone[n] };
+		}
+		else
+		{
+			const vvw::mstudioboneweightextra_t* const pVvwWeight = pVVW->GetWeightData(in.weightextra.extraweightindex + (n - 3));
+
+			influences[n] = { pVvwWeight->weight / 32767.0f, pVvwWeight->bone };
+		}
+	}
+
+	const int newCount = PruneInfluences(influences, count, stats);
+
+	if (newCount == count)
+	{
+		out = in;
+		return false;
+	}
+
+	memset(&out, 0, sizeof(out));
+
+	for (int n = 0; n < newCount; n++)
+	{
+		if (extraWeights)
+			out.weightextra.weight[n] = PackInfluenceWeight(influences[n].weight);
+		else
+			out.weight[n] = influences[n].weight;
+
+		out.bone[n] = static_cast<unsigned char>(influences[n].bone);
+	}
+
+	out.numbones = static_cast<char>(newCount);
+
+	return true;
+}
+
+//
+// PruneMeshWeights_VG
+// Purpose: prune the packed weights of a vg mesh that uses extra bone weights, vertices are edited in place and
+//			the mesh's extra bone weights are rebuilt into extraWeightsOut (empty if no vertex needs them anymore)
+//
+void PruneMeshWeights_VG(char* pVerts, const uint32_t vertCount, const uint32_t vertCacheSize, const uint64_t flags, const vvw::mstudioboneweightextra_t* pExtraWeights, const int extraWeightCount, std::vector<vvw::mstudioboneweightextra_t>& extraWeightsOut, s_weightprunestats_t& stats)
+{
+	extraWeightsOut.clear();
+
+	// 'simple' meshes never reference extra bone weights, nothing to do here
+	// the wider weight layout is left alone as well, we don't know enough about it
+	if (!(flags & VERTEX_HAS_WEIGHT_BONES) || !(flags & VERTEX_HAS_WEIGHT_VALUES_2) || (flags & VERTEX_HAS_WEIGHT_VALUES_N) || !pExtraWeights || extraWeightCount <= 0)
+	{
+		if (pExtraWeights && extraWeightCount > 0)
+			extraWeightsOut.assign(pExtraWeights, pExtraWeights + extraWeightCount);
+
+		return;
+	}
+
+	const uint32_t weightsOffset = (flags & VERTEX_HAS_POSITION_PACKED) ? sizeof(Vector64) : ((flags & VERTEX_HAS_POSITION) ? sizeof(Vector) : 0);
+	const uint32_t bonesOffset = weightsOffset + sizeof(vg::mstudiopackedweights_t);
+
+	// make sure every vertex points inside this mesh's extra weights before touching anything
+	for (uint32_t v = 0; v < vertCount; v++)
+	{
+		const vg::mstudiopackedweights_t* const pWeights = reinterpret_cast<const vg::mstudiopackedweights_t*>(pVerts + v * vertCacheSize + weightsOffset);
+		const vg::mstudiopackedbones_t* const pBones = reinterpret_cast<const vg::mstudiopackedbones_t*>(pVerts + v * vertCacheSize + bonesOffset);
+
+		if (pBones->numbones > 1 && pWeights->weight[1] + pBones->numbones - 1 > extraWeightCount)
+		{
+			printf("  [VG] WARNING: vertex %u references extra bone weights outside its mesh, skipping weight pruning for mesh\n", v);
+			extraWeightsOut.assign(pExtraWeights, pExtraWeights + extraWeightCount);
+			return;
+		}
+	}
+
+	for (uint32_t v = 0; v < vertCount; v++)
+	{
+		vg::mstudiopackedweights_t* const pWeights = reinterpret_cast<vg::mstudiopackedweights_t*>(pVerts + v * vertCacheSize + weightsOffset);
+		vg::mstudiopackedbones_t* const pBones = reinterpret_cast<vg::mstudiopackedbones_t*>(pVerts + v * vertCacheSize + bonesOffset);
+
+		const int count = min(pBones->numbones + 1, MAX_VERT_INFLUENCES);
+		const vvw::mstudioboneweightextra_t* const pVertExtraWeights = pExtraWeights + pWeights->weight[1];
+
+		// first bone is fixed, the middle ones are extra weights, and the last bone's weight is whatever is left over
+		vertexinfluence_t influences[MAX_VERT_INFLUENCES];
+		influences[0] = { pWeights->weight[0] / 32767.0f, pBones->bones[0] };
+
+		float sum = influences[0].weight;
+		for (int n = 1; n < count - 1; n++)
+		{
+			influences[n] = { pVertExtraWeights[n - 1].weight / 32767.0f, pVertExtraWeights[n - 1].bone };
+			sum += influences[n].weight;
+		}
+
+		if (count > 1)
+			influences[count - 1] = { max(1.0f - sum, 0.0f), pBones->bones[1] };
+
+		const int newCount = PruneInfluences(influences, count, stats);
+		const int extraWeightIndex = static_cast<int>(extraWeightsOut.size());
+
+		// untouched vertices keep their exact extra weights, they just move
+		if (newCount == count)
+		{
+			if (count > 2)
+				extraWeightsOut.insert(extraWeightsOut.end(), pVertExtraWeights, pVertExtraWeights + (count - 2));
+
+			pWeights->weight[1] = static_cast<unsigned short>(extraWeightIndex);
+			continue;
+		}
+
+		for (int n = 1; n < newCount - 1; n++)
+			extraWeightsOut.push_back({ PackInfluenceWeight(influences[n].weight), influences[n].bone });
+
+		pWeights->weight[0] = PackInfluenceWeight(influences[0].weight);
+		pWeights->weight[1] = static_cast<unsigned short>(extraWeightIndex);
+
+		pBones->bones[0] = static_cast<unsigned char>(influences[0].bone);
+		pBones->bones[1] = static_cast<unsigned char>(influences[newCount - 1].bone);
+		pBones->numbones = static_cast<byte>(newCount - 1);
+	}
+}
+
+//
+// WriteSectionArena
+// Purpose: run one WriteSections task into its own sub-arena, with this thread's g_model pointed at it
+//
+static void WriteSectionArena(s_sectionarena_t& arena, const size_t index, const size_t maxSize, void* pHdr, const std::function<void(const size_t)>& write)
+{
+	// room to align the start to 16, so the writer's own alignment lands where it would in the output
+	arena.capacity = maxSize;
+	arena.buffer.reset(new char[arena.capacity + 15]{});
+	arena.pBase = arena.buffer.get();
+	ALIGN16(arena.pBase);
+
+	// the calling thread runs tasks too, so whatever it was writing is put aside
+	s_modeldata_t outer = std::move(g_model);
+
+	g_model = s_modeldata_t{};
+	g_model.pHdr = pHdr;
+	g_model.pBase = arena.pBase;
+	g_model.pData = arena.pBase;
+	g_model.pSection = &arena;
+
+	write(index);
+
+	arena.size = static_cast<size_t>(g_model.pData - arena.pBase);
+	arena.strings = std::move(g_model.stringTable);
+
+	g_model = std::move(outer);
+
+	if (arena.size > arena.capacity)
+		Error("section %zu wrote %zu bytes into a sub-arena sized for %zu\n", index, arena.size, arena.capacity);
+}
+
+//
+// StitchSectionArena
+// Purpose: append a written sub-arena to the output as if its task had written there directly
+//
+static void StitchSectionArena(const s_sectionarena_t& arena, const size_t startAlign, const bool printLog)
+{
+	ALIGN(g_model.pData, startAlign);
+
+	char* const pDst = g_model.pData;
+	memcpy(pDst, arena.pBase, arena.size);
+
+	auto relocate = [&arena, pDst](char* p) -> char*
+	{
+		return p >= arena.pBase && p < arena.pBase + arena.size ? pDst + (p - arena.pBase) : p;
+	};
+
+	for (const s_sectionfixup_t& fixup : arena.fixups)
+		*reinterpret_cast<int*>(relocate(reinterpret_cast<char*>(fixup.ptr))) = static_cast<int>(pDst + fixup.targetOffset - fixup.anchor);
+
+	// added again in order rather than copied, so duplicates resolve against every string before them like a serial run
+	for (const stringentry_t& entry : arena.strings)
+	{
+		if (entry.ptr)
+			AddToStringTable(relocate(entry.base), reinterpret_cast<int*>(relocate(reinterpret_cast<char*>(entry.ptr))), entry.string);
+	}
+
+	if (printLog)
+		fputs(arena.log.c_str(), stdout);
+
+	g_model.pData += arena.size;
+}
+
+//
+// WriteSectionsParallel
+// Purpose: every section into its own sub-arena as a parallel task, then stitch them in order
+//
+static void WriteSectionsParallel(const size_t count, const size_t startAlign, const std::function<size_t(const size_t)>& maxSize,
+	const std::function<void(const size_t)>& write, const bool printLog)
+{
+	std::vector<s_sectionarena_t> arenas(count);
+	void* const pHdr = g_model.pHdr;
+
+	ParallelForSections(count, [&](const size_t i)
+	{
+		WriteSectionArena(arenas[i], i, maxSize(i), pHdr, write);
+	});
+
+	for (const s_sectionarena_t& arena : arenas)
+		StitchSectionArena(arena, startAlign, printLog);
+}
+
+//
+// WriteSections
+// Purpose: write variable size sections in parallel with output identical to writing them in order
+// with -serial they are written in order straight into the output, with -verifysections both ways and diffed
+//
+void WriteSections(const char* pszName, char* pHeaders, const size_t count, const size_t startAlign,
+	const std::function<size_t(const size_t)>& maxSize, const std::function<void(const size_t)>& write)
+{
+	if (g_options.serialSections)
+	{
+		for (size_t i = 0; i < count; i++)
+			write(i);
+
+		return;
+	}
+
+	if (!g_options.verifySections)
+	{
+		WriteSectionsParallel(count, startAlign, maxSize, write, true);
+		return;
+	}
+
+	// the writers also fill in the headers the sections hang off, so those are put back before the second pass
+	char* const pStart = g_model.pData;
+	const size_t stringCount = g_model.stringTable.size();
+	const std::vector<char> headers(pHeaders, pStart);
+
+	for (size_t i = 0; i < count; i++)
+		write(i);
+
+	const std::vector<char> serial(pHeaders, g_model.pData);
+	const std::vector<stringentry_t> serialStrings(g_model.stringTable.begin() + stringCount, g_model.stringTable.end());
+
+	memcpy(pHeaders, headers.data(), headers.size());
+	memset(pStart, 0, g_model.pData - pStart);
+	g_model.pData = pStart;
+	g_model.stringTable.resize(stringCount);
+
+	WriteSectionsParallel(count, startAlign, maxSize, write, false);
+
+	const size_t size = static_cast<size_t>(g_model.pData - pHeaders);
+	size_t mismatchCount = 0;
+	size_t firstMismatch = 0;
+
+	for (size_t i = 0; i < min(size, serial.size()); i++)
+	{
+		if (pHeaders[i] == serial[i])
+			continue;
+
+		if (!mismatchCount)
+			firstMismatch = i;
+
+		mismatchCount++;
+	}
+
+	size_t stringMismatch = serialStrings.size();
+	for (size_t i = 0; i < serialStrings.size() && stringCount + i < g_model.stringTable.size(); i++)
+	{
+		const stringentry_t& a = serialStrings[i];
+		const stringentry_t& b = g_model.stringTable[stringCount + i];
+
+		if (a.base != b.base || a.ptr != b.ptr || a.dupindex != b.dupindex || strcmp(a.string, b.string))
+		{
+			stringMismatch = i;
+			break;
+		}
+	}
+
+	if (size != serial.size())
+		printf("  [SECTIONS] ERROR: parallel %s are %zu bytes, serial %zu\n", pszName, size, serial.size());
+	else if (mismatchCount)
+		printf("  [SECTIONS] ERROR: %zu of %zu bytes of %s differ from -serial (first at 0x%zX)\n", mismatchCount, size, pszName, firstMismatch);
+	else if (stringMismatch != serialStrings.size() || g_model.stringTable.size() - stringCount != serialStrings.size())
+		printf("  [SECTIONS] ERROR: string table entries of %s differ from -serial (first at entry %zu)\n", pszName, stringMismatch);
+	else
+		printf("  [SECTIONS] verified: %zu bytes and %zu strings of %s identical to -serial\n", size, serialStrings.size(), pszName);
+}
+
+//
+// CheckModelSize
+// Purpose: compare the written model image against the size it was allocated with
+//
+void CheckModelSize(const size_t plannedSize)
+{
+	const size_t size = static_cast<size_t>(g_model.pData - g_model.pBase);
+
+	if (size > plannedSize)
+		Error("model image is %zu bytes, only %zu were planned\n", size, plannedSize);
+
+	printf("  [SIZE] model image %zu bytes, %zu planned\n", size, plannedSize);
+}
+
+//
+// AddWeightPruneStats
+// Purpose: merge stats from meshes pruned as separate tasks
+//
+void AddWeightPruneStats(s_weightprunestats_t& stats, const s_weightprunestats_t& other)
+{
+	stats.numVertices += other.numVertices;
+	stats.numPrunedVertices += other.numPrunedVertices;
+	stats.numDroppedInfluences += other.numDroppedInfluences;
+	stats.extraWeightsIn += other.extraWeightsIn;
+	stats.extraWeightsOut += other.extraWeightsOut;
+	stats.errorSum += other.errorSum;
+	stats.errorMax = max(stats.errorMax, other.errorMax);
+}
+
+//
+// PrintWeightPruneStats
+// Purpose: report what weight pruning cost and saved
+//
+void PrintWeightPruneStats(const s_weightprunestats_t& stats)
+{
+	const size_t bytesSaved = (stats.extraWeightsIn - stats.extraWeightsOut) * sizeof(vvw::mstudioboneweightextra_t);
+
+	printf("  [VG] Weight pruning (threshold %.3f): %zu/%zu vertices changed, %zu influences dropped\n",
+		g_options.pruneWeightThreshold, stats.numPrunedVertices, stats.numVertices, stats.numDroppedInfluences);
+	printf("  [VG] Weight pruning error: avg %.5f, max %.5f (summed weight moved per vertex)\n",
+		stats.numPrunedVertices ? stats.errorSum / stats.numPrunedVertices : 0.0, stats.errorMax);
+	printf("  [VG] Extra bone weights: %zu -> %zu, %zu bytes saved\n", stats.extraWeightsIn, stats.extraWeightsOut, bytesSaved);
+}
+
+//
+// MinimizeBonePalette
+// Purpose: shrink boneStates down to the bones the meshes actually weight to and remap every vertex onto it.
+//			bones are ordered by the first mesh that uses them, and by hierarchy (model bone index) within a mesh,
+//			so each mesh's bones end up close together. returns false if the palette was left untouched
+//
+bool MinimizeBonePalette(const std::vector<s_palettemesh_t>& meshes, std::vector<unsigned char>& boneStates)
+{
+	const size_t paletteSize = boneStates.size();
+
+	if (paletteSize == 0)
+		return false;
+
+	// palette indices are bytes, -1 for unused
+	int remap[256];
+	std::fill(std::begin(remap), std::end(remap), -1);
+
+	std::vector<unsigned char> order; // old palette indices in their new order
+	size_t maxMeshBones = 0;
+
+	for (const s_palettemesh_t& mesh : meshes)
+	{
+		if (!mesh.pVerts)
+			continue;
+
+		std::vector<unsigned char> introduced;
+		bool meshBones[256] {};
+		size_t meshBoneCount = 0;
+
+		auto useBone = [&](const int bone) -> bool
+		{
+			if (bone < 0 || bone >= paletteSize)
+				return false;
+
+			if (!meshBones[bone])
+			{
+				meshBones[bone] = true;
+				meshBoneCount++;
+			}
+
+			if (remap[bone] == -1)
+			{
+				remap[bone] = -2; // seen, index assigned once the mesh is done
+				introduced.push_back(static_cast<unsigned char>(bone));
+			}
+
+			return true;
+		};
+
+		for (uint32_t v = 0; v < mesh.vertCount; v++)
+		{
+			const vg::mstudiopackedbones_t* const pBones = reinterpret_cast<const vg::mstudiopackedbones_t*>(mesh.pVerts + v * mesh.vertStride + mesh.bonesOffset);
+
+			// 'complex' weights only keep the first and last bone in the vertex, the rest live in the extra weights
+			const int numVertBones = mesh.pExtraWeights ? min(static_cast<int>(pBones->numbones), 1) : min(static_cast<int>(pBones->numbones), 2);
+
+			for (int n = 0; n <= numVertBones; n++)
+			{
+				if (!useBone(pBones->bones[n]))
+				{
+					printf("  [VG] WARNING: vertex bone %i is outside the bone palette (%zu), keeping the palette as is\n", pBones->bones[n], paletteSize);
+					return false;
+				}
+			}
+		}
+
+		for (int i = 0; i < mesh.extraWeightCount; i++)
+		{
+			if (!useBone(mesh.pExtraWeights[i].bone))
+			{
+				printf("  [VG] WARNING: extra weight bone %i is outside the bone palette (%zu), keeping the palette as is\n", mesh.pExtraWeights[i].bone, paletteSize);
+				return false;
+			}
+		}
+
+		std::stable_sort(introduced.begin(), introduced.end(), [&boneStates](const unsigned char a, const unsigned char b) { return boneStates[a] < boneStates[b]; });
+
+		for (const unsigned char bone : introduced)
+		{
+			remap[bone] = static_cast<int>(order.size());
+			order.push_back(bone);
+		}
+
+		maxMeshBones = max(maxMeshBones, meshBoneCount);
+	}
+
+	if (order.empty())
+		return false;
+
+	for (const s_palettemesh_t& mesh : meshes)
+	{
+		if (!mesh.pVerts)
+			continue;
+
+		for (uint32_t v = 0; v < mesh.vertCount; v++)
+		{
+			vg::mstudiopackedbones_t* const pBones = reinterpret_cast<vg::mstudiopackedbones_t*>(mesh.pVerts + v * mesh.vertStride + mesh.bonesOffset);
+
+			const int numVertBones = mesh.pExtraWeights ? min(static_cast<int>(pBones->numbones), 1) : min(static_cast<int>(pBones->numbones), 2);
+
+			for (int n = 0; n <= numVertBones; n++)
+				pBones->bones[n] = static_cast<unsigned char>(remap[pBones->bones[n]]);
+
+			// slots without a weight could point anywhere in the old palette, keep them on the first bone like respawn does
+			for (int n = numVertBones + 1; n < 3; n++)
+				pBones->bones[n] = pBones->bones[0];
+		}
+
+		for (int i = 0; i < mesh.extraWeightCount; i++)
+			mesh.pExtraWeights[i].bone = static_cast<short>(remap[mesh.pExtraWeights[i].bone]);
+	}
+
+	std::vector<unsigned char> newBoneStates(order.size());
+	for (size_t i = 0; i < order.size(); i++)
+		newBoneStates[i] = boneStates[order[i]];
+
+	printf("  [VG] Bone palette: %zu -> %zu bones (largest mesh uses %zu)\n", paletteSize, newBoneStates.size(), maxMeshBones);
+
+	boneStates = std::move(newBoneStates);
+
+	return true;
+}
+
+//
+// MinimizeBonePalette_VG
+// Purpose: MinimizeBonePalette for rev1 mesh headers that have already been laid out over their vertex and extra weight buffers
+//
+bool MinimizeBonePalette_VG(char* pVertexData, char* pExtraWeightData, vg::rev1::MeshHeader_t* pMeshes, const int meshCount, std::vector<unsigned char>& boneStates)
+{
+	std::vector<s_palettemesh_t> paletteMeshes(meshCount);
+
+	for (int i = 0; i < meshCount; i++)
+	{
+		const vg::rev1::MeshHeader_t* const pMesh = &pMeshes[i];
+		s_palettemesh_t& mesh = paletteMeshes[i];
+
+		if (!(pMesh->flags & VERTEX_HAS_WEIGHT_BONES) || pMesh->vertCount == 0)
+			continue;
+
+		mesh.pVerts = pVertexData + pMesh->vertOffset;
+		mesh.vertCount = pMesh->vertCount;
+		mesh.vertStride = pMesh->vertCacheSize;
+		mesh.bonesOffset = ((pMesh->flags & VERTEX_HAS_POSITION_PACKED) ? sizeof(Vector64) : ((pMesh->flags & VERTEX_HAS_POSITION) ? sizeof(Vector) : 0))
+			+ ((pMesh->flags & VERTEX_HAS_WEIGHT_VALUES_N) ? 8 : 0) + ((pMesh->flags & VERTEX_HAS_WEIGHT_VALUES_2) ? sizeof(vg::mstudiopackedweights_t) : 0);
+
+		if (pMesh->extraBoneWeightSize > 0)
+		{
+			mesh.pExtraWeights = reinterpret_cast<vvw::mstudioboneweightextra_t*>(pExtraWeightData + pMesh->extraBoneWeightOffset);
+			mesh.extraWeightCount = pMesh->extraBoneWeightSize / sizeof(vvw::mstudioboneweightextra_t);
+		}
+	}
+
+	return MinimizeBonePalette(paletteMeshes, boneStates);
+}
+
+// vg vertices start with their position, packed or full
+static Vector GetVertexPosition(const char* const pVert, const bool packed)
+{
+	Vector pos;
+
+	if (packed)
+	{
+		Vector64 packedPos;
+		memcpy(&packedPos, pVert, sizeof(Vector64));
+		pos = packedPos;
+	}
+	else
+		memcpy(&pos, pVert, sizeof(Vector));
+
+	return pos;
+}
+
+//
+// UpdateVertexCache
+// Purpose: run a triangle through a fifo cache of OVERDRAW_CACHE_SIZE vertices, returns how many of its vertices missed.
+//			a vertex is cached while fewer than OVERDRAW_CACHE_SIZE misses happened after its own, moving timestamp
+//			past OVERDRAW_CACHE_SIZE flushes the whole cache
+//
+static uint32_t UpdateVertexCache(const uint16_t* pTri, std::vector<uint32_t>& timestamps, uint32_t& timestamp)
+{
+	uint32_t misses = 0;
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (timestamp - timestamps[pTri[i]] > OVERDRAW_CACHE_SIZE)
+		{
+			timestamps[pTri[i]] = timestamp++;
+			misses++;
+		}
+	}
+
+	return misses;
+}
+
+static uint64_t CountVertexCacheMisses(const uint16_t* pIndices, const uint32_t triCount, const uint32_t vertCount)
+{
+	std::vector<uint32_t> timestamps(vertCount, 0);
+	uint32_t timestamp = OVERDRAW_CACHE_SIZE + 1;
+
+	uint64_t misses = 0;
+	for (uint32_t i = 0; i < triCount; i++)
+		misses += UpdateVertexCache(pIndices + i * 3, timestamps, timestamp);
+
+	return misses;
+}
+
+//
+// RasterizeOverdraw
+// Purpose: software rasterize the triangles in order from the six axis directions with a depth test, returns how many
+//			pixels passed the depth test. covered gets the pixels any triangle ended up on, shaded / covered is the overdraw
+//
+static uint64_t RasterizeOverdraw(const std::vector<Vector>& positions, const uint16_t* pIndices, const uint32_t triCount, uint64_t& covered)
+{
+	Vector mins(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vector maxs(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for (const Vector& pos : positions)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			mins[i] = min(mins[i], pos[i]);
+			maxs[i] = max(maxs[i], pos[i]);
+		}
+	}
+
+	const float extent = max(max(maxs.x - mins.x, maxs.y - mins.y), maxs.z - mins.z);
+	if (extent <= 0.0f)
+		return 0;
+
+	const float* const pMins = &mins.x;
+
+	// one scale for every axis so the views keep the mesh's proportions
+	const float scale = static_cast<float>(OVERDRAW_GRID_SIZE) / extent;
+
+	std::vector<float> depth(OVERDRAW_GRID_SIZE * OVERDRAW_GRID_SIZE);
+	uint64_t shaded = 0;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const int axisU = (axis + 1) % 3;
+		const int axisV = (axis + 2) % 3;
+
+		// side 0 looks along the axis from below, side 1 from above. triangles are front facing when they wind clockwise
+		// on screen like d3d culls them, which is when their counter clockwise normal points away from the view
+		for (int side = 0; side < 2; side++)
+		{
+			const float clearDepth = side ? -FLT_MAX : FLT_MAX;
+			std::fill(depth.begin(), depth.end(), clearDepth);
+
+			for (uint32_t t = 0; t < triCount; t++)
+			{
+				float u[3], v[3], d[3];
+				for (int i = 0; i < 3; i++)
+				{
+					const float* const pPos = &positions[pIndices[t * 3 + i]].x;
+
+					u[i] = (pPos[axisU] - pMins[axisU]) * scale;
+					v[i] = (pPos[axisV] - pMins[axisV]) * scale;
+					d[i] = pPos[axis] - pMins[axis];
+				}
+
+				const float area = (u[1] - u[0]) * (v[2] - v[0]) - (v[1] - v[0]) * (u[2] - u[0]);
+				if (side ? area >= 0.0f : area <= 0.0f)
+					continue;
+
+				const float sign = side ? -1.0f : 1.0f;
+				const float invArea = 1.0f / (area * sign);
+
+				const int x0 = max(static_cast<int>(min(min(u[0], u[1]), u[2])), 0);
+				const int x1 = min(static_cast<int>(max(max(u[0], u[1]), u[2])), OVERDRAW_GRID_SIZE - 1);
+				const int y0 = max(static_cast<int>(min(min(v[0], v[1]), v[2])), 0);
+				const int y1 = min(static_cast<int>(max(max(v[0], v[1]), v[2])), OVERDRAW_GRID_SIZE - 1);
+
+				for (int y = y0; y <= y1; y++)
+				{
+					const float py = y + 0.5f;
+
+					for (int x = x0; x <= x1; x++)
+					{
+						const float px = x + 0.5f;
+
+						// barycentrics from the edge functions, all positive inside the triangle for either winding
+						const float w0 = ((u[2] - u[1]) * (py - v[1]) - (v[2] - v[1]) * (px - u[1])) * sign;
+						const float w1 = ((u[0] - u[2]) * (py - v[2]) - (v[0] - v[2]) * (px - u[2])) * sign;
+						const float w2 = ((u[1] - u[0]) * (py - v[0]) - (v[1] - v[0]) * (px - u[0])) * sign;
+
+						if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+							continue;
+
+						const float z = (w0 * d[0] + w1 * d[1] + w2 * d[2]) * invArea;
+						float& pixelDepth = depth[y * OVERDRAW_GRID_SIZE + x];
+
+						if (side ? z > pixelDepth : z < pixelDepth)
+						{
+							pixelDepth = z;
+							shaded++;
+						}
+					}
+				}
+			}
+
+			for (const float pixelDepth : depth)
+			{
+				if (pixelDepth != clearDepth)
+					covered++;
+			}
+		}
+	}
+
+	return shaded;
+}
+
+//
+// OptimizeMeshOverdraw
+// Purpose: reorder a mesh's triangles so surfaces facing away from the mesh's center draw first and hide what is behind them.
+//			the existing order is cut into clusters wherever the vertex cache restarts, and again wherever the running
+//			acmr of a cluster drops to cacheThreshold times its acmr on its own, so sorting clusters costs little cache.
+//			clusters are sorted by how far their area weighted center sits out along their normal, like a view independent
+//			depth sort. the new order is only kept if it rasterizes less overdraw and stays within cacheThreshold in total
+//
+bool OptimizeMeshOverdraw(const s_overdrawmesh_t& mesh, const float cacheThreshold, s_overdrawstats_t& stats)
+{
+	const uint32_t triCount = mesh.indexCount / 3;
+
+	if (triCount < 2 || mesh.vertCount == 0)
+		return false;
+
+	for (uint32_t i = 0; i < triCount * 3; i++)
+	{
+		if (mesh.pIndices[i] >= mesh.vertCount)
+		{
+			printf("  [VG] WARNING: index %u is outside the mesh's %u vertices, keeping its triangle order\n", mesh.pIndices[i], mesh.vertCount);
+			return false;
+		}
+	}
+
+	std::vector<Vector> positions(mesh.vertCount);
+	for (uint32_t v = 0; v < mesh.vertCount; v++)
+		positions[v] = GetVertexPosition(mesh.pVerts + static_cast<size_t>(v) * mesh.vertStride, mesh.packedPosition);
+
+	std::vector<uint32_t> timestamps(mesh.vertCount, 0);
+	uint32_t timestamp = OVERDRAW_CACHE_SIZE + 1;
+
+	// hard boundaries, a triangle that misses on all three vertices starts a new patch of the mesh
+	std::vector<uint32_t> patches;
+	uint64_t missesIn = 0;
+
+	for (uint32_t i = 0; i < triCount; i++)
+	{
+		const uint32_t misses = UpdateVertexCache(mesh.pIndices + i * 3, timestamps, timestamp);
+
+		if (i == 0 || misses == 3)
+			patches.push_back(i);
+
+		missesIn += misses;
+	}
+
+	// soft boundaries, split patches further once a prefix is about as cache friendly as the whole patch
+	std::vector<uint32_t> clusters;
+
+	for (size_t p = 0; p < patches.size(); p++)
+	{
+		const uint32_t start = patches[p];
+		const uint32_t end = p + 1 < patches.size() ? patches[p + 1] : triCount;
+
+		timestamp += OVERDRAW_CACHE_SIZE + 1;
+
+		uint32_t patchMisses = 0;
+		for (uint32_t i = start; i < end; i++)
+			patchMisses += UpdateVertexCache(mesh.pIndices + i * 3, timestamps, timestamp);
+
+		const float patchThreshold = cacheThreshold * (static_cast<float>(patchMisses) / static_cast<float>(end - start));
+
+		clusters.push_back(start);
+		timestamp += OVERDRAW_CACHE_SIZE + 1;
+
+		uint32_t runningMisses = 0;
+		uint32_t runningTris = 0;
+
+		for (uint32_t i = start; i < end; i++)
+		{
+			runningMisses += UpdateVertexCache(mesh.pIndices + i * 3, timestamps, timestamp);
+			runningTris++;
+
+			if (i + 1 < end && static_cast<float>(runningMisses) / static_cast<float>(runningTris) <= patchThreshold)
+			{
+				clusters.push_back(i + 1);
+				timestamp += OVERDRAW_CACHE_SIZE + 1;
+
+				runningMisses = 0;
+				runningTris = 0;
+			}
+		}
+	}
+
+	Vector meshCenter(0.0f, 0.0f, 0.0f);
+	for (const Vector& pos : positions)
+		meshCenter += pos;
+
+	meshCenter /= static_cast<float>(mesh.vertCount);
+
+	// winding decides which way normals point, outward is whichever way most of the surface faces away from the center
+	float facing = 0.0f;
+
+	std::vector<float> clusterKeys(clusters.size());
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		const uint32_t start = clusters[c];
+		const uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triCount;
+
+		Vector center(0.0f, 0.0f, 0.0f);
+		Vector normal(0.0f, 0.0f, 0.0f);
+		float area = 0.0f;
+
+		for (uint32_t i = start; i < end; i++)
+		{
+			const Vector& p0 = positions[mesh.pIndices[i * 3 + 0]];
+			const Vector& p1 = positions[mesh.pIndices[i * 3 + 1]];
+			const Vector& p2 = positions[mesh.pIndices[i * 3 + 2]];
+
+			const Vector e1 = p1 - p0;
+			const Vector e2 = p2 - p0;
+			const Vector cross(e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x);
+
+			const float triArea = sqrtf(DotProduct(&cross.x, &cross.x));
+
+			center += (p0 + p1 + p2) * (triArea / 3.0f);
+			normal += cross;
+			area += triArea;
+
+			const Vector offset = (p0 + p1 + p2) / 3.0f - meshCenter;
+			facing += DotProduct(&offset.x, &cross.x);
+		}
+
+		if (area > 0.0f)
+			center /= area;
+		else
+			center = meshCenter;
+
+		const float normalLength = sqrtf(DotProduct(&normal.x, &normal.x));
+		if (normalLength > 0.0f)
+			normal /= normalLength;
+
+		const Vector offset = center - meshCenter;
+		clusterKeys[c] = DotProduct(&offset.x, &normal.x);
+	}
+
+	if (facing < 0.0f)
+	{
+		for (float& key : clusterKeys)
+			key = -key;
+	}
+
+	std::vector<uint32_t> order(clusters.size());
+	for (uint32_t c = 0; c < order.size(); c++)
+		order[c] = c;
+
+	std::stable_sort(order.begin(), order.end(), [&clusterKeys](const uint32_t a, const uint32_t b) { return clusterKeys[a] > clusterKeys[b]; });
+
+	std::vector<uint16_t> newIndices;
+	newIndices.reserve(triCount * 3);
+
+	for (const uint32_t c : order)
+	{
+		const uint32_t start = clusters[c];
+		const uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triCount;
+
+		newIndices.insert(newIndices.end(), mesh.pIndices + start * 3, mesh.pIndices + end * 3);
+	}
+
+	const uint64_t missesOut = CountVertexCacheMisses(newIndices.data(), triCount, mesh.vertCount);
+
+	uint64_t covered = 0;
+	uint64_t coveredOut = 0;
+	const uint64_t shadedIn = RasterizeOverdraw(positions, mesh.pIndices, triCount, covered);
+	const uint64_t shadedOut = RasterizeOverdraw(positions, newIndices.data(), triCount, coveredOut);
+
+	const bool keep = shadedOut < shadedIn && static_cast<double>(missesOut) <= static_cast<double>(missesIn) * cacheThreshold;
+
+	if (keep)
+		memcpy(mesh.pIndices, newIndices.data(), newIndices.size() * sizeof(uint16_t));
+
+	stats.meshes++;
+	stats.meshesReordered += keep ? 1 : 0;
+	stats.triangles += triCount;
+	stats.pixelsCovered += covered;
+	stats.pixelsShadedIn += shadedIn;
+	stats.pixelsShadedOut += keep ? shadedOut : shadedIn;
+	stats.cacheMissesIn += missesIn;
+	stats.cacheMissesOut += keep ? missesOut : missesIn;
+
+	return keep;
+}
+
+//
+// OptimizeOverdraw
+// Purpose: OptimizeMeshOverdraw every mesh as its own task and print the totals
+//
+void OptimizeOverdraw(const std::vector<s_overdrawmesh_t>& meshes, const float cacheThreshold)
+{
+	std::vector<s_overdrawstats_t> meshStats(meshes.size());
+
+	ParallelForSections(meshes.size(), [&](const size_t i)
+	{
+		if (meshes[i].pIndices)
+			OptimizeMeshOverdraw(meshes[i], cacheThreshold, meshStats[i]);
+	});
+
+	s_overdrawstats_t stats {};
+	for (const s_overdrawstats_t& mesh : meshStats)
+	{
+		stats.meshes += mesh.meshes;
+		stats.meshesReordered += mesh.meshesReordered;
+		stats.triangles += mesh.triangles;
+		stats.pixelsCovered += mesh.pixelsCovered;
+		stats.pixelsShadedIn += mesh.pixelsShadedIn;
+		stats.pixelsShadedOut += mesh.pixelsShadedOut;
+		stats.cacheMissesIn += mesh.cacheMissesIn;
+		stats.cacheMissesOut += mesh.cacheMissesOut;
+	}
+
+	if (stats.pixelsCovered == 0 || stats.triangles == 0)
+		return;
+
+	const double coverage = static_cast<double>(stats.pixelsCovered);
+	const double triangles = static_cast<double>(stats.triangles);
+
+	printf("  [VG] Overdraw: %.3f -> %.3f, acmr %.3f -> %.3f (%zu of %zu meshes reordered)\n",
+		stats.pixelsShadedIn / coverage, stats.pixelsShadedOut / coverage, stats.cacheMissesIn / triangles, stats.cacheMissesOut / triangles,
+		stats.meshesReordered, stats.meshes);
+}
+
+//
+// OptimizeOverdraw_VG
+// Purpose: OptimizeOverdraw for rev1 mesh headers that have already been laid out over their index and vertex buffers
+//
+void OptimizeOverdraw_VG(char* pIndexData, const char* pVertexData, const vg::rev1::MeshHeader_t* pMeshes, const int meshCount, const float cacheThreshold)
+{
+	std::vector<s_overdrawmesh_t> overdrawMeshes(meshCount);
+
+	for (int i = 0; i < meshCount; i++)
+	{
+		const vg::rev1::MeshHeader_t* const pMesh = &pMeshes[i];
+		s_overdrawmesh_t& mesh = overdrawMeshes[i];
+
+		if (!(pMesh->flags & (VERTEX_HAS_POSITION | VERTEX_HAS_POSITION_PACKED)) || pMesh->vertCount == 0 || pMesh->indexCount < 6)
+			continue;
+
+		mesh.pIndices = reinterpret_cast<uint16_t*>(pIndexData) + pMesh->indexOffset;
+		mesh.indexCount = pMesh->indexCount;
+		mesh.pVerts = pVertexData + pMesh->vertOffset;
+		mesh.vertCount = pMesh->vertCount;
+		mesh.vertStride = pMesh->vertCacheSize;
+		mesh.packedPosition = (pMesh->flags & VERTEX_HAS_POSITION_PACKED) != 0;
+	}
+
+	OptimizeOverdraw(overdrawMeshes, cacheThreshold);
+}
+
+// every mesh of a lod as one triangle soup, the deviation between lods doesn't care which mesh a triangle came from
+struct s_lodsurface_t
+{
+	std::vector<Vector> positions;
+	std::vector<uint32_t> indices;
+
+	Vector mins;
+	Vector maxs;
+};
+
+// uniform grid over a surface's triangles, cells list every triangle whose bounds touch them
+struct s_trianglegrid_t
+{
+	Vector mins;
+	float cellSize;
+	int dims[3];
+
+	std::vector<uint32_t> cellStart; // cellStart[cell] to cellStart[cell + 1] in cellTris
+	std::vector<uint32_t> cellTris;
+};
+
+static void GatherLODSurface(const char* pIndexData, const char* pVertexData, const vg::rev1::MeshHeader_t* pMeshes, const int meshCount, const vg::rev1::ModelLODHeader_t* pLod, s_lodsurface_t& surface)
+{
+	surface.mins = Vector(FLT_MAX, FLT_MAX, FLT_MAX);
+	surface.maxs = Vector(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	const int lastMesh = min(static_cast<int>(pLod->meshOffset) + static_cast<int>(pLod->meshCount), meshCount);
+
+	for (int i = pLod->meshOffset; i < lastMesh; i++)
+	{
+		const vg::rev1::MeshHeader_t* const pMesh = &pMeshes[i];
+
+		if (!(pMesh->flags & (VERTEX_HAS_POSITION | VERTEX_HAS_POSITION_PACKED)) || pMesh->vertCount == 0 || pMesh->indexCount < 3)
+			continue;
+
+		const uint32_t base = static_cast<uint32_t>(surface.positions.size());
+		const bool packed = (pMesh->flags & VERTEX_HAS_POSITION_PACKED) != 0;
+
+		for (uint32_t v = 0; v < pMesh->vertCount; v++)
+			surface.positions.push_back(GetVertexPosition(pVertexData + pMesh->vertOffset + static_cast<size_t>(v) * pMesh->vertCacheSize, packed));
+
+		const uint16_t* const pIndices = reinterpret_cast<const uint16_t*>(pIndexData) + pMesh->indexOffset;
+
+		for (int t = 0; t + 2 < pMesh->indexCount; t += 3)
+		{
+			if (pIndices[t] >= pMesh->vertCount || pIndices[t + 1] >= pMesh->vertCount || pIndices[t + 2] >= pMesh->vertCount)
+				continue;
+
+			for (int k = 0; k < 3; k++)
+			{
+				const Vector& pos = surface.positions[base + pIndices[t + k]];
+
+				surface.indices.push_back(base + pIndices[t + k]);
+
+				for (int a = 0; a < 3; a++)
+				{
+					surface.mins[a] = min(surface.mins[a], pos[a]);
+					surface.maxs[a] = max(surface.maxs[a], pos[a]);
+				}
+			}
+		}
+	}
+}
+
+//
+// BuildTriangleGrid
+// Purpose: bin a surface's triangles into cubic cells, LOD_GRID_CELLS_PER_TRI per cube root of its triangle count
+//			along its longest axis. flat or long surfaces get fewer cells instead of empty layers
+//
+static void BuildTriangleGrid(const s_lodsurface_t& surface, s_trianglegrid_t& grid)
+{
+	const uint32_t triCount = static_cast<uint32_t>(surface.indices.size() / 3);
+	const Vector extent = surface.maxs - surface.mins;
+	const float longest = max(max(extent.x, extent.y), max(extent.z, 1e-4f));
+
+	const float resolution = min(max(LOD_GRID_CELLS_PER_TRI * cbrtf(static_cast<float>(triCount)), 1.0f), static_cast<float>(LOD_GRID_MAX_DIM));
+
+	grid.mins = surface.mins;
+	grid.cellSize = longest / resolution;
+
+	for (int a = 0; a < 3; a++)
+		grid.dims[a] = min(static_cast<int>(extent[a] / grid.cellSize) + 1, LOD_GRID_MAX_DIM);
+
+	const size_t cellCount = static_cast<size_t>(grid.dims[0]) * grid.dims[1] * grid.dims[2];
+
+	std::vector<int> triCells(static_cast<size_t>(triCount) * 6);
+
+	for (uint32_t t = 0; t < triCount; t++)
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			float lo = FLT_MAX;
+			float hi = -FLT_MAX;
+
+			for (int k = 0; k < 3; k++)
+			{
+				const float value = surface.positions[surface.indices[t * 3 + k]][a];
+				lo = min(lo, value);
+				hi = max(hi, value);
+			}
+
+			triCells[t * 6 + a] = min(max(static_cast<int>((lo - grid.mins[a]) / grid.cellSize), 0), grid.dims[a] - 1);
+			triCells[t * 6 + 3 + a] = min(max(static_cast<int>((hi - grid.mins[a]) / grid.cellSize), 0), grid.dims[a] - 1);
+		}
+	}
+
+	// count then fill, so every cell's triangles sit next to each other
+	grid.cellStart.assign(cellCount + 1, 0);
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		std::vector<uint32_t> cellFill;
+		if (pass)
+		{
+			for (size_t c = 0; c < cellCount; c++)
+				grid.cellStart[c + 1] += grid.cellStart[c];
+
+			grid.cellTris.resize(grid.cellStart[cellCount]);
+			cellFill.assign(grid.cellStart.begin(), grid.cellStart.end() - 1);
+		}
+
+		for (uint32_t t = 0; t < triCount; t++)
+		{
+			const int* const pCells = &triCells[t * 6];
+
+			for (int z = pCells[2]; z <= pCells[5]; z++)
+			{
+				for (int y = pCells[1]; y <= pCells[4]; y++)
+				{
+					for (int x = pCells[0]; x <= pCells[3]; x++)
+					{
+						const size_t cell = (static_cast<size_t>(z) * grid.dims[1] + y) * grid.dims[0] + x;
+
+						if (pass)
+							grid.cellTris[cellFill[cell]++] = t;
+						else
+							grid.cellStart[cell + 1]++;
+					}
+				}
+			}
+		}
+	}
+}
+
+//
+// PointTriangleDistanceSqr
+// Purpose: squared distance from p to the closest point of triangle abc, found by which voronoi region of the triangle p is in
+//
+static float PointTriangleDistanceSqr(const Vector& p, const Vector& a, const Vector& b, const Vector& c)
+{
+	const Vector ab = b - a;
+	const Vector ac = c - a;
+	const Vector ap = p - a;
+
+	Vector closest;
+
+	const float d1 = DotProduct(&ab.x, &ap.x);
+	const float d2 = DotProduct(&ac.x, &ap.x);
+
+	const Vector bp = p - b;
+	const float d3 = DotProduct(&ab.x, &bp.x);
+	const float d4 = DotProduct(&ac.x, &bp.x);
+
+	const Vector cp = p - c;
+	const float d5 = DotProduct(&ab.x, &cp.x);
+	const float d6 = DotProduct(&ac.x, &cp.x);
+
+	const float va = d3 * d6 - d5 * d4;
+	const float vb = d5 * d2 - d1 * d6;
+	const float vc = d1 * d4 - d3 * d2;
+
+	if (d1 <= 0.0f && d2 <= 0.0f)
+		closest = a;
+	else if (d3 >= 0.0f && d4 <= d3)
+		closest = b;
+	else if (d6 >= 0.0f && d5 <= d6)
+		closest = c;
+	// degenerate triangles land on an edge with no length, which is just its start
+	else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		closest = d1 > d3 ? a + ab * (d1 / (d1 - d3)) : a;
+	else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		closest = d2 > d6 ? a + ac * (d2 / (d2 - d6)) : a;
+	else if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+		closest = (d4 - d3) + (d5 - d6) > 0.0f ? b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))) : b;
+	else
+	{
+		const float denom = va + vb + vc;
+		closest = denom > 0.0f ? a + ab * (vb / denom) + ac * (vc / denom) : a;
+	}
+
+	const Vector offset = p - closest;
+	return DotProduct(&offset.x, &offset.x);
+}
+
+//
+// GetSurfaceDistanceSqr
+// Purpose: squared distance from p to the closest triangle in the grid, searching shells of cells outward from p's cell.
+//			once the shells r cells out have been searched nothing closer than r cells can be left, and once anything is within
+//			cutoff the caller has no use for the exact distance
+//
+static float GetSurfaceDistanceSqr(const s_lodsurface_t& surface, const s_trianglegrid_t& grid, const Vector& p, const float cutoffSqr, std::vector<uint32_t>& stamps, uint32_t& stamp)
+{
+	int cell[3];
+	for (int a = 0; a < 3; a++)
+		cell[a] = min(max(static_cast<int>((p[a] - grid.mins[a]) / grid.cellSize), 0), grid.dims[a] - 1);
+
+	const int maxShell = max(max(grid.dims[0], grid.dims[1]), grid.dims[2]);
+
+	stamp++;
+	float bestSqr = FLT_MAX;
+
+	for (int r = 0; r < maxShell; r++)
+	{
+		// p can sit anywhere in its own cell, so the shells before this one only cover r - 1 cells around it
+		const float searched = static_cast<float>(r - 1) * grid.cellSize;
+
+		if (bestSqr <= cutoffSqr || (r > 0 && bestSqr <= searched * searched))
+			break;
+
+		const int z0 = max(cell[2] - r, 0), z1 = min(cell[2] + r, grid.dims[2] - 1);
+		const int y0 = max(cell[1] - r, 0), y1 = min(cell[1] + r, grid.dims[1] - 1);
+		const int x0 = max(cell[0] - r, 0), x1 = min(cell[0] + r, grid.dims[0] - 1);
+
+		for (int z = z0; z <= z1; z++)
+		{
+			for (int y = y0; y <= y1; y++)
+			{
+				const bool inner = abs(z - cell[2]) < r && abs(y - cell[1]) < r;
+
+				for (int x = x0; x <= x1; x++)
+				{
+					// only the shell, the cells inside it were searched already
+					if (inner && abs(x - cell[0]) < r)
+						x = min(cell[0] + r, x1 + 1) - 1;
+
+					if (max(max(abs(x - cell[0]), abs(y - cell[1])), abs(z - cell[2])) != r)
+						continue;
+
+					const size_t index = (static_cast<size_t>(z) * grid.dims[1] + y) * grid.dims[0] + x;
+
+					for (uint32_t i = grid.cellStart[index]; i < grid.cellStart[index + 1]; i++)
+					{
+						const uint32_t t = grid.cellTris[i];
+
+						if (stamps[t] == stamp)
+							continue;
+
+						stamps[t] = stamp;
+
+						const float distSqr = PointTriangleDistanceSqr(p, surface.positions[surface.indices[t * 3 + 0]],
+							surface.positions[surface.indices[t * 3 + 1]], surface.positions[surface.indices[t * 3 + 2]]);
+
+						bestSqr = min(bestSqr, distSqr);
+					}
+				}
+			}
+		}
+	}
+
+	return bestSqr;
+}
+
+//
+// GetSurfaceDeviation
+// Purpose: one sided hausdorff distance, how far any vertex or triangle center of 'from' lies from the surface of 'to'.
+//			points that are already closer than the largest distance found can't change the result, so they stop early
+//
+static float GetSurfaceDeviation(const s_lodsurface_t& from, const s_lodsurface_t& to, const s_trianglegrid_t& toGrid)
+{
+	const uint32_t fromTris = static_cast<uint32_t>(from.indices.size() / 3);
+	const uint32_t toTris = static_cast<uint32_t>(to.indices.size() / 3);
+
+	if (fromTris == 0)
+		return 0.0f;
+
+	// a lod that draws nothing loses the whole model
+	if (toTris == 0)
+	{
+		const Vector extent = from.maxs - from.mins;
+		return sqrtf(DotProduct(&extent.x, &extent.x)) * 0.5f;
+	}
+
+	std::vector<uint32_t> stamps(toTris, 0);
+	uint32_t stamp = 0;
+
+	float deviationSqr = 0.0f;
+
+	// only vertices the triangles use, unused ones are never drawn
+	std::vector<bool> visited(from.positions.size(), false);
+
+	for (uint32_t t = 0; t < fromTris; t++)
+	{
+		const Vector& p0 = from.positions[from.indices[t * 3 + 0]];
+		const Vector& p1 = from.positions[from.indices[t * 3 + 1]];
+		const Vector& p2 = from.positions[from.indices[t * 3 + 2]];
+
+		deviationSqr = max(deviationSqr, GetSurfaceDistanceSqr(to, toGrid, (p0 + p1 + p2) / 3.0f, deviationSqr, stamps, stamp));
+
+		for (int k = 0; k < 3; k++)
+		{
+			const uint32_t v = from.indices[t * 3 + k];
+
+			if (visited[v])
+				continue;
+
+			visited[v] = true;
+			deviationSqr = max(deviationSqr, GetSurfaceDistanceSqr(to, toGrid, from.positions[v], deviationSqr, stamps, stamp));
+		}
+	}
+
+	return sqrtf(deviationSqr);
+}
+
+//
+// ComputeLODSwitchPoints_VG
+// Purpose: set the switch point of every lod from how far it deviates from the lod before it (hausdorff distance both ways).
+//			the engine's lod metric is LOD_SWITCH_METRIC_SCALE over the screen height of one unit in pixels, so a deviation
+//			of d units is pixelError pixels tall exactly at metric LOD_SWITCH_METRIC_SCALE * d / pixelError.
+//			switch points never go down, a lod can't be used before the one in front of it
+//
+void ComputeLODSwitchPoints_VG(const char* pIndexData, const char* pVertexData, const vg::rev1::MeshHeader_t* pMeshes, const int meshCount,
+	vg::rev1::ModelLODHeader_t* pLods, const int lodCount, const float pixelError)
+{
+	if (lodCount <= 0)
+		return;
+
+	pLods[0].switchPoint = 0.0f;
+
+	if (lodCount == 1)
+		return;
+
+	std::vector<s_lodsurface_t> surfaces(lodCount);
+	std::vector<s_trianglegrid_t> grids(lodCount);
+
+	ParallelForSections(lodCount, [&](const size_t i)
+	{
+		GatherLODSurface(pIndexData, pVertexData, pMeshes, meshCount, &pLods[i], surfaces[i]);
+
+		if (!surfaces[i].indices.empty())
+			BuildTriangleGrid(surfaces[i], grids[i]);
+	});
+
+	// each direction of each pair of neighbouring lods is its own task
+	std::vector<float> deviations((lodCount - 1) * 2, 0.0f);
+
+	ParallelForSections(deviations.size(), [&](const size_t i)
+	{
+		const size_t lod = i / 2 + 1;
+		const size_t from = (i & 1) ? lod : lod - 1;
+		const size_t to = (i & 1) ? lod - 1 : lod;
+
+		deviations[i] = GetSurfaceDeviation(surfaces[from], surfaces[to], grids[to]);
+	});
+
+	float switchPoint = 0.0f;
+
+	for (int i = 1; i < lodCount; i++)
+	{
+		const float deviation = max(deviations[(i - 1) * 2], deviations[(i - 1) * 2 + 1]);
+		switchPoint = max(switchPoint, LOD_SWITCH_METRIC_SCALE * deviation / pixelError);
+
+		pLods[i].switchPoint = switchPoint;
+
+		printf("  [VG] LOD %i: %zu tris, deviates %.3f units from LOD %i, switch point %.2f\n",
+			i, surfaces[i].indices.size() / 3, deviation, i - 1, switchPoint);
+	}
+}
+
+//
+// CheckVGLayout
+// Purpose: compare a written rev1 vg against its precomputed layout
+// weight pruning only ever shrinks the extra weights, so everything after them may land earlier than planned
+//
+bool CheckVGLayout(const s_vglayout_t& layout, const vg::rev1::VertexGroupHeader_t* pHdr)
+{
+	const struct
+	{
+		const char* name;
+		size_t expected;
+		__int64 actual;
+		bool canShrink;
+	} sections[] = {
+		{ "boneStateChange", layout.boneStateChangeOffset, pHdr->boneStateChangeOffset, false },
+		{ "mesh", layout.meshOffset, pHdr->meshOffset, false },
+		{ "index", layout.indexOffset, pHdr->indexOffset, false },
+		{ "vert", layout.vertOffset, pHdr->vertOffset, false },
+		{ "extraBoneWeight", layout.extraBoneWeightOffset, pHdr->extraBoneWeightOffset, false },
+		{ "unknown", layout.unknownOffset, pHdr->unknownOffset, g_options.pruneWeights },
+		{ "lod", layout.lodOffset, pHdr->lodOffset, g_options.pruneWeights },
+		{ "legacyWeight", layout.legacyWeightOffset, pHdr->legacyWeightOffset, g_options.pruneWeights },
+		{ "strip", layout.stripOffset, pHdr->stripOffset, g_options.pruneWeights },
+		{ "end", layout.size, pHdr->dataSize, g_options.pruneWeights },
+	};
+
+	bool matches = true;
+	for (const auto& section : sections)
+	{
+		const size_t actual = static_cast<size_t>(section.actual);
+		if (actual == section.expected || (section.canShrink && actual < section.expected))
+			continue;
+
+		printf("  [VG] WARNING: %s section at 0x%zx, layout expected 0x%zx\n", section.name, actual, section.expected);
+		matches = false;
+	}
+
+	return matches;
+}
+
+//
+// CalcVertexBounds_VVD
+// Purpose: min/max of every root lod vertex, split into blocks that are bounded in parallel
+//
+bool CalcVertexBounds_VVD(const vvd::vertexFileHeader_t* pVVD, Vector& mins, Vector& maxs)
+{
+	constexpr uint32_t blockSize = 0x10000;
+
+	const uint32_t vertexCount = pVVD->numLODs > 0 ? static_cast<uint32_t>(pVVD->numLODVertexes[0]) : 0;
+	if (vertexCount == 0)
+		return false;
+
+	const size_t blockCount = (vertexCount + blockSize - 1) / blockSize;
+	std::vector<Vector> blockMins(blockCount, Vector(FLT_MAX, FLT_MAX, FLT_MAX));
+	std::vector<Vector> blockMaxs(blockCount, Vector(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+
+	const char* const pPositions = reinterpret_cast<const char*>(&pVVD->GetVertexData(0)->m_vecPosition);
+
+	ParallelForSections(blockCount, [&](const size_t i)
+	{
+		const uint32_t first = static_cast<uint32_t>(i) * blockSize;
+		const uint32_t count = min(blockSize, vertexCount - first);
+
+		g_kernels.ExtendBounds(pPositions + static_cast<size_t>(first) * sizeof(vvd::mstudiovertex_t), sizeof(vvd::mstudiovertex_t), count, &blockMins[i].x, &blockMaxs[i].x);
+	});
+
+	mins = blockMins[0];
+	maxs = blockMaxs[0];
+
+	for (size_t i = 1; i < blockCount; i++)
+	{
+		mins = Vector(min(mins.x, blockMins[i].x), min(mins.y, blockMins[i].y), min(mins.z, blockMins[i].z));
+		maxs = Vector(max(maxs.x, blockMaxs[i].x), max(maxs.y, blockMaxs[i].y), max(maxs.z, blockMaxs[i].z));
+	}
+
+	return true;
+}
+
+static float BoundsVolume(const Vector& mins, const Vector& maxs)
+{
+	return max(maxs.x - mins.x, 0.0f) * max(maxs.y - mins.y, 0.0f) * max(maxs.z - mins.z, 0.0f);
+}
+
+static void PrintBoundsChange(const char* pszName, const Vector& oldMins, const Vector& oldMaxs, const Vector& mins, const Vector& maxs)
+{
+	const float oldVolume = BoundsVolume(oldMins, oldMaxs);
+	const float volume = BoundsVolume(mins, maxs);
+
+	if (oldVolume > 0.0f)
+		printf("  [BOUNDS] %-6s volume %.1f -> %.1f (%+.1f%%)\n", pszName, oldVolume, volume, (volume - oldVolume) / oldVolume * 100.0f);
+	else
+		printf("  [BOUNDS] %-6s was empty, now %.1f\n", pszName, volume);
+}
+
+//
+// CalcBoneExtents
+// Purpose: bound vertices in the space of their bone, GetVertex(v, pos) returns vertex v's bone (-1 for none) and its pose space position
+//
+template <typename GetVertexFn>
+static bool CalcBoneExtents(const uint32_t vertexCount, const std::vector<matrix3x4_t>& poseToBone, s_boneextents_t& extents, const GetVertexFn& GetVertex)
+{
+	constexpr uint32_t blockSize = 0x4000;
+
+	const int numBones = static_cast<int>(poseToBone.size());
+	if (vertexCount == 0 || numBones == 0)
+		return false;
+
+	const size_t blockCount = (vertexCount + blockSize - 1) / blockSize;
+
+	// each vertex's bone (-1 when it has none) and bone space position, grouped by bone once the blocks are done
+	std::vector<int> vertBones(vertexCount, -1);
+	std::vector<Vector> vertLocals(vertexCount);
+
+	std::vector<s_boneextents_t> blockExtents(blockCount);
+	for (s_boneextents_t& block : blockExtents)
+	{
+		block.mins.assign(numBones, Vector(FLT_MAX, FLT_MAX, FLT_MAX));
+		block.maxs.assign(numBones, Vector(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+		block.vertCounts.assign(numBones, 0);
+	}
+
+	ParallelForSections(blockCount, [&](const size_t i)
+	{
+		s_boneextents_t& block = blockExtents[i];
+
+		const uint32_t first = static_cast<uint32_t>(i) * blockSize;
+		const uint32_t last = min(first + blockSize, vertexCount);
+
+		for (uint32_t v = first; v < last; v++)
+		{
+			Vector pos;
+			const int bone = GetVertex(v, pos);
+			if (bone < 0 || bone >= numBones)
+				continue;
+
+			Vector& local = vertLocals[v];
+			VectorTransform(&pos.x, poseToBone[bone], &local.x);
+			vertBones[v] = bone;
+
+			Vector& mins = block.mins[bone];
+			Vector& maxs = block.maxs[bone];
+			mins = Vector(min(mins.x, local.x), min(mins.y, local.y), min(mins.z, local.z));
+			maxs = Vector(max(maxs.x, local.x), max(maxs.y, local.y), max(maxs.z, local.z));
+			block.vertCounts[bone]++;
+		}
+	});
+
+	extents = std::move(blockExtents[0]);
+
+	for (size_t i = 1; i < blockCount; i++)
+	{
+		const s_boneextents_t& block = blockExtents[i];
+
+		for (int bone = 0; bone < numBones; bone++)
+		{
+			Vector& mins = extents.mins[bone];
+			Vector& maxs = extents.maxs[bone];
+			mins = Vector(min(mins.x, block.mins[bone].x), min(mins.y, block.mins[bone].y), min(mins.z, block.mins[bone].z));
+			maxs = Vector(max(maxs.x, block.maxs[bone].x), max(maxs.y, block.maxs[bone].y), max(maxs.z, block.maxs[bone].z));
+			extents.vertCounts[bone] += block.vertCounts[bone];
+		}
+	}
+
+	extents.firstVert.assign(numBones, 0);
+	for (int bone = 1; bone < numBones; bone++)
+		extents.firstVert[bone] = extents.firstVert[bone - 1] + extents.vertCounts[bone - 1];
+
+	std::vector<uint32_t> next = extents.firstVert;
+	extents.verts.resize(numBones > 0 ? extents.firstVert[numBones - 1] + extents.vertCounts[numBones - 1] : 0);
+
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		if (vertBones[v] >= 0)
+			extents.verts[next[vertBones[v]]++] = vertLocals[v];
+	}
+
+	return true;
+}
+
+//
+// CalcBoneExtents_VVD
+// Purpose: bound every root lod vertex in the space of the bone with its largest weight
+//
+bool CalcBoneExtents_VVD(const vvd::vertexFileHeader_t* pVVD, const std::vector<matrix3x4_t>& poseToBone, s_boneextents_t& extents)
+{
+	const uint32_t vertexCount = pVVD->numLODs > 0 ? static_cast<uint32_t>(pVVD->numLODVertexes[0]) : 0;
+
+	return CalcBoneExtents(vertexCount, poseToBone, extents, [pVVD](const uint32_t v, Vector& pos)
+	{
+		const vvd::mstudiovertex_t* const pVert = pVVD->GetVertexData(v);
+		const vvd::mstudioboneweight_t& weights = pVert->m_BoneWeights;
+
+		int bestWeight = 0;
+		for (int w = 1; w < weights.numbones && w < MAX_NUM_BONES_PER_VERT; w++)
+		{
+			if (weights.weight[w] > weights.weight[bestWeight])
+				bestWeight = w;
+		}
+
+		pos = pVert->m_vecPosition;
+		return static_cast<int>(weights.bone[bestWeight]);
+	});
+}
+
+//
+// GetDominantBone_VG
+// Purpose: hardware bone with the largest weight of a vg vertex. without extra bone weights the packed weights and bones hold
+//			every influence, with them the middle influences are in the extra weights and only the first and last are compared
+//
+static int GetDominantBone_VG(const char* const pVert, const uint64_t flags, const bool hasExtraWeights)
+{
+	if (!(flags & VERTEX_HAS_WEIGHT_BONES))
+		return 0;
+
+	const uint32_t weightsOffset = (flags & VERTEX_HAS_POSITION_PACKED) ? sizeof(Vector64) : ((flags & VERTEX_HAS_POSITION) ? sizeof(Vector) : 0);
+	const uint32_t bonesOffset = weightsOffset + ((flags & VERTEX_HAS_WEIGHT_VALUES_N) ? 8 : 0) + ((flags & VERTEX_HAS_WEIGHT_VALUES_2) ? sizeof(vg::mstudiopackedweights_t) : 0);
+
+	vg::mstudiopackedbones_t bones;
+	memcpy(&bones, pVert + bonesOffset, sizeof(bones));
+
+	// the wider weight layout is left alone, we don't know enough about it
+	if (bones.numbones <= 0 || !(flags & VERTEX_HAS_WEIGHT_VALUES_2) || (flags & VERTEX_HAS_WEIGHT_VALUES_N))
+		return bones.bones[0];
+
+	vg::mstudiopackedweights_t weights;
+	memcpy(&weights, pVert + weightsOffset, sizeof(weights));
+
+	const float weight0 = weights.weight[0] / 32767.0f;
+
+	// the last bone gets what is left over, shared with the extra weights between them
+	if (hasExtraWeights)
+		return weight0 * bones.numbones >= 1.0f - weight0 ? bones.bones[0] : bones.bones[1];
+
+	const float weight1 = bones.numbones > 1 ? weights.weight[1] / 32767.0f : 1.0f - weight0;
+	const float influences[3] = { weight0, weight1, bones.numbones > 1 ? 1.0f - weight0 - weight1 : 0.0f };
+
+	int best = 0;
+	for (int i = 1; i < 3; i++)
+	{
+		if (influences[i] > influences[best])
+			best = i;
+	}
+
+	return bones.bones[best];
+}
+
+//
+// CalcBoneExtents_VG
+// Purpose: CalcBoneExtents_VVD for the root lod of a rev1 vg laid out over its vertex data, also bounds the lod in pose space
+//			hardware bones go through the bone states, an empty table means the vertices use model bones directly
+//
+bool CalcBoneExtents_VG(const char* pVertexData, const vg::rev1::MeshHeader_t* pMeshes, const int meshCount, const vg::rev1::ModelLODHeader_t* pLod,
+	const unsigned char* pBoneStates, const int boneStateCount, const std::vector<matrix3x4_t>& poseToBone, s_boneextents_t& extents, Vector& mins, Vector& maxs)
+{
+	const int firstMesh = pLod->meshOffset;
+	const int lastMesh = min(static_cast<int>(pLod->meshOffset) + static_cast<int>(pLod->meshCount), meshCount);
+	if (firstMesh >= lastMesh)
+		return false;
+
+	// each mesh decodes into its own range of the flattened lod
+	std::vector<uint32_t> meshFirstVert(lastMesh - firstMesh + 1, 0);
+	for (int i = firstMesh; i < lastMesh; i++)
+	{
+		const vg::rev1::MeshHeader_t* const pMesh = &pMeshes[i];
+		const uint32_t count = (pMesh->flags & (VERTEX_HAS_POSITION | VERTEX_HAS_POSITION_PACKED)) ? pMesh->vertCount : 0;
+
+		meshFirstVert[i - firstMesh + 1] = meshFirstVert[i - firstMesh] + count;
+	}
+
+	const uint32_t vertexCount = meshFirstVert.back();
+	if (vertexCount == 0)
+		return false;
+
+	std::vector<Vector> positions(vertexCount);
+	std::vector<int> bones(vertexCount, -1);
+
+	ParallelForSections(lastMesh - firstMesh, [&](const size_t i)
+	{
+		const vg::rev1::MeshHeader_t* const pMesh = &pMeshes[firstMesh + i];
+		if (!(pMesh->flags & (VERTEX_HAS_POSITION | VERTEX_HAS_POSITION_PACKED)))
+			return;
+
+		const bool packed = (pMesh->flags & VERTEX_HAS_POSITION_PACKED) != 0;
+		const bool hasExtraWeights = pMesh->extraBoneWeightSize > 0;
+
+		for (uint32_t v = 0; v < pMesh->vertCount; v++)
+		{
+			const char* const pVert = pVertexData + pMesh->vertOffset + static_cast<size_t>(v) * pMesh->vertCacheSize;
+			const uint32_t index = meshFirstVert[i] + v;
+
+			positions[index] = GetVertexPosition(pVert, packed);
+
+			const int hardwareBone = GetDominantBone_VG(pVert, pMesh->flags, hasExtraWeights);
+			if (boneStateCount == 0)
+				bones[index] = hardwareBone;
+			else if (hardwareBone < boneStateCount)
+				bones[index] = pBoneStates[hardwareBone];
+		}
+	});
+
+	mins = Vector(FLT_MAX, FLT_MAX, FLT_MAX);
+	maxs = Vector(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	g_kernels.ExtendBounds(reinterpret_cast<const char*>(positions.data()), sizeof(Vector), vertexCount, &mins.x, &maxs.x);
+
+	return CalcBoneExtents(vertexCount, poseToBone, extents, [&positions, &bones](const uint32_t v, Vector& pos)
+	{
+		pos = positions[v];
+		return bones[v];
+	});
+}
+
+// the model image animation data is read from, tasks don't see g_model so they carry its range with them
+struct s_animreader_t
+{
+	const char* pBase;
+	const char* pEnd;
+
+	inline bool Contains(const void* const p, const size_t size) const
+	{
+		const char* const pChar = reinterpret_cast<const char*>(p);
+		return pChar >= pBase && pChar + size <= pEnd;
+	}
+};
+
+// values to skip past an rle run, indexed by its valid count. the engine's table, see ExtractAnimValue in bone_setup.h
+static const char s_RleSeekLUT[60]
+{
+	1,  15, 16, 2,  7,  8,  2,  15, 0,  3,  15, 0,  4,  15, 0,  5,
+	15, 0,  6,  15, 0,  7,  15, 0,  2,  15, 2,  3,  15, 2,  4,  15,
+	2,  5,  15, 2,  6,  15, 2,  7,  15, 2,  2,  15, 4,  3,  15, 4,
+	4,  15, 4,  5,  15, 4,  6,  15, 4,  7,  15, 4
+};
+
+static const char s_RleFrameBitCountLUT[4]{ 0, 2, 4, 0 };
+static const float s_RleFrameValOffsetLUT[4]{ 0.0f, 3.0f, 15.0f, 0.0f };
+
+constexpr float RLE_ROT_SCALE = 0.00019175345f; // -2pi to 2pi over a short
+constexpr float RLE_SCALE_SCALE = 0.0030518509f; // 0 to 100 over a short
+
+//
+// ExtractRleValue
+// Purpose: one frame of an rle track, false if the track runs outside the model
+//			runs decode the same way as ExtractAnimValue in bone_setup.h
+//
+static bool ExtractRleValue(const s_animreader_t& reader, const r5::mstudioanimvalue_t* pValue, int frame, const float scale, float& out)
+{
+	// find the run that has the frame
+	while (true)
+	{
+		if (!reader.Contains(pValue, sizeof(r5::mstudioanimvalue_t)))
+			return false;
+
+		const int valid = static_cast<unsigned char>(pValue->num.valid);
+		const int total = static_cast<unsigned char>(pValue->num.total);
+
+		if (valid >= 20 || total == 0)
+			return false;
+
+		if (frame < total)
+			break;
+
+		frame -= total;
+		pValue += s_RleSeekLUT[3 * valid] + ((s_RleSeekLUT[3 * valid + 1] + total * s_RleSeekLUT[3 * valid + 2]) / 16);
+	}
+
+	const int valid = static_cast<unsigned char>(pValue->num.valid);
+	const int total = static_cast<unsigned char>(pValue->num.total);
+
+	switch (valid)
+	{
+	// a short per frame
+	case 0:
+	{
+		if (!reader.Contains(pValue, (frame + 2) * sizeof(r5::mstudioanimvalue_t)))
+			return false;
+
+		out = static_cast<float>(pValue[frame + 1].value) * scale;
+		return true;
+	}
+	// a short, then a signed byte per later frame adjusting it
+	case 1:
+	{
+		if (!reader.Contains(pValue, 2 * sizeof(r5::mstudioanimvalue_t) + frame))
+			return false;
+
+		int16_t value = pValue[1].value;
+		if (frame > 0)
+			value += reinterpret_cast<const char*>(&pValue[2])[frame - 1];
+
+		out = static_cast<float>(value) * scale;
+		return true;
+	}
+	// a short, curve terms weighted by powers of the run's cycle, then optional packed adjustments per frame
+	default:
+	{
+		const int bitLUTIndex = (valid - 2) / 6;
+		const int numCurveValues = (valid - 2) % 6;
+
+		const uint8_t bitCount = s_RleFrameBitCountLUT[bitLUTIndex];
+		const int frameBitOffset = frame * bitCount;
+		const int numBitValues = bitLUTIndex ? (frameBitOffset >> 4) + 1 : 0;
+
+		if (!reader.Contains(pValue, (numCurveValues + 2 + numBitValues) * sizeof(r5::mstudioanimvalue_t)))
+			return false;
+
+		const float cycle = total > 1 ? static_cast<float>(frame) / static_cast<float>(total - 1) : 0.0f;
+
+		float value = static_cast<float>(pValue[1].value);
+		float weight = 1.0f;
+
+		for (int i = 0; i < numCurveValues; i++)
+		{
+			weight *= cycle;
+			value += static_cast<float>(pValue[i + 2].value) * weight;
+		}
+
+		if (bitLUTIndex)
+		{
+			const int16_t* const pBits = &pValue[numCurveValues + 2].value;
+			const uint8_t mask = (1 << bitCount) - 1;
+
+			value -= s_RleFrameValOffsetLUT[bitLUTIndex];
+			value += 2.0f * (mask & (pBits[frameBitOffset >> 4] >> (frameBitOffset & 15)));
+		}
+
+		out = value * scale;
+		return true;
+	}
+	}
+}
+
+//
+// ExtractRleAxes
+// Purpose: the axes of a value pointer that have tracks, x y z in that order. the first track is at its offset, later ones
+//			axisIdx1 and axisIdx2 values past it. axes without a track are left as they are
+//
+static bool ExtractRleAxes(const s_animreader_t& reader, const r5::mstudioanim_valueptr_t* pValuePtr, const int frame, const float scale, float* const pAxes)
+{
+	const r5::mstudioanimvalue_t* const pFirst = reinterpret_cast<const r5::mstudioanimvalue_t*>(reinterpret_cast<const char*>(pValuePtr) + pValuePtr->offset);
+	const int trackOffsets[3] = { 0, pValuePtr->axisIdx1, pValuePtr->axisIdx2 };
+
+	int track = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (!(pValuePtr->flags & (STUDIO_ANIMPTR_X >> axis)))
+			continue;
+
+		if (!ExtractRleValue(reader, pFirst + trackOffsets[track++], frame, scale, pAxes[axis]))
+			return false;
+	}
+
+	return true;
+}
+
+//
+// CalcRleBonePose
+// Purpose: position, rotation and scale of one bone at a frame of its rle block, over its base values. false if the block can't be read
+//			animated position and scale tracks are offsets from the base values, animated rotations replace the base angles they have tracks for
+//
+static bool CalcRleBonePose(const s_animreader_t& reader, const r5::mstudio_rle_anim_t* pRle, const int boneFlags, const int frame, const r5::v8::mstudiobone_t& bone,
+	Vector& pos, Quaternion& q, Vector& scale)
+{
+	const char* pData = reinterpret_cast<const char*>(pRle) + sizeof(r5::mstudio_rle_anim_t);
+
+	if (boneFlags & r5::STUDIO_ANIM_POS)
+	{
+		if (pRle->flags & r5::STUDIO_ANIM_ANIMPOS)
+		{
+			if (!reader.Contains(pData, sizeof(float) + sizeof(r5::mstudioanim_valueptr_t)))
+				return false;
+
+			float posScale;
+			memcpy(&posScale, pData, sizeof(float));
+
+			float axes[3] = { 0.0f, 0.0f, 0.0f };
+			if (!ExtractRleAxes(reader, reinterpret_cast<const r5::mstudioanim_valueptr_t*>(pData + sizeof(float)), frame, posScale, axes))
+				return false;
+
+			pos = bone.pos + Vector(axes[0], axes[1], axes[2]);
+			pData += sizeof(float) + sizeof(r5::mstudioanim_valueptr_t);
+		}
+		else
+		{
+			if (!reader.Contains(pData, sizeof(Vector48)))
+				return false;
+
+			Vector48 packedPos;
+			memcpy(&packedPos, pData, sizeof(Vector48));
+			pos = packedPos;
+			pData += sizeof(Vector48);
+		}
+	}
+
+	if (boneFlags & r5::STUDIO_ANIM_ROT)
+	{
+		if (pRle->flags & r5::STUDIO_ANIM_ANIMROT)
+		{
+			if (!reader.Contains(pData, sizeof(r5::mstudioanim_valueptr_t)))
+				return false;
+
+			float axes[3] = { bone.rot.x, bone.rot.y, bone.rot.z };
+			if (!ExtractRleAxes(reader, reinterpret_cast<const r5::mstudioanim_valueptr_t*>(pData), frame, RLE_ROT_SCALE, axes))
+				return false;
+
+			AngleQuaternion(RadianEuler(axes[0], axes[1], axes[2]), q);
+			pData += sizeof(r5::mstudioanim_valueptr_t);
+		}
+		else
+		{
+			if (!reader.Contains(pData, sizeof(Quaternion64)))
+				return false;
+
+			Quaternion64 packedQuat;
+			memcpy(&packedQuat, pData, sizeof(Quaternion64));
+			q = packedQuat;
+			pData += sizeof(Quaternion64);
+		}
+	}
+
+	if (boneFlags & r5::STUDIO_ANIM_SCALE)
+	{
+		if (pRle->flags & r5::STUDIO_ANIM_ANIMSCALE)
+		{
+			if (!reader.Contains(pData, sizeof(r5::mstudioanim_valueptr_t)))
+				return false;
+
+			float axes[3] = { 0.0f, 0.0f, 0.0f };
+			if (!ExtractRleAxes(reader, reinterpret_cast<const r5::mstudioanim_valueptr_t*>(pData), frame, RLE_SCALE_SCALE, axes))
+				return false;
+
+			scale = bone.scale + Vector(axes[0], axes[1], axes[2]);
+		}
+		else
+		{
+			if (!reader.Contains(pData, sizeof(Vector48)))
+				return false;
+
+			Vector48 packedScale;
+			memcpy(&packedScale, pData, sizeof(Vector48));
+			scale = packedScale;
+		}
+	}
+
+	return pos.IsValid() && q.IsValid() && scale.IsValid();
+}
+
+//
+// CalcAnimPose
+// Purpose: bone to pose transforms at one frame of an animation stored with the model, false if it can't be evaluated
+//
+static bool CalcAnimPose(const s_animreader_t& reader, const r5::v8::mstudioanimdesc_t* pAnimDesc, const int frame, const r5::v8::mstudiobone_t* pBones, const int numBones,
+	std::vector<matrix3x4_t>& boneToPose)
+{
+	const char* const pAnim = reinterpret_cast<const char*>(pAnimDesc) + pAnimDesc->animindex;
+	const int flagSize = ((4 * numBones + 7) / 8 + 1) & 0xFFFFFFFE;
+
+	if (!reader.Contains(pAnim, flagSize))
+		return false;
+
+	const char* pBlock = pAnim + flagSize;
+
+	for (int i = 0; i < numBones; i++)
+	{
+		const r5::v8::mstudiobone_t& bone = pBones[i];
+
+		Vector pos = bone.pos;
+		Quaternion q = bone.quat;
+		Vector scale = bone.scale;
+
+		const int boneFlags = (pAnim[i / 2] >> (4 * (i % 2))) & 0x7;
+		if (boneFlags)
+		{
+			const r5::mstudio_rle_anim_t* const pRle = reinterpret_cast<const r5::mstudio_rle_anim_t*>(pBlock);
+			if (!reader.Contains(pRle, sizeof(r5::mstudio_rle_anim_t)) || pRle->size < static_cast<short>(sizeof(r5::mstudio_rle_anim_t)) || !reader.Contains(pRle, pRle->size))
+				return false;
+
+			if (!CalcRleBonePose(reader, pRle, boneFlags, frame, bone, pos, q, scale))
+				return false;
+
+			pBlock += pRle->size;
+		}
+
+		matrix3x4_t local;
+		QuaternionMatrix(q, pos, local);
+
+		for (int row = 0; row < 3; row++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+				local[row][axis] *= scale[axis];
+		}
+
+		// parents come first, the pose is built in one pass
+		if (bone.parent < 0)
+			boneToPose[i] = local;
+		else if (bone.parent < i)
+			ConcatTransforms(boneToPose[bone.parent], local, boneToPose[i]);
+		else
+			return false;
+	}
+
+	return true;
+}
+
+// extend a box by every bone's vertex extents in a pose
+static void ExtendPoseBounds(const s_boneextents_t& extents, const std::vector<matrix3x4_t>& boneToPose, Vector& mins, Vector& maxs)
+{
+	const size_t numBones = min(boneToPose.size(), extents.vertCounts.size());
+
+	for (size_t bone = 0; bone < numBones; bone++)
+	{
+		if (!extents.vertCounts[bone])
+			continue;
+
+		const Vector center = (extents.mins[bone] + extents.maxs[bone]) * 0.5f;
+		const Vector halfSize = (extents.maxs[bone] - extents.mins[bone]) * 0.5f;
+		const matrix3x4_t& m = boneToPose[bone];
+
+		for (int row = 0; row < 3; row++)
+		{
+			const float c = m[row][0] * center.x + m[row][1] * center.y + m[row][2] * center.z + m[row][3];
+			const float r = fabsf(m[row][0]) * halfSize.x + fabsf(m[row][1]) * halfSize.y + fabsf(m[row][2]) * halfSize.z;
+
+			mins[row] = min(mins[row], c - r);
+			maxs[row] = max(maxs[row], c + r);
+		}
+	}
+}
+
+//
+// CalcSequenceBounds
+// Purpose: bounds of every frame of every animation a sequence blends, false if the sequence has to keep its source box
+//			STUDIO_ALLZEROS animations hold the bind pose and get the exact vertex bounds. animations without tracks that aren't
+//			flagged are placeholders for data stored outside the model (v19.1 keeps its animations in rseq assets), and sectioned
+//			animations keep frames outside it as well, so neither can be bounded here
+//
+static bool CalcSequenceBounds(const s_animreader_t& reader, const r5::v8::mstudioseqdesc_t* pSeq, const r5::v8::mstudiobone_t* pBones, const int numBones,
+	const s_boneextents_t& extents, const Vector& bindMins, const Vector& bindMaxs, Vector& mins, Vector& maxs)
+{
+	if (pSeq->flags & STUDIO_DELTA)
+		return false;
+
+	const int numAnims = max(pSeq->groupsize[0] * pSeq->groupsize[1], 1);
+	const int* const pAnimIndices = reinterpret_cast<const int*>(reinterpret_cast<const char*>(pSeq) + pSeq->animindexindex);
+
+	if (!pSeq->animindexindex || !reader.Contains(pAnimIndices, numAnims * sizeof(int)))
+		return false;
+
+	mins = Vector(FLT_MAX, FLT_MAX, FLT_MAX);
+	maxs = Vector(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	std::vector<matrix3x4_t> boneToPose(numBones);
+
+	for (int i = 0; i < numAnims; i++)
+	{
+		const r5::v8::mstudioanimdesc_t* const pAnimDesc = reinterpret_cast<const r5::v8::mstudioanimdesc_t*>(reinterpret_cast<const char*>(pSeq) + pAnimIndices[i]);
+		if (!reader.Contains(pAnimDesc, sizeof(r5::v8::mstudioanimdesc_t)))
+			return false;
+
+		if (pAnimDesc->flags & STUDIO_ALLZEROS)
+		{
+			mins = Vector(min(mins.x, bindMins.x), min(mins.y, bindMins.y), min(mins.z, bindMins.z));
+			maxs = Vector(max(maxs.x, bindMaxs.x), max(maxs.y, bindMaxs.y), max(maxs.z, bindMaxs.z));
+			continue;
+		}
+
+		if (pAnimDesc->animindex <= 0 || pAnimDesc->sectionframes > 0)
+			return false;
+
+		const char* const pAnim = reinterpret_cast<const char*>(pAnimDesc) + pAnimDesc->animindex;
+		const int flagSize = ((4 * numBones + 7) / 8 + 1) & 0xFFFFFFFE;
+
+		if (!reader.Contains(pAnim, flagSize) || std::all_of(pAnim, pAnim + flagSize, [](const char flags) { return (flags & 0x77) == 0; }))
+			return false;
+
+		const int numFrames = max(pAnimDesc->numframes, 1);
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			if (!CalcAnimPose(reader, pAnimDesc, frame, pBones, numBones, boneToPose))
+				return false;
+
+			ExtendPoseBounds(extents, boneToPose, mins, maxs);
+		}
+	}
+
+	return mins.x <= maxs.x && mins.y <= maxs.y && mins.z <= maxs.z;
+}
+
+//
+// ApplyTightBounds
+// Purpose: recompute the sequence boxes of the model being written from its bone extents, then make its view and bvh boxes
+//			the union of the bind pose vertex bounds and every sequence box, and report how much each box changed.
+//			the hull is the movement box rather than a render bound, so it is never touched
+//			every sequence must be written, and the string table not yet, since labels aren't resolved until then
+//
+void ApplyTightBounds(const Vector& bindMins, const Vector& bindMaxs, const s_boneextents_t& extents)
+{
+	r5::v8::studiohdr_t* const pHdr = g_model.hdrV54();
+
+	const r5::v8::mstudiobone_t* const pBones = PTR_FROM_IDX(r5::v8::mstudiobone_t, pHdr, pHdr->boneindex);
+	r5::v8::mstudioseqdesc_t* const pSeqs = PTR_FROM_IDX(r5::v8::mstudioseqdesc_t, pHdr, pHdr->localseqindex);
+
+	const int numSeqs = pHdr->numlocalseq;
+	const s_animreader_t reader{ g_model.pBase, g_model.pData };
+
+	std::vector<Vector> seqMins(numSeqs);
+	std::vector<Vector> seqMaxs(numSeqs);
+	std::vector<char> computed(numSeqs, false);
+
+	ParallelForSections(numSeqs, [&](const size_t i)
+	{
+		computed[i] = CalcSequenceBounds(reader, &pSeqs[i], pBones, pHdr->numbones, extents, bindMins, bindMaxs, seqMins[i], seqMaxs[i]);
+	});
+
+	Vector mins = bindMins;
+	Vector maxs = bindMaxs;
+	int numKept = 0;
+
+	for (int i = 0; i < numSeqs; i++)
+	{
+		r5::v8::mstudioseqdesc_t* const pSeq = &pSeqs[i];
+
+		if (computed[i])
+		{
+			char name[16];
+			snprintf(name, sizeof(name), "seq %i", i);
+			PrintBoundsChange(name, pSeq->bbmin, pSeq->bbmax, seqMins[i], seqMaxs[i]);
+
+			pSeq->bbmin = seqMins[i];
+			pSeq->bbmax = seqMaxs[i];
+		}
+		else
+			numKept++;
+
+		// delta sequences add onto another sequence's pose, their box doesn't bound the model
+		if (pSeq->flags & STUDIO_DELTA)
+			continue;
+
+		mins = Vector(min(mins.x, pSeq->bbmin.x), min(mins.y, pSeq->bbmin.y), min(mins.z, pSeq->bbmin.z));
+		maxs = Vector(max(maxs.x, pSeq->bbmax.x), max(maxs.y, pSeq->bbmax.y), max(maxs.z, pSeq->bbmax.z));
+	}
+
+	if (numKept > 0)
+		printf("  [BOUNDS] %i of %i sequences kept their source box (delta, sectioned or stored outside the model)\n", numKept, numSeqs);
+
+	PrintBoundsChange("view", pHdr->view_bbmin, pHdr->view_bbmax, mins, maxs);
+
+	pHdr->mins = mins;
+	pHdr->maxs = maxs;
+	pHdr->view_bbmin = mins;
+	pHdr->view_bbmax = maxs;
+}
+
+//
+// ApplyTightBounds_VVD
+// Purpose: ApplyTightBounds from the root lod of a vvd, the model's bones must still be in vvd order
+//
+void ApplyTightBounds_VVD(const vvd::vertexFileHeader_t* pVVD)
+{
+	const r5::v8::studiohdr_t* const pHdr = g_model.hdrV54();
+
+	Vector mins, maxs;
+	s_boneextents_t extents;
+
+	if (!CalcVertexBounds_VVD(pVVD, mins, maxs) || !CalcBoneExtents_VVD(pVVD, PTR_FROM_IDX(r5::v8::mstudiobone_t, pHdr, pHdr->boneindex), pHdr->numbones, extents))
+	{
+		printf("  [BOUNDS] skipped, the vvd has no root lod vertices\n");
+		return;
+	}
+
+	ApplyTightBounds(mins, maxs, extents);
+}
+
+//
+// ApplyTightBounds_VG
+// Purpose: ApplyTightBounds from the root lod of a rev1 vg laid out over its vertex data, its bone states must follow the model's bones
+//
+void ApplyTightBounds_VG(const char* pVertexData, const vg::rev1::MeshHeader_t* pMeshes, const int meshCount, const vg::rev1::ModelLODHeader_t* pLods, const int lodCount,
+	const unsigned char* pBoneStates, const int boneStateCount)
+{
+	const r5::v8::studiohdr_t* const pHdr = g_model.hdrV54();
+	const r5::v8::mstudiobone_t* const pBones = PTR_FROM_IDX(r5::v8::mstudiobone_t, pHdr, pHdr->boneindex);
+
+	std::vector<matrix3x4_t> poseToBone(pHdr->numbones);
+	for (int i = 0; i < pHdr->numbones; i++)
+		poseToBone[i] = pBones[i].poseToBone;
+
+	Vector mins, maxs;
+	s_boneextents_t extents;
+
+	if (lodCount <= 0 || !CalcBoneExtents_VG(pVertexData, pMeshes, meshCount, &pLods[0], pBoneStates, boneStateCount, poseToBone, extents, mins, maxs))
+	{
+		printf("  [BOUNDS] skipped, the vg has no root lod vertices\n");
+		return;
+	}
+
+	ApplyTightBounds(mins, maxs, extents);
+}
+
+//
+// FitClippedHitbox
+// Purpose: bounds of a bone's vertices inside a box, false if there are too few to describe one
+//
+static bool FitClippedHitbox(const s_boneextents_t& extents, const int bone, const Vector& clipMin, const Vector& clipMax, const uint32_t minVerts, Vector& mins, Vector& maxs)
+{
+	mins = Vector(FLT_MAX, FLT_MAX, FLT_MAX);
+	maxs = Vector(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	uint32_t count = 0;
+
+	const uint32_t first = extents.firstVert[bone];
+	for (uint32_t v = first; v < first + extents.vertCounts[bone]; v++)
+	{
+		const Vector& pos = extents.verts[v];
+		if (pos.x < clipMin.x || pos.y < clipMin.y || pos.z < clipMin.z || pos.x > clipMax.x || pos.y > clipMax.y || pos.z > clipMax.z)
+			continue;
+
+		mins = Vector(min(mins.x, pos.x), min(mins.y, pos.y), min(mins.z, pos.z));
+		maxs = Vector(max(maxs.x, pos.x), max(maxs.y, pos.y), max(maxs.z, pos.z));
+		count++;
+	}
+
+	return count >= minVerts && BoundsVolume(mins, maxs) > 0.0f;
+}
+
+//
+// FitHitboxSet
+// Purpose: refit and compact the hitboxes of one set in place
+// a bone's only hitbox in the set is fit to all of its vertices. a bone with several (head, neck, jaw on one bone) fits
+// each to the vertices inside its own source box grown by a margin, so they don't all become the same box
+// two hitboxes of the same bone and group are merged if their union is barely bigger than the larger one,
+// which also covers exact duplicates and boxes inside other boxes
+//
+void FitHitboxSet(std::vector<s_hitboxfit_t>& hitboxes, const s_boneextents_t* pBoneExtents, s_hitboxfitstats_t& stats)
+{
+	// fewer vertices than this can't describe a box, keep the source one
+	constexpr uint32_t minRefitVerts = 4;
+	constexpr float minExtent = 0.01f;
+	constexpr float mergeTolerance = 1.05f;
+
+	// share of its size a source box grows by on each side before it clips the bone's vertices, and the least it grows
+	constexpr float clipMarginScale = 0.25f;
+	constexpr float clipMarginMin = 0.5f;
+
+	// bones that have a hitbox in this set, and the ones that have several
+	byteset hitboxBones;
+	byteset sharedBones;
+	for (const s_hitboxfit_t& hitbox : hitboxes)
+	{
+		if (hitbox.bone >= 0 && hitbox.bone <= 0xFF && !hitboxBones.insert(static_cast<unsigned char>(hitbox.bone)))
+			sharedBones.insert(static_cast<unsigned char>(hitbox.bone));
+	}
+
+	for (s_hitboxfit_t& hitbox : hitboxes)
+	{
+		hitbox.keep = true;
+		stats.numHitboxes++;
+		stats.volumeIn += BoundsVolume(hitbox.bbmin, hitbox.bbmax);
+
+		if (!g_options.refitHitboxes || !pBoneExtents || hitbox.bone < 0 || hitbox.bone >= static_cast<int>(pBoneExtents->vertCounts.size()))
+			continue;
+
+		if (pBoneExtents->vertCounts[hitbox.bone] < minRefitVerts)
+			continue;
+
+		if (hitbox.bone <= 0xFF && sharedBones.count(static_cast<unsigned char>(hitbox.bone)))
+		{
+			const Vector size = hitbox.bbmax - hitbox.bbmin;
+			const Vector margin(max(size.x * clipMarginScale, clipMarginMin), max(size.y * clipMarginScale, clipMarginMin), max(size.z * clipMarginScale, clipMarginMin));
+
+			Vector mins, maxs;
+			if (!FitClippedHitbox(*pBoneExtents, hitbox.bone, hitbox.bbmin - margin, hitbox.bbmax + margin, minRefitVerts, mins, maxs))
+				continue;
+
+			hitbox.bbmin = mins;
+			hitbox.bbmax = maxs;
+			stats.numRefit++;
+			continue;
+		}
+
+		const Vector& mins = pBoneExtents->mins[hitbox.bone];
+		const Vector& maxs = pBoneExtents->maxs[hitbox.bone];
+		if (BoundsVolume(mins, maxs) <= 0.0f)
+			continue;
+
+		hitbox.bbmin = mins;
+		hitbox.bbmax = maxs;
+		stats.numRefit++;
+	}
+
+	if (g_options.mergeHitboxes)
+	{
+		for (s_hitboxfit_t& hitbox : hitboxes)
+		{
+			const Vector size = hitbox.bbmax - hitbox.bbmin;
+			if (size.x < minExtent || size.y < minExtent || size.z < minExtent)
+			{
+				hitbox.keep = false;
+				stats.numDegenerate++;
+			}
+		}
+
+		for (size_t i = 0; i < hitboxes.size(); i++)
+		{
+			s_hitboxfit_t& target = hitboxes[i];
+			if (!target.keep)
+				continue;
+
+			for (size_t j = i + 1; j < hitboxes.size(); j++)
+			{
+				s_hitboxfit_t& other = hitboxes[j];
+				if (!other.keep || other.bone != target.bone || other.group != target.group)
+					continue;
+
+				const Vector unionMin(min(target.bbmin.x, other.bbmin.x), min(target.bbmin.y, other.bbmin.y), min(target.bbmin.z, other.bbmin.z));
+				const Vector unionMax(max(target.bbmax.x, other.bbmax.x), max(target.bbmax.y, other.bbmax.y), max(target.bbmax.z, other.bbmax.z));
+
+				const float largest = max(BoundsVolume(target.bbmin, target.bbmax), BoundsVolume(other.bbmin, other.bbmax));
+				if (BoundsVolume(unionMin, unionMax) > largest * mergeTolerance)
+					continue;
+
+				target.bbmin = unionMin;
+				target.bbmax = unionMax;
+				other.keep = false;
+				stats.numMerged++;
+			}
+		}
+	}
+
+	for (const s_hitboxfit_t& hitbox : hitboxes)
+	{
+		if (hitbox.keep)
+			stats.volumeOut += BoundsVolume(hitbox.bbmin, hitbox.bbmax);
+	}
+}
+
+void PrintHitboxFitStats(const s_hitboxfitstats_t& stats)
+{
+	if (!g_options.refitHitboxes && !g_options.mergeHitboxes)
+		return;
+
+	const double change = stats.volumeIn > 0.0 ? (stats.volumeOut - stats.volumeIn) / stats.volumeIn * 100.0 : 0.0;
+
+	printf("  [HITBOX] %d hitboxes, %d refit, %d degenerate dropped, %d merged, volume %.1f -> %.1f (%+.1f%%)\n",
+		stats.numHitboxes, stats.numRefit, stats.numDegenerate, stats.numMerged, stats.volumeIn, stats.volumeOut, change);
+}
+
+//
+// BuildTextureRemap
+// Purpose: mark every texture some family can put on a mesh, the rest are left out of the texture table
+//
+void BuildTextureRemap(const short* pOldSkinRef, const int numSkinRef, const int numSkinFamilies, const int numTextures)
+{
+	g_model.textureRemap.clear();
+
+	if (!g_options.cullMaterials || numSkinRef <= 0 || numSkinFamilies <= 0 || numTextures <= 0)
+		return;
+
+	// no meshes (animation or rig only) or a mesh that reads past its family row, nothing is safe to cull
+	const int numUsedSkinRef = GetUsedSkinRefCount(g_model.hdrV54());
+	if (numUsedSkinRef <= 0 || numUsedSkinRef > numSkinRef)
+		return;
+
+	std::vector<int> remap(numTextures, -1);
+	for (int i = 0; i < numSkinFamilies; i++)
+	{
+		for (int j = 0; j < numUsedSkinRef; j++)
+		{
+			const short texture = pOldSkinRef[i * numSkinRef + j];
+			if (texture >= 0 && texture < numTextures)
+				remap[texture] = 0;
+		}
+	}
+
+	int numKept = 0;
+	for (int& index : remap)
+	{
+		if (index == 0)
+			index = numKept++;
+	}
+
+	if (numKept == numTextures)
+		return;
+
+	printf("  [MATERIAL] culled %i of %i textures that no mesh references\n", numTextures - numKept, numTextures);
+
+	g_model.textureRemap = std::move(remap);
+}
+
+// culled textures can still be in columns no mesh reads, point those at the first texture
+static void RemapSkinTextures(short* pSkinRef, const int count)
+{
+	if (g_model.textureRemap.empty())
+		return;
+
+	const int numTextures = static_cast<int>(g_model.textureRemap.size());
+	for (int i = 0; i < count; i++)
+	{
+		if (pSkinRef[i] >= 0 && pSkinRef[i] < numTextures)
+			pSkinRef[i] = static_cast<short>(max(g_model.textureRemap[pSkinRef[i]], 0));
+	}
+
+	g_model.textureRemap.clear();
+}
+
+//
+// WriteSkinTable
+// Purpose: copy a numSkinFamilies x numSkinRef skin table, optionally trimming the columns no mesh reads
+// and dropping trailing families that are identical to an earlier one
+//
+int WriteSkinTable(const short* pOldSkinRef, const int numSkinRef, const int numSkinFamilies, const int numUsedSkinRef, std::vector<int>& families)
+{
+	families.clear();
+
+	if (!g_options.compactSkins || numSkinRef <= 0 || numSkinFamilies <= 0)
+	{
+		for (int i = 0; i < numSkinFamilies; i++)
+			families.push_back(i);
+
+		const size_t skinIndexDataSize = sizeof(short) * numSkinRef * numSkinFamilies;
+		memcpy(g_model.pData, pOldSkinRef, skinIndexDataSize);
+		RemapSkinTextures(reinterpret_cast<short*>(g_model.pData), numSkinRef * numSkinFamilies);
+		g_model.pData += skinIndexDataSize;
+
+		return numSkinRef;
+	}
+
+	// a mesh past numskinref already reads into the next family, leave those tables as they are
+	const int newNumSkinRef = numUsedSkinRef > 0 && numUsedSkinRef < numSkinRef ? numUsedSkinRef : numSkinRef;
+	const size_t rowSize = sizeof(short) * newNumSkinRef;
+
+	// skins are picked by index, so only duplicates after the last distinct family can go without renumbering the others
+	// the default skin is never a duplicate. the trimmed columns are never read and can differ
+	int numNewFamilies = 1;
+	for (int i = 1; i < numSkinFamilies; i++)
+	{
+		const short* const pRow = pOldSkinRef + i * numSkinRef;
+
+		bool duplicate = false;
+		for (int j = 0; j < i; j++)
+		{
+			if (!memcmp(pOldSkinRef + j * numSkinRef, pRow, rowSize))
+			{
+				duplicate = true;
+				break;
+			}
+		}
+
+		if (!duplicate)
+			numNewFamilies = i + 1;
+	}
+
+	short* const pNewSkinRef = reinterpret_cast<short*>(g_model.pData);
+
+	for (int i = 0; i < numNewFamilies; i++)
+	{
+		memcpy(pNewSkinRef + i * newNumSkinRef, pOldSkinRef + i * numSkinRef, rowSize);
+		families.push_back(i);
+	}
+
+	RemapSkinTextures(pNewSkinRef, newNumSkinRef * numNewFamilies);
+	g_model.pData += rowSize * numNewFamilies;
+
+	if (newNumSkinRef != numSkinRef || numNewFamilies != numSkinFamilies)
+	{
+		printf("  [SKIN] compacted %i skins x %i skinrefs to %i x %i (%zu -> %zu bytes)\n", numSkinFamilies, numSkinRef, numNewFamilies, newNumSkinRef,
+			sizeof(short) * numSkinRef * numSkinFamilies, rowSize * numNewFamilies);
+	}
+
+	return newNumSkinRef;
+}
+
+static bool IsInModelData(const void* const p, const size_t size)
+{
+	const char* const pChar = reinterpret_cast<const char*>(p);
+	return pChar >= g_model.pBase && pChar + size <= g_model.pData;
+}
+
+template <typename T>
+static void PermuteBoneArray(T* const pArray, const std::vector<int>& order)
+{
+	const std::vector<T> old(pArray, pArray + order.size());
+	for (size_t i = 0; i < order.size(); i++)
+		pArray[i] = old[order[i]];
+}
+
+//
+// GetBoneAnimSize
+// Purpose: size of a per bone rle animation (nibble flags, then one block for each animated bone), 0 if it runs past the model data
+//
+static size_t GetBoneAnimSize(const char* const pAnim, const int numBones)
+{
+	const int flagSize = ((4 * numBones + 7) / 8 + 1) & 0xFFFFFFFE;
+	if (!IsInModelData(pAnim, flagSize))
+		return 0;
+
+	size_t size = flagSize;
+	for (int i = 0; i < numBones; i++)
+	{
+		if (!((pAnim[i / 2] >> (4 * (i % 2))) & 0x7))
+			continue;
+
+		const r5::mstudio_rle_anim_t* const pRle = reinterpret_cast<const r5::mstudio_rle_anim_t*>(pAnim + size);
+		if (!IsInModelData(pRle, sizeof(r5::mstudio_rle_anim_t)) || pRle->size < static_cast<short>(sizeof(r5::mstudio_rle_anim_t)) || !IsInModelData(pRle, pRle->size))
+			return 0;
+
+		size += pRle->size;
+	}
+
+	return size;
+}
+
+// rle blocks only point inside themselves, so they can be moved as they are. tracks of bones past numKept are dropped,
+// which leaves the rest of the old size as zeroes
+static void ReorderBoneAnim(char* const pAnim, const size_t size, const std::vector<int>& order, const int numKept)
+{
+	const int numBones = static_cast<int>(order.size());
+	const int flagSize = ((4 * numBones + 7) / 8 + 1) & 0xFFFFFFFE;
+	const int newFlagSize = ((4 * numKept + 7) / 8 + 1) & 0xFFFFFFFE;
+
+	const std::vector<char> old(pAnim, pAnim + size);
+
+	std::vector<size_t> blockOffsets(numBones, 0);
+	size_t offset = flagSize;
+	for (int i = 0; i < numBones; i++)
+	{
+		blockOffsets[i] = offset;
+		if ((old[i / 2] >> (4 * (i % 2))) & 0x7)
+			offset += reinterpret_cast<const r5::mstudio_rle_anim_t*>(&old[offset])->size;
+	}
+
+	memset(pAnim, 0, size);
+
+	offset = newFlagSize;
+	for (int i = 0; i < numKept; i++)
+	{
+		const int oldBone = order[i];
+		const char flags = (old[oldBone / 2] >> (4 * (oldBone % 2))) & 0xF;
+		pAnim[i / 2] |= flags << (4 * (i % 2));
+
+		if (!(flags & 0x7))
+			continue;
+
+		const short blockSize = reinterpret_cast<const r5::mstudio_rle_anim_t*>(&old[blockOffsets[oldBone]])->size;
+		memcpy(pAnim + offset, &old[blockOffsets[oldBone]], blockSize);
+		offset += blockSize;
+	}
+}
+
+//
+// ReorderProceduralBones
+// Purpose: move the jiggle structs and proc bone tables over to the reordered bones, proc bones are never dropped
+//
+static void ReorderProceduralBones(r5::v8::studiohdr_t* const pHdr, r5::v8::mstudiobone_t* const pBones, const std::vector<int>& order, const std::vector<int>& remap, const int numKept)
+{
+	const int numBones = pHdr->numbones;
+
+	std::vector<int> procBones;
+	for (int i = 0; i < numBones; i++)
+	{
+		if (pBones[i].proctype > 0 && pBones[i].procindex && IsInModelData(reinterpret_cast<char*>(&pBones[i]) + pBones[i].procindex, sizeof(r5::v8::mstudiojigglebone_t)))
+			procBones.push_back(i);
+	}
+
+	if (procBones.empty())
+		return;
+
+	auto GetJiggleBone = [&pBones](const int bone) { return reinterpret_cast<r5::v8::mstudiojigglebone_t*>(reinterpret_cast<char*>(&pBones[bone]) + pBones[bone].procindex); };
+	auto RemapJiggleBone = [&remap, numBones](r5::v8::mstudiojigglebone_t& jiggleBone) { if (jiggleBone.bone < numBones) jiggleBone.bone = static_cast<uint8_t>(remap[jiggleBone.bone]); };
+
+	// the converters write one jiggle struct per proc bone back to back, in bone order
+	r5::v8::mstudiojigglebone_t* pJiggleBones = GetJiggleBone(procBones[0]);
+	for (const int bone : procBones)
+		pJiggleBones = min(pJiggleBones, GetJiggleBone(bone));
+
+	const int count = static_cast<int>(procBones.size());
+	std::vector<bool> slots(count, false);
+	bool contiguous = pHdr->procBoneCount == count && pHdr->procBoneTableOffset && pHdr->linearProcBoneOffset;
+
+	for (size_t i = 0; i < procBones.size() && contiguous; i++)
+	{
+		const ptrdiff_t slot = GetJiggleBone(procBones[i]) - pJiggleBones;
+		if (slot < 0 || slot >= count || slots[slot])
+			contiguous = false;
+		else
+			slots[slot] = true;
+	}
+
+	unsigned char* const pProcBoneTable = PTR_FROM_IDX(unsigned char, pHdr, pHdr->procBoneTableOffset);
+	unsigned char* const pLinearProcBones = PTR_FROM_IDX(unsigned char, pHdr, pHdr->linearProcBoneOffset);
+
+	if (contiguous)
+	{
+		const std::vector<r5::v8::mstudiojigglebone_t> oldJiggleBones(pJiggleBones, pJiggleBones + count);
+		std::vector<r5::v8::mstudiojigglebone_t> newJiggleBones(count);
+
+		memset(pLinearProcBones, 0xff, numKept);
+
+		for (int i = 0; i < count; i++)
+		{
+			const int bone = procBones[i];
+
+			newJiggleBones[i] = oldJiggleBones[GetJiggleBone(bone) - pJiggleBones];
+			RemapJiggleBone(newJiggleBones[i]);
+
+			pBones[bone].procindex = static_cast<int>(reinterpret_cast<char*>(pJiggleBones + i) - reinterpret_cast<char*>(&pBones[bone]));
+
+			pProcBoneTable[i] = static_cast<unsigned char>(bone);
+			pLinearProcBones[bone] = static_cast<unsigned char>(i);
+		}
+
+		memcpy(pJiggleBones, newJiggleBones.data(), count * sizeof(r5::v8::mstudiojigglebone_t));
+		return;
+	}
+
+	// laid out some other way, renumber in place and leave the table out of order
+	for (const int bone : procBones)
+		RemapJiggleBone(*GetJiggleBone(bone));
+
+	if (pHdr->procBoneTableOffset)
+	{
+		for (int i = 0; i < pHdr->procBoneCount; i++)
+		{
+			if (pProcBoneTable[i] < numBones)
+				pProcBoneTable[i] = static_cast<unsigned char>(remap[pProcBoneTable[i]]);
+		}
+	}
+
+	if (pHdr->linearProcBoneOffset)
+		PermuteBoneArray(pLinearProcBones, order);
+}
+
+//
+// ApplyBoneOrder
+// Purpose: move the bones of g_model to the order given (new bone -> old bone) and remap everything that stores a bone index,
+// bones past numKept are dropped. the string table still holds pointers into the bones, so this runs before it is written
+//
+static bool ApplyBoneOrder(const std::vector<int>& order, const int numKept)
+{
+	r5::v8::studiohdr_t* const pHdr = g_model.hdrV54();
+	r5::v8::mstudiobone_t* const pBones = PTR_FROM_IDX(r5::v8::mstudiobone_t, pHdr, pHdr->boneindex);
+	const int numBones = pHdr->numbones;
+
+	// old bone -> new bone
+	std::vector<int> remap(numBones);
+	for (int i = 0; i < numBones; i++)
+		remap[order[i]] = i;
+
+	auto RemapBone = [&remap, numBones](int& bone) { if (bone >= 0 && bone < numBones) bone = remap[bone]; };
+
+	// find every animation up front, one that can't be walked means the data isn't safe to touch at all
+	std::vector<std::pair<char*, size_t>> anims;
+	std::set<char*> seenAnims;
+	bool validAnims = true;
+
+	for (int i = 0; i < pHdr->numlocalanim && validAnims; i++)
+	{
+		r5::v8::mstudioanimdesc_t* const pAnimDesc = PTR_FROM_IDX(r5::v8::mstudioanimdesc_t, pHdr, pHdr->localanimindex) + i;
+
+		if ((pAnimDesc->flags & STUDIO_ALLZEROS) || !(pAnimDesc->flags & STUDIO_ANIM_UNK))
+			continue;
+
+		std::vector<char*> animPtrs;
+		if (pAnimDesc->sectionframes > 0 && pAnimDesc->sectionindex)
+		{
+			const int numSections = (pAnimDesc->numframes - 1 + pAnimDesc->sectionframes - 1) / pAnimDesc->sectionframes + 1;
+			const r5::v8::mstudioanimsections_t* const pSections = PTR_FROM_IDX(r5::v8::mstudioanimsections_t, pAnimDesc, pAnimDesc->sectionindex);
+
+			if (!IsInModelData(pSections, numSections * sizeof(r5::v8::mstudioanimsections_t)))
+			{
+				validAnims = false;
+				break;
+			}
+
+			for (int j = 0; j < numSections; j++)
+				animPtrs.push_back(PTR_FROM_IDX(char, pAnimDesc, pSections[j].animindex));
+		}
+		else
+		{
+			animPtrs.push_back(PTR_FROM_IDX(char, pAnimDesc, pAnimDesc->animindex));
+		}
+
+		for (char* const pAnim : animPtrs)
+		{
+			if (seenAnims.count(pAnim))
+				continue;
+
+			const size_t size = GetBoneAnimSize(pAnim, numBones);
+			if (!size)
+			{
+				validAnims = false;
+				break;
+			}
+
+			seenAnims.insert(pAnim);
+			anims.emplace_back(pAnim, size);
+		}
+	}
+
+	if (!validAnims)
+	{
+		printf("  [BONES] WARNING: model has animation data that could not be read, bones were left as they were\n");
+		return false;
+	}
+
+	// bones, the string table entries pointing into them and their jiggle structs
+	for (stringentry_t& entry : g_model.stringTable)
+	{
+		const ptrdiff_t offset = reinterpret_cast<char*>(entry.ptr) - reinterpret_cast<char*>(pBones);
+		if (!entry.ptr || offset < 0 || offset >= static_cast<ptrdiff_t>(numBones * sizeof(r5::v8::mstudiobone_t)))
+			continue;
+
+		const int bone = static_cast<int>(offset / sizeof(r5::v8::mstudiobone_t));
+		const ptrdiff_t delta = (remap[bone] - bone) * static_cast<ptrdiff_t>(sizeof(r5::v8::mstudiobone_t));
+
+		entry.ptr = reinterpret_cast<int*>(reinterpret_cast<char*>(entry.ptr) + delta);
+		entry.base += delta;
+	}
+
+	for (int i = 0; i < numBones; i++)
+	{
+		if (pBones[i].proctype > 0 && pBones[i].procindex)
+			pBones[i].procindex += (i - remap[i]) * static_cast<int>(sizeof(r5::v8::mstudiobone_t));
+	}
+
+	PermuteBoneArray(pBones, order);
+
+	for (int i = 0; i < numKept; i++)
+		RemapBone(pBones[i].parent);
+
+	ReorderProceduralBones(pHdr, pBones, order, remap, numKept);
+
+	// still sorted by name once the removed bones are left out
+	if (pHdr->bonetablebynameindex)
+	{
+		unsigned char* const pBoneTable = PTR_FROM_IDX(unsigned char, pHdr, pHdr->bonetablebynameindex);
+
+		int count = 0;
+		for (int i = 0; i < numBones; i++)
+		{
+			if (pBoneTable[i] < numBones && remap[pBoneTable[i]] < numKept)
+				pBoneTable[count++] = static_cast<unsigned char>(remap[pBoneTable[i]]);
+		}
+	}
+
+	if (pHdr->linearboneindex)
+	{
+		r5::v8::mstudiolinearbone_t* const pLinearBone = PTR_FROM_IDX(r5::v8::mstudiolinearbone_t, pHdr, pHdr->linearboneindex);
+
+		if (pLinearBone->numbones == numBones)
+		{
+			PermuteBoneArray(pLinearBone->pFlags(0), order);
+			PermuteBoneArray(pLinearBone->pParent(0), order);
+			PermuteBoneArray(const_cast<Vector*>(pLinearBone->pPos(0)), order);
+			PermuteBoneArray(const_cast<Quaternion*>(pLinearBone->pQuat(0)), order);
+			PermuteBoneArray(const_cast<RadianEuler*>(pLinearBone->pRot(0)), order);
+			PermuteBoneArray(const_cast<matrix3x4_t*>(pLinearBone->pPoseToBone(0)), order);
+
+			for (int i = 0; i < numKept; i++)
+				RemapBone(*pLinearBone->pParent(i));
+
+			pLinearBone->numbones = numKept;
+		}
+
+		// the converters only write a linear table for more than one bone
+		if (numKept <= 1)
+			pHdr->linearboneindex = 0;
+	}
+
+	for (int i = 0; i < pHdr->numhitboxsets; i++)
+	{
+		r5::v8::mstudiohitboxset_t* const pSet = PTR_FROM_IDX(r5::v8::mstudiohitboxset_t, pHdr, pHdr->hitboxsetindex) + i;
+		r5::v8::mstudiobbox_t* const pHitboxes = PTR_FROM_IDX(r5::v8::mstudiobbox_t, pSet, pSet->hitboxindex);
+
+		for (int j = 0; j < pSet->numhitboxes; j++)
+			RemapBone(pHitboxes[j].bone);
+	}
+
+	r5::v8::mstudioattachment_t* const pAttachments = PTR_FROM_IDX(r5::v8::mstudioattachment_t, pHdr, pHdr->localattachmentindex);
+	for (int i = 0; i < pHdr->numlocalattachments; i++)
+		RemapBone(pAttachments[i].localbone);
+
+	for (int i = 0; i < pHdr->numikchains; i++)
+	{
+		r5::v8::mstudioikchain_t* const pChain = PTR_FROM_IDX(r5::v8::mstudioikchain_t, pHdr, pHdr->ikchainindex) + i;
+		for (int j = 0; j < pChain->numlinks; j++)
+			RemapBone(pChain->pLink(j)->bone);
+	}
+
+	int* const pBoneFollowers = PTR_FROM_IDX(int, pHdr, pHdr->boneFollowerOffset);
+	for (int i = 0; i < pHdr->boneFollowerCount && pHdr->boneFollowerOffset; i++)
+		RemapBone(pBoneFollowers[i]);
+
+	for (int i = 0; i < pHdr->uiPanelCount && pHdr->uiPanelOffset; i++)
+	{
+		r5::v8::mstudiorruiheader_t* const pPanel = PTR_FROM_IDX(r5::v8::mstudiorruiheader_t, pHdr, pHdr->uiPanelOffset) + i;
+		r5::v8::mstudioruimesh_t* const pMesh = PTR_FROM_IDX(r5::v8::mstudioruimesh_t, pPanel, pPanel->ruimeshindex);
+		short* const pParents = reinterpret_cast<short*>(reinterpret_cast<char*>(pMesh) + sizeof(r5::v8::mstudioruimesh_t) + pMesh->parentindex);
+
+		for (int j = 0; j < pMesh->numparents; j++)
+		{
+			if (pParents[j] >= 0 && pParents[j] < numBones)
+				pParents[j] = static_cast<short>(remap[pParents[j]]);
+		}
+	}
+
+	for (int i = 0; i < pHdr->numlocalanim; i++)
+	{
+		r5::v8::mstudioanimdesc_t* const pAnimDesc = PTR_FROM_IDX(r5::v8::mstudioanimdesc_t, pHdr, pHdr->localanimindex) + i;
+		if (!pAnimDesc->ikruleindex)
+			continue;
+
+		r5::v8::mstudioikrule_t* const pIkRules = PTR_FROM_IDX(r5::v8::mstudioikrule_t, pAnimDesc, pAnimDesc->ikruleindex);
+		for (int j = 0; j < pAnimDesc->numikrules; j++)
+			RemapBone(pIkRules[j].bone);
+	}
+
+	for (const auto& anim : anims)
+		ReorderBoneAnim(anim.first, anim.second, order, numKept);
+
+	// sequences can share a weightlist
+	std::set<float*> seenWeightLists;
+	for (int i = 0; i < pHdr->numlocalseq; i++)
+	{
+		r5::v8::mstudioseqdesc_t* const pSeqDesc = PTR_FROM_IDX(r5::v8::mstudioseqdesc_t, pHdr, pHdr->localseqindex) + i;
+		float* const pWeightList = PTR_FROM_IDX(float, pSeqDesc, pSeqDesc->weightlistindex);
+
+		if (!pSeqDesc->weightlistindex || seenWeightLists.count(pWeightList) || !IsInModelData(pWeightList, numBones * sizeof(float)))
+			continue;
+
+		seenWeightLists.insert(pWeightList);
+		PermuteBoneArray(pWeightList, order);
+	}
+
+	pHdr->numbones = numKept;
+
+	// the vg bone states index the source bones, so an earlier pass is folded into this one
+	if (g_model.boneRemap.empty())
+	{
+		g_model.boneRemap = std::move(remap);
+	}
+	else
+	{
+		for (int& bone : g_model.boneRemap)
+		{
+			if (bone < numBones)
+				bone = remap[bone];
+		}
+	}
+
+	return true;
+}
+
+// depth first from each root, siblings keep their order
+static bool ReorderBonesDepthFirst()
+{
+	r5::v8::studiohdr_t* const pHdr = g_model.hdrV54();
+	const r5::v8::mstudiobone_t* const pBones = PTR_FROM_IDX(r5::v8::mstudiobone_t, pHdr, pHdr->boneindex);
+	const int numBones = pHdr->numbones;
+
+	std::vector<std::vector<int>> children(numBones);
+	std::vector<int> roots;
+	for (int i = 0; i < numBones; i++)
+	{
+		const int parent = pBones[i].parent;
+		if (parent < 0 || parent >= numBones || parent == i)
+			roots.push_back(i);
+		else
+			children[parent].push_back(i);
+	}
+
+	// new bone -> old bone
+	std::vector<int> order;
+	order.reserve(numBones);
+
+	std::vector<int> stack;
+	for (const int root : roots)
+	{
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			const int bone = stack.back();
+			stack.pop_back();
+			order.push_back(bone);
+
+			for (auto it = children[bone].rbegin(); it != children[bone].rend(); ++it)
+				stack.push_back(*it);
+		}
+	}
+
+	// bones in a parent loop never get reached from a root
+	if (static_cast<int>(order.size()) != numBones)
+	{
+		printf("  [BONES] WARNING: bone hierarchy has a parent loop, bones were not reordered\n");
+		return false;
+	}
+
+	int numMoved = 0;
+	for (int i = 0; i < numBones; i++)
+		numMoved += order[i] != i;
+
+	if (!numMoved || !ApplyBoneOrder(order, numBones))
+		return false;
+
+	printf("  [BONES] reordered %i bones parent first, %i moved\n", numBones, numMoved);
+
+	return true;
+}
+
+//
+// CullUnusedBones
+// Purpose: drop bones no vertex, hitbox, attachment, ik chain, proc bone, physics or bone merge uses, along with their animation tracks.
+//			a bone with a used child is used, and animation alone doesn't keep a bone
+//
+static bool CullUnusedBones(const vvd::vertexFileHeader_t* const pVVD)
+{
+	r5::v8::studiohdr_t* const pHdr = g_model.hdrV54();
+	const r5::v8::mstudiobone_t* const pBones = PTR_FROM_IDX(r5::v8::mstudiobone_t, pHdr, pHdr->boneindex);
+	const int numBones = pHdr->numbones;
+
+	std::vector<bool> used(numBones, false);
+	auto MarkBone = [&used, numBones](const int bone) { if (bone >= 0 && bone < numBones) used[bone] = true; };
+
+	// the model is parented through bone 0
+	MarkBone(0);
+
+	// every weight goes into the vg bone palette, even the empty ones
+	const int vertexCount = pVVD->numLODs > 0 ? pVVD->numLODVertexes[0] : 0;
+	for (int i = 0; i < vertexCount; i++)
+	{
+		const vvd::mstudioboneweight_t& weights = pVVD->GetVertexData(i)->m_BoneWeights;
+		for (int j = 0; j < weights.numbones && j < MAX_NUM_BONES_PER_VERT; j++)
+			MarkBone(weights.bone[j]);
+	}
+
+	// physics and bone merge find their bones by name at runtime
+	constexpr int keepFlags = BONE_PHYSICALLY_SIMULATED | BONE_PHYSICS_PROCEDURAL | BONE_ALWAYS_PROCEDURAL | BONE_USED_BY_BONE_MERGE;
+	for (int i = 0; i < numBones; i++)
+	{
+		if ((pBones[i].flags & keepFlags) || pBones[i].proctype > 0)
+			MarkBone(i);
+	}
+
+	for (int i = 0; i < pHdr->numhitboxsets; i++)
+	{
+		const r5::v8::mstudiohitboxset_t* const pSet = PTR_FROM_IDX(r5::v8::mstudiohitboxset_t, pHdr, pHdr->hitboxsetindex) + i;
+		const r5::v8::mstudiobbox_t* const pHitboxes = PTR_FROM_IDX(r5::v8::mstudiobbox_t, pSet, pSet->hitboxindex);
+
+		for (int j = 0; j < pSet->numhitboxes; j++)
+			MarkBone(pHitboxes[j].bone);
+	}
+
+	const r5::v8::mstudioattachment_t* const pAttachments = PTR_FROM_IDX(r5::v8::mstudioattachment_t, pHdr, pHdr->localattachmentindex);
+	for (int i = 0; i < pHdr->numlocalattachments; i++)
+		MarkBone(pAttachments[i].localbone);
+
+	for (int i = 0; i < pHdr->numikchains; i++)
+	{
+		r5::v8::mstudioikchain_t* const pChain = PTR_FROM_IDX(r5::v8::mstudioikchain_t, pHdr, pHdr->ikchainindex) + i;
+		for (int j = 0; j < pChain->numlinks; j++)
+			MarkBone(pChain->pLink(j)->bone);
+	}
+
+	for (int i = 0; i < pHdr->numlocalanim; i++)
+	{
+		const r5::v8::mstudioanimdesc_t* const pAnimDesc = PTR_FROM_IDX(r5::v8::mstudioanimdesc_t, pHdr, pHdr->localanimindex) + i;
+		if (!pAnimDesc->ikruleindex)
+			continue;
+
+		const r5::v8::mstudioikrule_t* const pIkRules = PTR_FROM_IDX(r5::v8::mstudioikrule_t, pAnimDesc, pAnimDesc->ikruleindex);
+		for (int j = 0; j < pAnimDesc->numikrules; j++)
+			MarkBone(pIkRules[j].bone);
+	}
+
+	const int* const pBoneFollowers = PTR_FROM_IDX(int, pHdr, pHdr->boneFollowerOffset);
+	for (int i = 0; i < pHdr->boneFollowerCount && pHdr->boneFollowerOffset; i++)
+		MarkBone(pBoneFollowers[i]);
+
+	// a used bone needs its whole parent chain, the step limit stops on parent loops
+	for (int i = 0; i < numBones; i++)
+	{
+		if (!used[i])
+			continue;
+
+		int bone = pBones[i].parent;
+		for (int steps = 0; bone >= 0 && bone < numBones && steps < numBones; steps++)
+		{
+			used[bone] = true;
+			bone = pBones[bone].parent;
+		}
+	}
+
+	// kept bones stay in their order, the dropped ones go after them
+	std::vector<int> order;
+	order.reserve(numBones);
+
+	for (int i = 0; i < numBones; i++)
+	{
+		if (used[i])
+			order.push_back(i);
+	}
+
+	const int numKept = static_cast<int>(order.size());
+	if (numKept == numBones)
+		return false;
+
+	std::vector<const char*> culledNames;
+	for (int i = 0; i < numBones; i++)
+	{
+		if (used[i])
+			continue;
+
+		order.push_back(i);
+		culledNames.push_back(GetQueuedString(&pBones[i].sznameindex));
+	}
+
+	if (!ApplyBoneOrder(order, numKept))
+		return false;
+
+	printf("  [BONES] culled %i of %i bones nothing uses:\n", numBones - numKept, numBones);
+	for (const char* const pszName : culledNames)
+		printf("    %s\n", pszName);
+
+	return true;
+}
+
+//
+// RemapBones_V54
+// Purpose: runs the bone passes that are switched on over the converted model in g_model
+//
+bool RemapBones_V54(const bool canRemapVG, const vvd::vertexFileHeader_t* const pVVD)
+{
+	g_model.boneRemap.clear();
+
+	const bool cullBones = g_options.cullBones && pVVD;
+	if ((!cullBones && !g_options.reorderBones) || g_model.hdrV54()->numbones <= 1)
+		return false;
+
+	if (!canRemapVG)
+	{
+		printf("  [BONES] not remapping bones, this conversion does not rewrite the model's vg\n");
+		return false;
+	}
+
+	bool changed = false;
+
+	// cull first so the reorder only walks the bones that are left
+	if (cullBones)
+		changed |= CullUnusedBones(pVVD);
+
+	if (g_options.reorderBones)
+		changed |= ReorderBonesDepthFirst();
+
+	return changed;
+}
+
+void RemapBoneStates(unsigned char* const pBoneStates, const size_t count)
+{
+	if (g_model.boneRemap.empty())
+		return;
+
+	const size_t numBones = g_model.boneRemap.size();
+	for (size_t i = 0; i < count; i++)
+	{
+		if (pBoneStates[i] < numBones)
+			pBoneStates[i] = static_cast<unsigned char>(g_model.boneRemap[pBoneStates[i]]);
+	}
+
+	g_model.boneRemap.clear();
+}
+
+//
+// CanRemapVGBones
+// Purpose: mirrors the vg handling of the rmdl conversions, only a vg they convert gets its bone states remapped
+//
+bool CanRemapVGBones(const std::string& vgPath, const bool acceptRev4)
+{
+	if (!FILE_EXISTS(vgPath))
+		return false;
+
+	char header[sizeof(vg::rev4::VertexGroupHeader_t)]{};
+
+	std::ifstream ifs(vgPath, std::ios::in | std::ios::binary);
+	ifs.read(header, sizeof(header));
+
+	const int magic = *reinterpret_cast<const int*>(header);
+	if (magic == 'GVt0')
+		return true;
+
+	if (!acceptRev4 || magic == '0GVt')
+		return false;
+
+	const vg::rev4::VertexGroupHeader_t* const pRev4Hdr = reinterpret_cast<const vg::rev4::VertexGroupHeader_t*>(header);
+	return pRev4Hdr->lodCount > 0 && pRev4Hdr->lodCount <= 8 && pRev4Hdr->lodMap != 0;
+}
+
 void CVertexHardwareDataFile_V1::FillFromDiskFiles(r5::v8::studiohdr_t* pHdr, OptimizedModel::FileHeader_t* pVtx, vvd::vertexFileHeader_t* pVVD, vvc::vertexColorFileHeader_t* pVVC, vvw::vertexBoneWeightsExtraFileHeader_t* pVVW)
 {
 	bool isLargeModel = false;
 
-	printf("  [VG] Hull bounds: min(%.1f, %.1f, %.1f) max(%.1f, %.1f, %.1f)\n",
-		pHdr->hull_min.x, pHdr->hull_min.y, pHdr->hull_min.z,
-		pHdr->hull_max.x, pHdr->hull_max.y, pHdr->hull_max.z);
+	// with -tightbounds the packing follows the vertices themselves, the hull is a movement box that may not hold them
+	Vector mins = pHdr->hull_min;
+	Vector maxs = pHdr->hull_max;
+	const bool vertexBounds = g_options.tightBounds && CalcVertexBounds_VVD(pVVD, mins, maxs);
+
+	printf("  [VG] %s bounds: min(%.1f, %.1f, %.1f) max(%.1f, %.1f, %.1f)\n", vertexBounds ? "Vertex" : "Hull",
+		mins.x, mins.y, mins.z,
+		maxs.x, maxs.y, maxs.z);
 
 	// Check if model exceeds Vector64 encoding limits
 	// Vector64 can encode: X/Y in [-1024, 1024], Z in [-2048, 2048]
-	if (!isLargeModel && (pHdr->hull_min.x < -1023.f || pHdr->hull_max.x > 1023.f))
+	if (!isLargeModel && (mins.x < -1023.f || maxs.x > 1023.f))
 		isLargeModel = true;
 
-	if (!isLargeModel && (pHdr->hull_min.y < -1023.f || pHdr->hull_max.y > 1023.f))
+	if (!isLargeModel && (mins.y < -1023.f || maxs.y > 1023.f))
 		isLargeModel = true;
 
-	if (!isLargeModel && (pHdr->hull_min.z < -2047.f || pHdr->hull_max.z > 2047.f))
+	if (!isLargeModel && (mins.z < -2047.f || maxs.z > 2047.f))
 		isLargeModel = true;
 
 	printf("  [VG] isLargeModel = %s (using %s positions)\n",
@@ -281,6 +3330,17 @@ void CVertexHardwareDataFile_V1::FillFromDiskFiles(r5::v8::studiohdr_t* pHdr, Op
 	// no need to remap with so few, or so I have observed
 	if (pHdr->numbones > 2)
 		SetupBoneStateFromDiskFile(pVVD, pVVW);
+	else
+	{
+		// weights still look their bones up in the map, so map them onto themselves or onto their remapped bone
+		const int numSourceBones = g_model.boneRemap.empty() ? pHdr->numbones : static_cast<int>(g_model.boneRemap.size());
+		for (int i = 0; i < numSourceBones; i++)
+		{
+			const int bone = g_model.boneRemap.empty() ? i : g_model.boneRemap[i];
+			if (bone < pHdr->numbones)
+				boneMap.emplace(static_cast<unsigned char>(i), static_cast<unsigned char>(bone));
+		}
+	}
 
 	hdr.boneStateChangeCount = boneStates.size(); // set bonestate count
 	hdr.lodCount = pVtx->numLODs;
@@ -293,6 +3353,8 @@ void CVertexHardwareDataFile_V1::FillFromDiskFiles(r5::v8::studiohdr_t* pHdr, Op
 	std::vector<const Color32*> pVvcColors;
 	std::vector<const Vector2D*> pVvcUv2s;
 
+	s_weightprunestats_t pruneStats {};
+
 	for (int lodIdx = 0; lodIdx < pVtx->numLODs; lodIdx++)
 	{
 		int localVertOffset = 0; // gotta be a better way to offset into lods?
@@ -321,7 +3383,7 @@ void CVertexHardwareDataFile_V1::FillFromDiskFiles(r5::v8::studiohdr_t* pHdr, Op
 				for (int meshIdx = 0; meshIdx < pVtxLod->numMeshes; meshIdx++)
 				{
 					OptimizedModel::MeshHeader_t* pVtxMesh = pVtxLod->pMesh(meshIdx);
-					r5::v8::mstudiomesh_t* pMdlMesh = pMdlModel->pMesh(meshIdx); // remove if unneeded
+					const r5::v8::mstudiomesh_t* pMdlMesh = GetSourceMesh(pMdlModel, meshIdx, static_cast<int>(meshes.size()) - newHwLOD.meshOffset);
 
 					// IMPORTANT: Use global mesh index for parentMeshIndex, not local meshIdx
 					int globalMeshIndex = static_cast<int>(meshes.size());
@@ -408,28 +3470,37 @@ void CVertexHardwareDataFile_V1::FillFromDiskFiles(r5::v8::studiohdr_t* pHdr, Op
 
 							// add bone state func here if needed
 
+							const bool extraWeights = (pHdr->flags & STUDIOHDR_FLAGS_USES_EXTRA_BONE_WEIGHTS) && pHdr->version == MdlVersion::APEXLEGENDS; // add version check just in case as we are reading off a header flag
+
+							// pruned weights never reach into the vvw, so everything below can read them like normal vvd weights
+							vvd::mstudioboneweight_t prunedWeights;
+							const vvd::mstudioboneweight_t* pVvdWeights = &pVvdVert->m_BoneWeights;
+
+							if (g_options.pruneWeights && PruneVertexWeights_VVD(pVvdVert->m_BoneWeights, prunedWeights, pVVW, extraWeights, pruneStats))
+								pVvdWeights = &prunedWeights;
+
 							// set the actual weights
 							// redo at somepoint but for now I cba to do it
-							if ((pHdr->flags & STUDIOHDR_FLAGS_USES_EXTRA_BONE_WEIGHTS) && pHdr->version == MdlVersion::APEXLEGENDS) // add version check just in case as we are reading off a header flag
+							if (extraWeights)
 							{
 								// "complex" weights
 								newHwVert.m_WeightsPacked.weight[1] = newHwMesh.extraBoneWeightSize; // set this before so we can add for the next one
 
-								for (int n = 0; n < pVvdVert->m_BoneWeights.numbones; n++)
+								for (int n = 0; n < pVvdWeights->numbones; n++)
 								{
 									// this causes the weird conversion artifact that normal vg has where verts with one weight have the same bone in two slots
 									// so obviously respawn is doing something similar
-									if (n == (pVvdVert->m_BoneWeights.numbones - 1))
+									if (n == (pVvdWeights->numbones - 1))
 									{
 										if (n > 0 && n < 3)
 										{
-											newHwVert.m_BonesPacked.bones[1] = boneMap.find(pVvdVert->m_BoneWeights.bone[n])->second;
+											newHwVert.m_BonesPacked.bones[1] = boneMap.at(pVvdWeights->bone[n]);
 										}
 										else if (n > 2)
 										{
-											const vvw::mstudioboneweightextra_t* const pVvwWeight = pVVW->GetWeightData(pVvdVert->m_BoneWeights.weightextra.extraweightindex + (n - 3)); // subtract three to get the real idx
+											const vvw::mstudioboneweightextra_t* const pVvwWeight = pVVW->GetWeightData(pVvdWeights->weightextra.extraweightindex + (n - 3)); // subtract three to get the real idx
 
-											newHwVert.m_BonesPacked.bones[1] = boneMap.find(pVvwWeight->bone)->second; // change this to the bone remap
+											newHwVert.m_BonesPacked.bones[1] = boneMap.at(pVvwWeight->bone); // change this to the bone remap
 										}
 									}
 									else
@@ -438,8 +3509,8 @@ void CVertexHardwareDataFile_V1::FillFromDiskFiles(r5::v8::studiohdr_t* pHdr, Op
 										{
 											vvw::mstudioboneweightextra_t newHwExtraWeight{};
 
-											newHwExtraWeight.weight = pVvdVert->m_BoneWeights.weightextra.weight[n];
-											newHwExtraWeight.bone = boneMap.find(pVvdVert->m_BoneWeights.bone[n])->second;
+											newHwExtraWeight.weight = pVvdWeights->weightextra.weight[n];
+											newHwExtraWeight.bone = boneMap.at(pVvdWeights->bone[n]);
 
 											extraBoneWeights.push_back(newHwExtraWeight);
 
@@ -447,12 +3518,12 @@ void CVertexHardwareDataFile_V1::FillFromDiskFiles(r5::v8::studiohdr_t* pHdr, Op
 										}
 										else if (n > 2)
 										{
-											const vvw::mstudioboneweightextra_t* const pVvwWeight = pVVW->GetWeightData(pVvdVert->m_BoneWeights.weightextra.extraweightindex + (n - 3));
+											const vvw::mstudioboneweightextra_t* const pVvwWeight = pVVW->GetWeightData(pVvdWeights->weightextra.extraweightindex + (n - 3));
 
 											vvw::mstudioboneweightextra_t newHwExtraWeight{};
 
 											newHwExtraWeight.weight = pVvwWeight->weight;
-											newHwExtraWeight.bone = boneMap.find(pVvwWeight->bone)->second; // change this to the bone remap
+											newHwExtraWeight.bone = boneMap.at(pVvwWeight->bone); // change this to the bone remap
 
 											extraBoneWeights.push_back(newHwExtraWeight);
 
@@ -462,31 +3533,31 @@ void CVertexHardwareDataFile_V1::FillFromDiskFiles(r5::v8::studiohdr_t* pHdr, Op
 								}
 
 								// first slot is fixed, 2nd bone id will always be the last weight, with the weight value dropped
-								newHwVert.m_WeightsPacked.weight[0] = (pVvdVert->m_BoneWeights.weightextra.weight[0]);
-								newHwVert.m_BonesPacked.bones[0] = boneMap.find(pVvdVert->m_BoneWeights.bone[0])->second;
+								newHwVert.m_WeightsPacked.weight[0] = (pVvdWeights->weightextra.weight[0]);
+								newHwVert.m_BonesPacked.bones[0] = boneMap.at(pVvdWeights->bone[0]);
 
-								newHwVert.m_BonesPacked.numbones = (pVvdVert->m_BoneWeights.numbones - 1);
+								newHwVert.m_BonesPacked.numbones = (pVvdWeights->numbones - 1);
 							}
 							else
 							{
 								// "simple" weights
 								// use vvd bone count instead of previously set as it should never be funky
-								for (int n = 0; n < pVvdVert->m_BoneWeights.numbones; n++)
+								for (int n = 0; n < pVvdWeights->numbones; n++)
 								{
 									// don't set weight for third because it gets dropped
 									// third weight is gotten by subtracting the weights that were not dropped from 1.0f
 									if (n < 2)
 									{
-										newHwVert.m_WeightsPacked.weight[n] = (pVvdVert->m_BoneWeights.weight[n] * 32767.0); // "pack" float into short, weight will always be <= 1.0f
+										newHwVert.m_WeightsPacked.weight[n] = (pVvdWeights->weight[n] * 32767.0); // "pack" float into short, weight will always be <= 1.0f
 									}
 
-									newHwVert.m_BonesPacked.bones[n] = boneMap.find(pVvdVert->m_BoneWeights.bone[n])->second;
+									newHwVert.m_BonesPacked.bones[n] = boneMap.at(pVvdWeights->bone[n]);
 								}
 
-								newHwVert.m_BonesPacked.numbones = (pVvdVert->m_BoneWeights.numbones - 1);
+								newHwVert.m_BonesPacked.numbones = (pVvdWeights->numbones - 1);
 							}
 
-							legacyBoneWeights.push_back(pVvdVert->m_BoneWeights);
+							legacyBoneWeights.push_back(*pVvdWeights);
 							newHwMesh.legacyWeightCount++;
 
 							vertices.push_back(newHwVert);
@@ -553,9 +3624,78 @@ void CVertexHardwareDataFile_V1::FillFromDiskFiles(r5::v8::studiohdr_t* pHdr, Op
 		lods.push_back(newHwLOD);
 	}
 
+	if (!g_model.meshMergeMap.empty())
+	{
+		MergeMeshes((pHdr->flags & STUDIOHDR_FLAGS_USES_EXTRA_BONE_WEIGHTS) && pHdr->version == MdlVersion::APEXLEGENDS);
+
+		g_model.sourceMeshes.clear();
+		g_model.meshMergeMap.clear();
+	}
+
+	// after merging so merged meshes are ordered as a whole
+	if (g_options.optimizeOverdraw)
+	{
+		std::vector<s_overdrawmesh_t> overdrawMeshes(meshes.size());
+
+		size_t meshVertOffset = 0;
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			const vg::rev1::MeshHeader_t& mesh = meshes[i];
+
+			if (mesh.vertCount > 0 && mesh.indexCount >= 6)
+			{
+				overdrawMeshes[i].pIndices = &indices[mesh.indexOffset];
+				overdrawMeshes[i].indexCount = mesh.indexCount;
+				overdrawMeshes[i].pVerts = reinterpret_cast<const char*>(&vertices[meshVertOffset].m_vecPosition);
+				overdrawMeshes[i].vertCount = mesh.vertCount;
+				overdrawMeshes[i].vertStride = sizeof(vg::Vertex_t);
+			}
+
+			meshVertOffset += mesh.vertCount;
+		}
+
+		OptimizeOverdraw(overdrawMeshes, g_options.overdrawCacheThreshold);
+	}
+
 	printf("  [VG] Created: %zu meshes, %zu vertices, %zu indices\n",
 		meshes.size(), vertices.size(), indices.size());
 
+	if (g_options.pruneWeights)
+		PrintWeightPruneStats(pruneStats);
+
+	// the palette was built from every lod0 weight up front, now trim it to what the meshes ended up using
+	if (g_options.minimizePalette && !boneStates.empty())
+	{
+		std::vector<s_palettemesh_t> paletteMeshes(meshes.size());
+
+		size_t meshVertOffset = 0;
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			const vg::rev1::MeshHeader_t& mesh = meshes[i];
+
+			if ((mesh.flags & VERTEX_HAS_WEIGHT_BONES) && mesh.vertCount > 0)
+			{
+				paletteMeshes[i].pVerts = reinterpret_cast<char*>(&vertices[meshVertOffset]);
+				paletteMeshes[i].vertCount = mesh.vertCount;
+				paletteMeshes[i].vertStride = sizeof(vg::Vertex_t);
+				paletteMeshes[i].bonesOffset = offsetof(vg::Vertex_t, m_BonesPacked);
+
+				if (mesh.extraBoneWeightSize > 0)
+				{
+					paletteMeshes[i].pExtraWeights = &extraBoneWeights[mesh.extraBoneWeightOffset / sizeof(vvw::mstudioboneweightextra_t)];
+					paletteMeshes[i].extraWeightCount = mesh.extraBoneWeightSize / sizeof(vvw::mstudioboneweightextra_t);
+				}
+			}
+
+			meshVertOffset += mesh.vertCount;
+		}
+
+		if (MinimizeBonePalette(paletteMeshes, boneStates))
+			hdr.boneStateChangeCount = boneStates.size();
+	}
+
+	RemapBoneStates(boneStates.data(), boneStates.size());
+
 	// Debug: show first mesh flags to verify position format
 	if (!meshes.empty())
 	{
@@ -568,6 +3708,142 @@ void CVertexHardwareDataFile_V1::FillFromDiskFiles(r5::v8::studiohdr_t* pHdr, Op
 	}
 }
 
+//
+// CVertexHardwareDataFile_V1::MergeMeshes
+// Purpose: follow the rmdl mesh merge in every lod, the meshes of a merged mesh are appended in their original order
+// so their indices, extra weight indices and strips only need to be moved past the meshes before them
+//
+void CVertexHardwareDataFile_V1::MergeMeshes(const bool extraWeights)
+{
+	const std::vector<int>& mergeMap = g_model.meshMergeMap;
+
+	const int numSourceMeshes = static_cast<int>(mergeMap.size());
+	const int numMergedMeshes = *std::max_element(mergeMap.begin(), mergeMap.end()) + 1;
+
+	// where each source mesh's vertices start
+	std::vector<size_t> firstVertex(meshes.size());
+	for (size_t i = 1; i < meshes.size(); i++)
+		firstVertex[i] = firstVertex[i - 1] + meshes[i - 1].vertCount;
+
+	std::vector<vg::rev1::MeshHeader_t> newMeshes;
+	std::vector<OptimizedModel::StripHeader_t> newStrips;
+	std::vector<unsigned short> newIndices;
+	std::vector<vg::Vertex_t> newVertices;
+	std::vector<vvw::mstudioboneweightextra_t> newExtraBoneWeights;
+	std::vector<vvd::mstudioboneweight_t> newLegacyBoneWeights;
+
+	newMeshes.reserve(lods.size() * numMergedMeshes);
+	newStrips.reserve(lods.size() * numMergedMeshes);
+	newIndices.reserve(indices.size());
+	newVertices.reserve(vertices.size());
+	newExtraBoneWeights.reserve(extraBoneWeights.size());
+	newLegacyBoneWeights.reserve(legacyBoneWeights.size());
+
+	std::vector<std::vector<int>> sources(numMergedMeshes);
+	for (int i = 0; i < numSourceMeshes; i++)
+		sources[mergeMap[i]].push_back(i);
+
+	size_t vertexBufferSize = 0;
+
+	for (vg::rev1::ModelLODHeader_t& lod : lods)
+	{
+		const int lodMeshOffset = lod.meshOffset;
+
+		lod.meshOffset = static_cast<unsigned short>(newMeshes.size());
+		lod.meshCount = static_cast<unsigned short>(numMergedMeshes);
+
+		for (int i = 0; i < numMergedMeshes; i++)
+		{
+			vg::rev1::MeshHeader_t newMesh{};
+			OptimizedModel::StripHeader_t newStrip{};
+
+			newMesh.vertOffset = static_cast<unsigned int>(vertexBufferSize);
+			newMesh.indexOffset = static_cast<int>(newIndices.size());
+			newMesh.extraBoneWeightOffset = static_cast<int>(newExtraBoneWeights.size() * sizeof(vvw::mstudioboneweightextra_t));
+			newMesh.legacyWeightOffset = static_cast<int>(newLegacyBoneWeights.size());
+			newMesh.stripOffset = static_cast<int>(newStrips.size());
+			newMesh.stripCount = 1;
+
+			for (const int source : sources[i])
+			{
+				const int meshIdx = lodMeshOffset + source;
+				const vg::rev1::MeshHeader_t& mesh = meshes[meshIdx];
+
+				if (mesh.vertCount == 0)
+					continue;
+
+				// meshes of one model share their vertex layout, empty meshes have no flags to go by
+				if (newMesh.vertCount == 0)
+				{
+					newMesh.flags = mesh.flags;
+					newMesh.vertCacheSize = mesh.vertCacheSize;
+					newStrip = strips[mesh.stripOffset];
+					newStrip.numIndices = 0;
+					newStrip.numVerts = 0;
+					newStrip.numBones = 0;
+				}
+
+				const OptimizedModel::StripHeader_t& strip = strips[mesh.stripOffset];
+				newStrip.numIndices += strip.numIndices;
+				newStrip.numVerts += strip.numVerts;
+				newStrip.numBones = max(newStrip.numBones, strip.numBones);
+
+				for (int idx = 0; idx < mesh.indexCount; idx++)
+					newIndices.push_back(static_cast<unsigned short>(indices[mesh.indexOffset + idx] + newMesh.vertCount));
+
+				const int extraWeightBase = newMesh.extraBoneWeightSize / sizeof(vvw::mstudioboneweightextra_t);
+
+				// the 16 bit extra weight index can't address more, MergeModelMeshes_V54 splits a merged mesh before this
+				assert(!extraWeights || extraWeightBase + mesh.extraBoneWeightSize / sizeof(vvw::mstudioboneweightextra_t) <= maxMergedExtraWeights);
+
+				for (unsigned int v = 0; v < mesh.vertCount; v++)
+				{
+					vg::Vertex_t vertex = vertices[firstVertex[meshIdx] + v];
+					vertex.parentMeshIndex = static_cast<__int64>(newMeshes.size());
+
+					// "complex" weights index the extra weights of their own mesh
+					if (extraWeights)
+						vertex.m_WeightsPacked.weight[1] += static_cast<unsigned short>(extraWeightBase);
+
+					newVertices.push_back(vertex);
+				}
+
+				const vvw::mstudioboneweightextra_t* const pExtraWeights = extraBoneWeights.data() + mesh.extraBoneWeightOffset / sizeof(vvw::mstudioboneweightextra_t);
+				newExtraBoneWeights.insert(newExtraBoneWeights.end(), pExtraWeights, pExtraWeights + mesh.extraBoneWeightSize / sizeof(vvw::mstudioboneweightextra_t));
+
+				newLegacyBoneWeights.insert(newLegacyBoneWeights.end(), legacyBoneWeights.begin() + mesh.legacyWeightOffset, legacyBoneWeights.begin() + mesh.legacyWeightOffset + mesh.legacyWeightCount);
+
+				newMesh.vertCount += mesh.vertCount;
+				newMesh.indexCount += mesh.indexCount;
+				newMesh.extraBoneWeightSize += mesh.extraBoneWeightSize;
+				newMesh.legacyWeightCount += mesh.legacyWeightCount;
+			}
+
+			// same as an empty mesh built from the vtx
+			if (newMesh.vertCount == 0)
+			{
+				newMesh.vertCacheSize = static_cast<unsigned int>(CalculateVertexSizeFromFlags(0));
+				newStrip.flags = 0x1;
+			}
+
+			vertexBufferSize += static_cast<size_t>(newMesh.vertCacheSize) * newMesh.vertCount;
+
+			newMeshes.push_back(newMesh);
+			newStrips.push_back(newStrip);
+		}
+	}
+
+	meshes = std::move(newMeshes);
+	strips = std::move(newStrips);
+	indices = std::move(newIndices);
+	vertices = std::move(newVertices);
+	extraBoneWeights = std::move(newExtraBoneWeights);
+	legacyBoneWeights = std::move(newLegacyBoneWeights);
+
+	hdr.meshCount = meshes.size();
+	hdr.stripCount = strips.size();
+}
+
 void CVertexHardwareDataFile_V1::Write(const std::string& filePath)
 {
 	BinaryIO io;
@@ -651,6 +3927,243 @@ void CVertexHardwareDataFile_V1::Write(const std::string& filePath)
 	io.close();
 }
 
+//
+// MergeModelMeshes_V54
+// Purpose: merge the meshes of each model that share a material, a mesh is only added to a merged mesh while
+// every lod of it stays within 16 bit indices and 16 bit extra weight indices
+//
+bool MergeModelMeshes_V54(OptimizedModel::FileHeader_t* pVtx, const vvd::vertexFileHeader_t* pVVD)
+{
+	constexpr int maxMergedVerts = 0xFFFF;
+
+	g_model.sourceMeshes.clear();
+	g_model.meshMergeMap.clear();
+
+	r5::v8::studiohdr_t* const pHdr = g_model.hdrV54();
+	if (!pVtx || pHdr->numbodyparts <= 0 || pVtx->numBodyParts != pHdr->numbodyparts)
+		return false;
+
+	const int numLODs = min(pVtx->numLODs, MAX_NUM_LODS);
+
+	// same check as FillFromDiskFiles, only "complex" weights put vertices into the extra weights
+	const bool extraWeights = pVVD && pHdr->numbones > 1 && (pHdr->flags & STUDIOHDR_FLAGS_USES_EXTRA_BONE_WEIGHTS) && pHdr->version == MdlVersion::APEXLEGENDS;
+
+	// vvd vertices of each lod, walked in the same order FillFromDiskFiles reads them
+	std::vector<const vvd::mstudiovertex_t*> lodVertices[MAX_NUM_LODS];
+	int lodVertOffsets[MAX_NUM_LODS] = {};
+
+	if (extraWeights)
+	{
+		std::vector<const Vector4D*> tangents;
+		std::vector<const Color32*> colors;
+		std::vector<const Vector2D*> uv2s;
+
+		for (int lod = 0; lod < numLODs; lod++)
+			GetVertexesFromVVD(const_cast<vvd::vertexFileHeader_t*>(pVVD), nullptr, lod, lodVertices[lod], tangents, colors, uv2s);
+	}
+
+	std::vector<r5::v8::mstudiomesh_t> sourceMeshes;
+	std::vector<int> mergeMap;
+
+	// new mesh index within its model for every source mesh
+	std::vector<int> localMap;
+	std::vector<int> newMeshCounts;
+
+	for (int i = 0; i < pHdr->numbodyparts; i++)
+	{
+		r5::v8::mstudiobodyparts_t* const pBodypart = pHdr->pBodypart(i);
+		OptimizedModel::BodyPartHeader_t* const pVtxBodypart = pVtx->pBodyPart(i);
+
+		if (pVtxBodypart->numModels != pBodypart->nummodels)
+			return false;
+
+		for (int j = 0; j < pBodypart->nummodels; j++)
+		{
+			r5::v8::mstudiomodel_t* const pModel = pBodypart->pModel(j);
+			OptimizedModel::ModelHeader_t* const pVtxModel = pVtxBodypart->pModel(j);
+
+			// per merged mesh, its material and vertex and extra weight count in each lod
+			std::vector<int> groupMaterials;
+			std::vector<int> groupVerts;
+			std::vector<int> groupExtraWeights;
+
+			for (int k = 0; k < pModel->nummeshes; k++)
+			{
+				const r5::v8::mstudiomesh_t* const pMesh = pModel->pMesh(k);
+
+				int meshVerts[MAX_NUM_LODS] = {};
+				int meshExtraWeights[MAX_NUM_LODS] = {};
+				for (int lod = 0; lod < numLODs; lod++)
+				{
+					OptimizedModel::ModelLODHeader_t* const pVtxLod = pVtxModel->pLOD(lod);
+					if (pVtxLod->numMeshes != pModel->nummeshes)
+						return false;
+
+					OptimizedModel::MeshHeader_t* const pVtxMesh = pVtxLod->pMesh(k);
+					for (int g = 0; g < pVtxMesh->numStripGroups; g++)
+					{
+						OptimizedModel::StripGroupHeader_t* const pStripGroup = pVtxMesh->pStripGroup(g);
+						meshVerts[lod] += pStripGroup->numVerts;
+
+						if (!extraWeights)
+							continue;
+
+						// every weight besides the first and last goes into the extra weights, pruning only lowers this
+						for (int v = 0; v < pStripGroup->numVerts; v++)
+						{
+							const size_t vertIdx = static_cast<size_t>(lodVertOffsets[lod] + pStripGroup->pVertex(v)->origMeshVertID);
+							if (vertIdx < lodVertices[lod].size())
+								meshExtraWeights[lod] += max(lodVertices[lod][vertIdx]->m_BoneWeights.numbones - 2, 0);
+						}
+					}
+
+					// same fallback as FillFromDiskFiles
+					lodVertOffsets[lod] += pMesh->vertexloddata.numLODVertexes[lod] ? pMesh->vertexloddata.numLODVertexes[lod] : pMesh->numvertices;
+				}
+
+				// the last group of this material is the only one still open
+				int group = -1;
+				for (int g = static_cast<int>(groupMaterials.size()) - 1; g >= 0; g--)
+				{
+					if (groupMaterials[g] == pMesh->material)
+					{
+						group = g;
+						break;
+					}
+				}
+
+				for (int lod = 0; group >= 0 && lod < numLODs; lod++)
+				{
+					if (groupVerts[group * MAX_NUM_LODS + lod] + meshVerts[lod] > maxMergedVerts
+						|| groupExtraWeights[group * MAX_NUM_LODS + lod] + meshExtraWeights[lod] > maxMergedExtraWeights)
+						group = -1;
+				}
+
+				if (group < 0)
+				{
+					group = static_cast<int>(groupMaterials.size());
+					groupMaterials.push_back(pMesh->material);
+					groupVerts.resize(groupVerts.size() + MAX_NUM_LODS);
+					groupExtraWeights.resize(groupExtraWeights.size() + MAX_NUM_LODS);
+				}
+
+				for (int lod = 0; lod < numLODs; lod++)
+				{
+					groupVerts[group * MAX_NUM_LODS + lod] += meshVerts[lod];
+					groupExtraWeights[group * MAX_NUM_LODS + lod] += meshExtraWeights[lod];
+				}
+
+				sourceMeshes.push_back(*pMesh);
+				localMap.push_back(group);
+			}
+
+			newMeshCounts.push_back(static_cast<int>(groupMaterials.size()));
+		}
+	}
+
+	int numMergedMeshes = 0;
+	for (const int count : newMeshCounts)
+		numMergedMeshes += count;
+	if (numMergedMeshes == static_cast<int>(sourceMeshes.size()))
+		return false;
+
+	// meshids are either ordinals over the whole model or restart in every model, keep whichever the source used
+	bool globalMeshIds = true;
+	for (size_t i = 0; i < sourceMeshes.size() && globalMeshIds; i++)
+		globalMeshIds = sourceMeshes[i].meshid == static_cast<int>(i);
+
+	// models and meshes are rebuilt after the bodypart array, nothing in there is in the string table
+	r5::v8::mstudiobodyparts_t* const pBodypartStart = pHdr->pBodypart(0);
+	char* const pRegionStart = reinterpret_cast<char*>(pBodypartStart + pHdr->numbodyparts);
+	const size_t regionSize = g_model.pData - pRegionStart;
+
+	std::vector<char> region(regionSize);
+	char* pOut = region.data();
+
+	int sourceIdx = 0;
+	int modelIdx = 0;
+	int mergedIdx = 0;
+
+	for (int i = 0; i < pHdr->numbodyparts; i++)
+	{
+		r5::v8::mstudiobodyparts_t* const pBodypart = pBodypartStart + i;
+		r5::v8::mstudiomodel_t* const pOldModels = pBodypart->pModel(0);
+
+		r5::v8::mstudiomodel_t* const pNewModels = reinterpret_cast<r5::v8::mstudiomodel_t*>(pOut);
+		memcpy(pNewModels, pOldModels, sizeof(r5::v8::mstudiomodel_t) * pBodypart->nummodels);
+		pOut += sizeof(r5::v8::mstudiomodel_t) * pBodypart->nummodels;
+
+		// offsets are relative to where the bodypart will be, which doesn't move
+		pBodypart->modelindex = static_cast<int>(pRegionStart + (reinterpret_cast<char*>(pNewModels) - region.data()) - reinterpret_cast<char*>(pBodypart));
+
+		for (int j = 0; j < pBodypart->nummodels; j++, modelIdx++)
+		{
+			r5::v8::mstudiomodel_t* const pModel = pNewModels + j;
+			r5::v8::mstudiomesh_t* const pMeshes = reinterpret_cast<r5::v8::mstudiomesh_t*>(pOut);
+
+			const int numSourceMeshes = pModel->nummeshes;
+			const int numMeshes = newMeshCounts[modelIdx];
+
+			pModel->meshindex = static_cast<int>(reinterpret_cast<char*>(pMeshes) - reinterpret_cast<char*>(pModel));
+			pModel->nummeshes = numMeshes;
+
+			std::vector<bool> started(numMeshes);
+			std::vector<Vector> centerSums(numMeshes, Vector(0.0f, 0.0f, 0.0f));
+
+			for (int k = 0; k < numSourceMeshes; k++, sourceIdx++)
+			{
+				const r5::v8::mstudiomesh_t& source = sourceMeshes[sourceIdx];
+				const int local = localMap[sourceIdx];
+				r5::v8::mstudiomesh_t& mesh = pMeshes[local];
+
+				mergeMap.push_back(mergedIdx + local);
+
+				if (!started[local])
+				{
+					started[local] = true;
+					mesh = source;
+					mesh.numvertices = 0;
+					memset(mesh.vertexloddata.numLODVertexes, 0, sizeof(mesh.vertexloddata.numLODVertexes));
+				}
+
+				mesh.numvertices += source.numvertices;
+				for (int lod = 0; lod < MAX_NUM_LODS; lod++)
+					mesh.vertexloddata.numLODVertexes[lod] += source.vertexloddata.numLODVertexes[lod];
+
+				centerSums[local] += source.center * static_cast<float>(max(source.numvertices, 1));
+			}
+
+			for (int k = 0; k < numMeshes; k++)
+			{
+				r5::v8::mstudiomesh_t& mesh = pMeshes[k];
+
+				mesh.center = centerSums[k] / static_cast<float>(max(mesh.numvertices, 1));
+				mesh.meshid = globalMeshIds ? mergedIdx + k : k;
+				mesh.modelindex = static_cast<int>(reinterpret_cast<char*>(pModel) - reinterpret_cast<char*>(&mesh));
+				mesh.pUnknown = nullptr;
+			}
+
+			mergedIdx += numMeshes;
+			pOut += sizeof(r5::v8::mstudiomesh_t) * numMeshes;
+		}
+	}
+
+	const size_t newRegionSize = pOut - region.data();
+
+	memcpy(pRegionStart, region.data(), newRegionSize);
+	memset(pRegionStart + newRegionSize, 0, regionSize - newRegionSize);
+	g_model.pData = pRegionStart + newRegionSize;
+
+	ALIGN4(g_model.pData);
+
+	printf("  [MESH] merged %zu meshes into %i by material (%zu header bytes saved)\n", sourceMeshes.size(), numMergedMeshes, regionSize - newRegionSize);
+
+	g_model.sourceMeshes = std::move(sourceMeshes);
+	g_model.meshMergeMap = std::move(mergeMap);
+
+	return true;
+}
+
 void CreateVGFile(const std::string& filePath, r5::v8::studiohdr_t* pHdr, char* vtxBuf, char* vvdBuf, char* vvcBuf, char* vvwBuf)
 {
 	OptimizedModel::FileHeader_t* pVTX = reinterpret_cast<OptimizedModel::FileHeader_t*>(vtxBuf);
@@ -3624,6 +3624,59 @@ namespace r5
 			int surfaceNameOffset;
 		};
 
+		// child types for bvh4 nodes, as in the apex legends bvh4 collision layout (node children, poly leaves
+		// and hull leaves share one 4 bit type). only node, none and poly3 are written by GenerateCollisionData_V8
+		enum BVHChildType_t : int
+		{
+			BVH_CHILD_NODE = 0,
+			BVH_CHILD_NONE = 1,
+			BVH_CHILD_EMPTY = 2,
+			BVH_CHILD_BUNDLE = 3,
+			BVH_CHILD_TRIANGLE = 4,
+			BVH_CHILD_POLY3 = 5, // leaf of 3 vertex polygons, mstudiocollbvhpolyleaf_t
+			BVH_CHILD_POLY4 = 6,
+			BVH_CHILD_POLY5PLUS = 7,
+			BVH_CHILD_CONVEXHULL = 8,
+			BVH_CHILD_STATICPROP = 9,
+			BVH_CHILD_HEIGHTFIELD = 10,
+		};
+
+		// bvh4 node, bounds are int16 in the space of the header's origin and scale
+		// stored as mins[4] maxs[4] per axis so all four children can be tested at once
+		struct mstudiocollbvhnode_t
+		{
+			short bounds[24];
+
+			uint32_t cmIndex : 8; // index into content masks
+			uint32_t index0 : 24;
+			uint32_t pad : 8;
+			uint32_t index1 : 24;
+			uint32_t childType0 : 4;
+			uint32_t childType1 : 4;
+			uint32_t index2 : 24;
+			uint32_t childType2 : 4;
+			uint32_t childType3 : 4;
+			uint32_t index3 : 24;
+		};
+		static_assert(sizeof(mstudiocollbvhnode_t) == 64, "mstudiocollbvhnode_t size mismatch");
+
+		// poly3 leaf, followed by numPolys packed triangles
+		struct mstudiocollbvhpolyleaf_t
+		{
+			uint32_t surfPropIdx : 12;
+			uint32_t numPolys : 4; // stored as count - 1
+			uint32_t baseVertex : 16;
+		};
+
+		// v0 is relative to the leaf's baseVertex, v1 and v2 are v0 + 1 + their offset
+		struct mstudiocollbvhpoly3_t
+		{
+			uint32_t v0 : 11;
+			uint32_t v1Offset : 9;
+			uint32_t v2Offset : 9;
+			uint32_t edgeFlags : 3;
+		};
+
 		struct studiohdr_t
 		{
 			int id; // Model format ID, such as "IDST" (0x49 0x44 0x53 0x54)
@@ -5211,6 +5264,8 @@ struct stringentry_t
 	int dupindex;
 };
 
+struct s_sectionarena_t;
+
 struct s_modeldata_t
 {
 	//r5::v8::studiohdr_t* pHdr;
@@ -5223,9 +5278,86 @@ struct s_modeldata_t
 	std::vector<stringentry_t> stringTable;
 	char* pBase;
 	char* pData;
+
+	// old texture index -> written texture index, -1 if culled. empty when every texture is written
+	std::vector<int> textureRemap;
+
+	// with -mergemeshes, the meshes as they were before merging (in vtx order) and the merged mesh each went into
+	// empty when no meshes were merged
+	std::vector<r5::v8::mstudiomesh_t> sourceMeshes;
+	std::vector<int> meshMergeMap;
+
+	// with -cullbones or -reorderbones, source bone index -> new bone index for the vg bone states. empty when the bones were left as they were
+	std::vector<int> boneRemap;
+
+	// inside a WriteSections task, the sub-arena pData points into. null when writing straight into the output
+	s_sectionarena_t* pSection = nullptr;
+};
+
+// thread local so -jobs-from can run several conversions at once
+inline thread_local s_modeldata_t g_model;
+
+// optional conversion stages, set from the command line
+struct s_convertoptions_t
+{
+	bool generateBVH; // build collision for models that don't have any
+	bool verifyFastPath; // diff in place conversions against the rebuilding converter
+	bool pruneWeights; // reduce vertex weights so extra bone weights can be dropped
+	float pruneWeightThreshold; // influences below this are removed when pruning
+	bool minimizePalette; // shrink and reorder the hardware bone palette
+	bool serialSections; // convert independent sections of a model on one thread
+	bool verifySections; // also write sub-arena sections serially and diff the two outputs
+	bool tightBounds; // recompute view and sequence bounds from vertex positions and animation frames
+	bool refitHitboxes; // fit hitboxes to the vertices of their bone
+	bool mergeHitboxes; // drop degenerate hitboxes and merge redundant ones
+	bool compactSkins; // trim unread skinref columns and drop trailing skin families identical to an earlier one
+	bool cullMaterials; // drop textures no mesh can reach through the skin table
+	bool mergeMeshes; // merge meshes of a model that share a material
+	bool optimizeOverdraw; // reorder vg triangles front to back
+	float overdrawCacheThreshold; // allowed vertex cache miss ratio of the reordered triangles against the original order
+	bool reorderBones; // renumber bones so parents always come before their children
+	bool cullBones; // remove bones no vertex, hitbox, attachment, ik chain or proc bone uses
+	std::string includeModelPath; // game root include models are merged from, empty keeps them as references and writes no sequences
+	bool simplifyPhy; // reduce the convex pieces of phy solids to a vertex budget
+	int phyHullVertexBudget; // most vertices a simplified convex piece keeps
+	float phyMaxVolumeLoss; // share of a convex piece's volume simplification may remove
+	bool computeLODSwitchPoints; // set vg lod switch points from the deviation between lods
+	float lodPixelError; // screen height in pixels the deviation of a lod may reach when it switches in
 };
 
-inline s_modeldata_t g_model;
+// each job list worker sets its own copy from the job's options
+inline thread_local s_convertoptions_t g_options;
+
+// runs independent sections of one model as parallel tasks
+// tasks see the caller's g_options but not g_model (both are thread local), so they must write through their own pointers
+// and the caller decides the layout up front, which keeps the output identical to a serial run
+// sections whose size is only known once written go through WriteSections instead
+inline void ParallelForSections(const size_t count, const std::function<void(const size_t)>& fn)
+{
+	const s_convertoptions_t options = g_options;
+
+	ParallelFor(count, options.serialSections ? 1 : 0, [&options, &fn](const size_t i)
+	{
+		g_options = options;
+		fn(i);
+	});
+}
+
+// a copy whose destination was already laid out
+struct s_sectioncopy_t
+{
+	char* pDst;
+	const char* pSrc;
+	size_t size;
+};
+
+inline void CopySections(const std::vector<s_sectioncopy_t>& copies)
+{
+	ParallelForSections(copies.size(), [&copies](const size_t i)
+	{
+		memcpy(copies[i].pDst, copies[i].pSrc, copies[i].size);
+	});
+}
 
 static void BeginStringTable()
 {
@@ -5263,42 +5395,181 @@ static void AddToStringTable(char* base, int* ptr, const char* string)
 	g_model.stringTable.emplace_back(newString);
 }
 
+// orders strings by their reversed characters, which puts every string right after the ones it ends
+static bool StringTailLess(const char* pszA, size_t lengthA, const char* pszB, size_t lengthB)
+{
+	while (lengthA && lengthB)
+	{
+		const unsigned char a = pszA[--lengthA];
+		const unsigned char b = pszB[--lengthB];
+
+		if (a != b)
+			return a < b;
+	}
+
+	return lengthA < lengthB;
+}
+
 static char* WriteStringTable(char* pData)
 {
 	auto& stringTable = g_model.stringTable;
 
-	for (auto& it : stringTable)
+	std::vector<size_t> lengths(stringTable.size(), 0);
+	std::vector<size_t> uniqueStrings;
+
+	for (size_t i = 0; i < stringTable.size(); i++)
+	{
+		if (stringTable[i].dupindex != -1 || !stringTable[i].ptr)
+			continue;
+
+		lengths[i] = strlen(stringTable[i].string);
+		uniqueStrings.push_back(i);
+	}
+
+	std::sort(uniqueStrings.begin(), uniqueStrings.end(), [&stringTable, &lengths](const size_t a, const size_t b)
 	{
+		return StringTailLess(stringTable[a].string, lengths[a], stringTable[b].string, lengths[b]);
+	});
+
+	// a string that ends the one sorted after it is stored in the tail of that string (or the string that one is stored in)
+	std::vector<int> tailOf(stringTable.size(), -1);
+	for (size_t i = uniqueStrings.size(); i-- > 1;)
+	{
+		const size_t shorter = uniqueStrings[i - 1];
+		const size_t longer = uniqueStrings[i];
+
+		if (lengths[shorter] >= lengths[longer] || memcmp(stringTable[longer].string + lengths[longer] - lengths[shorter], stringTable[shorter].string, lengths[shorter]))
+			continue;
+
+		tailOf[shorter] = tailOf[longer] == -1 ? static_cast<int>(longer) : tailOf[longer];
+	}
+
+	for (size_t i = 0; i < stringTable.size(); i++)
+	{
+		stringentry_t& it = stringTable[i];
+
 		// if first time the string is added to the table (unique or first version of duplicated strings)
-		if (it.dupindex == -1)
+		if (it.dupindex == -1 && tailOf[i] == -1)
 		{
 			it.addr = pData;
 
 			if (it.ptr)
 			{
 				*it.ptr = pData - it.base;
-				
-				int length = strlen(it.string);
-				strcpy_s(pData, length+1, it.string);
 
-				pData += length;
+				strcpy_s(pData, lengths[i] + 1, it.string);
+
+				pData += lengths[i];
 			}
 
 			*pData = '\0';
 
 			pData++;
 		}
-		else
-		{
-			// if string is a duplicate entry
-			// find the offset from the var's base ptr to the initial instance of the string
-			*it.ptr = stringTable[it.dupindex].addr - it.base;
-		}
+	}
+
+	for (size_t i = 0; i < stringTable.size(); i++)
+	{
+		stringentry_t& it = stringTable[i];
+
+		if (tailOf[i] == -1)
+			continue;
+
+		const stringentry_t& tail = stringTable[tailOf[i]];
+
+		it.addr = tail.addr + lengths[tailOf[i]] - lengths[i];
+		*it.ptr = it.addr - it.base;
+	}
+
+	// duplicates go last since the entry they point to may share a tail
+	for (stringentry_t& it : stringTable)
+	{
+		if (it.dupindex == -1)
+			continue;
+
+		// find the offset from the var's base ptr to the initial instance of the string
+		*it.ptr = stringTable[it.dupindex].addr - it.base;
 	}
 
 	return pData;
 }
 
+// offset from a struct outside a sub-arena (a header written before the tasks ran) into it, set when the arena is stitched
+struct s_sectionfixup_t
+{
+	int* ptr;
+	const char* anchor;
+	size_t targetOffset;
+};
+
+// what one WriteSections task wrote: its bytes, the strings it added and the log it would have printed, all in write order
+struct s_sectionarena_t
+{
+	std::unique_ptr<char[]> buffer;
+	char* pBase; // 16 byte aligned start inside buffer
+	size_t capacity;
+	size_t size;
+
+	std::vector<stringentry_t> strings;
+	std::vector<s_sectionfixup_t> fixups;
+	std::string log;
+};
+
+// store pTarget - pAnchor in *ptr, where pAnchor may lie outside the section being written
+inline void SetSectionOffset(int* ptr, const char* pAnchor, const char* pTarget)
+{
+	s_sectionarena_t* const pSection = g_model.pSection;
+
+	if (!pSection)
+	{
+		*ptr = static_cast<int>(pTarget - pAnchor);
+		return;
+	}
+
+	pSection->fixups.push_back(s_sectionfixup_t{ ptr, pAnchor, static_cast<size_t>(pTarget - pSection->pBase) });
+}
+
+// printf for section writers, buffered per task so the log keeps the serial order
+inline void SectionLog(const char* fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+
+	if (s_sectionarena_t* const pSection = g_model.pSection)
+	{
+		char buf[1024];
+		vsnprintf(buf, sizeof(buf), fmt, args);
+		pSection->log += buf;
+	}
+	else
+	{
+		vprintf(fmt, args);
+	}
+
+	va_end(args);
+}
+
+// writes count variable size sections at g_model.pData, section i by write(i), as if they were written one after another
+// each task writes through g_model as usual, into a zeroed sub-arena of at least maxSize(i) bytes, and the arenas are
+// stitched back in order: copied to the next startAlign boundary, their strings added to the string table and their fixups set.
+// a writer must start by aligning to startAlign, never align to more than it, and use SetSectionOffset and SectionLog
+// for anything outside its own section
+void WriteSections(const char* pszName, char* pHeaders, const size_t count, const size_t startAlign,
+	const std::function<size_t(const size_t)>& maxSize, const std::function<void(const size_t)>& write);
+
+// most bytes a model image can take, summed section by section from the source headers so the output is allocated once
+// every alignment counts its worst case padding and every string is counted in full, interning only makes the table smaller
+struct s_modelsize_t
+{
+	size_t size = 0;
+
+	void Add(const size_t bytes, const size_t align = 1) { size += bytes + align - 1; }
+	void AddString(const char* const pszString) { size += (pszString ? strlen(pszString) : 0) + 1; }
+};
+
+// compare the written model image against its planned size, a model that outgrew it is an error in the size pass
+void CheckModelSize(const size_t plannedSize);
+
 /* VERTEX HARDWARE DATA START */
 class CVertexHardwareDataFile_V1
 {
@@ -5314,6 +5585,8 @@ public:
 	void Write(const std::string& filePath);
 
 private:
+	void MergeMeshes(const bool extraWeights);
+
 	//int numVertices;
 	//int numMeshes;
 	////int numLODs;
@@ -5329,7 +5602,7 @@ private:
 
 	// remaped bones used for quick lookup
 	std::vector<unsigned char> boneStates;
-	std::map<unsigned char, unsigned char> boneMap;
+	bytemap boneMap;
 
 	// mesh data
 	std::vector<vg::rev1::ModelLODHeader_t> lods;
@@ -5345,10 +5618,233 @@ private:
 };
 
 uint32_t PackNormalTangent_UINT32(const Vector& vec, const Vector4D& tangent);
+void GetVertexesFromVVD(vvd::vertexFileHeader_t* pVVD, vvc::vertexColorFileHeader_t* pVVC, const int lodLevel, std::vector<const vvd::mstudiovertex_t*>& pVvdVertices, std::vector<const Vector4D*>& pVvdTangents, std::vector<const Color32*>& pVvcColors, std::vector<const Vector2D*>& pVvcUv2s);
 
 void CreateVGFile(const std::string& filePath, r5::v8::studiohdr_t* pHdr, char* vtxBuf, char* vvdBuf, char* vvcBuf = nullptr, char* vvwBuf = nullptr);
+
+// per material mesh merging for models converted from vtx/vvd, call right after the bodyparts are converted
+// merges the rmdl meshes in place and leaves the plan in g_model for the vg and collision
+bool MergeModelMeshes_V54(OptimizedModel::FileHeader_t* pVtx, const vvd::vertexFileHeader_t* pVVD);
+
+// "complex" weight vertices point into the extra weights of their mesh with an unsigned short
+constexpr int maxMergedExtraWeights = 0xFFFF;
+
+// the rmdl mesh a vtx mesh was converted from, sourceMeshIdx counts vtx meshes over all models of one lod
+inline const r5::v8::mstudiomesh_t* GetSourceMesh(r5::v8::mstudiomodel_t* pModel, const int meshIdx, const int sourceMeshIdx)
+{
+	if (g_model.sourceMeshes.empty())
+		return pModel->pMesh(meshIdx);
+
+	return &g_model.sourceMeshes[sourceMeshIdx];
+}
+
+// weight pruning, anything above this many influences needs extra bone weights in the 'simple' layout
+#define MAX_PRUNED_BONES_PER_VERT 3
+
+struct s_weightprunestats_t
+{
+	size_t numVertices; // vertices looked at
+	size_t numPrunedVertices; // vertices that lost at least one influence
+	size_t numDroppedInfluences;
+
+	size_t extraWeightsIn; // extra bone weight entries before pruning
+	size_t extraWeightsOut; // and after
+
+	double errorSum; // sum of per vertex weight error, L1 over all original influences
+	float errorMax;
+};
+
+bool PruneVertexWeights_VVD(const vvd::mstudioboneweight_t& in, vvd::mstudioboneweight_t& out, const vvw::vertexBoneWeightsExtraFileHeader_t* pVVW, const bool extraWeights, s_weightprunestats_t& stats);
+void PruneMeshWeights_VG(char* pVerts, const uint32_t vertCount, const uint32_t vertCacheSize, const uint64_t flags, const vvw::mstudioboneweightextra_t* pExtraWeights, const int extraWeightCount, std::vector<vvw::mstudioboneweightextra_t>& extraWeightsOut, s_weightprunestats_t& stats);
+void AddWeightPruneStats(s_weightprunestats_t& stats, const s_weightprunestats_t& other);
+void PrintWeightPruneStats(const s_weightprunestats_t& stats);
+
+// a mesh's weighted vertices as the bone palette sees them, vertices can be packed or vg::Vertex_t
+struct s_palettemesh_t
+{
+	char* pVerts;
+	uint32_t vertCount;
+	uint32_t vertStride;
+	uint32_t bonesOffset; // offset of mstudiopackedbones_t in a vertex
+
+	vvw::mstudioboneweightextra_t* pExtraWeights; // only set for 'complex' weights
+	int extraWeightCount;
+};
+
+bool MinimizeBonePalette(const std::vector<s_palettemesh_t>& meshes, std::vector<unsigned char>& boneStates);
+bool MinimizeBonePalette_VG(char* pVertexData, char* pExtraWeightData, vg::rev1::MeshHeader_t* pMeshes, const int meshCount, std::vector<unsigned char>& boneStates);
+
+#define OVERDRAW_CACHE_SIZE 16 // fifo post transform cache the reordering is measured against
+#define OVERDRAW_GRID_SIZE 256 // resolution of the views overdraw is rasterized in
+
+// a mesh's triangle list and the vertex positions it indexes, vertices can be packed or vg::Vertex_t
+struct s_overdrawmesh_t
+{
+	uint16_t* pIndices; // reordered in place
+	uint32_t indexCount;
+
+	const char* pVerts;
+	uint32_t vertCount;
+	uint32_t vertStride;
+	bool packedPosition; // Vector64 at the start of each vertex instead of a Vector
+};
+
+struct s_overdrawstats_t
+{
+	size_t meshes;
+	size_t meshesReordered;
+	size_t triangles;
+
+	// summed over six axis views of every mesh, overdraw is shaded / covered
+	uint64_t pixelsCovered;
+	uint64_t pixelsShadedIn;
+	uint64_t pixelsShadedOut;
+
+	// misses in a OVERDRAW_CACHE_SIZE fifo, acmr is misses / triangles
+	uint64_t cacheMissesIn;
+	uint64_t cacheMissesOut;
+};
+
+bool OptimizeMeshOverdraw(const s_overdrawmesh_t& mesh, const float cacheThreshold, s_overdrawstats_t& stats);
+void OptimizeOverdraw(const std::vector<s_overdrawmesh_t>& meshes, const float cacheThreshold);
+void OptimizeOverdraw_VG(char* pIndexData, const char* pVertexData, const vg::rev1::MeshHeader_t* pMeshes, const int meshCount, const float cacheThreshold);
+
+#define LOD_SWITCH_METRIC_SCALE 100.0f // lod metric is this over the pixel height of one unit, same as vtx switch points from $lod
+#define LOD_GRID_CELLS_PER_TRI 2.0f // cells along a surface's longest axis per cube root of its triangles
+#define LOD_GRID_MAX_DIM 128
+
+void ComputeLODSwitchPoints_VG(const char* pIndexData, const char* pVertexData, const vg::rev1::MeshHeader_t* pMeshes, const int meshCount,
+	vg::rev1::ModelLODHeader_t* pLods, const int lodCount, const float pixelError);
+
+// rev1 vg section offsets, sized from the source headers before anything is written so the output is allocated once
+// offsets are relative to a 16 byte aligned buffer, the writers align absolute pointers
+struct s_vglayout_t
+{
+	size_t boneStateChangeOffset;
+	size_t meshOffset;
+	size_t indexOffset;
+	size_t vertOffset;
+	size_t extraBoneWeightOffset;
+	size_t unknownOffset;
+	size_t lodOffset;
+	size_t legacyWeightOffset;
+	size_t stripOffset;
+
+	size_t size;
+};
+
+inline size_t AlignVGOffset(const size_t offset) { return (offset + 15) & ~static_cast<size_t>(15); }
+
+bool CheckVGLayout(const s_vglayout_t& layout, const vg::rev1::VertexGroupHeader_t* pHdr);
+
+// tight model bounds from the root lod's vertex positions
+bool CalcVertexBounds_VVD(const vvd::vertexFileHeader_t* pVVD, Vector& mins, Vector& maxs);
+
+// bone space extents of the vertices each bone dominates (largest weight), from the bind pose
+struct s_boneextents_t
+{
+	std::vector<Vector> mins;
+	std::vector<Vector> maxs;
+	std::vector<uint32_t> vertCounts;
+
+	// the vertices themselves in bone space, grouped by bone: bone i has [firstVert[i], firstVert[i] + vertCounts[i])
+	// bones with several hitboxes fit each one to the vertices near it rather than to the whole bone
+	std::vector<Vector> verts;
+	std::vector<uint32_t> firstVert;
+};
+
+bool CalcBoneExtents_VVD(const vvd::vertexFileHeader_t* pVVD, const std::vector<matrix3x4_t>& poseToBone, s_boneextents_t& extents);
+
+template <typename T>
+inline bool CalcBoneExtents_VVD(const vvd::vertexFileHeader_t* pVVD, const T* pBones, const int numBones, s_boneextents_t& extents)
+{
+	std::vector<matrix3x4_t> poseToBone(numBones);
+	for (int i = 0; i < numBones; i++)
+		poseToBone[i] = pBones[i].poseToBone;
+
+	return CalcBoneExtents_VVD(pVVD, poseToBone, extents);
+}
+
+bool CalcBoneExtents_VG(const char* pVertexData, const vg::rev1::MeshHeader_t* pMeshes, const int meshCount, const vg::rev1::ModelLODHeader_t* pLod,
+	const unsigned char* pBoneStates, const int boneStateCount, const std::vector<matrix3x4_t>& poseToBone, s_boneextents_t& extents, Vector& mins, Vector& maxs);
+
+// replace the sequence, view and bvh boxes of the model being written with ones bounded from its bone extents over every
+// frame of its sequences, run once the sequences are written. the _VVD and _VG versions take the extents from the root lod
+void ApplyTightBounds(const Vector& bindMins, const Vector& bindMaxs, const s_boneextents_t& extents);
+void ApplyTightBounds_VVD(const vvd::vertexFileHeader_t* pVVD);
+void ApplyTightBounds_VG(const char* pVertexData, const vg::rev1::MeshHeader_t* pMeshes, const int meshCount, const vg::rev1::ModelLODHeader_t* pLods, const int lodCount,
+	const unsigned char* pBoneStates, const int boneStateCount);
+
+// one hitbox of a set as the fitting pass sees it, hitboxes with keep cleared are not written
+struct s_hitboxfit_t
+{
+	int bone;
+	int group;
+	Vector bbmin;
+	Vector bbmax;
+	bool keep;
+};
+
+struct s_hitboxfitstats_t
+{
+	int numHitboxes;
+	int numRefit;
+	int numDegenerate; // dropped for having no volume
+	int numMerged; // folded into another hitbox of the same bone and group
+
+	double volumeIn;
+	double volumeOut;
+};
+
+// refits to pBoneExtents with -refithitboxes (bones with too few vertices keep their box), then merges and drops with -mergehitboxes
+void FitHitboxSet(std::vector<s_hitboxfit_t>& hitboxes, const s_boneextents_t* pBoneExtents, s_hitboxfitstats_t& stats);
+void PrintHitboxFitStats(const s_hitboxfitstats_t& stats);
 /* VERTEX HARDWARE DATA end */
 
+// skinrefs the meshes of a converted model can read, columns past this are never looked up
+// meshes index into a family row that starts at skin * numskinref, so only columns no mesh uses can be trimmed
+template <typename T>
+inline int GetUsedSkinRefCount(T* const pHdr)
+{
+	int numUsed = 0;
+	for (int i = 0; i < pHdr->numbodyparts; i++)
+	{
+		auto* const pBodypart = pHdr->pBodypart(i);
+		for (int j = 0; j < pBodypart->nummodels; j++)
+		{
+			auto* const pModel = pBodypart->pModel(j);
+			for (int k = 0; k < pModel->nummeshes; k++)
+				numUsed = max(numUsed, pModel->pMesh(k)->material + 1);
+		}
+	}
+
+	return numUsed;
+}
+
+// with -cullmaterials, finds the textures no mesh reaches through the skin table and fills g_model.textureRemap
+// call once the bodyparts are converted and before the textures are
+void BuildTextureRemap(const short* pOldSkinRef, const int numSkinRef, const int numSkinFamilies, const int numTextures);
+
+inline bool IsTextureCulled(const int index)
+{
+	return !g_model.textureRemap.empty() && g_model.textureRemap[index] < 0;
+}
+
+// writes the skin table at g_model.pData, compacted with -compactskins and renumbered to g_model.textureRemap
+// families receives the source family of every written family, returns the written numskinref
+int WriteSkinTable(const short* pOldSkinRef, const int numSkinRef, const int numSkinFamilies, const int numUsedSkinRef, std::vector<int>& families);
+
+// with -cullbones, removes the bones nothing uses (only when pVVD is given), with -reorderbones, renumbers them depth first.
+// remaps every bone index written so far, call right before WriteStringTable. canRemapVG is false when the conversion won't
+// write the model's vg, which keeps the old bones. rigs keep the source bones since external rseqs index them
+bool RemapBones_V54(const bool canRemapVG, const vvd::vertexFileHeader_t* const pVVD = nullptr);
+
+// remaps vg bone states (the only model bone indices in a vg, vertices index the states) through g_model.boneRemap, then clears it
+void RemapBoneStates(unsigned char* const pBoneStates, const size_t count);
+
+// true when the rmdl conversions rewrite the vg at vgPath instead of copying it or skipping it
+bool CanRemapVGBones(const std::string& vgPath, const bool acceptRev4);
+
 // for converting attachments between normal mdl versions
 // used for: mdl v52/v53 conversions
 static int ConvertAttachmentsToMDL(mstudioattachment_t* pOldAttachments, int numAttachments)
@@ -5455,6 +5951,68 @@ static int ConvertSrcBoneTransforms(mstudiosrcbonetransform_t* pOldBoneTransform
 	ALIGN4(g_model.pData);
 }
 
+// returns the string queued for a string table field, names aren't resolvable until the table is written
+static const char* GetQueuedString(const int* const ptr)
+{
+	for (const stringentry_t& it : g_model.stringTable)
+	{
+		if (it.ptr == ptr)
+			return it.string;
+	}
+
+	return "";
+}
+
+// regenerates the bone by name table (bone ids sorted by name), the engine binary searches it
+// with a case insensitive compare so it has to match the converted bones exactly
+// the source table is only used to report if it was missing or out of order
+// used for: all conversions, bones have to be converted first
+template <typename BoneType, typename HdrType>
+static void WriteBoneTableByName(HdrType* const pHdr, const unsigned char* const pOldBoneTable)
+{
+	const BoneType* const pBones = reinterpret_cast<const BoneType*>((char*)pHdr + pHdr->boneindex);
+	const int numBones = pHdr->numbones;
+
+	std::vector<const char*> boneNames(numBones);
+	for (int i = 0; i < numBones; i++)
+		boneNames[i] = GetQueuedString(&pBones[i].sznameindex);
+
+	auto BoneNameLess = [&boneNames](const unsigned char a, const unsigned char b) { return _stricmp(boneNames[a], boneNames[b]) < 0; };
+
+	unsigned char* const pTable = reinterpret_cast<unsigned char*>(g_model.pData);
+	for (int i = 0; i < numBones; i++)
+		pTable[i] = static_cast<unsigned char>(i);
+
+	std::stable_sort(pTable, pTable + numBones, BoneNameLess);
+
+	if (!pOldBoneTable)
+	{
+		printf("model has no bone name table, generated one...\n");
+	}
+	else
+	{
+		// bones with matching names can be in any order, so check the old one is a sorted permutation instead of comparing bytes
+		std::vector<bool> seen(numBones, false);
+		bool valid = true;
+
+		for (int i = 0; i < numBones && valid; i++)
+		{
+			if (pOldBoneTable[i] >= numBones || seen[pOldBoneTable[i]] || (i > 0 && BoneNameLess(pOldBoneTable[i], pOldBoneTable[i - 1])))
+				valid = false;
+			else
+				seen[pOldBoneTable[i]] = true;
+		}
+
+		if (!valid)
+			printf("bone name table did not match bone names, regenerated...\n");
+	}
+
+	pHdr->bonetablebynameindex = g_model.pData - (char*)pHdr;
+	g_model.pData += numBones;
+
+	ALIGN4(g_model.pData);
+}
+
 // mult by two for: flags and parrents, rot and pos.
 constexpr int boneDataSize = ((sizeof(int) * 2) + (sizeof(Vector) * 2) + sizeof(Quaternion) + sizeof(matrix3x4_t));
 